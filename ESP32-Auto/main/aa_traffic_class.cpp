@@ -0,0 +1,105 @@
+#include <string.h>
+#include "aa_traffic_class.h"
+
+// IP TOS bytes (DSCP << 2); the Wi-Fi driver maps precedence to WMM
+static const uint8_t g_class_tos[AA_TRAFFIC_CLASS_COUNT] = {
+    0x00,   // DSCP 0 (BE)
+    0x88,   // DSCP 34 (AF41)
+    0xC0    // DSCP 48 (CS6)
+};
+
+static const char *g_class_names[AA_TRAFFIC_CLASS_COUNT] = {
+    "best-effort",
+    "audio",
+    "input"
+};
+
+aa_traffic_class_t aa_traffic_class_for_channel(uint8_t channel) {
+    switch (channel) {
+        case AA_CHANNEL_CONTROL:
+        case AA_CHANNEL_INPUT:
+        case AA_CHANNEL_SENSOR:
+            return AA_TRAFFIC_CLASS_INPUT;
+
+        case AA_CHANNEL_MEDIA_AUDIO:
+        case AA_CHANNEL_SPEECH_AUDIO:
+        case AA_CHANNEL_SYSTEM_AUDIO:
+        case AA_CHANNEL_AV_INPUT:
+            return AA_TRAFFIC_CLASS_AUDIO;
+
+        case AA_CHANNEL_VIDEO:
+        case AA_CHANNEL_BLUETOOTH:
+        default:
+            return AA_TRAFFIC_CLASS_BEST_EFFORT;
+    }
+}
+
+uint8_t aa_traffic_class_tos(aa_traffic_class_t traffic_class) {
+    return (traffic_class < AA_TRAFFIC_CLASS_COUNT) ? g_class_tos[traffic_class] : 0;
+}
+
+const char* aa_traffic_class_name(aa_traffic_class_t traffic_class) {
+    return (traffic_class < AA_TRAFFIC_CLASS_COUNT) ? g_class_names[traffic_class] : "unknown";
+}
+
+void aa_frame_scanner_init(aa_frame_scanner_t *scanner) {
+    if (scanner != NULL) {
+        memset(scanner, 0, sizeof(*scanner));
+        scanner->header_size = AA_FRAME_HEADER_SIZE;
+    }
+}
+
+size_t aa_frame_scanner_next(aa_frame_scanner_t *scanner, const uint8_t *data, size_t size,
+                             aa_traffic_class_t *traffic_class) {
+    if (scanner == NULL || data == NULL || size == 0) {
+        return 0;
+    }
+
+    size_t used = 0;
+    bool started = false;   // Class of this run fixed
+
+    while (used < size) {
+        bool in_header = (scanner->remaining == 0);
+
+        if (in_header && scanner->header_len == 0) {
+            // A frame starts here; its channel byte decides the class
+            aa_traffic_class_t next = aa_traffic_class_for_channel(data[used]);
+            if (started && next != scanner->current) {
+                break;
+            }
+            scanner->current = next;
+            scanner->header_size = AA_FRAME_HEADER_SIZE;
+            scanner->frames++;
+        }
+        started = true;
+
+        if (!in_header) {
+            size_t take = size - used;
+            if (take > scanner->remaining) {
+                take = scanner->remaining;
+            }
+            used += take;
+            scanner->remaining -= (uint32_t)take;
+            continue;
+        }
+
+        scanner->header[scanner->header_len++] = data[used++];
+
+        if (scanner->header_len == 2) {
+            uint8_t flags = scanner->header[1];
+            bool multi_first = (flags & AA_FRAME_FLAG_FIRST) && !(flags & AA_FRAME_FLAG_LAST);
+            scanner->header_size = multi_first ? AA_FRAME_EXT_HEADER_SIZE : AA_FRAME_HEADER_SIZE;
+        }
+
+        if (scanner->header_len == scanner->header_size) {
+            // The 16-bit length covers this frame's payload only
+            scanner->remaining = ((uint32_t)scanner->header[2] << 8) | scanner->header[3];
+            scanner->header_len = 0;
+        }
+    }
+
+    if (traffic_class != NULL) {
+        *traffic_class = scanner->current;
+    }
+    return used;
+}
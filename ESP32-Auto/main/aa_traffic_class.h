@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Android Auto traffic classes
+// Frames on the wire start with channel(1) flags(1) length(2, big endian),
+// plus a 4-byte total length on the first fragment of a multi-frame
+// message. The header stays in clear text after the TLS handshake, so the
+// channel of every byte is known without decrypting anything.
+//
+// Only what the dongle sends to the phone is tagged, so the classes order
+// the head unit's traffic: touch, sensors, control and microphone audio.
+// Video flows the other way and is not queued here. What the tagging buys
+// is a shorter contention window for those small frames against the
+// phone's video on the same channel.
+
+// Channel IDs are fixed, in the order head units usually list their
+// services; they are not read from service discovery. A head unit that
+// numbers its channels differently gets bytes in the wrong class, never
+// altered ones.
+typedef enum {
+    AA_CHANNEL_CONTROL = 0,
+    AA_CHANNEL_INPUT = 1,
+    AA_CHANNEL_SENSOR = 2,
+    AA_CHANNEL_VIDEO = 3,
+    AA_CHANNEL_MEDIA_AUDIO = 4,
+    AA_CHANNEL_SPEECH_AUDIO = 5,
+    AA_CHANNEL_SYSTEM_AUDIO = 6,
+    AA_CHANNEL_AV_INPUT = 7,
+    AA_CHANNEL_BLUETOOTH = 8
+} aa_channel_t;
+
+#define AA_FRAME_FLAG_FIRST         0x01
+#define AA_FRAME_FLAG_LAST          0x02
+#define AA_FRAME_HEADER_SIZE        4
+#define AA_FRAME_EXT_HEADER_SIZE    8       // First fragment of a multi-frame message
+
+// Classes map onto WMM access categories through the IP TOS byte
+typedef enum {
+    AA_TRAFFIC_CLASS_BEST_EFFORT = 0,   // Video, Bluetooth, unknown: DSCP 0 -> AC_BE
+    AA_TRAFFIC_CLASS_AUDIO,             // Audio and microphone: AF41 -> AC_VI
+    AA_TRAFFIC_CLASS_INPUT,             // Touch, control, sensors: CS6 -> AC_VO
+    AA_TRAFFIC_CLASS_COUNT
+} aa_traffic_class_t;
+
+aa_traffic_class_t aa_traffic_class_for_channel(uint8_t channel);
+uint8_t aa_traffic_class_tos(aa_traffic_class_t traffic_class);
+const char* aa_traffic_class_name(aa_traffic_class_t traffic_class);
+
+// Frame scanner
+// Follows frame boundaries across arbitrary reads and splits a buffer into
+// runs whose bytes all belong to one traffic class. A corrupt length only
+// mis-tags bytes until the stream ends; nothing is dropped or altered.
+typedef struct {
+    uint8_t header[AA_FRAME_EXT_HEADER_SIZE];
+    uint8_t header_len;             // Header bytes seen of the current frame
+    uint8_t header_size;            // 4 or 8 once the flags are known
+    uint32_t remaining;             // Payload bytes left in the current frame
+    aa_traffic_class_t current;     // Class of the current frame
+    uint32_t frames;                // Frames started
+} aa_frame_scanner_t;
+
+void aa_frame_scanner_init(aa_frame_scanner_t *scanner);
+// Consumes the longest prefix of data that is one class; returns its length
+size_t aa_frame_scanner_next(aa_frame_scanner_t *scanner, const uint8_t *data, size_t size,
+                             aa_traffic_class_t *traffic_class);
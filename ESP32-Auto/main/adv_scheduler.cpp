@@ -0,0 +1,81 @@
+#include <string.h>
+#include "adv_scheduler.h"
+
+// Indexed by adv_mode_t
+static const adv_mode_params_t g_mode_params[ADV_MODE_COUNT] = {
+    { "off",  0,     0 },
+    { "slow", 0x640, 0x780 },      // 1000-1200 ms
+    { "fast", 0x20,  0x40 },       // 20-40 ms
+};
+
+const adv_mode_params_t* adv_mode_params(adv_mode_t mode) {
+    return &g_mode_params[(mode < ADV_MODE_COUNT) ? mode : ADV_MODE_OFF];
+}
+
+adv_mode_t adv_scheduler_policy(conn_state_t state, bool peer_connected, int64_t time_in_state_us) {
+    // A connected phone is served over GATT; the controller stops advertising anyway
+    if (peer_connected || state == CONN_STATE_STREAMING) {
+        return ADV_MODE_OFF;
+    }
+
+    // Leaving STREAMING lands here with time_in_state_us reset, so a
+    // lost session is fast again straight away
+    return (time_in_state_us < ADV_FAST_WINDOW_US) ? ADV_MODE_FAST : ADV_MODE_SLOW;
+}
+
+// Mean time between advertising events in a mode; 0 when off
+static int64_t adv_mode_period_us(adv_mode_t mode) {
+    const adv_mode_params_t *params = adv_mode_params(mode);
+    if (params->interval_max == 0) {
+        return 0;
+    }
+    return ((int64_t)params->interval_min + params->interval_max) * 625 / 2 + ADV_DELAY_AVG_US;
+}
+
+void adv_airtime_init(adv_airtime_t *airtime, int64_t now_us) {
+    if (airtime != NULL) {
+        memset(airtime, 0, sizeof(*airtime));
+        airtime->mode = ADV_MODE_OFF;
+        airtime->mode_since_us = now_us;
+        airtime->start_us = now_us;
+    }
+}
+
+void adv_airtime_set_mode(adv_airtime_t *airtime, adv_mode_t mode, int64_t now_us) {
+    if (airtime == NULL || mode >= ADV_MODE_COUNT || mode == airtime->mode) {
+        return;
+    }
+
+    airtime->time_in_mode_us[airtime->mode] += now_us - airtime->mode_since_us;
+    airtime->mode = mode;
+    airtime->mode_since_us = now_us;
+    airtime->mode_changes++;
+}
+
+void adv_airtime_get_stats(const adv_airtime_t *airtime, int64_t now_us, adv_airtime_stats_t *stats) {
+    if (airtime == NULL || stats == NULL) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->mode = airtime->mode;
+    stats->mode_changes = airtime->mode_changes;
+    memcpy(stats->time_in_mode_us, airtime->time_in_mode_us, sizeof(stats->time_in_mode_us));
+    stats->time_in_mode_us[airtime->mode] += now_us - airtime->mode_since_us;
+
+    // Summed per mode, so rounding does not build up over mode changes
+    int64_t events = 0;
+    for (int mode = 0; mode < ADV_MODE_COUNT; mode++) {
+        int64_t period = adv_mode_period_us((adv_mode_t)mode);
+        if (period > 0) {
+            events += stats->time_in_mode_us[mode] / period;
+        }
+    }
+    stats->events = (uint32_t)events;
+
+    int64_t period = adv_mode_period_us(airtime->mode);
+    stats->rate_x10 = (period > 0) ? (uint32_t)(10000000LL / period) : 0;
+
+    int64_t elapsed = now_us - airtime->start_us;
+    stats->avg_rate_x10 = (elapsed > 0) ? (uint32_t)(events * 10000000LL / elapsed) : 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+#include "connection_fsm.h"
+
+// BLE advertising scheduler
+// The S3 has one 2.4 GHz radio; every advertising event is airtime Wi-Fi
+// does not get. Advertise fast only while a phone may be looking for us,
+// slow when nobody came for a while, and not at all while streaming.
+// Pure logic: the connection manager applies the policy, the Bluetooth
+// manager accounts for the time actually spent advertising in each mode.
+
+typedef enum {
+    ADV_MODE_OFF = 0,
+    ADV_MODE_SLOW,
+    ADV_MODE_FAST,
+    ADV_MODE_COUNT
+} adv_mode_t;
+
+typedef struct {
+    const char *name;
+    uint16_t interval_min;          // 0.625 ms units
+    uint16_t interval_max;
+} adv_mode_params_t;
+
+#define ADV_FAST_WINDOW_US          (30 * 1000000LL)    // Fast advertising after a state change
+#define ADV_DELAY_AVG_US            5000                // Mean of the 0-10 ms random advDelay
+
+typedef struct {
+    adv_mode_t mode;
+    int64_t mode_since_us;
+    int64_t time_in_mode_us[ADV_MODE_COUNT];    // Closed spans only
+    uint32_t mode_changes;
+    int64_t start_us;
+} adv_airtime_t;
+
+typedef struct {
+    adv_mode_t mode;
+    int64_t time_in_mode_us[ADV_MODE_COUNT];
+    uint32_t mode_changes;
+    uint32_t events;                // Advertising events since init, estimated
+    uint32_t rate_x10;              // Events per second in the current mode, x10
+    uint32_t avg_rate_x10;          // Events per second since init, x10
+} adv_airtime_stats_t;
+
+const adv_mode_params_t* adv_mode_params(adv_mode_t mode);
+// Mode for a connection state; time_in_state_us since the state was entered
+adv_mode_t adv_scheduler_policy(conn_state_t state, bool peer_connected, int64_t time_in_state_us);
+
+// Airtime accounting
+void adv_airtime_init(adv_airtime_t *airtime, int64_t now_us);
+void adv_airtime_set_mode(adv_airtime_t *airtime, adv_mode_t mode, int64_t now_us);
+void adv_airtime_get_stats(const adv_airtime_t *airtime, int64_t now_us, adv_airtime_stats_t *stats);
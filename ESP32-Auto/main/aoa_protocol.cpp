@@ -2,27 +2,26 @@
 #include "string.h"
 #include "common.h"
 #include "usb_gadget.h"
+#include "aoa_protocol.h"
+#include "device_identity.h"
 
 static const char *TAG = "AOA_PROTOCOL";
 
-// AOA Protocol State
-typedef enum {
-    AOA_STATE_DISCONNECTED = 0,
-    AOA_STATE_CONNECTED,
-    AOA_STATE_DETECTING,
-    AOA_STATE_NEGOTIATING,
-    AOA_STATE_SENDING_STRINGS,
-    AOA_STATE_STARTING_ACCESSORY,
-    AOA_STATE_ACCESSORY_MODE
-} aoa_state_t;
-
 static aoa_state_t g_aoa_state = AOA_STATE_DISCONNECTED;
 static bool g_is_accessory_mode = false;
-static device_info_t g_current_device_info = {0};
+static const device_identity_t *g_identity = NULL;
 static uint16_t g_aoa_protocol_version = 0;
 
-// Default device information
-static const device_info_t g_default_device_info = {
+// Audio mode we ask for, and the mode actually in effect once negotiated.
+// The gadget describes no USB audio-class interface, so the audio PIDs
+// (0x2D02-0x2D05) would promise endpoints the head unit cannot find;
+// audio stays off and the accessory always enumerates as 0x2D00.
+static aoa_audio_mode_t g_requested_audio_mode = AOA_AUDIO_MODE_NONE;
+static aoa_audio_mode_t g_aoa_audio_mode = AOA_AUDIO_MODE_NONE;
+
+// Default device information, used until aoa_set_device_identity()
+static device_identity_t g_default_identity;
+static const device_identity_config_t g_default_device_info = {
     .manufacturer = "DIY Wireless Dongle",
     .model = "ESP32-AA-Dongle",
     .description = "ESP32 Wireless Android Auto Dongle",
@@ -35,7 +34,8 @@ static const device_info_t g_default_device_info = {
 static status_t aoa_handle_get_protocol(uint16_t *protocol_version);
 static status_t aoa_handle_send_string(uint8_t string_index, const char *string);
 static status_t aoa_handle_start_accessory(void);
-static status_t aoa_send_string(uint8_t string_index, const char *string);
+static status_t aoa_handle_audio_support(uint16_t mode);
+static status_t aoa_send_string(uint8_t string_index, const char *string, size_t string_len);
 
 status_t aoa_init(void) {
     ESP_LOGI(TAG, "Initializing Android Open Accessory Protocol");
@@ -43,9 +43,13 @@ status_t aoa_init(void) {
     g_aoa_state = AOA_STATE_DISCONNECTED;
     g_is_accessory_mode = false;
     g_aoa_protocol_version = 0;
+    g_aoa_audio_mode = AOA_AUDIO_MODE_NONE;
     
     // Set default device information
-    memcpy(&g_current_device_info, &g_default_device_info, sizeof(device_info_t));
+    if (g_identity == NULL) {
+        device_identity_build(&g_default_identity, &g_default_device_info);
+        g_identity = &g_default_identity;
+    }
     
     ESP_LOGI(TAG, "AOA protocol initialized");
     return STATUS_OK;
@@ -79,15 +83,6 @@ static status_t aoa_handle_send_string(uint8_t string_index, const char *string)
         g_aoa_state = AOA_STATE_SENDING_STRINGS;
     }
     
-    const char *supported_strings[] = {
-        g_current_device_info.manufacturer,
-        g_current_device_info.model,
-        g_current_device_info.description,
-        g_current_device_info.version,
-        g_current_device_info.uri,
-        g_current_device_info.serial
-    };
-    
     if (string_index < 6 && string != NULL) {
         // Update our device info with received string (if valid)
         if (string_index < 6) {
@@ -121,14 +116,33 @@ static status_t aoa_handle_start_accessory(void) {
     return STATUS_OK;
 }
 
-static status_t aoa_send_string(uint8_t string_index, const char *string) {
+static status_t aoa_handle_audio_support(uint16_t mode) {
+    ESP_LOGI(TAG, "AOA_AUDIO_SUPPORT request: mode=%d", mode);
+    
+    // Audio mode selection was added in AOA protocol version 2
+    if (g_aoa_protocol_version < 2) {
+        ESP_LOGW(TAG, "AOA_AUDIO_SUPPORT requires protocol version 2 (have %d)", g_aoa_protocol_version);
+        return STATUS_ERROR_PROTOCOL;
+    }
+    
+    // Only "no audio" can be honoured without an audio-class interface
+    if (mode != AOA_AUDIO_MODE_NONE) {
+        ESP_LOGW(TAG, "Unsupported AOA audio mode: %d", mode);
+        return STATUS_ERROR_PROTOCOL;
+    }
+    
+    g_aoa_audio_mode = AOA_AUDIO_MODE_NONE;
+    ESP_LOGI(TAG, "AOA audio disabled");
+    return STATUS_OK;
+}
+
+static status_t aoa_send_string(uint8_t string_index, const char *string, size_t string_len) {
     if (string == NULL) {
         return STATUS_ERROR_PROTOCOL;
     }
     
     ESP_LOGD(TAG, "Sending string %d: %s", string_index, string);
     
-    size_t string_len = strlen(string);
     if (string_len > 255) {
         string_len = 255;  // Limit string length
     }
@@ -150,9 +164,10 @@ static status_t aoa_send_string(uint8_t string_index, const char *string) {
 
 status_t aoa_start_accessory_mode(void) {
     ESP_LOGI(TAG, "Starting Android Accessory Mode");
-    ESP_LOGI(TAG, "Device: %s %s", g_current_device_info.manufacturer, g_current_device_info.model);
-    ESP_LOGI(TAG, "Description: %s", g_current_device_info.description);
-    ESP_LOGI(TAG, "Version: %s", g_current_device_info.version);
+    ESP_LOGI(TAG, "Device: %s %s", device_identity_get(g_identity, DEVICE_IDENTITY_MANUFACTURER),
+             device_identity_get(g_identity, DEVICE_IDENTITY_MODEL));
+    ESP_LOGI(TAG, "Description: %s", device_identity_get(g_identity, DEVICE_IDENTITY_DESCRIPTION));
+    ESP_LOGI(TAG, "Version: %s", device_identity_get(g_identity, DEVICE_IDENTITY_VERSION));
     
     // Change USB PID to accessory mode
     status_t ret = usb_set_device_descriptor(AOA_VID, AOA_PID_ACCESSORY);
@@ -167,20 +182,21 @@ status_t aoa_start_accessory_mode(void) {
     return STATUS_OK;
 }
 
-status_t aoa_set_device_info(const device_info_t *device_info) {
-    if (device_info == NULL) {
+status_t aoa_set_device_identity(const device_identity_t *identity) {
+    if (identity == NULL) {
         return STATUS_ERROR_PROTOCOL;
     }
     
     ESP_LOGI(TAG, "Setting device info:");
-    ESP_LOGI(TAG, "  Manufacturer: %s", device_info->manufacturer);
-    ESP_LOGI(TAG, "  Model: %s", device_info->model);
-    ESP_LOGI(TAG, "  Description: %s", device_info->description);
-    ESP_LOGI(TAG, "  Version: %s", device_info->version);
-    ESP_LOGI(TAG, "  URI: %s", device_info->uri);
-    ESP_LOGI(TAG, "  Serial: %s", device_info->serial);
+    ESP_LOGI(TAG, "  Manufacturer: %s", device_identity_get(identity, DEVICE_IDENTITY_MANUFACTURER));
+    ESP_LOGI(TAG, "  Model: %s", device_identity_get(identity, DEVICE_IDENTITY_MODEL));
+    ESP_LOGI(TAG, "  Description: %s", device_identity_get(identity, DEVICE_IDENTITY_DESCRIPTION));
+    ESP_LOGI(TAG, "  Version: %s", device_identity_get(identity, DEVICE_IDENTITY_VERSION));
+    ESP_LOGI(TAG, "  URI: %s", device_identity_get(identity, DEVICE_IDENTITY_URI));
+    ESP_LOGI(TAG, "  Serial: %s", device_identity_get(identity, DEVICE_IDENTITY_SERIAL));
     
-    memcpy(&g_current_device_info, device_info, sizeof(device_info_t));
+    // Shared, not copied; the identity must outlive the AOA session
+    g_identity = identity;
     
     return STATUS_OK;
 }
@@ -193,6 +209,23 @@ aoa_state_t aoa_get_state(void) {
     return g_aoa_state;
 }
 
+status_t aoa_set_audio_mode(aoa_audio_mode_t mode) {
+    if (mode != AOA_AUDIO_MODE_NONE) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+    
+    g_requested_audio_mode = mode;
+    return STATUS_OK;
+}
+
+aoa_audio_mode_t aoa_get_audio_mode(void) {
+    return g_aoa_audio_mode;
+}
+
+uint16_t aoa_get_protocol_version(void) {
+    return g_aoa_protocol_version;
+}
+
 status_t aoa_handle_control_request(uint8_t bmRequestType, uint8_t bRequest, 
                                  uint16_t wValue, uint16_t wIndex, 
                                  uint8_t *data, size_t length) {
@@ -237,8 +270,7 @@ status_t aoa_handle_control_request(uint8_t bmRequestType, uint8_t bRequest,
             break;
             
         case AOA_CMD_AUDIO_SUPPORT:
-            ESP_LOGD(TAG, "AOA_AUDIO_SUPPORT not implemented");
-            break;
+            return aoa_handle_audio_support(wValue);
             
         default:
             ESP_LOGW(TAG, "Unknown AOA request: 0x%02X", bRequest);
@@ -287,17 +319,10 @@ status_t aoa_negotiate_accessory_mode(void) {
     g_aoa_state = AOA_STATE_SENDING_STRINGS;
     
     // Step 2: Send device strings
-    const char *strings[] = {
-        g_current_device_info.manufacturer,
-        g_current_device_info.model,
-        g_current_device_info.description,
-        g_current_device_info.version,
-        g_current_device_info.uri,
-        g_current_device_info.serial
-    };
-    
-    for (int i = 0; i < 6; i++) {
-        status_t ret = aoa_send_string(i, strings[i]);
+    for (int i = 0; i < DEVICE_IDENTITY_FIELD_COUNT; i++) {
+        device_identity_field_t field = (device_identity_field_t)i;
+        status_t ret = aoa_send_string(i, device_identity_get(g_identity, field),
+                                       device_identity_length(g_identity, field));
         if (ret != STATUS_OK) {
             ESP_LOGE(TAG, "Failed to send string %d", i);
             g_aoa_state = AOA_STATE_CONNECTED;
@@ -306,9 +331,31 @@ status_t aoa_negotiate_accessory_mode(void) {
         vTaskDelay(pdMS_TO_TICKS(10));  // Small delay between strings
     }
     
+    // Step 3: Request the audio interface (AOA 2.0); must precede START_ACCESSORY
+    g_aoa_audio_mode = AOA_AUDIO_MODE_NONE;
+    if (g_aoa_protocol_version >= 2 && g_requested_audio_mode != AOA_AUDIO_MODE_NONE) {
+        ret = usb_control_transfer(
+            USB_REQ_TYPE_VENDOR | USB_REQ_TYPE_RECIPIENT_DEVICE,
+            AOA_CMD_AUDIO_SUPPORT,
+            g_requested_audio_mode,
+            0,
+            NULL,
+            0,
+            &transferred
+        );
+        
+        if (ret == ESP_OK) {
+            g_aoa_audio_mode = g_requested_audio_mode;
+            ESP_LOGI(TAG, "AOA audio mode %d requested", g_aoa_audio_mode);
+        } else {
+            // Audio is optional; carry on without it
+            ESP_LOGW(TAG, "Failed to request AOA audio mode, continuing without audio");
+        }
+    }
+    
     g_aoa_state = AOA_STATE_STARTING_ACCESSORY;
     
-    // Step 3: Send START_ACCESSORY request
+    // Step 4: Send START_ACCESSORY request
     ret = usb_control_transfer(
         USB_REQ_TYPE_VENDOR | USB_REQ_TYPE_RECIPIENT_DEVICE,
         AOA_CMD_START_ACCESSORY,
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+#include "device_identity.h"
+
+// AOA Protocol State
+typedef enum {
+    AOA_STATE_DISCONNECTED = 0,
+    AOA_STATE_CONNECTED,
+    AOA_STATE_DETECTING,
+    AOA_STATE_NEGOTIATING,
+    AOA_STATE_SENDING_STRINGS,
+    AOA_STATE_STARTING_ACCESSORY,
+    AOA_STATE_ACCESSORY_MODE
+} aoa_state_t;
+
+// AOA 2.0 audio modes (wValue of AOA_CMD_AUDIO_SUPPORT)
+typedef enum {
+    AOA_AUDIO_MODE_NONE = 0,
+    AOA_AUDIO_MODE_PCM_16BIT_44100_STEREO = 1
+} aoa_audio_mode_t;
+
+// AOA Protocol Functions
+status_t aoa_init(void);
+status_t aoa_start_accessory_mode(void);
+status_t aoa_set_device_identity(const device_identity_t *identity);
+status_t aoa_negotiate_accessory_mode(void);
+status_t aoa_handle_control_request(uint8_t bmRequestType, uint8_t bRequest,
+                                    uint16_t wValue, uint16_t wIndex,
+                                    uint8_t *data, size_t length);
+bool aoa_is_accessory_mode(void);
+aoa_state_t aoa_get_state(void);
+
+// Audio negotiation (AOA protocol version 2 and later)
+status_t aoa_set_audio_mode(aoa_audio_mode_t mode);
+aoa_audio_mode_t aoa_get_audio_mode(void);
+uint16_t aoa_get_protocol_version(void);
@@ -1,4 +1,8 @@
+#include <string.h>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_bt.h"
 #include "esp_bt_main.h"
 #include "esp_bt_device.h"
@@ -6,10 +10,85 @@
 #include "esp_gap_ble_api.h"
 #include "esp_bluedroid.h"
 #include "common.h"
+#include "bluetooth_manager.h"
 
 static const char *TAG = "BLUETOOTH_MANAGER";
 static bool g_is_bluetooth_active = false;
 static bool g_is_advertising = false;
+static bluetooth_event_cb_t g_event_callback = NULL;
+static void *g_event_ctx = NULL;
+static esp_bd_addr_t g_peer_addr;
+static bool g_has_peer = false;
+static uint8_t g_service_uuid[16];
+static bool g_has_service_uuid = false;
+static bool g_peer_connected = false;
+static bool g_peer_secure = false;
+
+// Advertising mode and the airtime it has used; updated from the GAP callback
+static adv_mode_t g_adv_mode = ADV_MODE_FAST;
+static adv_airtime_t g_airtime;
+static StaticSemaphore_t g_airtime_mutex_buffer;
+static SemaphoreHandle_t g_airtime_mutex = NULL;
+
+static esp_gatts_cb_t g_gatts_handlers[BLUETOOTH_MAX_GATTS_HANDLERS];
+static int g_gatts_handler_count = 0;
+
+static void bluetooth_notify(bluetooth_event_t event) {
+    if (g_event_callback != NULL) {
+        g_event_callback(event, g_event_ctx);
+    }
+}
+
+static void bluetooth_account_airtime(adv_mode_t mode) {
+    if (g_airtime_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(g_airtime_mutex, portMAX_DELAY);
+    adv_airtime_set_mode(&g_airtime, mode, esp_timer_get_time());
+    xSemaphoreGive(g_airtime_mutex);
+}
+
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                                esp_ble_gatts_cb_param_t *param) {
+    for (int i = 0; i < g_gatts_handler_count; i++) {
+        g_gatts_handlers[i](event, gatts_if, param);
+    }
+}
+
+// The bootstrap offer carries the hotspot key, so its characteristics need
+// an encrypted link, and the key for that comes from bonding with LE Secure
+// Connections only. The dongle has no display or buttons, so the phone
+// confirms the pairing on its side.
+static status_t bluetooth_set_security(void) {
+    esp_ble_auth_req_t auth_req = ESP_LE_AUTH_REQ_SC_BOND;
+    esp_ble_io_cap_t io_cap = ESP_IO_CAP_NONE;
+    uint8_t key_size = 16;
+    uint8_t init_key = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
+    uint8_t rsp_key = ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK;
+    uint8_t only_specified = ESP_BLE_ONLY_ACCEPT_SPECIFIED_AUTH_ENABLE;
+    
+    const struct {
+        esp_ble_sm_param_t param;
+        void *value;
+        uint8_t size;
+    } params[] = {
+        { ESP_BLE_SM_AUTHEN_REQ_MODE, &auth_req, sizeof(auth_req) },
+        { ESP_BLE_SM_IOCAP_MODE, &io_cap, sizeof(io_cap) },
+        { ESP_BLE_SM_MAX_KEY_SIZE, &key_size, sizeof(key_size) },
+        { ESP_BLE_SM_SET_INIT_KEY, &init_key, sizeof(init_key) },
+        { ESP_BLE_SM_SET_RSP_KEY, &rsp_key, sizeof(rsp_key) },
+        { ESP_BLE_SM_ONLY_ACCEPT_SPECIFIED_SEC_AUTH, &only_specified, sizeof(only_specified) },
+    };
+    
+    for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); i++) {
+        esp_err_t ret = esp_ble_gap_set_security_param(params[i].param, params[i].value, params[i].size);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set security parameter %d: %s", params[i].param, esp_err_to_name(ret));
+            return STATUS_ERROR_INIT;
+        }
+    }
+    return STATUS_OK;
+}
 
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
     switch (event) {
@@ -24,15 +103,36 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
         case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
             g_is_advertising = (param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS);
             ESP_LOGI(TAG, "BLE advertising %s", g_is_advertising ? "started" : "failed to start");
+            bluetooth_account_airtime(g_is_advertising ? g_adv_mode : ADV_MODE_OFF);
+            bluetooth_notify(g_is_advertising ? BLUETOOTH_EVENT_ADV_STARTED : BLUETOOTH_EVENT_ADV_FAILED);
             break;
             
         case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
             g_is_advertising = false;
             ESP_LOGI(TAG, "BLE advertising stopped");
+            bluetooth_account_airtime(ADV_MODE_OFF);
+            bluetooth_notify(BLUETOOTH_EVENT_ADV_STOPPED);
             break;
             
         case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
             ESP_LOGI(TAG, "BLE connection parameters updated");
+            memcpy(g_peer_addr, param->update_conn_params.bda, sizeof(g_peer_addr));
+            g_has_peer = true;
+            break;
+            
+        case ESP_GAP_BLE_SEC_REQ_EVT:
+            esp_ble_gap_security_rsp(param->ble_security.ble_req.bd_addr, true);
+            break;
+            
+        case ESP_GAP_BLE_AUTH_CMPL_EVT:
+            // Also reported when a bonded phone reconnects with its stored key
+            g_peer_secure = param->ble_security.auth_cmpl.success &&
+                            (param->ble_security.auth_cmpl.auth_mode & ESP_LE_AUTH_BOND);
+            if (g_peer_secure) {
+                ESP_LOGI(TAG, "BLE link encrypted (auth mode %d)", param->ble_security.auth_cmpl.auth_mode);
+            } else {
+                ESP_LOGW(TAG, "BLE pairing failed or not bonded: 0x%x", param->ble_security.auth_cmpl.fail_reason);
+            }
             break;
             
         default:
@@ -80,6 +180,12 @@ status_t bluetooth_init(void) {
         return STATUS_ERROR_INIT;
     }
     
+    g_airtime_mutex = xSemaphoreCreateMutexStatic(&g_airtime_mutex_buffer);
+    if (g_airtime_mutex == NULL) {
+        return STATUS_ERROR_MEMORY;
+    }
+    adv_airtime_init(&g_airtime, esp_timer_get_time());
+    
     // Register GAP callback
     ret = esp_ble_gap_register_callback(gap_event_handler);
     if (ret != ESP_OK) {
@@ -87,6 +193,16 @@ status_t bluetooth_init(void) {
         return STATUS_ERROR_INIT;
     }
     
+    ret = esp_ble_gatts_register_callback(gatts_event_handler);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GATTS callback: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+    
+    if (bluetooth_set_security() != STATUS_OK) {
+        return STATUS_ERROR_INIT;
+    }
+    
     // Set device name
     ret = esp_bt_dev_set_device_name("ESP32-AA-Dongle");
     if (ret != ESP_OK) {
@@ -111,12 +227,19 @@ status_t bluetooth_start_advertising(void) {
         return STATUS_OK;
     }
     
-    ESP_LOGI(TAG, "Starting Bluetooth advertising");
+    if (g_adv_mode == ADV_MODE_OFF) {
+        ESP_LOGD(TAG, "Advertising is off");
+        return STATUS_OK;
+    }
+    
+    const adv_mode_params_t *mode = adv_mode_params(g_adv_mode);
+    ESP_LOGI(TAG, "Starting Bluetooth advertising (%s)", mode->name);
     
     // Set advertisement data
+    // 31 bytes hold the flags, TX power and a 128-bit UUID, but not the name too
     esp_ble_adv_data_t adv_data = {
         .set_scan_rsp = false,
-        .include_name = true,
+        .include_name = !g_has_service_uuid,
         .include_txpower = true,
         .min_interval = 0x20,    // 20ms
         .max_interval = 0x40,    // 40ms
@@ -125,8 +248,8 @@ status_t bluetooth_start_advertising(void) {
         .p_manufacturer_data = NULL,
         .service_data_len = 0,
         .p_service_data = NULL,
-        .service_uuid_len = 0,
-        .p_service_uuid = NULL,
+        .service_uuid_len = (uint16_t)(g_has_service_uuid ? sizeof(g_service_uuid) : 0),
+        .p_service_uuid = g_has_service_uuid ? g_service_uuid : NULL,
         .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
     };
     
@@ -161,8 +284,8 @@ status_t bluetooth_start_advertising(void) {
     
     // Set advertising parameters
     esp_ble_adv_params_t adv_params = {
-        .adv_int_min = 0x20,      // 20ms
-        .adv_int_max = 0x40,      // 40ms
+        .adv_int_min = mode->interval_min,
+        .adv_int_max = mode->interval_max,
         .adv_type = ADV_TYPE_IND,
         .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
         .peer_addr_type = BLE_ADDR_TYPE_PUBLIC,
@@ -213,6 +336,7 @@ status_t bluetooth_deinit(void) {
     
     g_is_bluetooth_active = false;
     g_is_advertising = false;
+    bluetooth_account_airtime(ADV_MODE_OFF);
     
     ESP_LOGI(TAG, "Bluetooth deinitialized");
     return STATUS_OK;
@@ -224,4 +348,99 @@ bool bluetooth_is_active(void) {
 
 bool bluetooth_is_advertising(void) {
     return g_is_advertising;
+}
+
+void bluetooth_set_event_callback(bluetooth_event_cb_t callback, void *ctx) {
+    g_event_callback = callback;
+    g_event_ctx = ctx;
+}
+
+bool bluetooth_get_peer_address(uint8_t addr[6]) {
+    if (!g_has_peer) {
+        return false;
+    }
+    memcpy(addr, g_peer_addr, sizeof(g_peer_addr));
+    return true;
+}
+
+bool bluetooth_is_peer_secure(void) {
+    return g_peer_connected && g_peer_secure;
+}
+
+void bluetooth_set_service_uuid(const uint8_t uuid[16]) {
+    memcpy(g_service_uuid, uuid, sizeof(g_service_uuid));
+    g_has_service_uuid = true;
+}
+
+void bluetooth_handle_connection(bool connected, const uint8_t addr[6]) {
+    if (connected) {
+        // The controller stops connectable advertising on connect
+        memcpy(g_peer_addr, addr, sizeof(g_peer_addr));
+        g_has_peer = true;
+        g_peer_connected = true;
+        g_peer_secure = false;
+        g_is_advertising = false;
+        bluetooth_account_airtime(ADV_MODE_OFF);
+        ESP_LOGI(TAG, "BLE peer connected");
+
+        // Pair (or encrypt with the bond) before the phone asks for the offer
+        esp_err_t ret = esp_ble_set_encryption(g_peer_addr, ESP_BLE_SEC_ENCRYPT);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to start encryption: %s", esp_err_to_name(ret));
+        }
+        bluetooth_notify(BLUETOOTH_EVENT_CONNECTED);
+        return;
+    }
+
+    g_peer_connected = false;
+    g_peer_secure = false;
+    ESP_LOGI(TAG, "BLE peer disconnected");
+    bluetooth_notify(BLUETOOTH_EVENT_DISCONNECTED);
+    if (g_is_bluetooth_active) {
+        bluetooth_start_advertising();
+    }
+}
+
+status_t bluetooth_set_adv_mode(adv_mode_t mode) {
+    if (mode >= ADV_MODE_COUNT) {
+        return STATUS_ERROR_INIT;
+    }
+    if (mode == g_adv_mode) {
+        return STATUS_OK;
+    }
+    
+    ESP_LOGI(TAG, "Advertising mode %s -> %s", adv_mode_params(g_adv_mode)->name, adv_mode_params(mode)->name);
+    g_adv_mode = mode;
+    
+    if (!g_is_bluetooth_active || g_peer_connected) {
+        return STATUS_OK;  // Applied when advertising next starts
+    }
+    
+    // New intervals only take effect on a fresh start
+    status_t ret = bluetooth_stop_advertising();
+    if (ret != STATUS_OK || mode == ADV_MODE_OFF) {
+        return ret;
+    }
+    return bluetooth_start_advertising();
+}
+
+adv_mode_t bluetooth_get_adv_mode(void) {
+    return g_adv_mode;
+}
+
+void bluetooth_get_adv_stats(adv_airtime_stats_t *stats) {
+    if (stats == NULL || g_airtime_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(g_airtime_mutex, portMAX_DELAY);
+    adv_airtime_get_stats(&g_airtime, esp_timer_get_time(), stats);
+    xSemaphoreGive(g_airtime_mutex);
+}
+
+status_t bluetooth_register_gatts_handler(esp_gatts_cb_t handler) {
+    if (handler == NULL || g_gatts_handler_count >= BLUETOOTH_MAX_GATTS_HANDLERS) {
+        return STATUS_ERROR_INIT;
+    }
+    g_gatts_handlers[g_gatts_handler_count++] = handler;
+    return STATUS_OK;
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_gatts_api.h"
+#include "common.h"
+#include "adv_scheduler.h"
+
+// Bluetooth events reported to the connection manager
+typedef enum {
+    BLUETOOTH_EVENT_ADV_STARTED = 0,
+    BLUETOOTH_EVENT_ADV_FAILED,
+    BLUETOOTH_EVENT_ADV_STOPPED,
+    BLUETOOTH_EVENT_CONNECTED,
+    BLUETOOTH_EVENT_DISCONNECTED
+} bluetooth_event_t;
+
+typedef void (*bluetooth_event_cb_t)(bluetooth_event_t event, void *ctx);
+
+// Bluetooth functions
+status_t bluetooth_init(void);
+status_t bluetooth_start_advertising(void);
+status_t bluetooth_stop_advertising(void);
+status_t bluetooth_deinit(void);
+bool bluetooth_is_active(void);
+bool bluetooth_is_advertising(void);
+void bluetooth_set_event_callback(bluetooth_event_cb_t callback, void *ctx);
+// Address of the last connected BLE peer; false if none has connected
+bool bluetooth_get_peer_address(uint8_t addr[6]);
+// Link to the connected peer is encrypted with a bonded key
+bool bluetooth_is_peer_secure(void);
+// Advertise a 128-bit service UUID; the name moves to the scan response
+void bluetooth_set_service_uuid(const uint8_t uuid[16]);
+// Called by GATT services on connect and disconnect; advertising resumes on disconnect
+void bluetooth_handle_connection(bool connected, const uint8_t addr[6]);
+// Advertising interval; OFF stops advertising until another mode is set
+status_t bluetooth_set_adv_mode(adv_mode_t mode);
+adv_mode_t bluetooth_get_adv_mode(void);
+// Time spent advertising in each mode and the resulting event rate
+void bluetooth_get_adv_stats(adv_airtime_stats_t *stats);
+// Bluedroid takes a single GATTS callback; services register here instead
+// and filter events on their own gatts_if
+#define BLUETOOTH_MAX_GATTS_HANDLERS 4
+status_t bluetooth_register_gatts_handler(esp_gatts_cb_t handler);
\ No newline at end of file
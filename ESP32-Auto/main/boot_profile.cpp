@@ -0,0 +1,78 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "boot_profile.h"
+
+static const char *TAG = "BOOT_PROFILE";
+
+// Phases are written by their own init task and read after they finish, so
+// each record has a single writer.
+static boot_timeline_t g_timeline;
+
+static const char *g_phase_names[BOOT_PHASE_COUNT] = {
+    "nvs",
+    "wifi",
+    "bluetooth",
+    "usb",
+    "proxy",
+    "ready",
+    "session"
+};
+
+void boot_profile_start(void) {
+    memset(&g_timeline, 0, sizeof(g_timeline));
+    g_timeline.app_main_us = esp_timer_get_time();
+}
+
+void boot_profile_begin(boot_phase_t phase) {
+    if (phase < BOOT_PHASE_COUNT) {
+        g_timeline.phases[phase].start_us = esp_timer_get_time();
+        g_timeline.phases[phase].end_us = 0;
+    }
+}
+
+void boot_profile_end(boot_phase_t phase, status_t result) {
+    if (phase < BOOT_PHASE_COUNT) {
+        g_timeline.phases[phase].end_us = esp_timer_get_time();
+        g_timeline.phases[phase].result = result;
+    }
+}
+
+void boot_profile_set_warm(bool warm) {
+    g_timeline.warm = warm;
+}
+
+void boot_profile_get(boot_timeline_t *timeline) {
+    if (timeline != NULL) {
+        *timeline = g_timeline;
+    }
+}
+
+int64_t boot_profile_ready_us(void) {
+    return g_timeline.phases[BOOT_PHASE_READY].end_us;
+}
+
+const char* boot_profile_phase_name(boot_phase_t phase) {
+    return (phase < BOOT_PHASE_COUNT) ? g_phase_names[phase] : "unknown";
+}
+
+void boot_profile_log(void) {
+    ESP_LOGI(TAG, "Boot timeline (ms since power-on, %s start), app_main at %lld.%03lld",
+             g_timeline.warm ? "warm" : "cold",
+             g_timeline.app_main_us / 1000, g_timeline.app_main_us % 1000);
+
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        const boot_phase_record_t *record = &g_timeline.phases[i];
+        if (record->start_us == 0) {
+            continue;
+        }
+
+        int64_t duration = (record->end_us > 0) ? record->end_us - record->start_us : 0;
+        ESP_LOGI(TAG, "  %-10s %6lld -> %6lld ms (%lld ms)%s",
+                 g_phase_names[i],
+                 record->start_us / 1000,
+                 record->end_us / 1000,
+                 duration / 1000,
+                 (record->result != STATUS_OK) ? " FAILED" : "");
+    }
+}
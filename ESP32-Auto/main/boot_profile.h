@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+
+// Boot timeline
+// Each bring-up phase records when it started and finished, in microseconds
+// since power-on (esp_timer starts at reset). BOOT_PHASE_READY marks the
+// point where the adapter can accept a phone; BOOT_PHASE_SESSION runs from
+// there to the first streaming session, so warm and cold boots compare.
+
+typedef enum {
+    BOOT_PHASE_NVS = 0,
+    BOOT_PHASE_WIFI,
+    BOOT_PHASE_BLUETOOTH,
+    BOOT_PHASE_USB,
+    BOOT_PHASE_PROXY,
+    BOOT_PHASE_READY,
+    BOOT_PHASE_SESSION,
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+typedef struct {
+    int64_t start_us;           // 0 when the phase has not started
+    int64_t end_us;             // 0 while running
+    status_t result;
+} boot_phase_record_t;
+
+typedef struct {
+    boot_phase_record_t phases[BOOT_PHASE_COUNT];
+    int64_t app_main_us;        // When app_main started (ROM + bootloader time before it)
+    bool warm;                  // Started from the reconnect cache
+} boot_timeline_t;
+
+// Boot profile functions
+void boot_profile_start(void);
+void boot_profile_begin(boot_phase_t phase);
+void boot_profile_end(boot_phase_t phase, status_t result);
+void boot_profile_set_warm(bool warm);
+void boot_profile_get(boot_timeline_t *timeline);
+int64_t boot_profile_ready_us(void);
+const char* boot_profile_phase_name(boot_phase_t phase);
+void boot_profile_log(void);
@@ -0,0 +1,290 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
+#include "esp_gap_ble_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "bluetooth_manager.h"
+#include "bootstrap_service.h"
+
+static const char *TAG = "BOOTSTRAP_SERVICE";
+
+// 128-bit UUIDs, little endian as Bluedroid expects them
+static const uint8_t g_service_uuid[16] = {
+    0x9b, 0x4c, 0x1e, 0x6a, 0x52, 0x38, 0x41, 0x9d, 0xa3, 0x6f, 0x0c, 0x7e, 0x00, 0x01, 0xaa, 0xe5
+};
+static const uint8_t g_rx_uuid[16] = {
+    0x9b, 0x4c, 0x1e, 0x6a, 0x52, 0x38, 0x41, 0x9d, 0xa3, 0x6f, 0x0c, 0x7e, 0x01, 0x01, 0xaa, 0xe5
+};
+static const uint8_t g_tx_uuid[16] = {
+    0x9b, 0x4c, 0x1e, 0x6a, 0x52, 0x38, 0x41, 0x9d, 0xa3, 0x6f, 0x0c, 0x7e, 0x02, 0x01, 0xaa, 0xe5
+};
+
+static const uint16_t g_primary_service_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t g_char_decl_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t g_cccd_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint8_t g_rx_props = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+static const uint8_t g_tx_props = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static uint8_t g_cccd_value[2] = { 0x00, 0x00 };
+
+enum {
+    BOOTSTRAP_IDX_SERVICE = 0,
+    BOOTSTRAP_IDX_RX_DECL,
+    BOOTSTRAP_IDX_RX_VALUE,
+    BOOTSTRAP_IDX_TX_DECL,
+    BOOTSTRAP_IDX_TX_VALUE,
+    BOOTSTRAP_IDX_TX_CCCD,
+    BOOTSTRAP_IDX_COUNT
+};
+
+static const esp_gatts_attr_db_t g_attr_table[BOOTSTRAP_IDX_COUNT] = {
+    {   // BOOTSTRAP_IDX_SERVICE
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_primary_service_uuid, ESP_GATT_PERM_READ,
+          sizeof(g_service_uuid), sizeof(g_service_uuid), (uint8_t*)g_service_uuid }
+    },
+    {   // BOOTSTRAP_IDX_RX_DECL
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_char_decl_uuid, ESP_GATT_PERM_READ,
+          sizeof(uint8_t), sizeof(uint8_t), (uint8_t*)&g_rx_props }
+    },
+    // Writes are answered by hand, so the bytes reach the bootstrap unbuffered
+    {   // BOOTSTRAP_IDX_RX_VALUE
+        { ESP_GATT_RSP_BY_APP },
+        { ESP_UUID_LEN_128, (uint8_t*)g_rx_uuid, ESP_GATT_PERM_WRITE_ENCRYPTED,
+          BOOTSTRAP_MAX_MESSAGE_SIZE, 0, NULL }
+    },
+    {   // BOOTSTRAP_IDX_TX_DECL
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_char_decl_uuid, ESP_GATT_PERM_READ,
+          sizeof(uint8_t), sizeof(uint8_t), (uint8_t*)&g_tx_props }
+    },
+    {   // BOOTSTRAP_IDX_TX_VALUE
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_128, (uint8_t*)g_tx_uuid, ESP_GATT_PERM_READ_ENCRYPTED,
+          BOOTSTRAP_OFFER_MAX_SIZE, 0, NULL }
+    },
+    // Until the phone has bonded, writes here fail with insufficient
+    // encryption, which makes it pair and retry
+    {   // BOOTSTRAP_IDX_TX_CCCD
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_cccd_uuid, ESP_GATT_PERM_READ_ENCRYPTED | ESP_GATT_PERM_WRITE_ENCRYPTED,
+          sizeof(g_cccd_value), sizeof(g_cccd_value), g_cccd_value }
+    },
+};
+
+static wireless_bootstrap_t g_bootstrap;
+static StaticSemaphore_t g_bootstrap_mutex_buffer;
+static SemaphoreHandle_t g_bootstrap_mutex = NULL;
+static uint16_t g_handles[BOOTSTRAP_IDX_COUNT];
+static esp_gatt_if_t g_gatts_if = ESP_GATT_IF_NONE;
+static uint16_t g_conn_id = 0;
+static uint16_t g_mtu = 23;
+static bool g_connected = false;
+
+// proto_send_fn_t; notifications carry at most MTU - 3 bytes. The offer
+// holds the hotspot key, so nothing goes out before the link is bonded.
+static status_t bootstrap_service_send(const uint8_t *data, size_t size, void *ctx) {
+    if (!g_connected) {
+        return STATUS_ERROR_CONNECTION;
+    }
+    if (!bluetooth_is_peer_secure()) {
+        ESP_LOGW(TAG, "Link not encrypted, offer withheld");
+        return STATUS_ERROR_CONNECTION;
+    }
+
+    size_t chunk = g_mtu - 3;
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t length = (size - offset < chunk) ? size - offset : chunk;
+        esp_err_t ret = esp_ble_gatts_send_indicate(g_gatts_if, g_conn_id, g_handles[BOOTSTRAP_IDX_TX_VALUE],
+                                                    (uint16_t)length, (uint8_t*)data + offset, false);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Notify failed: %s", esp_err_to_name(ret));
+            return STATUS_ERROR_CONNECTION;
+        }
+    }
+    return STATUS_OK;
+}
+
+// wireless_bootstrap does not log; report what the phone's input changed
+static void bootstrap_service_log_progress(bootstrap_state_t state, uint8_t retries) {
+    if (g_bootstrap.state == state && g_bootstrap.retries == retries) {
+        return;
+    }
+
+    switch (g_bootstrap.state) {
+        case BOOTSTRAP_STATE_JOINED:
+            ESP_LOGI(TAG, "Phone joined the hotspot %lld ms after connecting",
+                     g_bootstrap.stats.last_join_us / 1000);
+            break;
+        case BOOTSTRAP_STATE_FAILED:
+            ESP_LOGW(TAG, "Phone failed to join after %d offers", g_bootstrap.retries + 1);
+            break;
+        case BOOTSTRAP_STATE_OFFERED:
+            ESP_LOGW(TAG, "Phone reported an error, offering again (%d)", g_bootstrap.retries);
+            break;
+        default:
+            break;
+    }
+}
+
+static void bootstrap_service_handle_write(esp_ble_gatts_cb_param_t *param) {
+    int64_t now = esp_timer_get_time();
+
+    if (param->write.handle == g_handles[BOOTSTRAP_IDX_TX_CCCD] && param->write.len == 2) {
+        bool notify = (param->write.value[0] & 0x01) != 0;
+        if (notify) {
+            xSemaphoreTake(g_bootstrap_mutex, portMAX_DELAY);
+            status_t ret = wireless_bootstrap_ready(&g_bootstrap, now);
+            xSemaphoreGive(g_bootstrap_mutex);
+            if (ret != STATUS_OK) {
+                ESP_LOGW(TAG, "Failed to send the bootstrap offer");
+            }
+        }
+        return;
+    }
+
+    if (param->write.handle == g_handles[BOOTSTRAP_IDX_RX_VALUE]) {
+        xSemaphoreTake(g_bootstrap_mutex, portMAX_DELAY);
+        bootstrap_state_t state = g_bootstrap.state;
+        uint8_t retries = g_bootstrap.retries;
+        wireless_bootstrap_receive(&g_bootstrap, param->write.value, param->write.len, now);
+        bootstrap_service_log_progress(state, retries);
+        xSemaphoreGive(g_bootstrap_mutex);
+
+        if (param->write.need_rsp) {
+            esp_ble_gatts_send_response(g_gatts_if, param->write.conn_id, param->write.trans_id,
+                                        ESP_GATT_OK, NULL);
+        }
+    }
+}
+
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                                esp_ble_gatts_cb_param_t *param) {
+    // Every registered app sees every event; only our own registration counts
+    if (event != ESP_GATTS_REG_EVT && gatts_if != g_gatts_if) {
+        return;
+    }
+
+    switch (event) {
+        case ESP_GATTS_REG_EVT:
+            if (param->reg.app_id != BOOTSTRAP_SERVICE_APP_ID) {
+                break;
+            }
+            if (param->reg.status != ESP_GATT_OK) {
+                ESP_LOGE(TAG, "GATT app registration failed: %d", param->reg.status);
+                break;
+            }
+            g_gatts_if = gatts_if;
+            esp_ble_gatts_create_attr_tab(g_attr_table, gatts_if, BOOTSTRAP_IDX_COUNT, 0);
+            break;
+
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+            if (param->add_attr_tab.status != ESP_GATT_OK || param->add_attr_tab.num_handle != BOOTSTRAP_IDX_COUNT) {
+                ESP_LOGE(TAG, "Failed to create attribute table: %d", param->add_attr_tab.status);
+                break;
+            }
+            memcpy(g_handles, param->add_attr_tab.handles, sizeof(g_handles));
+            esp_ble_gatts_start_service(g_handles[BOOTSTRAP_IDX_SERVICE]);
+            ESP_LOGI(TAG, "Bootstrap service started");
+            break;
+
+        case ESP_GATTS_CONNECT_EVT:
+            g_conn_id = param->connect.conn_id;
+            g_mtu = 23;
+            g_connected = true;
+            xSemaphoreTake(g_bootstrap_mutex, portMAX_DELAY);
+            wireless_bootstrap_connected(&g_bootstrap, esp_timer_get_time());
+            xSemaphoreGive(g_bootstrap_mutex);
+            bluetooth_handle_connection(true, param->connect.remote_bda);
+            break;
+
+        case ESP_GATTS_MTU_EVT:
+            g_mtu = param->mtu.mtu;
+            ESP_LOGI(TAG, "MTU %d", g_mtu);
+            break;
+
+        case ESP_GATTS_WRITE_EVT:
+            if (!param->write.is_prep) {
+                bootstrap_service_handle_write(param);
+            }
+            break;
+
+        case ESP_GATTS_DISCONNECT_EVT:
+            g_connected = false;
+            xSemaphoreTake(g_bootstrap_mutex, portMAX_DELAY);
+            ESP_LOGI(TAG, "Phone disconnected in state %s",
+                     wireless_bootstrap_state_name(g_bootstrap.state));
+            wireless_bootstrap_disconnected(&g_bootstrap);
+            proto_session_reset();
+            xSemaphoreGive(g_bootstrap_mutex);
+            bluetooth_handle_connection(false, param->disconnect.remote_bda);
+            break;
+
+        default:
+            ESP_LOGD(TAG, "Unhandled GATTS event: %d", event);
+            break;
+    }
+}
+
+status_t bootstrap_service_init(const wireless_bootstrap_config_t *config) {
+    g_bootstrap_mutex = xSemaphoreCreateMutexStatic(&g_bootstrap_mutex_buffer);
+    if (g_bootstrap_mutex == NULL) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    status_t status = wireless_bootstrap_init(&g_bootstrap, config, bootstrap_service_send, NULL);
+    if (status != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to build the bootstrap offer (max %d bytes)", BOOTSTRAP_OFFER_MAX_SIZE);
+        return status;
+    }
+    ESP_LOGI(TAG, "Bootstrap offer for %s ready, %d bytes", config->ssid, (int)g_bootstrap.offer_size);
+
+    if (bluetooth_register_gatts_handler(gatts_event_handler) != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to register GATTS handler");
+        return STATUS_ERROR_INIT;
+    }
+
+    esp_err_t ret = esp_ble_gatts_app_register(BOOTSTRAP_SERVICE_APP_ID);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GATT app: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    // A large MTU lets the offer go out as one notification
+    ret = esp_ble_gatt_set_local_mtu(BOOTSTRAP_SERVICE_MTU);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set local MTU: %s", esp_err_to_name(ret));
+    }
+
+    bluetooth_set_service_uuid(g_service_uuid);
+    return STATUS_OK;
+}
+
+bool bootstrap_service_is_connected(void) {
+    return g_connected;
+}
+
+void bootstrap_service_tcp_connected(int64_t tcp_us) {
+    if (g_bootstrap_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(g_bootstrap_mutex, portMAX_DELAY);
+    uint32_t completed = g_bootstrap.stats.completed;
+    wireless_bootstrap_tcp_connected(&g_bootstrap, tcp_us);
+    if (g_bootstrap.stats.completed != completed) {
+        ESP_LOGI(TAG, "Bluetooth connect to proxy TCP connect: %lld ms", g_bootstrap.stats.last_tcp_us / 1000);
+    }
+    xSemaphoreGive(g_bootstrap_mutex);
+}
+
+void bootstrap_service_get_stats(bootstrap_stats_t *stats) {
+    if (g_bootstrap_mutex == NULL || stats == NULL) {
+        return;
+    }
+    xSemaphoreTake(g_bootstrap_mutex, portMAX_DELAY);
+    wireless_bootstrap_get_stats(&g_bootstrap, stats);
+    xSemaphoreGive(g_bootstrap_mutex);
+}
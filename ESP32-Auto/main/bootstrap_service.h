@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+#include "wireless_bootstrap.h"
+
+// BLE GATT transport for the wireless bootstrap
+// One primary service with an RX characteristic the phone writes to and a
+// TX characteristic the dongle notifies on. Both need a bonded, encrypted
+// link (bluetooth_manager.cpp pairs on connect). The offer goes out as soon
+// as the phone enables notifications, in one notification when the MTU allows.
+
+#define BOOTSTRAP_SERVICE_APP_ID    0x41
+#define BOOTSTRAP_SERVICE_MTU       517
+
+// Bootstrap service functions
+status_t bootstrap_service_init(const wireless_bootstrap_config_t *config);
+bool bootstrap_service_is_connected(void);
+// Forward the proxy's accept time to time the whole bootstrap
+void bootstrap_service_tcp_connected(int64_t tcp_us);
+void bootstrap_service_get_stats(bootstrap_stats_t *stats);
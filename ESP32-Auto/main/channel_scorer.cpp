@@ -0,0 +1,77 @@
+#include <string.h>
+#include "channel_scorer.h"
+
+// Share of an AP's load felt this many channels away from its primary
+static const uint8_t g_overlap_pct[CHANNEL_OVERLAP + 1] = { 100, 70, 40, 20, 5 };
+
+// Channels 1, 6 and 11 do not overlap each other; preferred on a tie
+static bool channel_is_preferred(uint8_t channel) {
+    return channel == 1 || channel == 6 || channel == 11;
+}
+
+// Received strength as load: -100 dBm or weaker counts 1, -30 dBm or
+// stronger counts 71, linear in between
+static uint32_t channel_rssi_load(int8_t rssi) {
+    int value = rssi;
+    if (value < -100) value = -100;
+    if (value > -30) value = -30;
+    return (uint32_t)(value + 101);
+}
+
+void channel_scorer_score(const channel_scan_record_t *records, size_t count, channel_scores_t *scores) {
+    if (scores == NULL) {
+        return;
+    }
+
+    memset(scores, 0, sizeof(*scores));
+    if (records == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t primary = records[i].channel;
+        if (primary < CHANNEL_MIN || primary > CHANNEL_MAX) {
+            continue;  // 5 GHz or malformed
+        }
+
+        uint32_t load = channel_rssi_load(records[i].rssi);
+        scores->ap_count[primary]++;
+        scores->records++;
+
+        for (int distance = -CHANNEL_OVERLAP; distance <= CHANNEL_OVERLAP; distance++) {
+            int channel = primary + distance;
+            if (channel < CHANNEL_MIN || channel > CHANNEL_MAX) {
+                continue;
+            }
+            int index = (distance < 0) ? -distance : distance;
+            scores->load[channel] += load * g_overlap_pct[index];
+        }
+    }
+}
+
+uint8_t channel_scorer_pick(const channel_scores_t *scores, uint8_t current, uint8_t hysteresis_pct) {
+    if (scores == NULL) {
+        return (current >= CHANNEL_MIN && current <= CHANNEL_MAX) ? current : CHANNEL_MIN;
+    }
+
+    uint8_t best = CHANNEL_MIN;
+    for (uint8_t channel = CHANNEL_MIN + 1; channel <= CHANNEL_MAX; channel++) {
+        uint32_t load = scores->load[channel];
+        uint32_t best_load = scores->load[best];
+        if (load < best_load ||
+            (load == best_load && channel_is_preferred(channel) && !channel_is_preferred(best))) {
+            best = channel;
+        }
+    }
+
+    // Moving the AP drops nobody while idle, but still costs a restart;
+    // only move for a clear improvement
+    if (current >= CHANNEL_MIN && current <= CHANNEL_MAX && current != best) {
+        uint64_t threshold = (uint64_t)scores->load[current] * (100 - (hysteresis_pct > 100 ? 100 : hysteresis_pct));
+        if ((uint64_t)scores->load[best] * 100 >= threshold) {
+            return current;
+        }
+    }
+
+    return best;
+}
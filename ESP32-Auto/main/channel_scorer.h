@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// 2.4 GHz channel scoring
+// Scores channels 1-13 from a table of scan results. Every AP loads its own
+// channel by its received strength and, less so, the channels its 20 MHz
+// signal overlaps (up to four either side). Lower scores are better. Pure
+// logic; recorded scan tables can be replayed off target.
+
+#define CHANNEL_MIN             1
+#define CHANNEL_MAX             13
+#define CHANNEL_OVERLAP         4       // Channels either side a 20 MHz signal reaches
+
+typedef struct {
+    uint8_t channel;            // Primary channel of the AP
+    int8_t rssi;                // dBm
+} channel_scan_record_t;
+
+typedef struct {
+    uint32_t load[CHANNEL_MAX + 1];         // Indexed by channel; [0] unused
+    uint8_t ap_count[CHANNEL_MAX + 1];      // APs with this primary channel
+    uint16_t records;                       // Records scored (out of range ones skipped)
+} channel_scores_t;
+
+// Channel scorer functions
+void channel_scorer_score(const channel_scan_record_t *records, size_t count, channel_scores_t *scores);
+// Best channel; when current is valid it is kept unless another channel's
+// load is lower by more than hysteresis_pct percent.
+uint8_t channel_scorer_pick(const channel_scores_t *scores, uint8_t current, uint8_t hysteresis_pct);
@@ -37,16 +37,6 @@ typedef enum {
     CONNECTION_STRATEGY_USB_FIRST = 2
 } connection_strategy_t;
 
-// Device Information
-typedef struct {
-    char manufacturer[256];
-    char model[256];
-    char description[256];
-    char version[256];
-    char uri[256];
-    char serial[256];
-} device_info_t;
-
 // Status codes
 typedef enum {
     STATUS_OK = 0,
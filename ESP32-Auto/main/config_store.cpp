@@ -0,0 +1,208 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "config_store.h"
+#include "proxy_handler.h"
+#include "wifi_hotspot.h"
+
+static const char *TAG = "CONFIG_STORE";
+
+#define CONFIG_NAMESPACE        "config"
+
+// Indexed by config_key_t
+static const config_param_t g_params[CONFIG_KEY_COUNT] = {
+    { "proxy_chunk",   4096,  512, PROXY_BUFFER_SIZE },
+    { "proxy_accept",  5000, 1000, 60000 },
+    { "proxy_stats",   5000, 1000, 600000 },
+    { "proxy_poll",       1,    1, 20 },                    // 0 would starve lower priorities
+    { "proxy_autotune",   1,    0, 1 },
+    { "proxy_lat_us", 20000, 1000, 500000 },
+    { "stall_usb_rd",   500,   50, 10000 },
+    { "stall_tcp_tx",  1000,   50, 10000 },                 // Wi-Fi retries ride out short fades
+    { "stall_tcp_rx",   500,   50, 10000 },
+    { "stall_usb_wr",   500,   50, 10000 },
+    { "stall_recover",    0,    0, 1 },
+    { "usb_fifo_us",   1000,  100, 20000 },
+    { "wifi_profile",  WIFI_PROFILE_MAX_THROUGHPUT, 0, WIFI_PROFILE_COUNT - 1 },
+};
+
+static uint32_t g_values[CONFIG_KEY_COUNT];
+static uint32_t g_dirty = 0;                                // Bit per key not yet in flash
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t g_flush_timer = NULL;
+
+static bool config_in_range(const config_param_t *param, uint32_t value) {
+    return value >= param->min && value <= param->max;
+}
+
+static void config_flush_timer_cb(void *arg) {
+    config_store_flush();
+}
+
+status_t config_store_init(void) {
+    nvs_handle_t handle;
+
+    for (int key = 0; key < CONFIG_KEY_COUNT; key++) {
+        g_values[key] = g_params[key].def;
+    }
+    g_dirty = 0;
+
+    if (g_flush_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = config_flush_timer_cb,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "config_flush",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&args, &g_flush_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create flush timer");
+            return STATUS_ERROR_MEMORY;
+        }
+    }
+
+    esp_err_t ret = nvs_open(CONFIG_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "No stored configuration, using defaults");
+        return STATUS_OK;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    for (int key = 0; key < CONFIG_KEY_COUNT; key++) {
+        uint32_t value;
+        ret = nvs_get_u32(handle, g_params[key].name, &value);
+        if (ret == ESP_ERR_NVS_NOT_FOUND) {
+            continue;
+        }
+
+        // A bad value only costs the default; the key stays as it is in flash
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Ignoring %s: %s", g_params[key].name, esp_err_to_name(ret));
+            continue;
+        }
+        if (!config_in_range(&g_params[key], value)) {
+            ESP_LOGW(TAG, "Ignoring %s = %lu, outside %lu..%lu", g_params[key].name, (unsigned long)value,
+                     (unsigned long)g_params[key].min, (unsigned long)g_params[key].max);
+            continue;
+        }
+        g_values[key] = value;
+    }
+    nvs_close(handle);
+
+    config_store_log();
+    return STATUS_OK;
+}
+
+const config_param_t* config_get_param(config_key_t key) {
+    return (key < CONFIG_KEY_COUNT) ? &g_params[key] : NULL;
+}
+
+status_t config_find(const char *name, config_key_t *key) {
+    if (name == NULL || key == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    for (int i = 0; i < CONFIG_KEY_COUNT; i++) {
+        if (strcmp(name, g_params[i].name) == 0) {
+            *key = (config_key_t)i;
+            return STATUS_OK;
+        }
+    }
+    return STATUS_ERROR_INIT;
+}
+
+uint32_t config_get(config_key_t key) {
+    // Aligned word reads; no lock needed
+    return (key < CONFIG_KEY_COUNT) ? g_values[key] : 0;
+}
+
+status_t config_set(config_key_t key, uint32_t value) {
+    if (key >= CONFIG_KEY_COUNT || !config_in_range(&g_params[key], value)) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    taskENTER_CRITICAL(&g_lock);
+    bool changed = (g_values[key] != value);
+    g_values[key] = value;
+    if (changed) {
+        g_dirty |= 1u << key;
+    }
+    taskEXIT_CRITICAL(&g_lock);
+
+    // Each set pushes the write back, so a burst of sets costs one commit
+    if (changed && g_flush_timer != NULL) {
+        esp_timer_stop(g_flush_timer);
+        esp_timer_start_once(g_flush_timer, (uint64_t)CONFIG_FLUSH_DELAY_MS * 1000);
+    }
+    return STATUS_OK;
+}
+
+status_t config_reset(void) {
+    for (int key = 0; key < CONFIG_KEY_COUNT; key++) {
+        config_set((config_key_t)key, g_params[key].def);
+    }
+    return STATUS_OK;
+}
+
+status_t config_store_flush(void) {
+    uint32_t values[CONFIG_KEY_COUNT];
+
+    taskENTER_CRITICAL(&g_lock);
+    uint32_t dirty = g_dirty;
+    g_dirty = 0;
+    memcpy(values, g_values, sizeof(values));
+    taskEXIT_CRITICAL(&g_lock);
+
+    if (dirty == 0) {
+        return STATUS_OK;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        for (int key = 0; key < CONFIG_KEY_COUNT && ret == ESP_OK; key++) {
+            if (!(dirty & (1u << key))) {
+                continue;
+            }
+            // Defaults are erased, so a firmware with new defaults takes effect
+            if (values[key] == g_params[key].def) {
+                ret = nvs_erase_key(handle, g_params[key].name);
+                if (ret == ESP_ERR_NVS_NOT_FOUND) {
+                    ret = ESP_OK;
+                }
+            } else {
+                ret = nvs_set_u32(handle, g_params[key].name, values[key]);
+            }
+        }
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if (ret != ESP_OK) {
+        // Left pending for the next set or flush
+        taskENTER_CRITICAL(&g_lock);
+        g_dirty |= dirty;
+        taskEXIT_CRITICAL(&g_lock);
+        ESP_LOGE(TAG, "Failed to write configuration: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    ESP_LOGI(TAG, "Configuration written (keys 0x%02lx)", (unsigned long)dirty);
+    return STATUS_OK;
+}
+
+void config_store_log(void) {
+    for (int key = 0; key < CONFIG_KEY_COUNT; key++) {
+        if (g_values[key] != g_params[key].def) {
+            ESP_LOGI(TAG, "%s = %lu (default %lu)", g_params[key].name,
+                     (unsigned long)g_values[key], (unsigned long)g_params[key].def);
+        }
+    }
+}
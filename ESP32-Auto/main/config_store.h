@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+
+// Runtime configuration store
+// Performance knobs for the proxy, USB and Wi-Fi, each a u32 under its own
+// key in the "config" NVS namespace, so a head unit can be tuned from an
+// NVS partition image (nvs_partition_gen.py) without a firmware build.
+// Values are range checked on load and on set; a missing or out-of-range
+// key reads as its default.
+//
+// config_set() only updates RAM. Writes are coalesced: changed keys reach
+// flash together CONFIG_FLUSH_DELAY_MS after the last set, in one commit.
+// Owners pick up new values when they reconfigure: proxy_reconfigure()
+// (live, between stats windows) and wifi_hotspot_set_profile(). Built
+// with METRICS_CONFIG_ENABLE, POST /config on the metrics server sets keys
+// and reconfigures both.
+
+#define CONFIG_FLUSH_DELAY_MS   2000
+
+typedef enum {
+    CONFIG_PROXY_CHUNK_SIZE = 0,        // Bytes per USB or TCP read
+    CONFIG_PROXY_ACCEPT_TIMEOUT_MS,     // Wait for the phone's TCP connect
+    CONFIG_PROXY_STATS_INTERVAL_MS,     // Connection statistics period
+    CONFIG_PROXY_POLL_INTERVAL_MS,      // Forwarding loop pause between reads
+    CONFIG_PROXY_AUTOTUNE,              // 1: proxy_tuner adjusts read size and poll interval
+    CONFIG_PROXY_LATENCY_TARGET_US,     // Egress p99 the tuner aims for; also the latency SLO
+    CONFIG_STALL_USB_READ_MS,           // Stall thresholds, in stall_stage_t order
+    CONFIG_STALL_TCP_SEND_MS,
+    CONFIG_STALL_TCP_RECV_MS,
+    CONFIG_STALL_USB_WRITE_MS,
+    CONFIG_STALL_RECOVER,               // 1: restart the stalled stage, not just report it
+    CONFIG_USB_FIFO_TIMEOUT_US,         // Wait for IN FIFO space per packet
+    CONFIG_WIFI_PROFILE,                // wifi_profile_t
+    CONFIG_KEY_COUNT
+} config_key_t;
+
+typedef struct {
+    const char *name;                   // NVS key, at most 15 characters
+    uint32_t def;
+    uint32_t min;
+    uint32_t max;
+} config_param_t;
+
+// Configuration store functions
+// config_store_init() needs NVS to be initialised.
+status_t config_store_init(void);
+const config_param_t* config_get_param(config_key_t key);
+status_t config_find(const char *name, config_key_t *key);
+uint32_t config_get(config_key_t key);
+status_t config_set(config_key_t key, uint32_t value);    // STATUS_ERROR_PROTOCOL when out of range
+status_t config_reset(void);                              // All keys back to their defaults
+status_t config_store_flush(void);                        // Writes pending changes now
+void config_store_log(void);
@@ -0,0 +1,180 @@
+#include <string.h>
+#include "connection_fsm.h"
+
+// Conditions tracked by the FSM; one bit per subsystem plus the phone
+#define CONN_COND(subsys)   (1u << (subsys))
+#define CONN_COND_PHONE     (1u << CONN_SUBSYS_COUNT)
+
+static const char *g_state_names[CONN_STATE_COUNT] = {
+    "bringup",
+    "starting",
+    "ready",
+    "streaming",
+    "recovering"
+};
+
+// Conditions that must hold before a session is started
+static uint8_t conn_required(connection_strategy_t strategy) {
+    switch (strategy) {
+        case CONNECTION_STRATEGY_PHONE_FIRST:
+            return CONN_COND(CONN_SUBSYS_WIFI) | CONN_COND(CONN_SUBSYS_USB) |
+                   CONN_COND(CONN_SUBSYS_PROXY) | CONN_COND_PHONE;
+
+        case CONNECTION_STRATEGY_USB_FIRST:
+            return CONN_COND(CONN_SUBSYS_USB) | CONN_COND(CONN_SUBSYS_PROXY);
+
+        case CONNECTION_STRATEGY_DONGLE_MODE:
+        default:
+            return CONN_COND(CONN_SUBSYS_WIFI) | CONN_COND(CONN_SUBSYS_BLUETOOTH) |
+                   CONN_COND(CONN_SUBSYS_USB) | CONN_COND(CONN_SUBSYS_PROXY);
+    }
+}
+
+// Conditions whose loss ends a running session. Bluetooth only bootstraps
+// the phone, so losing it never tears down a session.
+static uint8_t conn_critical(connection_strategy_t strategy) {
+    return conn_required(strategy) & ~CONN_COND(CONN_SUBSYS_BLUETOOTH);
+}
+
+static void conn_fsm_enter(conn_fsm_t *fsm, conn_state_t state, int64_t now_us) {
+    if (state == fsm->state) {
+        return;
+    }
+
+    fsm->stats.time_in_state_us[fsm->state] += now_us - fsm->state_entered_us;
+    fsm->stats.transitions++;
+
+    // Streaming lost: start the reconnect clock
+    if (fsm->state == CONN_STATE_STREAMING) {
+        fsm->lost_at_us = now_us;
+    }
+
+    if (state == CONN_STATE_STREAMING) {
+        fsm->stats.sessions++;
+        if (fsm->stats.first_stream_us == 0) {
+            fsm->stats.first_stream_us = now_us - fsm->start_us;
+        }
+        if (fsm->lost_at_us != 0) {
+            int64_t latency = now_us - fsm->lost_at_us;
+            fsm->stats.reconnects++;
+            fsm->stats.last_reconnect_us = latency;
+            if (latency > fsm->stats.max_reconnect_us) {
+                fsm->stats.max_reconnect_us = latency;
+            }
+            fsm->lost_at_us = 0;
+        }
+    }
+
+    fsm->state = state;
+    fsm->state_entered_us = now_us;
+}
+
+void conn_fsm_init(conn_fsm_t *fsm, connection_strategy_t strategy, int64_t now_us) {
+    memset(fsm, 0, sizeof(conn_fsm_t));
+    fsm->strategy = strategy;
+    fsm->state = CONN_STATE_BRINGUP;
+    fsm->start_us = now_us;
+    fsm->state_entered_us = now_us;
+}
+
+uint32_t conn_fsm_handle(conn_fsm_t *fsm, const conn_event_t *event, int64_t now_us) {
+    uint32_t actions = CONN_ACTION_NONE;
+    uint8_t lost = 0;
+
+    if (fsm == NULL || event == NULL) {
+        return CONN_ACTION_NONE;
+    }
+
+    switch (event->type) {
+        case CONN_EVENT_SUBSYS_UP:
+            if (event->subsystem < CONN_SUBSYS_COUNT) {
+                fsm->up |= CONN_COND(event->subsystem);
+            }
+            break;
+
+        case CONN_EVENT_SUBSYS_FAILED:
+            // Restart only the subsystem that failed
+            if (event->subsystem < CONN_SUBSYS_COUNT) {
+                lost = fsm->up & CONN_COND(event->subsystem);
+                fsm->up &= ~CONN_COND(event->subsystem);
+                fsm->stats.restarts[event->subsystem]++;
+                actions |= CONN_ACTION_RESTART(event->subsystem);
+            }
+            break;
+
+        case CONN_EVENT_PHONE_JOINED:
+            fsm->up |= CONN_COND_PHONE;
+            break;
+
+        case CONN_EVENT_PHONE_LEFT:
+            lost = fsm->up & CONN_COND_PHONE;
+            fsm->up &= ~CONN_COND_PHONE;
+            break;
+
+        case CONN_EVENT_SESSION_STARTED:
+            if (fsm->state == CONN_STATE_STARTING) {
+                conn_fsm_enter(fsm, CONN_STATE_READY, now_us);
+            }
+            break;
+
+        case CONN_EVENT_SESSION_FAILED:
+            if (fsm->state == CONN_STATE_STARTING) {
+                fsm->stats.session_failures++;
+                fsm->retry_at_us = now_us + CONN_RETRY_DELAY_US;
+                conn_fsm_enter(fsm, CONN_STATE_RECOVERING, now_us);
+            }
+            break;
+
+        case CONN_EVENT_CLIENT_CONNECTED:
+            if (fsm->state == CONN_STATE_READY) {
+                conn_fsm_enter(fsm, CONN_STATE_STREAMING, now_us);
+            }
+            break;
+
+        case CONN_EVENT_CLIENT_DISCONNECTED:
+            // The proxy keeps listening, so the session stays up for a reconnect
+            if (fsm->state == CONN_STATE_STREAMING) {
+                conn_fsm_enter(fsm, CONN_STATE_READY, now_us);
+            }
+            break;
+
+        case CONN_EVENT_TICK:
+        default:
+            break;
+    }
+
+    // A critical condition went away under a running session
+    bool in_session = (fsm->state == CONN_STATE_STARTING ||
+                       fsm->state == CONN_STATE_READY ||
+                       fsm->state == CONN_STATE_STREAMING);
+    if (in_session && (lost & conn_critical(fsm->strategy))) {
+        actions |= CONN_ACTION_STOP_SESSION;
+        conn_fsm_enter(fsm, CONN_STATE_BRINGUP, now_us);
+    }
+
+    // Start a session once the strategy's prerequisites hold
+    uint8_t required = conn_required(fsm->strategy);
+    bool can_start = (fsm->state == CONN_STATE_BRINGUP) ||
+                     (fsm->state == CONN_STATE_RECOVERING && now_us >= fsm->retry_at_us);
+    if (can_start && (fsm->up & required) == required) {
+        actions |= CONN_ACTION_START_SESSION;
+        conn_fsm_enter(fsm, CONN_STATE_STARTING, now_us);
+    } else if (fsm->state == CONN_STATE_RECOVERING && (fsm->up & required) != required) {
+        conn_fsm_enter(fsm, CONN_STATE_BRINGUP, now_us);
+    }
+
+    return actions;
+}
+
+void conn_fsm_get_stats(const conn_fsm_t *fsm, int64_t now_us, conn_fsm_stats_t *stats) {
+    if (fsm == NULL || stats == NULL) {
+        return;
+    }
+
+    *stats = fsm->stats;
+    stats->time_in_state_us[fsm->state] += now_us - fsm->state_entered_us;
+}
+
+const char* conn_fsm_state_name(conn_state_t state) {
+    return (state < CONN_STATE_COUNT) ? g_state_names[state] : "unknown";
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+
+// Connection orchestration state machine
+// Pure logic: events go in with a timestamp, a bitmask of actions comes out.
+// connection_manager.cpp runs it on the device; it can equally be driven
+// on the host with simulated event sequences.
+
+typedef enum {
+    CONN_SUBSYS_WIFI = 0,
+    CONN_SUBSYS_BLUETOOTH,
+    CONN_SUBSYS_USB,
+    CONN_SUBSYS_PROXY,
+    CONN_SUBSYS_COUNT
+} conn_subsystem_t;
+
+typedef enum {
+    CONN_EVENT_TICK = 0,                // Periodic, drives retries
+    CONN_EVENT_SUBSYS_UP,               // subsystem is ready
+    CONN_EVENT_SUBSYS_FAILED,           // subsystem has failed and needs a restart
+    CONN_EVENT_PHONE_JOINED,            // Phone associated with the hotspot
+    CONN_EVENT_PHONE_LEFT,
+    CONN_EVENT_SESSION_STARTED,         // Accessory mode and proxy are up
+    CONN_EVENT_SESSION_FAILED,
+    CONN_EVENT_CLIENT_CONNECTED,        // Phone connected to the proxy
+    CONN_EVENT_CLIENT_DISCONNECTED
+} conn_event_type_t;
+
+typedef struct {
+    conn_event_type_t type;
+    conn_subsystem_t subsystem;         // For SUBSYS_UP / SUBSYS_FAILED
+} conn_event_t;
+
+typedef enum {
+    CONN_STATE_BRINGUP = 0,             // Waiting for the strategy's prerequisites
+    CONN_STATE_STARTING,                // Session start requested
+    CONN_STATE_READY,                   // Session up, waiting for the phone's proxy connection
+    CONN_STATE_STREAMING,
+    CONN_STATE_RECOVERING,              // Session start failed; retrying after a delay
+    CONN_STATE_COUNT
+} conn_state_t;
+
+// Actions for the caller to carry out
+#define CONN_ACTION_NONE            0
+#define CONN_ACTION_START_SESSION   (1u << 0)
+#define CONN_ACTION_STOP_SESSION    (1u << 1)
+#define CONN_ACTION_RESTART(subsys) (1u << (2 + (subsys)))
+
+#define CONN_RETRY_DELAY_US         2000000
+
+typedef struct {
+    int64_t time_in_state_us[CONN_STATE_COUNT];
+    uint32_t transitions;
+    uint32_t sessions;                  // Times STREAMING was entered
+    uint32_t session_failures;
+    uint32_t restarts[CONN_SUBSYS_COUNT];
+    uint32_t reconnects;                // Returns to STREAMING after a loss
+    int64_t last_reconnect_us;          // Loss of streaming to streaming again
+    int64_t max_reconnect_us;
+    int64_t first_stream_us;            // Time from fsm init to first STREAMING
+} conn_fsm_stats_t;
+
+typedef struct {
+    connection_strategy_t strategy;
+    conn_state_t state;
+    uint8_t up;                         // Bitmask of CONN_COND_*
+    int64_t start_us;
+    int64_t state_entered_us;
+    int64_t retry_at_us;
+    int64_t lost_at_us;                 // 0 unless streaming was lost
+    conn_fsm_stats_t stats;
+} conn_fsm_t;
+
+// Connection FSM functions
+void conn_fsm_init(conn_fsm_t *fsm, connection_strategy_t strategy, int64_t now_us);
+uint32_t conn_fsm_handle(conn_fsm_t *fsm, const conn_event_t *event, int64_t now_us);
+void conn_fsm_get_stats(const conn_fsm_t *fsm, int64_t now_us, conn_fsm_stats_t *stats);
+const char* conn_fsm_state_name(conn_state_t state);
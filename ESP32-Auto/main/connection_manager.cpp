@@ -0,0 +1,245 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "connection_manager.h"
+#include "bluetooth_manager.h"
+#include "proxy_handler.h"
+#include "wifi_hotspot.h"
+#include "task_plan.h"
+
+static const char *TAG = "CONN_MANAGER";
+
+#define CONN_QUEUE_SIZE          16
+#define CONN_TICK_MS             1000
+
+static conn_fsm_t g_fsm;
+static connection_ops_t g_ops;
+static StaticQueue_t g_event_queue_buffer;
+static uint8_t g_event_queue_storage[CONN_QUEUE_SIZE * sizeof(conn_event_t)];
+static QueueHandle_t g_event_queue = NULL;
+static StaticSemaphore_t g_fsm_mutex_buffer;
+static SemaphoreHandle_t g_fsm_mutex = NULL;
+static TaskHandle_t g_task_handle = NULL;
+static uint32_t g_retry_mask = 0;       // Subsystems whose restart failed; retried each tick
+static volatile bool g_ble_connected = false;
+static int64_t g_ready_us = 0;          // When the session last entered READY
+
+static const char *g_subsys_names[CONN_SUBSYS_COUNT] = {
+    "wifi",
+    "bluetooth",
+    "usb",
+    "proxy"
+};
+
+// Subsystem event sources
+
+static void conn_wifi_event_handler(void *arg, esp_event_base_t event_base,
+                                    int32_t event_id, void *event_data) {
+    if (event_id == WIFI_EVENT_AP_STACONNECTED) {
+        connection_manager_post(CONN_EVENT_PHONE_JOINED, CONN_SUBSYS_WIFI);
+    } else if (event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+        connection_manager_post(CONN_EVENT_PHONE_LEFT, CONN_SUBSYS_WIFI);
+    } else if (event_id == WIFI_EVENT_AP_STOP && wifi_hotspot_is_active()) {
+        // wifi_hotspot_stop() clears the flag first, so this stop was not ours
+        connection_manager_post(CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_WIFI);
+    }
+}
+
+static void conn_bluetooth_event(bluetooth_event_t event, void *ctx) {
+    if (event == BLUETOOTH_EVENT_ADV_FAILED) {
+        connection_manager_post(CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_BLUETOOTH);
+    } else if (event == BLUETOOTH_EVENT_CONNECTED || event == BLUETOOTH_EVENT_DISCONNECTED) {
+        // Re-evaluate the advertising mode now rather than on the next tick
+        g_ble_connected = (event == BLUETOOTH_EVENT_CONNECTED);
+        connection_manager_post(CONN_EVENT_TICK, CONN_SUBSYS_BLUETOOTH);
+    }
+}
+
+static void conn_proxy_event(proxy_event_t event, void *ctx) {
+    switch (event) {
+        case PROXY_EVENT_CLIENT_CONNECTED:
+            connection_manager_post(CONN_EVENT_CLIENT_CONNECTED, CONN_SUBSYS_PROXY);
+            break;
+        case PROXY_EVENT_CLIENT_DISCONNECTED:
+            connection_manager_post(CONN_EVENT_CLIENT_DISCONNECTED, CONN_SUBSYS_PROXY);
+            break;
+        case PROXY_EVENT_FAILED:
+            connection_manager_post(CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_PROXY);
+            break;
+        case PROXY_EVENT_USB_FAILED:
+            connection_manager_post(CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_USB);
+            break;
+    }
+}
+
+// Action execution
+
+static void conn_execute(uint32_t actions) {
+    if (actions & CONN_ACTION_STOP_SESSION) {
+        ESP_LOGI(TAG, "Stopping session");
+        if (g_ops.stop_session != NULL) {
+            g_ops.stop_session();
+        }
+    }
+
+    // Restart only the subsystems that failed; report the outcome back
+    for (int i = 0; i < CONN_SUBSYS_COUNT; i++) {
+        if (!(actions & CONN_ACTION_RESTART(i))) {
+            continue;
+        }
+
+        ESP_LOGW(TAG, "Restarting %s", g_subsys_names[i]);
+        status_t ret = (g_ops.restart[i] != NULL) ? g_ops.restart[i]() : STATUS_ERROR_INIT;
+        if (ret == STATUS_OK) {
+            connection_manager_post(CONN_EVENT_SUBSYS_UP, (conn_subsystem_t)i);
+        } else {
+            // Retried on the next tick rather than in a tight loop
+            ESP_LOGE(TAG, "Failed to restart %s", g_subsys_names[i]);
+            g_retry_mask |= 1u << i;
+        }
+    }
+
+    if (actions & CONN_ACTION_START_SESSION) {
+        ESP_LOGI(TAG, "Starting session");
+        status_t ret = (g_ops.start_session != NULL) ? g_ops.start_session() : STATUS_ERROR_INIT;
+        connection_manager_post(ret == STATUS_OK ? CONN_EVENT_SESSION_STARTED : CONN_EVENT_SESSION_FAILED,
+                                CONN_SUBSYS_USB);
+    }
+}
+
+static void connection_manager_task(void *pvParameters) {
+    ESP_LOGI(TAG, "Connection manager started");
+
+    while (1) {
+        conn_event_t event;
+        if (xQueueReceive(g_event_queue, &event, pdMS_TO_TICKS(CONN_TICK_MS)) != pdTRUE) {
+            event.type = CONN_EVENT_TICK;
+            event.subsystem = CONN_SUBSYS_WIFI;
+
+            for (int i = 0; i < CONN_SUBSYS_COUNT; i++) {
+                if (g_retry_mask & (1u << i)) {
+                    connection_manager_post(CONN_EVENT_SUBSYS_FAILED, (conn_subsystem_t)i);
+                }
+            }
+            g_retry_mask = 0;
+        }
+
+        xSemaphoreTake(g_fsm_mutex, portMAX_DELAY);
+        conn_state_t before = g_fsm.state;
+        uint32_t actions = conn_fsm_handle(&g_fsm, &event, esp_timer_get_time());
+        conn_state_t after = g_fsm.state;
+        int64_t entered_us = g_fsm.state_entered_us;
+        xSemaphoreGive(g_fsm_mutex);
+
+        if (before != after) {
+            ESP_LOGI(TAG, "State %s -> %s", conn_fsm_state_name(before), conn_fsm_state_name(after));
+            if (after == CONN_STATE_STREAMING && g_fsm.stats.reconnects > 0) {
+                ESP_LOGI(TAG, "Reconnected in %lld ms", g_fsm.stats.last_reconnect_us / 1000);
+            }
+            if (after == CONN_STATE_READY) {
+                g_ready_us = entered_us;
+            }
+            if (after == CONN_STATE_STREAMING && g_ops.session_streaming != NULL) {
+                g_ops.session_streaming(entered_us - g_ready_us);
+            }
+        }
+
+        if (actions != CONN_ACTION_NONE) {
+            conn_execute(actions);
+        }
+
+        // Advertising follows the state: fast while a phone may be pairing,
+        // slow after a quiet spell, off while streaming
+        bluetooth_set_adv_mode(adv_scheduler_policy(after, g_ble_connected,
+                                                    esp_timer_get_time() - g_fsm.state_entered_us));
+    }
+}
+
+status_t connection_manager_init(connection_strategy_t strategy, const connection_ops_t *ops) {
+    if (ops == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    ESP_LOGI(TAG, "Initializing connection manager, strategy %d", strategy);
+
+    g_ops = *ops;
+    conn_fsm_init(&g_fsm, strategy, esp_timer_get_time());
+
+    g_fsm_mutex = xSemaphoreCreateMutexStatic(&g_fsm_mutex_buffer);
+    g_event_queue = xQueueCreateStatic(CONN_QUEUE_SIZE, sizeof(conn_event_t),
+                                       g_event_queue_storage, &g_event_queue_buffer);
+    if (g_fsm_mutex == NULL || g_event_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create connection manager queue");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    // Sources are hooked up before any subsystem starts, so nothing that
+    // happens during bring-up is missed; events wait in the queue until
+    // connection_manager_start(). Wi-Fi init creates the same default loop.
+    esp_err_t ret = esp_event_loop_create_default();
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to create event loop: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+    ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &conn_wifi_event_handler, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register WiFi event handler: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    bluetooth_set_event_callback(conn_bluetooth_event, NULL);
+    proxy_set_event_callback(conn_proxy_event, NULL);
+    return STATUS_OK;
+}
+
+status_t connection_manager_start(void) {
+    if (g_event_queue == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    ESP_LOGI(TAG, "Starting connection manager, %d events queued during bring-up",
+             (int)uxQueueMessagesWaiting(g_event_queue));
+
+    if (task_plan_create(TASK_ID_CONN_MANAGER, connection_manager_task, NULL, &g_task_handle) != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to create connection manager task");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    return STATUS_OK;
+}
+
+status_t connection_manager_post(conn_event_type_t type, conn_subsystem_t subsystem) {
+    if (g_event_queue == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    conn_event_t event;
+    event.type = type;
+    event.subsystem = subsystem;
+
+    if (xQueueSend(g_event_queue, &event, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Event queue full, dropping event %d", type);
+        return STATUS_ERROR_MEMORY;
+    }
+    return STATUS_OK;
+}
+
+conn_state_t connection_manager_get_state(void) {
+    return g_fsm.state;
+}
+
+void connection_manager_get_stats(conn_fsm_stats_t *stats) {
+    if (stats == NULL || g_fsm_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(g_fsm_mutex, portMAX_DELAY);
+    conn_fsm_get_stats(&g_fsm, esp_timer_get_time(), stats);
+    xSemaphoreGive(g_fsm_mutex);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+#include "connection_fsm.h"
+
+// Runs the connection FSM on its own task. Subsystems post events; the
+// manager carries out the resulting actions through the operations below.
+// Init hooks up the event sources and must run before bring-up; each
+// subsystem posts SUBSYS_UP as it comes up, and the events queue until
+// start creates the task.
+typedef struct {
+    status_t (*start_session)(void);
+    void (*stop_session)(void);
+    // Optional; each time a session starts streaming, with the time since
+    // it became ready (started, or its client dropped)
+    void (*session_streaming)(int64_t connect_us);
+    status_t (*restart[CONN_SUBSYS_COUNT])(void);
+} connection_ops_t;
+
+// Connection manager functions
+status_t connection_manager_init(connection_strategy_t strategy, const connection_ops_t *ops);
+status_t connection_manager_start(void);
+status_t connection_manager_post(conn_event_type_t type, conn_subsystem_t subsystem);
+conn_state_t connection_manager_get_state(void);
+void connection_manager_get_stats(conn_fsm_stats_t *stats);
@@ -0,0 +1,54 @@
+#include <string.h>
+#include "device_identity.h"
+
+status_t device_identity_build(device_identity_t *identity, const device_identity_config_t *config) {
+    if (identity == NULL || config == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    const char *strings[DEVICE_IDENTITY_FIELD_COUNT] = {
+        config->manufacturer,
+        config->model,
+        config->description,
+        config->version,
+        config->uri,
+        config->serial
+    };
+
+    memset(identity, 0, sizeof(device_identity_t));
+
+    size_t used = 0;
+    for (int i = 0; i < DEVICE_IDENTITY_FIELD_COUNT; i++) {
+        const char *str = (strings[i] != NULL) ? strings[i] : "";
+        size_t length = strlen(str);
+
+        // Offsets are 8-bit, so every string must start inside the buffer
+        if (length + 1 > DEVICE_IDENTITY_DATA_SIZE - used) {
+            return STATUS_ERROR_MEMORY;
+        }
+
+        memcpy(identity->data + used, str, length + 1);
+        identity->offset[i] = (uint8_t)used;
+        identity->length[i] = (uint8_t)length;
+        used += length + 1;
+    }
+
+    identity->size = (uint16_t)used;
+    return STATUS_OK;
+}
+
+const char* device_identity_get(const device_identity_t *identity, device_identity_field_t field) {
+    if (identity == NULL || field < 0 || field >= DEVICE_IDENTITY_FIELD_COUNT) {
+        return "";
+    }
+
+    return identity->data + identity->offset[field];
+}
+
+size_t device_identity_length(const device_identity_t *identity, device_identity_field_t field) {
+    if (identity == NULL || field < 0 || field >= DEVICE_IDENTITY_FIELD_COUNT) {
+        return 0;
+    }
+
+    return identity->length[field];
+}
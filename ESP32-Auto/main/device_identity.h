@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Compact device identity
+// All identity strings live NUL-terminated in one buffer, addressed by
+// offset/length. An identity is built once and then shared read-only by
+// pointer between AOA, the USB string descriptors and protobuf DeviceInfo.
+
+#define DEVICE_IDENTITY_DATA_SIZE   256     // All six strings, including NULs
+
+// Field order matches the AOA string indices (AOA_STRING_*)
+typedef enum {
+    DEVICE_IDENTITY_MANUFACTURER = AOA_STRING_MANUFACTURER,
+    DEVICE_IDENTITY_MODEL = AOA_STRING_MODEL,
+    DEVICE_IDENTITY_DESCRIPTION = AOA_STRING_DESCRIPTION,
+    DEVICE_IDENTITY_VERSION = AOA_STRING_VERSION,
+    DEVICE_IDENTITY_URI = AOA_STRING_URI,
+    DEVICE_IDENTITY_SERIAL = AOA_STRING_SERIAL,
+    DEVICE_IDENTITY_FIELD_COUNT
+} device_identity_field_t;
+
+// Source strings, e.g. from a constant table or config; only read at build time
+typedef struct {
+    const char *manufacturer;
+    const char *model;
+    const char *description;
+    const char *version;
+    const char *uri;
+    const char *serial;
+} device_identity_config_t;
+
+typedef struct {
+    uint8_t offset[DEVICE_IDENTITY_FIELD_COUNT];
+    uint8_t length[DEVICE_IDENTITY_FIELD_COUNT];
+    uint16_t size;              // Bytes used in data
+    char data[DEVICE_IDENTITY_DATA_SIZE];
+} device_identity_t;
+
+// Device identity functions
+status_t device_identity_build(device_identity_t *identity, const device_identity_config_t *config);
+const char* device_identity_get(const device_identity_t *identity, device_identity_field_t field);
+size_t device_identity_length(const device_identity_t *identity, device_identity_field_t field);
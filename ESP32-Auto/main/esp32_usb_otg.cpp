@@ -6,6 +6,8 @@
 #include "hal/usb_hal.h"
 #include "hal/gpio_hal.h"
 #include "esp32_usb_otg.h"
+#include "hot_path.h"
+#include "trace.h"
 
 static const char *TAG = "ESP32_USB_OTG";
 
@@ -15,16 +17,20 @@ static bool g_usb_initialized = false;
 static bool g_device_configured = false;
 static uint8_t g_device_address = 0;
 static bool g_is_connected = false;
+static usb_otg_event_stats_t g_event_stats;
+static uint32_t g_fifo_timeout_us = 1000;
 
 // Interrupt callback function
 static void (*g_usb_callback)(uint8_t event, void *data) = NULL;
 
 // Internal functions
-static void usb_otg_isr_handler(void *arg);
-static void handle_reset_interrupt(void);
-static void handle_enum_done_interrupt(void);
-static void handle_rx_status_interrupt(void);
-static void handle_endpoint_interrupt(uint8_t ep_num, bool is_in);
+static void usb_otg_write_address(uint8_t addr);
+static void usb_otg_ep_configure(uint8_t ep_num, bool is_in, uint16_t max_packet, uint8_t ep_type);
+static void usb_otg_ep_enable(uint8_t ep_num, bool is_in);
+static void usb_otg_ep_disable(uint8_t ep_num, bool is_in);
+static void handle_reset_event(void);
+static void handle_enum_done_event(void);
+static void handle_endpoint_event(uint8_t ep_num, bool is_in);
 
 esp_err_t esp32_usb_otg_init(void) {
     ESP_LOGI(TAG, "Initializing ESP32-S3 USB OTG in device mode");
@@ -50,19 +56,17 @@ esp_err_t esp32_usb_otg_init(void) {
     g_usb_regs->core.gusbcfg &= ~GUSBCFG_FHMOD;  // Clear host mode
     g_usb_regs->core.gusbcfg |= GUSBCFG_FDMOD;   // Set device mode
     
-    // Configure core settings
-    g_usb_regs->core.gahbcfg = GAHBCFG_GINT | GAHBCFG_TXFELVL | GAHBCFG_HBSTLEN_16;
+    // Configure core settings; GINT stays clear, the core is polled
+    g_usb_regs->core.gahbcfg = GAHBCFG_HBSTLEN_16;
     
     // Set device speed to Full Speed (12 Mbps)
     g_usb_regs->core.dcfg |= DCFG_DSPD_FS;
     
-    // Unmask interrupts
-    g_usb_regs->core.gintmsk = GINTSTS_USBRST | GINTSTS_ENUMDNE | GINTSTS_RXFLVL | 
-                                 GINTSTS_IEPINT | GINTSTS_OEPINT | GINTSTS_USBSUSP |
-                                 GINTSTS_USBRST | GINTSTS_ENUMDNE;
-    
-    // Enable USB interrupt
-    // TODO: Register interrupt handler with ESP32 interrupt controller
+    // Events esp32_usb_otg_poll() services. RXFLVL and the TX FIFO empty
+    // events stay masked: the read and write paths check the FIFOs
+    // themselves, and nothing else may pop the RX FIFO.
+    g_usb_regs->core.gintmsk = GINTSTS_USBRST | GINTSTS_ENUMDNE | GINTSTS_IEPINT |
+                                 GINTSTS_OEPINT | GINTSTS_USBSUSP;
     
     g_usb_initialized = true;
     g_device_configured = false;
@@ -148,14 +152,7 @@ esp_err_t esp32_usb_otg_set_address(uint8_t addr) {
     }
     
     ESP_LOGI(TAG, "Setting USB device address: %d", addr);
-    
-    // Set device address in DCFG register
-    uint32_t dcfg = g_usb_regs->core.dcfg;
-    dcfg &= ~DCFG_DEVADDR_MASK;
-    dcfg |= ((uint32_t)addr << DCFG_DEVADDR_SHIFT) & DCFG_DEVADDR_MASK;
-    g_usb_regs->core.dcfg = dcfg;
-    
-    g_device_address = addr;
+    usb_otg_write_address(addr);
     return ESP_OK;
 }
 
@@ -171,44 +168,7 @@ esp_err_t esp32_usb_otg_configure_endpoint(uint8_t ep_num, bool is_in, uint16_t
     ESP_LOGI(TAG, "Configuring EP %d (IN: %d) - Max Packet: %d, Type: %d", 
              ep_num, is_in, max_packet, ep_type);
     
-    if (is_in) {
-        // Configure IN endpoint
-        usb_otg_in_ep_regs_t *ep = &g_usb_regs->in_ep[ep_num];
-        
-        uint32_t depctl = 0;
-        depctl |= DEPCTL_MPS(max_packet & 0x7FF);
-        depctl |= ((uint32_t)ep_type << DEPCTL_EPTYPE_SHIFT) & DEPCTL_EPTYPE_MASK;
-        depctl |= DEPCTL_USBACTEP;
-        
-        // Clear stall and enable
-        depctl &= ~DEPCTL_STALL;
-        
-        // For non-control endpoints, set the endpoint type
-        if (ep_num != 0) {
-            ep->diepctl = depctl;
-        } else {
-            // EP0 uses different register
-            g_usb_regs->core.in_ep[0].diepctl = depctl;
-        }
-    } else {
-        // Configure OUT endpoint
-        usb_otg_out_ep_regs_t *ep = &g_usb_regs->out_ep[ep_num];
-        
-        uint32_t depctl = 0;
-        depctl |= DEPCTL_MPS(max_packet & 0x7FF);
-        depctl |= ((uint32_t)ep_type << DEPCTL_EPTYPE_SHIFT) & DEPCTL_EPTYPE_MASK;
-        depctl |= DEPCTL_USBACTEP;
-        
-        // Clear stall
-        depctl &= ~DEPCTL_STALL;
-        
-        if (ep_num != 0) {
-            ep->doepctl = depctl;
-        } else {
-            g_usb_regs->core.out_ep[0].doepctl = depctl;
-        }
-    }
-    
+    usb_otg_ep_configure(ep_num, is_in, max_packet, ep_type);
     return ESP_OK;
 }
 
@@ -219,23 +179,7 @@ esp_err_t esp32_usb_otg_enable_endpoint(uint8_t ep_num, bool is_in) {
     
     ESP_LOGD(TAG, "Enabling EP %d (IN: %d)", ep_num, is_in);
     
-    if (is_in) {
-        // Enable IN endpoint
-        usb_otg_in_ep_regs_t *ep = &g_usb_regs->in_ep[ep_num];
-        ep->diepctl |= DEPCTL_EPENA;
-        
-        // Unmask endpoint interrupt
-        g_usb_regs->core.diepempmsk |= (1 << ep_num);
-        g_usb_regs->core.diepmsk |= (1 << ep_num);
-    } else {
-        // Enable OUT endpoint
-        usb_otg_out_ep_regs_t *ep = &g_usb_regs->out_ep[ep_num];
-        ep->doepctl |= DEPCTL_EPENA;
-        
-        // Unmask endpoint interrupt
-        g_usb_regs->core.doepmsk |= (1 << ep_num);
-    }
-    
+    usb_otg_ep_enable(ep_num, is_in);
     return ESP_OK;
 }
 
@@ -246,27 +190,11 @@ esp_err_t esp32_usb_otg_disable_endpoint(uint8_t ep_num, bool is_in) {
     
     ESP_LOGD(TAG, "Disabling EP %d (IN: %d)", ep_num, is_in);
     
-    if (is_in) {
-        // Disable IN endpoint
-        usb_otg_in_ep_regs_t *ep = &g_usb_regs->in_ep[ep_num];
-        ep->diepctl &= ~DEPCTL_EPENA;
-        
-        // Mask endpoint interrupt
-        g_usb_regs->core.diepempmsk &= ~(1 << ep_num);
-        g_usb_regs->core.diepmsk &= ~(1 << ep_num);
-    } else {
-        // Disable OUT endpoint
-        usb_otg_out_ep_regs_t *ep = &g_usb_regs->out_ep[ep_num];
-        ep->doepctl &= ~DEPCTL_EPENA;
-        
-        // Mask endpoint interrupt
-        g_usb_regs->core.doepmsk &= ~(1 << ep_num);
-    }
-    
+    usb_otg_ep_disable(ep_num, is_in);
     return ESP_OK;
 }
 
-esp_err_t esp32_usb_otg_write_endpoint(uint8_t ep_num, uint8_t *data, uint16_t length, uint16_t *transferred) {
+HOT_PATH esp_err_t esp32_usb_otg_write_endpoint(uint8_t ep_num, uint8_t *data, uint16_t length, uint16_t *transferred) {
     if (g_usb_regs == NULL || !g_usb_initialized || data == NULL || transferred == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
@@ -275,7 +203,7 @@ esp_err_t esp32_usb_otg_write_endpoint(uint8_t ep_num, uint8_t *data, uint16_t l
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGD(TAG, "Writing %d bytes to EP %d (IN)", length, ep_num);
+    TRACE("FIFO write %u bytes to EP %u", length, ep_num);
     
     *transferred = 0;
     uint16_t remaining = length;
@@ -285,13 +213,16 @@ esp_err_t esp32_usb_otg_write_endpoint(uint8_t ep_num, uint8_t *data, uint16_t l
     usb_otg_in_ep_regs_t *ep = &g_usb_regs->in_ep[ep_num];
     
     // Wait for endpoint to be ready
-    uint32_t timeout = 1000;
+    if (!(ep->dtxfsts & (1 << 0))) {
+        g_event_stats.tx_fifo_full++;
+    }
+    uint32_t timeout = g_fifo_timeout_us;
     while (!(ep->dtxfsts & (1 << 0)) && timeout--) {
         esp_rom_delay_us(1);
     }
     
     if (timeout == 0) {
-        ESP_LOGW(TAG, "EP %d FIFO not ready for write", ep_num);
+        TRACE("EP %u FIFO not ready for write", ep_num);
         return ESP_ERR_TIMEOUT;
     }
     
@@ -319,15 +250,15 @@ esp_err_t esp32_usb_otg_write_endpoint(uint8_t ep_num, uint8_t *data, uint16_t l
     }
     
     if (timeout == 0) {
-        ESP_LOGW(TAG, "Timeout writing to EP %d FIFO", ep_num);
+        TRACE("Timeout writing to EP %u FIFO", ep_num);
         return ESP_ERR_TIMEOUT;
     }
     
-    ESP_LOGD(TAG, "Successfully wrote %d bytes to EP %d", *transferred, ep_num);
+    TRACE("FIFO wrote %u bytes to EP %u", *transferred, ep_num);
     return ESP_OK;
 }
 
-esp_err_t esp32_usb_otg_read_endpoint(uint8_t ep_num, uint8_t *data, uint16_t length, uint16_t *received) {
+HOT_PATH esp_err_t esp32_usb_otg_read_endpoint(uint8_t ep_num, uint8_t *data, uint16_t length, uint16_t *received) {
     if (g_usb_regs == NULL || !g_usb_initialized || data == NULL || received == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
@@ -336,7 +267,9 @@ esp_err_t esp32_usb_otg_read_endpoint(uint8_t ep_num, uint8_t *data, uint16_t le
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGD(TAG, "Reading up to %d bytes from EP %d (OUT)", length, ep_num);
+    // The reader polls every millisecond, so it also services the core
+    // events; one caller keeps every event counter single-writer
+    esp32_usb_otg_poll();
     
     *received = 0;
     uint16_t available_length = length;
@@ -371,8 +304,9 @@ esp_err_t esp32_usb_otg_read_endpoint(uint8_t ep_num, uint8_t *data, uint16_t le
     
     // Pop the FIFO entry
     g_usb_regs->core.grxstsr = grxstsr;
+    g_event_stats.rx_packets++;
     
-    ESP_LOGD(TAG, "Successfully read %d bytes from EP %d", *received, ep_num);
+    TRACE("FIFO read %u bytes from EP %u", *received, ep_num);
     return ESP_OK;
 }
 
@@ -414,99 +348,215 @@ void esp32_usb_otg_print_status(void) {
     ESP_LOGI(TAG, "Device Status: 0x%08lX", dsts);
     ESP_LOGI(TAG, "OTG Control: 0x%08lX", gotgctl);
     ESP_LOGI(TAG, "USB Config: 0x%08lX", gusbcfg);
+    ESP_LOGI(TAG, "Events: %lu polled, %lu resets, %lu IN, %lu OUT, %lu RX packets",
+             (unsigned long)g_event_stats.polls, (unsigned long)g_event_stats.resets,
+             (unsigned long)g_event_stats.in_ep, (unsigned long)g_event_stats.out_ep,
+             (unsigned long)g_event_stats.rx_packets);
 }
 
-// Interrupt handlers (simplified)
-static void usb_otg_isr_handler(void *arg) {
-    if (g_usb_regs == NULL) {
+// Register-only helpers shared by the API and esp32_usb_otg_poll(), which
+// runs on the data path and must not log
+
+static void IRAM_ATTR usb_otg_write_address(uint8_t addr) {
+    // Set device address in DCFG register
+    uint32_t dcfg = g_usb_regs->core.dcfg;
+    dcfg &= ~DCFG_DEVADDR_MASK;
+    dcfg |= ((uint32_t)addr << DCFG_DEVADDR_SHIFT) & DCFG_DEVADDR_MASK;
+    g_usb_regs->core.dcfg = dcfg;
+    
+    g_device_address = addr;
+}
+
+static void IRAM_ATTR usb_otg_ep_configure(uint8_t ep_num, bool is_in, uint16_t max_packet, uint8_t ep_type) {
+    uint32_t depctl = 0;
+    depctl |= DEPCTL_MPS(max_packet & 0x7FF);
+    depctl |= ((uint32_t)ep_type << DEPCTL_EPTYPE_SHIFT) & DEPCTL_EPTYPE_MASK;
+    depctl |= DEPCTL_USBACTEP;
+    
+    // Clear stall
+    depctl &= ~DEPCTL_STALL;
+    
+    if (is_in) {
+        // EP0 uses different register
+        if (ep_num != 0) {
+            g_usb_regs->in_ep[ep_num].diepctl = depctl;
+        } else {
+            g_usb_regs->core.in_ep[0].diepctl = depctl;
+        }
+    } else {
+        if (ep_num != 0) {
+            g_usb_regs->out_ep[ep_num].doepctl = depctl;
+        } else {
+            g_usb_regs->core.out_ep[0].doepctl = depctl;
+        }
+    }
+}
+
+static void IRAM_ATTR usb_otg_ep_enable(uint8_t ep_num, bool is_in) {
+    if (is_in) {
+        g_usb_regs->in_ep[ep_num].diepctl |= DEPCTL_EPENA;
+        
+        // Report the endpoint's events to the poll. TX FIFO empty stays
+        // masked; the write path waits on DTXFSTS instead
+        g_usb_regs->core.diepmsk |= (1 << ep_num);
+    } else {
+        g_usb_regs->out_ep[ep_num].doepctl |= DEPCTL_EPENA;
+        
+        // Report the endpoint's events to the poll
+        g_usb_regs->core.doepmsk |= (1 << ep_num);
+    }
+}
+
+static void IRAM_ATTR usb_otg_ep_disable(uint8_t ep_num, bool is_in) {
+    if (is_in) {
+        g_usb_regs->in_ep[ep_num].diepctl &= ~DEPCTL_EPENA;
+        
+        // Stop reporting the endpoint's events
+        g_usb_regs->core.diepmsk &= ~(1 << ep_num);
+    } else {
+        g_usb_regs->out_ep[ep_num].doepctl &= ~DEPCTL_EPENA;
+        
+        // Stop reporting the endpoint's events
+        g_usb_regs->core.doepmsk &= ~(1 << ep_num);
+    }
+}
+
+void esp32_usb_otg_get_event_stats(usb_otg_event_stats_t *stats) {
+    if (stats != NULL) {
+        *stats = g_event_stats;
+    }
+}
+
+void esp32_usb_otg_set_fifo_timeout(uint32_t timeout_us) {
+    g_fifo_timeout_us = (timeout_us > 0) ? timeout_us : 1;
+}
+
+uint16_t esp32_usb_otg_rx_pending(uint8_t ep_num) {
+    if (g_usb_regs == NULL || !g_usb_initialized || ep_num > 15) {
+        return 0;
+    }
+    
+    // Status read, not pop; decoded as esp32_usb_otg_read_endpoint() does
+    uint32_t grxstsr = g_usb_regs->core.grxstsr;
+    if ((grxstsr & 0x7F) != ep_num) {
+        return 0;
+    }
+    return (grxstsr >> 16) & 0x7FF;
+}
+
+void esp32_usb_otg_trace_state(uint8_t ep_num) {
+    if (g_usb_regs == NULL || !g_usb_initialized || ep_num > 15) {
         return;
     }
     
-    uint32_t gintsts = g_usb_regs->core.gintsts;
-    uint32_t gintmsk = g_usb_regs->core.gintmsk;
-    uint32_t active_ints = gintsts & gintmsk;
+    // Two registers per record; tools/trace_decode.py prints them in order
+    TRACE("USB gintsts 0x%08x gintmsk 0x%08x", g_usb_regs->core.gintsts, g_usb_regs->core.gintmsk);
+    TRACE("USB grxstsr 0x%08x gnptxsts 0x%08x", g_usb_regs->core.grxstsr, g_usb_regs->core.gnptxsts);
+    TRACE("USB dsts 0x%08x dctl 0x%08x", g_usb_regs->core.dsts, g_usb_regs->core.dctl);
+    TRACE("USB EP IN diepctl 0x%08x diepint 0x%08x", g_usb_regs->in_ep[ep_num].diepctl,
+          g_usb_regs->in_ep[ep_num].diepint);
+    TRACE("USB EP IN dieptsiz 0x%08x dtxfsts 0x%08x", g_usb_regs->in_ep[ep_num].dieptsiz,
+          g_usb_regs->in_ep[ep_num].dtxfsts);
+    TRACE("USB EP OUT doepctl 0x%08x doepint 0x%08x", g_usb_regs->out_ep[ep_num].doepctl,
+          g_usb_regs->out_ep[ep_num].doepint);
+    TRACE("USB EP OUT doeptsiz 0x%08x, RX packets %u", g_usb_regs->out_ep[ep_num].doeptsiz,
+          g_event_stats.rx_packets);
+}
+
+// Drops whatever the host has not collected from this IN endpoint
+esp_err_t esp32_usb_otg_flush_tx_fifo(uint8_t ep_num) {
+    if (g_usb_regs == NULL || !g_usb_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
     
-    if (active_ints & GINTSTS_USBRST) {
-        ESP_LOGI(TAG, "USB Reset detected");
-        handle_reset_interrupt();
+    if (ep_num > 15) {
+        return ESP_ERR_INVALID_ARG;
     }
     
-    if (active_ints & GINTSTS_ENUMDNE) {
-        ESP_LOGI(TAG, "Enumeration done");
-        handle_enum_done_interrupt();
+    ESP_LOGD(TAG, "Flushing TX FIFO %d", ep_num);
+    
+    g_usb_regs->core.grstctl = GRSTCTL_TXFFLSH | ((uint32_t)ep_num << GRSTCTL_TXFNUM_SHIFT);
+    
+    // The core clears the bit when the flush is done
+    uint32_t timeout = 1000;
+    while ((g_usb_regs->core.grstctl & GRSTCTL_TXFFLSH) && timeout > 0) {
+        esp_rom_delay_us(1);
+        timeout--;
     }
     
-    if (active_ints & GINTSTS_RXFLVL) {
-        ESP_LOGD(TAG, "RX FIFO level interrupt");
-        handle_rx_status_interrupt();
+    return (timeout > 0) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// Core events, polled (simplified). GINTSTS latches an event whether or
+// not it is unmasked; only the events in GINTMSK are handled here.
+HOT_PATH void esp32_usb_otg_poll(void) {
+    if (g_usb_regs == NULL || !g_usb_initialized) {
+        return;
     }
     
-    if (active_ints & GINTSTS_IEPINT) {
-        ESP_LOGD(TAG, "IN endpoint interrupt");
-        handle_endpoint_interrupt(0, true);  // Simplified
+    uint32_t active = g_usb_regs->core.gintsts & g_usb_regs->core.gintmsk;
+    if (active == 0) {
+        return;
     }
     
-    if (active_ints & GINTSTS_OEPINT) {
-        ESP_LOGD(TAG, "OUT endpoint interrupt");
-        handle_endpoint_interrupt(0, false);  // Simplified
+    g_event_stats.polls++;
+    
+    if (active & GINTSTS_USBRST) {
+        g_event_stats.resets++;
+        handle_reset_event();
     }
     
-    // Clear interrupts
-    g_usb_regs->core.gintsts = active_ints;
+    if (active & GINTSTS_ENUMDNE) {
+        g_event_stats.enum_done++;
+        handle_enum_done_event();
+    }
+    
+    if (active & GINTSTS_IEPINT) {
+        g_event_stats.in_ep++;
+        handle_endpoint_event(0, true);  // Simplified
+    }
+    
+    if (active & GINTSTS_OEPINT) {
+        g_event_stats.out_ep++;
+        handle_endpoint_event(0, false);  // Simplified
+    }
+    
+    // Clear the latched events
+    g_usb_regs->core.gintsts = active;
 }
 
-static void handle_reset_interrupt(void) {
-    ESP_LOGI(TAG, "Handling USB reset");
-    
+static void IRAM_ATTR handle_reset_event(void) {
     // Reset device address
-    esp32_usb_otg_set_address(0);
+    usb_otg_write_address(0);
     
     // Re-initialize endpoints
     for (int i = 0; i < 16; i++) {
-        esp32_usb_otg_disable_endpoint(i, true);
-        esp32_usb_otg_disable_endpoint(i, false);
+        usb_otg_ep_disable(i, true);
+        usb_otg_ep_disable(i, false);
     }
     
     g_device_configured = false;
     g_is_connected = false;
 }
 
-static void handle_enum_done_interrupt(void) {
-    ESP_LOGI(TAG, "Handling enumeration complete");
-    
+static void IRAM_ATTR handle_enum_done_event(void) {
     // Device should now be configured
     g_device_configured = true;
     g_is_connected = true;
     
     // Enable data endpoints
-    esp32_usb_otg_configure_endpoint(1, true, 64, DEPCTL_EPTYPE_BULK);
-    esp32_usb_otg_configure_endpoint(1, false, 64, DEPCTL_EPTYPE_BULK);
-    esp32_usb_otg_enable_endpoint(1, true);
-    esp32_usb_otg_enable_endpoint(1, false);
-}
-
-static void handle_rx_status_interrupt(void) {
-    ESP_LOGD(TAG, "Handling RX status");
-    // Handle RX FIFO status
-    uint32_t grxstsr = g_usb_regs->core.grxstsr;
-    
-    // Read and clear status
-    g_usb_regs->core.grxstsr = grxstsr;
+    usb_otg_ep_configure(1, true, 64, DEPCTL_EPTYPE_BULK);
+    usb_otg_ep_configure(1, false, 64, DEPCTL_EPTYPE_BULK);
+    usb_otg_ep_enable(1, true);
+    usb_otg_ep_enable(1, false);
 }
 
-static void handle_endpoint_interrupt(uint8_t ep_num, bool is_in) {
-    ESP_LOGD(TAG, "Handling endpoint interrupt: EP %d IN:%d", ep_num, is_in);
-    
+static void IRAM_ATTR handle_endpoint_event(uint8_t ep_num, bool is_in) {
     if (is_in) {
         uint32_t diepint = g_usb_regs->core.diepint;
         if (diepint & (1 << ep_num)) {
             // Clear interrupt
             g_usb_regs->core.diepint = (1 << ep_num);
-            
-            uint32_t dtxfsts = g_usb_regs->core.in_ep[ep_num].dtxfsts;
-            if (dtxfsts & (1 << 6)) {
-                ESP_LOGD(TAG, "EP %d TX FIFO empty", ep_num);
-            }
         }
     } else {
         uint32_t doepint = g_usb_regs->core.doepint;
@@ -516,8 +566,8 @@ static void handle_endpoint_interrupt(uint8_t ep_num, bool is_in) {
             
             uint32_t doeptsiz = g_usb_regs->core.out_ep[ep_num].doeptsiz;
             if (doeptsiz & (1 << 19)) {
-                ESP_LOGD(TAG, "EP %d Transfer complete", ep_num);
+                g_event_stats.transfers++;
             }
         }
     }
-}
\ No newline at end of file
+}
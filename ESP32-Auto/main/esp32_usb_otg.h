@@ -260,5 +260,30 @@ esp_err_t esp32_usb_otg_enable_endpoint(uint8_t ep_num, bool is_in);
 esp_err_t esp32_usb_otg_disable_endpoint(uint8_t ep_num, bool is_in);
 esp_err_t esp32_usb_otg_write_endpoint(uint8_t ep_num, uint8_t *data, uint16_t length, uint16_t *transferred);
 esp_err_t esp32_usb_otg_read_endpoint(uint8_t ep_num, uint8_t *data, uint16_t length, uint16_t *received);
+void esp32_usb_otg_set_fifo_timeout(uint32_t timeout_us);  // Wait for IN FIFO space, per write
 bool esp32_usb_otg_is_connected(void);
-void esp32_usb_otg_print_status(void);
\ No newline at end of file
+void esp32_usb_otg_print_status(void);
+
+// The core's interrupt line is not used: events are polled from the
+// reader (esp32_usb_otg_read_endpoint), which calls this every time
+void esp32_usb_otg_poll(void);
+
+// Counted on the data path, which cannot log. Each field has one writer:
+// the reader, except tx_fifo_full, which the writer counts
+typedef struct {
+    uint32_t polls;             // Polls that found events
+    uint32_t resets;
+    uint32_t enum_done;
+    uint32_t in_ep;
+    uint32_t out_ep;
+    uint32_t transfers;
+    uint32_t rx_packets;        // RX FIFO entries popped
+    uint32_t tx_fifo_full;      // Writes that had to wait for IN FIFO space
+} usb_otg_event_stats_t;
+
+void esp32_usb_otg_get_event_stats(usb_otg_event_stats_t *stats);
+
+// Stall diagnosis and recovery, for the proxy's stall watch
+uint16_t esp32_usb_otg_rx_pending(uint8_t ep_num);       // Bytes at the top of the RX FIFO for this EP
+void esp32_usb_otg_trace_state(uint8_t ep_num);           // Core and EP registers into the trace ring
+esp_err_t esp32_usb_otg_flush_tx_fifo(uint8_t ep_num);
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "telemetry.h"
+
+// Data-path placement and profiling
+// Everything a forwarded packet runs through lives in IRAM: the USB OTG
+// event poll, the endpoint FIFO copies, usb_bulk_transfer(), the proxy
+// forwarding functions and, via linker.lf, the frame scanner and latency
+// histogram (pure modules that stay free of IDF headers). A flash cache
+// miss then cannot add a refill to a packet. lwIP's own hot path is placed by
+// CONFIG_LWIP_IRAM_OPTIMIZATION.
+//
+// Build with HOT_PATH_IRAM=0 to leave the annotated functions in flash,
+// and with HOT_PATH_PROFILE=1 to histogram CPU cycles per forwarded
+// packet; comparing the two shows what cache misses cost.
+
+#ifndef HOT_PATH_IRAM
+#define HOT_PATH_IRAM 1
+#endif
+
+#ifndef HOT_PATH_PROFILE
+#define HOT_PATH_PROFILE 0
+#endif
+
+#if HOT_PATH_IRAM
+#define HOT_PATH IRAM_ATTR
+#else
+#define HOT_PATH
+#endif
+
+typedef struct {
+    uint32_t start;
+    int core;
+} hot_path_sample_t;
+
+#if HOT_PATH_PROFILE
+
+static inline __attribute__((always_inline)) void hot_path_begin(hot_path_sample_t *sample) {
+    sample->core = esp_cpu_get_core_id();
+    sample->start = esp_cpu_get_cycle_count();
+}
+
+// Cycle counters are per core; a sample that migrated is dropped
+static inline __attribute__((always_inline)) void hot_path_end(hot_path_sample_t *sample,
+                                                               latency_histogram_t *cycles) {
+    uint32_t end = esp_cpu_get_cycle_count();
+    if (esp_cpu_get_core_id() == sample->core) {
+        latency_histogram_record(cycles, end - sample->start);
+    }
+}
+
+#else
+
+static inline __attribute__((always_inline)) void hot_path_begin(hot_path_sample_t *sample) {
+}
+
+static inline __attribute__((always_inline)) void hot_path_end(hot_path_sample_t *sample,
+                                                               latency_histogram_t *cycles) {
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "nvs_flash.h"
 #include "esp_bt.h"
 #include "esp_bt_main.h"
@@ -17,26 +18,32 @@
 #include "driver/usb_serial_jtag.h"
 
 #include "common.h"
+#include "device_identity.h"
 #include "usb_gadget.h"
 #include "aoa_protocol.h"
 #include "wifi_hotspot.h"
 #include "bluetooth_manager.h"
+#include "bootstrap_service.h"
+#include "telemetry_service.h"
+#include "metrics_server.h"
 #include "proxy_handler.h"
+#include "proto_handler.h"
+#include "boot_profile.h"
+#include "connection_manager.h"
+#include "reconnect_cache.h"
+#include "config_store.h"
+#include "task_plan.h"
+#include "mem_plan.h"
+#include "trace.h"
 
 static const char *TAG = "ESP32_AUTO";
 
 // Global connection strategy
 static connection_strategy_t g_connection_strategy = CONNECTION_STRATEGY_PHONE_FIRST;
 
-// Event group for status synchronization
-static EventGroupHandle_t g_event_group;
-static const int CONNECTED_EVENT = BIT0;
-static const int AOA_READY_EVENT = BIT1;
-static const int WIFI_READY_EVENT = BIT2;
-static const int BT_READY_EVENT = BIT3;
-
-// Device information for AOA
-static device_info_t g_device_info = {
+// Device information for AOA, USB and protobuf; built once in app_main
+static device_identity_t g_device_identity;
+static const device_identity_config_t g_device_info = {
     .manufacturer = "ESP32 Wireless",
     .model = "ESP32-Auto",
     .description = "ESP32 Wireless Android Auto Adapter",
@@ -45,13 +52,36 @@ static device_info_t g_device_info = {
     .serial = "ESP32-AUTO-001"
 };
 
+// Bring-up completion
+static StaticEventGroup_t g_init_group_buffer;
+static EventGroupHandle_t g_init_group;
+static const int INIT_NVS_DONE = BIT0;
+static const int INIT_WIFI_DONE = BIT1;
+static const int INIT_BT_DONE = BIT2;
+static const int INIT_USB_DONE = BIT3;
+static const int INIT_FAILED = BIT7;
+
+// What the last phone negotiated; all zero on a cold start
+static reconnect_cache_t g_reconnect;
+static bool g_session_streamed = false;
+
+#define HOTSPOT_SSID "ESP32-Auto"
+#define HOTSPOT_PASSWORD "ESP32AutoConnect"
+#define HOTSPOT_IP "192.168.4.1"            // SoftAP netif default
+
 // Function prototypes
 static status_t init_nvs(void);
 static status_t init_wifi(void);
 static status_t init_bluetooth(void);
 static status_t init_usb(void);
-static void wait_for_connections(void);
+static status_t init_subsystems(void);
+static void stop_session(void);
+static status_t restart_wifi(void);
+static status_t restart_bluetooth(void);
+static status_t restart_usb(void);
+static status_t restart_proxy(void);
 static status_t start_accessory_mode(void);
+static void session_streaming(int64_t connect_us);
 
 static status_t init_nvs(void) {
     esp_err_t ret = nvs_flash_init();
@@ -59,20 +89,42 @@ static status_t init_nvs(void) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
-    return (ret == ESP_OK) ? STATUS_OK : STATUS_ERROR_INIT;
+    if (ret != ESP_OK) {
+        return STATUS_ERROR_INIT;
+    }
+    
+    // Everything below NVS in the bring-up reads the cache and the
+    // configuration, so load both here
+    if (reconnect_cache_init() == STATUS_OK) {
+        boot_profile_set_warm(reconnect_cache_get(&g_reconnect));
+    }
+    return config_store_init();
 }
 
 static status_t init_wifi(void) {
     ESP_LOGI(TAG, "Initializing WiFi");
     
+    // Before init, so the profile's buffer budget is used
+    wifi_hotspot_set_profile((wifi_profile_t)config_get(CONFIG_WIFI_PROFILE));
+    proxy_set_tcp_nodelay(wifi_hotspot_get_profile_params()->tcp_nodelay);
+    
     status_t ret = wifi_hotspot_init();
     if (ret != STATUS_OK) return ret;
     
-    ret = wifi_hotspot_start("ESP32-Auto", "ESP32AutoConnect");
+    // Come up where the phone found us last time, skipping the channel scan
+    if (g_reconnect.wifi_channel != 0) {
+        wifi_hotspot_set_channel(g_reconnect.wifi_channel);
+    }
+    
+    ret = wifi_hotspot_start(HOTSPOT_SSID, HOTSPOT_PASSWORD);
     if (ret != STATUS_OK) return ret;
     
+    // Diagnostics only; the session does not depend on it
+    if (metrics_server_start() != STATUS_OK) {
+        ESP_LOGW(TAG, "Metrics server not available");
+    }
+    
     ESP_LOGI(TAG, "WiFi hotspot started");
-    xEventGroupSetBits(g_event_group, WIFI_READY_EVENT);
     return STATUS_OK;
 }
 
@@ -82,11 +134,35 @@ static status_t init_bluetooth(void) {
     status_t ret = bluetooth_init();
     if (ret != STATUS_OK) return ret;
     
+    // Wireless bootstrap: tells the phone which hotspot and port to use
+    static char bssid[18];
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_SOFTAP);
+    snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    
+    wireless_bootstrap_config_t bootstrap_config = {
+        .ssid = HOTSPOT_SSID,
+        .key = HOTSPOT_PASSWORD,
+        .bssid = bssid,
+        .ip_address = HOTSPOT_IP,
+        .port = proxy_get_tcp_port(),
+        .security_mode = PROTO_SECURITY_MODE_WPA_WPA2_PERSONAL,
+        .access_point_type = PROTO_ACCESS_POINT_TYPE_STATIC
+    };
+    ret = bootstrap_service_init(&bootstrap_config);
+    if (ret != STATUS_OK) {
+        ESP_LOGW(TAG, "Wireless bootstrap unavailable, phone must join the hotspot by hand");
+    }
+    
+    if (telemetry_service_init() != STATUS_OK) {
+        ESP_LOGW(TAG, "BLE telemetry unavailable");
+    }
+    
     ret = bluetooth_start_advertising();
     if (ret != STATUS_OK) return ret;
     
     ESP_LOGI(TAG, "Bluetooth initialized and advertising");
-    xEventGroupSetBits(g_event_group, BT_READY_EVENT);
     return STATUS_OK;
 }
 
@@ -106,50 +182,26 @@ static status_t init_usb(void) {
         return ret;
     }
     
-    // Set device information for AOA
-    ret = aoa_set_device_info(&g_device_info);
+    // Set device information for AOA and the USB string descriptors
+    usb_set_device_identity(&g_device_identity);
+    ret = aoa_set_device_identity(&g_device_identity);
     if (ret != STATUS_OK) {
         ESP_LOGE(TAG, "Failed to set device info");
         return ret;
     }
     
     ESP_LOGI(TAG, "USB and AOA initialized");
-    xEventGroupSetBits(g_event_group, AOA_READY_EVENT);
     return STATUS_OK;
 }
 
-static void wait_for_connections(void) {
-    ESP_LOGI(TAG, "Waiting for connections based on strategy: %d", g_connection_strategy);
-    
-    switch (g_connection_strategy) {
-        case CONNECTION_STRATEGY_PHONE_FIRST:
-            ESP_LOGI(TAG, "Waiting for phone connection first...");
-            // Wait for WiFi and Bluetooth to be ready
-            xEventGroupWaitBits(g_event_group, WIFI_READY_EVENT | BT_READY_EVENT, 
-                               pdTRUE, pdTRUE, portMAX_DELAY);
-            break;
-            
-        case CONNECTION_STRATEGY_USB_FIRST:
-            ESP_LOGI(TAG, "Waiting for USB connection first...");
-            xEventGroupWaitBits(g_event_group, AOA_READY_EVENT, 
-                               pdTRUE, pdTRUE, portMAX_DELAY);
-            break;
-            
-        case CONNECTION_STRATEGY_DONGLE_MODE:
-            ESP_LOGI(TAG, "Dongle mode - waiting for all connections...");
-            xEventGroupWaitBits(g_event_group, WIFI_READY_EVENT | BT_READY_EVENT | AOA_READY_EVENT,
-                               pdTRUE, pdTRUE, portMAX_DELAY);
-            break;
-    }
-}
-
 static status_t start_accessory_mode(void) {
     ESP_LOGI(TAG, "Starting Android Accessory Mode");
-    ESP_LOGI(TAG, "Device: %s %s", g_device_info.manufacturer, g_device_info.model);
-    ESP_LOGI(TAG, "Description: %s", g_device_info.description);
+    ESP_LOGI(TAG, "Device: %s %s", device_identity_get(&g_device_identity, DEVICE_IDENTITY_MANUFACTURER),
+             device_identity_get(&g_device_identity, DEVICE_IDENTITY_MODEL));
+    ESP_LOGI(TAG, "Description: %s", device_identity_get(&g_device_identity, DEVICE_IDENTITY_DESCRIPTION));
     
     // Set device info for AOA
-    status_t ret = aoa_set_device_info(&g_device_info);
+    status_t ret = aoa_set_device_identity(&g_device_identity);
     if (ret != STATUS_OK) {
         ESP_LOGE(TAG, "Failed to set device info");
         return ret;
@@ -162,8 +214,8 @@ static status_t start_accessory_mode(void) {
         return ret;
     }
     
-    // Start proxy server
-    ret = proxy_start();
+    // Start proxy server, unless it was pre-armed for a known phone
+    ret = proxy_is_active() ? STATUS_OK : proxy_start();
     if (ret != STATUS_OK) {
         ESP_LOGE(TAG, "Failed to start proxy");
         return ret;
@@ -173,52 +225,256 @@ static status_t start_accessory_mode(void) {
     return STATUS_OK;
 }
 
-extern "C" void app_main(void) {
-    ESP_LOGI(TAG, "ESP32 Auto Wireless Android Adapter starting...");
+static void stop_session(void) {
+    proxy_stop();
+    
+    // Knobs set without a reconfigure take effect for the next session
+    proxy_reconfigure();
+    
+    // High-water marks now cover a whole session
+    mem_plan_log_report();
+}
+
+// Remembers what this session negotiated for the next ignition
+static void session_streaming(int64_t connect_us) {
+    reconnect_cache_t entry = {};
+    
+    if (!g_session_streamed) {
+        g_session_streamed = true;
+        boot_profile_end(BOOT_PHASE_SESSION, STATUS_OK);
+        boot_profile_log();
+    }
+    bootstrap_service_tcp_connected(proxy_get_connect_time_us());
+    
+    wifi_hotspot_get_station_mac(entry.phone_mac);
+    bluetooth_get_peer_address(entry.ble_addr);
+    entry.wifi_channel = wifi_hotspot_get_channel();
+    entry.aoa_version = aoa_get_protocol_version();
+    entry.audio_mode = (uint8_t)aoa_get_audio_mode();
+    entry.tcp_port = (uint16_t)proxy_get_tcp_port();
+    entry.last_connect_ms = (uint32_t)(connect_us / 1000);
+    
+    // Session count only carries over for the same phone
+    bool same_phone = reconnect_cache_is_warm() &&
+                      memcmp(entry.phone_mac, g_reconnect.phone_mac, sizeof(entry.phone_mac)) == 0;
+    entry.sessions = same_phone ? g_reconnect.sessions + 1 : 1;
+    
+    if (reconnect_cache_store(&entry) == STATUS_OK) {
+        g_reconnect = entry;
+    }
+}
+
+// Recovery hooks for the connection manager; each restarts one subsystem
+
+static status_t restart_wifi(void) {
+    wifi_hotspot_stop();
+    // Radio settings only; the buffer budget waits for the next boot
+    wifi_hotspot_set_profile((wifi_profile_t)config_get(CONFIG_WIFI_PROFILE));
+    proxy_set_tcp_nodelay(wifi_hotspot_get_profile_params()->tcp_nodelay);
+    return wifi_hotspot_start(HOTSPOT_SSID, HOTSPOT_PASSWORD);
+}
+
+static status_t restart_bluetooth(void) {
+    bluetooth_stop_advertising();
+    return bluetooth_start_advertising();
+}
+
+// The gadget is re-initialised on the core that does its endpoint I/O and
+// polls its events, not on whichever core the connection manager runs on
+#define USB_RESTART_TIMEOUT_MS 5000
+
+static volatile status_t g_usb_restart_result;
+
+static void restart_usb_task(void *pvParameters) {
+    usb_gadget_deinit();
+    g_usb_restart_result = init_usb();
+    task_plan_exit(TASK_ID_INIT_USB);
+}
+
+static status_t restart_usb(void) {
+    g_usb_restart_result = STATUS_ERROR_INIT;
+    if (task_plan_create(TASK_ID_INIT_USB, restart_usb_task, NULL, NULL) != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to create USB restart task");
+        return STATUS_ERROR_MEMORY;
+    }
+    
+    status_t ret = task_plan_join(TASK_ID_INIT_USB, USB_RESTART_TIMEOUT_MS);
+    return (ret == STATUS_OK) ? g_usb_restart_result : ret;
+}
+
+static status_t restart_proxy(void) {
+    proxy_deinit();
+    return proxy_init();
+}
+
+static const connection_ops_t g_connection_ops = {
+    .start_session = start_accessory_mode,
+    .stop_session = stop_session,
+    .session_streaming = session_streaming,
+    .restart = {
+        restart_wifi,           // CONN_SUBSYS_WIFI
+        restart_bluetooth,      // CONN_SUBSYS_BLUETOOTH
+        restart_usb,            // CONN_SUBSYS_USB
+        restart_proxy           // CONN_SUBSYS_PROXY
+    }
+};
+
+// Subsystems that block on radio or controller start-up are brought up in
+// parallel, each in its own task once its dependencies are done.
+typedef struct {
+    const char *name;
+    task_id_t task;                 // Placement of the step's task
+    boot_phase_t phase;
+    status_t (*init)(void);
+    EventBits_t depends;
+    EventBits_t done;
+    conn_subsystem_t subsystem;     // Reported up to the connection manager
+} init_step_t;
+
+static const init_step_t g_init_steps[] = {
+    { "WiFi", TASK_ID_INIT_WIFI, BOOT_PHASE_WIFI, init_wifi, INIT_NVS_DONE, INIT_WIFI_DONE, CONN_SUBSYS_WIFI },
+    { "Bluetooth", TASK_ID_INIT_BLUETOOTH, BOOT_PHASE_BLUETOOTH, init_bluetooth, INIT_NVS_DONE, INIT_BT_DONE, CONN_SUBSYS_BLUETOOTH },
+    { "USB", TASK_ID_INIT_USB, BOOT_PHASE_USB, init_usb, INIT_NVS_DONE, INIT_USB_DONE, CONN_SUBSYS_USB },
+};
+
+#define INIT_STEP_COUNT (sizeof(g_init_steps) / sizeof(g_init_steps[0]))
+
+static void init_step_task(void *pvParameters) {
+    const init_step_t *step = (const init_step_t*)pvParameters;
+    
+    // Wait until every dependency is done, or give up if another step failed
+    EventBits_t bits = xEventGroupGetBits(g_init_group);
+    while ((bits & step->depends) != step->depends && !(bits & INIT_FAILED)) {
+        bits = xEventGroupWaitBits(g_init_group, step->depends | INIT_FAILED,
+                                   pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+    
+    if (!(bits & INIT_FAILED)) {
+        boot_profile_begin(step->phase);
+        status_t ret = step->init();
+        boot_profile_end(step->phase, ret);
+        
+        if (ret == STATUS_OK) {
+            connection_manager_post(CONN_EVENT_SUBSYS_UP, step->subsystem);
+            xEventGroupSetBits(g_init_group, step->done);
+        } else {
+            ESP_LOGE(TAG, "Failed to initialize %s", step->name);
+            xEventGroupSetBits(g_init_group, INIT_FAILED);
+        }
+    }
+    
+    task_plan_exit(step->task);
+}
+
+static status_t init_subsystems(void) {
+    EventBits_t all_done = 0;
+    
+    g_init_group = xEventGroupCreateStatic(&g_init_group_buffer);
+    if (g_init_group == NULL) {
+        return STATUS_ERROR_MEMORY;
+    }
     
-    // Create event group
-    g_event_group = xEventGroupCreate();
+    // Session arena and dispatch table, before the bootstrap can receive
+    status_t ret = proto_init();
+    if (ret != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to initialize protocol handler");
+        return ret;
+    }
+    
+    // Event sources before anything they watch can start
+    ret = connection_manager_init(g_connection_strategy, &g_connection_ops);
+    if (ret != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to initialize connection manager");
+        return ret;
+    }
+    
+    // Start every step first; each waits for NVS, so nothing reads the
+    // configuration or the reconnect cache before they are loaded
+    for (size_t i = 0; i < INIT_STEP_COUNT; i++) {
+        all_done |= g_init_steps[i].done;
+        if (task_plan_create(g_init_steps[i].task, init_step_task, (void*)&g_init_steps[i], NULL) != STATUS_OK) {
+            ESP_LOGE(TAG, "Failed to create %s init task", g_init_steps[i].name);
+            xEventGroupSetBits(g_init_group, INIT_FAILED);
+            return STATUS_ERROR_MEMORY;
+        }
+    }
     
-    // Initialize all subsystems
-    if (init_nvs() != STATUS_OK) {
+    // NVS gates the radios
+    boot_profile_begin(BOOT_PHASE_NVS);
+    ret = init_nvs();
+    boot_profile_end(BOOT_PHASE_NVS, ret);
+    if (ret != STATUS_OK) {
         ESP_LOGE(TAG, "Failed to initialize NVS");
-        return;
+        xEventGroupSetBits(g_init_group, INIT_FAILED);
+        return ret;
     }
+    xEventGroupSetBits(g_init_group, INIT_NVS_DONE);
     
-    if (init_wifi() != STATUS_OK) {
-        ESP_LOGE(TAG, "Failed to initialize WiFi");
-        return;
+    // The proxy only allocates, so it runs here while the radios start
+    // For a known phone the listener is armed now, so its TCP connect does
+    // not wait for the accessory handshake. The connection manager's proxy
+    // callback is already installed, so an early client is not missed
+    boot_profile_begin(BOOT_PHASE_PROXY);
+    ret = proxy_init();
+    if (ret == STATUS_OK && reconnect_cache_is_warm()) {
+        ret = proxy_start();
     }
+    boot_profile_end(BOOT_PHASE_PROXY, ret);
+    if (ret != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to initialize proxy");
+        xEventGroupSetBits(g_init_group, INIT_FAILED);
+        return ret;
+    }
+    connection_manager_post(CONN_EVENT_SUBSYS_UP, CONN_SUBSYS_PROXY);
+    
+    // Wait until all steps are done or one fails
+    EventBits_t bits = xEventGroupGetBits(g_init_group);
+    while ((bits & all_done) != all_done && !(bits & INIT_FAILED)) {
+        bits = xEventGroupWaitBits(g_init_group, all_done | INIT_FAILED,
+                                   pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+    
+    return (bits & INIT_FAILED) ? STATUS_ERROR_INIT : STATUS_OK;
+}
+
+extern "C" void app_main(void) {
+    boot_profile_start();
+    ESP_LOGI(TAG, "ESP32 Auto Wireless Android Adapter starting...");
     
-    if (init_bluetooth() != STATUS_OK) {
-        ESP_LOGE(TAG, "Failed to initialize Bluetooth");
+    if (device_identity_build(&g_device_identity, &g_device_info) != STATUS_OK) {
+        ESP_LOGE(TAG, "Device identity strings do not fit");
         return;
     }
     
-    if (init_usb() != STATUS_OK) {
-        ESP_LOGE(TAG, "Failed to initialize USB");
+    // Static stacks before the first task is created
+    if (task_plan_init() != STATUS_OK) {
         return;
     }
+    trace_init();
     
-    // Initialize proxy handler
-    if (proxy_init() != STATUS_OK) {
-        ESP_LOGE(TAG, "Failed to initialize proxy");
+    // Initialize all subsystems; "ready" spans from app_main to the last one
+    boot_profile_begin(BOOT_PHASE_READY);
+    status_t ret = init_subsystems();
+    boot_profile_end(BOOT_PHASE_READY, ret);
+    boot_profile_log();
+    
+    if (ret != STATUS_OK) {
+        ESP_LOGE(TAG, "Subsystem bring-up failed");
         return;
     }
     
-    // Main connection loop
-    while (1) {
-        wait_for_connections();
-        
-        if (start_accessory_mode() == STATUS_OK) {
-            ESP_LOGI(TAG, "Accessory mode active - ready for proxy");
-            
-            // Stay in accessory mode
-            xEventGroupWaitBits(g_event_group, CONNECTED_EVENT, 
-                               pdTRUE, pdTRUE, portMAX_DELAY);
-        } else {
-            ESP_LOGE(TAG, "Failed to start accessory mode, retrying...");
-            vTaskDelay(pdMS_TO_TICKS(2000));
-        }
+    ESP_LOGI(TAG, "Ready for phone %lld ms after power-on", boot_profile_ready_us() / 1000);
+    
+    // Closed by the first streaming session; compare warm against cold boots
+    boot_profile_begin(BOOT_PHASE_SESSION);
+    
+    // Everything below is event driven; what happened during bring-up is
+    // already queued
+    if (connection_manager_start() != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to start connection manager");
+        return;
     }
+    
+    // Every static region is registered by now
+    mem_plan_log_report();
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "mem_plan.h"
+
+static const char *TAG = "MEM_PLAN";
+
+static mem_region_t g_regions[MEM_PLAN_MAX_REGIONS];
+static int g_region_count = 0;
+static portMUX_TYPE g_regions_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *g_kind_names[MEM_KIND_COUNT] = {
+    "dma",
+    "internal",
+    "psram",
+    "stack"
+};
+
+// Heap capabilities listed in the report, worst case since boot
+static const struct {
+    const char *name;
+    uint32_t caps;
+} g_heaps[] = {
+    { "dma",      MALLOC_CAP_DMA | MALLOC_CAP_8BIT },
+    { "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT },
+    { "psram",    MALLOC_CAP_SPIRAM },
+};
+
+const char* mem_kind_name(mem_kind_t kind) {
+    return (kind < MEM_KIND_COUNT) ? g_kind_names[kind] : "?";
+}
+
+static status_t mem_plan_add(const mem_region_t *region) {
+    status_t ret = STATUS_OK;
+
+    // Init steps run in parallel, so registration can race
+    taskENTER_CRITICAL(&g_regions_lock);
+    if (g_region_count < MEM_PLAN_MAX_REGIONS) {
+        g_regions[g_region_count++] = *region;
+    } else {
+        ret = STATUS_ERROR_MEMORY;
+    }
+    taskEXIT_CRITICAL(&g_regions_lock);
+
+    if (ret != STATUS_OK) {
+        ESP_LOGE(TAG, "Region table full, %s not tracked", region->name);
+    }
+    return ret;
+}
+
+status_t mem_plan_add_buffer(const char *name, mem_kind_t kind, void *base, size_t size) {
+    if (name == NULL || base == NULL || size == 0) {
+        return STATUS_ERROR_INIT;
+    }
+
+    memset(base, MEM_PLAN_PAINT, size);
+
+    mem_region_t region = { name, kind, (const uint8_t*)base, size, true, NULL };
+    return mem_plan_add(&region);
+}
+
+status_t mem_plan_add_stack(const char *name, void *base, size_t size) {
+    if (name == NULL || base == NULL || size == 0) {
+        return STATUS_ERROR_INIT;
+    }
+
+    // Painted for the report until the first task runs on it
+    memset(base, MEM_PLAN_PAINT, size);
+
+    mem_region_t region = { name, MEM_KIND_STACK, (const uint8_t*)base, size, true, NULL };
+    return mem_plan_add(&region);
+}
+
+status_t mem_plan_add_object(const char *name, mem_kind_t kind, void *base, size_t size,
+                             mem_high_water_fn_t high_water) {
+    if (name == NULL || base == NULL || size == 0) {
+        return STATUS_ERROR_INIT;
+    }
+
+    mem_region_t region = { name, kind, (const uint8_t*)base, size, false, high_water };
+    return mem_plan_add(&region);
+}
+
+size_t mem_plan_scan_unused(const uint8_t *base, size_t size, bool from_end) {
+    size_t unused = 0;
+
+    if (from_end) {
+        while (unused < size && base[size - 1 - unused] == MEM_PLAN_PAINT) {
+            unused++;
+        }
+    } else {
+        while (unused < size && base[unused] == MEM_PLAN_PAINT) {
+            unused++;
+        }
+    }
+    return unused;
+}
+
+size_t mem_plan_region_high_water(const mem_region_t *region) {
+    if (region == NULL) {
+        return 0;
+    }
+
+    if (region->painted) {
+        // Stacks grow down, so their untouched bytes sit at the base
+        bool from_end = (region->kind != MEM_KIND_STACK);
+        return region->size - mem_plan_scan_unused(region->base, region->size, from_end);
+    }
+    if (region->high_water != NULL) {
+        return region->high_water();
+    }
+    return region->size;
+}
+
+int mem_plan_region_count(void) {
+    return g_region_count;
+}
+
+const mem_region_t* mem_plan_get_region(int index) {
+    return (index >= 0 && index < g_region_count) ? &g_regions[index] : NULL;
+}
+
+// The attribute silently falls back to internal RAM when PSRAM is disabled
+static bool mem_plan_placed(const mem_region_t *region) {
+    switch (region->kind) {
+        case MEM_KIND_DMA:
+            return esp_ptr_dma_capable(region->base);
+        case MEM_KIND_PSRAM:
+            return esp_ptr_external_ram(region->base);
+        default:
+            return esp_ptr_internal(region->base);
+    }
+}
+
+void mem_plan_log_report(void) {
+    size_t totals[MEM_KIND_COUNT] = {};
+
+    ESP_LOGI(TAG, "%-16s %-8s %7s %7s %4s", "region", "kind", "size", "high", "use");
+    for (int i = 0; i < g_region_count; i++) {
+        const mem_region_t *region = &g_regions[i];
+        size_t high = mem_plan_region_high_water(region);
+
+        if (region->painted || region->high_water != NULL) {
+            ESP_LOGI(TAG, "%-16s %-8s %7u %7u %3u%%", region->name, mem_kind_name(region->kind),
+                     (unsigned)region->size, (unsigned)high, (unsigned)(high * 100 / region->size));
+        } else {
+            ESP_LOGI(TAG, "%-16s %-8s %7u %7s %4s", region->name, mem_kind_name(region->kind),
+                     (unsigned)region->size, "-", "-");
+        }
+        if (!mem_plan_placed(region)) {
+            ESP_LOGW(TAG, "%s is not in %s memory", region->name, mem_kind_name(region->kind));
+        }
+        totals[region->kind] += region->size;
+    }
+
+    ESP_LOGI(TAG, "Static: dma %u, internal %u, stacks %u, psram %u bytes",
+             (unsigned)totals[MEM_KIND_DMA], (unsigned)totals[MEM_KIND_INTERNAL],
+             (unsigned)totals[MEM_KIND_STACK], (unsigned)totals[MEM_KIND_PSRAM]);
+
+    // Minimum free is the high-water mark of the heap; the largest block
+    // shrinking while free space holds steady is fragmentation
+    for (size_t i = 0; i < sizeof(g_heaps) / sizeof(g_heaps[0]); i++) {
+        ESP_LOGI(TAG, "Heap %-8s free %7u, min %7u, largest %7u", g_heaps[i].name,
+                 (unsigned)heap_caps_get_free_size(g_heaps[i].caps),
+                 (unsigned)heap_caps_get_minimum_free_size(g_heaps[i].caps),
+                 (unsigned)heap_caps_get_largest_free_block(g_heaps[i].caps));
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_attr.h"
+#include "common.h"
+
+// Static memory plan
+// Everything the data path needs for the life of the device is reserved at
+// link time: task stacks and control blocks (task_plan), queues, mutexes,
+// and the buffers below. Nothing on the steady-state path allocates from the
+// heap, so hours of connect/disconnect cycles cannot fragment it.
+//
+// Placement:
+//   MEM_PLAN_DMA    internal, DMA capable, word aligned: USB and socket
+//                   buffers touched on every packet
+//   MEM_PLAN_PSRAM  external RAM: bulk and history buffers that are large
+//                   and touched at most once per frame or sample
+//
+// Every region is registered at init and listed by mem_plan_log_report()
+// with its high-water mark, next to the heap minima per capability.
+
+#define MEM_PLAN_DMA        DMA_ATTR
+#define MEM_PLAN_PSRAM      EXT_RAM_BSS_ATTR    // Needs CONFIG_SPIRAM_ALLOW_BSS_SEG_EXTERNAL_MEMORY
+
+#define MEM_PLAN_MAX_REGIONS 32
+#define MEM_PLAN_PAINT      0xA5                // Same fill FreeRTOS uses for new stacks
+
+typedef enum {
+    MEM_KIND_DMA = 0,
+    MEM_KIND_INTERNAL,
+    MEM_KIND_PSRAM,
+    MEM_KIND_STACK,                             // Internal; grows down from the top
+    MEM_KIND_COUNT
+} mem_kind_t;
+
+// Bytes in use at the worst point so far, for regions that track it themselves
+typedef size_t (*mem_high_water_fn_t)(void);
+
+typedef struct {
+    const char *name;
+    mem_kind_t kind;
+    const uint8_t *base;
+    size_t size;
+    bool painted;                               // High water found by scanning for MEM_PLAN_PAINT
+    mem_high_water_fn_t high_water;
+} mem_region_t;
+
+// Byte buffers filled from the start; painted here, so register before use
+status_t mem_plan_add_buffer(const char *name, mem_kind_t kind, void *base, size_t size);
+// Task stacks, painted by FreeRTOS at each task creation
+status_t mem_plan_add_stack(const char *name, void *base, size_t size);
+// Structures with live state; high_water may be NULL
+status_t mem_plan_add_object(const char *name, mem_kind_t kind, void *base, size_t size,
+                             mem_high_water_fn_t high_water);
+
+// Untouched bytes at the end (buffers) or start (stacks) of a painted region
+size_t mem_plan_scan_unused(const uint8_t *base, size_t size, bool from_end);
+size_t mem_plan_region_high_water(const mem_region_t *region);
+
+int mem_plan_region_count(void);
+const mem_region_t* mem_plan_get_region(int index);
+const char* mem_kind_name(mem_kind_t kind);
+
+// Region table, placement check and heap minima
+void mem_plan_log_report(void);
@@ -0,0 +1,205 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+#include "aa_traffic_class.h"
+
+// Latency bucket bounds: one less than a power of two, so each is a
+// histogram bucket edge. 255 us to 131 ms, plus +Inf.
+#define METRICS_LATENCY_MIN_SHIFT   8
+#define METRICS_LATENCY_MAX_SHIFT   17
+
+typedef struct {
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+} metrics_writer_t;
+
+// Appends whole lines only, so an overflow leaves the text cut at a line
+static void metrics_printf(metrics_writer_t *writer, const char *format, ...) {
+    if (writer->overflow) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    size_t space = writer->capacity - writer->length;
+    int written = vsnprintf(writer->buffer + writer->length, space, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= space) {
+        writer->overflow = true;
+        writer->buffer[writer->length] = '\0';
+        return;
+    }
+    writer->length += written;
+}
+
+static void metrics_family(metrics_writer_t *writer, const char *name, const char *type, const char *help) {
+    metrics_printf(writer, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s %s\n",
+                   name, help, name, type);
+}
+
+static void metrics_value(metrics_writer_t *writer, const char *name, const char *labels, uint64_t value) {
+    if (labels != NULL) {
+        metrics_printf(writer, METRICS_PREFIX "%s{%s} %llu\n", name, labels, (unsigned long long)value);
+    } else {
+        metrics_printf(writer, METRICS_PREFIX "%s %llu\n", name, (unsigned long long)value);
+    }
+}
+
+static void metrics_signed(metrics_writer_t *writer, const char *name, const char *labels, int64_t value) {
+    metrics_printf(writer, METRICS_PREFIX "%s{%s} %lld\n", name, labels, (long long)value);
+}
+
+// Milliseconds as seconds, without floating point
+static void metrics_seconds(metrics_writer_t *writer, const char *name, uint64_t value_ms) {
+    metrics_printf(writer, METRICS_PREFIX "%s %llu.%03u\n", name, (unsigned long long)(value_ms / 1000),
+                   (unsigned)(value_ms % 1000));
+}
+
+// Microseconds as seconds, for the histogram sum
+static void metrics_sum_seconds(metrics_writer_t *writer, const char *labels, uint64_t value_us) {
+    metrics_printf(writer, METRICS_PREFIX "proxy_latency_seconds_sum{%s} %llu.%06u\n", labels,
+                   (unsigned long long)(value_us / 1000000), (unsigned)(value_us % 1000000));
+}
+
+static void metrics_latency(metrics_writer_t *writer, const char *direction, const latency_histogram_t *histogram) {
+    for (int shift = METRICS_LATENCY_MIN_SHIFT; shift <= METRICS_LATENCY_MAX_SHIFT; shift++) {
+        uint32_t bound_us = (1u << shift) - 1;
+        metrics_printf(writer, METRICS_PREFIX "proxy_latency_seconds_bucket{direction=\"%s\",le=\"0.%06lu\"} %lu\n",
+                       direction, (unsigned long)bound_us,
+                       (unsigned long)latency_histogram_count_le(histogram, bound_us));
+    }
+
+    // Summed from the buckets, like the percentiles, as count may lag them
+    uint32_t total = latency_histogram_count_le(histogram, TELEMETRY_LATENCY_MAX_US);
+    metrics_printf(writer, METRICS_PREFIX "proxy_latency_seconds_bucket{direction=\"%s\",le=\"+Inf\"} %lu\n",
+                   direction, (unsigned long)total);
+    metrics_printf(writer, METRICS_PREFIX "proxy_latency_seconds_count{direction=\"%s\"} %lu\n",
+                   direction, (unsigned long)total);
+
+    char labels[32];
+    snprintf(labels, sizeof(labels), "direction=\"%s\"", direction);
+    metrics_sum_seconds(writer, labels, histogram->sum_us);
+}
+
+static void metrics_render_proxy(metrics_writer_t *writer, const metrics_snapshot_t *snapshot) {
+    char labels[48];
+
+    metrics_family(writer, "proxy_active", "gauge", "1 while the TCP proxy is running");
+    metrics_value(writer, "proxy_active", NULL, snapshot->proxy_active);
+    metrics_family(writer, "proxy_client_connected", "gauge", "1 while a phone is connected to the proxy");
+    metrics_value(writer, "proxy_client_connected", NULL, snapshot->client_connected);
+
+    metrics_family(writer, "proxy_bytes_total", "counter", "Bytes forwarded on the current connection");
+    metrics_value(writer, "proxy_bytes_total", "direction=\"to_phone\"", snapshot->to_phone_bytes);
+    metrics_value(writer, "proxy_bytes_total", "direction=\"to_car\"", snapshot->to_car_bytes);
+
+    metrics_family(writer, "proxy_class_bytes_total", "counter", "Bytes sent to the phone by traffic class");
+    for (int i = 0; i < AA_TRAFFIC_CLASS_COUNT; i++) {
+        snprintf(labels, sizeof(labels), "class=\"%s\"", aa_traffic_class_name((aa_traffic_class_t)i));
+        metrics_value(writer, "proxy_class_bytes_total", labels, snapshot->traffic.bytes[i]);
+    }
+    metrics_family(writer, "proxy_tos_changes_total", "counter", "IP_TOS updates on the proxy socket");
+    metrics_value(writer, "proxy_tos_changes_total", NULL, snapshot->traffic.tos_changes);
+    metrics_family(writer, "proxy_frames_total", "counter", "Frames sent to the phone on the current connection");
+    metrics_value(writer, "proxy_frames_total", NULL, snapshot->traffic.frames);
+
+    metrics_family(writer, "proxy_latency_seconds", "histogram", "Forwarding latency, read to written");
+    metrics_latency(writer, "to_phone", &snapshot->to_phone_latency);
+    metrics_latency(writer, "to_car", &snapshot->to_car_latency);
+
+    metrics_family(writer, "proxy_chunk_bytes", "gauge", "Bytes per USB or TCP read");
+    metrics_value(writer, "proxy_chunk_bytes", NULL, snapshot->chunk_size);
+    metrics_family(writer, "proxy_poll_interval_seconds", "gauge", "Forwarding loop pause between reads");
+    metrics_seconds(writer, "proxy_poll_interval_seconds", snapshot->poll_interval_ms);
+
+    metrics_family(writer, "proxy_stalls_total", "counter", "Stage stalls: bytes pending with no progress past the threshold");
+    for (int i = 0; i < STALL_STAGE_COUNT; i++) {
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", stall_stage_name((stall_stage_t)i));
+        metrics_value(writer, "proxy_stalls_total", labels, snapshot->stalls[i]);
+    }
+    metrics_family(writer, "proxy_latency_slo_breaches_total", "counter", "Stats windows with p99 over the latency target");
+    metrics_value(writer, "proxy_latency_slo_breaches_total", "direction=\"to_phone\"", snapshot->slo_breaches[0]);
+    metrics_value(writer, "proxy_latency_slo_breaches_total", "direction=\"to_car\"", snapshot->slo_breaches[1]);
+}
+
+static void metrics_render_usb(metrics_writer_t *writer, const metrics_snapshot_t *snapshot) {
+    const metrics_usb_stats_t *usb = &snapshot->usb;
+
+    metrics_family(writer, "usb_connected", "gauge", "1 while the USB host is connected");
+    metrics_value(writer, "usb_connected", NULL, snapshot->usb_connected);
+
+    metrics_family(writer, "usb_events_total", "counter", "USB OTG core events by cause, polled by the reader");
+    metrics_value(writer, "usb_events_total", "event=\"any\"", usb->event_polls);
+    metrics_value(writer, "usb_events_total", "event=\"reset\"", usb->resets);
+    metrics_value(writer, "usb_events_total", "event=\"enum_done\"", usb->enum_done);
+    metrics_value(writer, "usb_events_total", "event=\"in_ep\"", usb->in_ep);
+    metrics_value(writer, "usb_events_total", "event=\"out_ep\"", usb->out_ep);
+    metrics_family(writer, "usb_fifo_total", "counter", "USB FIFO activity on the data path");
+    metrics_value(writer, "usb_fifo_total", "event=\"rx_packet\"", usb->rx_packets);
+    metrics_value(writer, "usb_fifo_total", "event=\"tx_full\"", usb->tx_fifo_full);
+    metrics_family(writer, "usb_transfers_total", "counter", "Completed USB transfers");
+    metrics_value(writer, "usb_transfers_total", NULL, usb->transfers);
+}
+
+static void metrics_render_wifi(metrics_writer_t *writer, const metrics_snapshot_t *snapshot) {
+    char labels[48];
+    size_t count = (snapshot->station_count < WIFI_HOTSPOT_MAX_STATIONS) ? snapshot->station_count
+                                                                          : WIFI_HOTSPOT_MAX_STATIONS;
+
+    metrics_family(writer, "wifi_channel", "gauge", "Hotspot channel");
+    metrics_value(writer, "wifi_channel", NULL, snapshot->wifi_channel);
+    metrics_family(writer, "wifi_stations", "gauge", "Stations associated with the hotspot");
+    metrics_value(writer, "wifi_stations", NULL, count);
+
+    metrics_family(writer, "wifi_station_rssi_dbm", "gauge", "Received signal strength per station");
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *mac = snapshot->stations[i].mac;
+        snprintf(labels, sizeof(labels), "mac=\"%02x:%02x:%02x:%02x:%02x:%02x\"",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        metrics_signed(writer, "wifi_station_rssi_dbm", labels, snapshot->stations[i].rssi);
+    }
+    metrics_family(writer, "wifi_station_phy_rate_bps", "gauge", "PHY rate per station, estimated from RSSI");
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *mac = snapshot->stations[i].mac;
+        snprintf(labels, sizeof(labels), "mac=\"%02x:%02x:%02x:%02x:%02x:%02x\"",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        metrics_value(writer, "wifi_station_phy_rate_bps", labels,
+                      (uint64_t)snapshot->stations[i].est_phy_rate_kbps * 1000);
+    }
+}
+
+static void metrics_render_heap(metrics_writer_t *writer, const metrics_snapshot_t *snapshot) {
+    metrics_family(writer, "heap_free_bytes", "gauge", "Free heap by capability");
+    metrics_value(writer, "heap_free_bytes", "region=\"internal\"", snapshot->internal_free);
+    metrics_value(writer, "heap_free_bytes", "region=\"dma\"", snapshot->dma_free);
+    metrics_value(writer, "heap_free_bytes", "region=\"psram\"", snapshot->psram_free);
+    metrics_family(writer, "heap_min_free_bytes", "gauge", "Lowest free internal heap since boot");
+    metrics_value(writer, "heap_min_free_bytes", "region=\"internal\"", snapshot->internal_min_free);
+    metrics_family(writer, "heap_largest_free_block_bytes", "gauge", "Largest free internal heap block");
+    metrics_value(writer, "heap_largest_free_block_bytes", "region=\"internal\"", snapshot->internal_largest);
+}
+
+status_t metrics_render(const metrics_snapshot_t *snapshot, char *buffer, size_t capacity, size_t *length) {
+    if (snapshot == NULL || buffer == NULL || capacity == 0) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    metrics_writer_t writer = { buffer, capacity, 0, false };
+    buffer[0] = '\0';
+
+    metrics_family(&writer, "uptime_seconds", "gauge", "Time since boot");
+    metrics_seconds(&writer, "uptime_seconds", snapshot->uptime_ms);
+    metrics_render_proxy(&writer, snapshot);
+    metrics_render_usb(&writer, snapshot);
+    metrics_render_wifi(&writer, snapshot);
+    metrics_render_heap(&writer, snapshot);
+
+    if (length != NULL) {
+        *length = writer.length;
+    }
+    return writer.overflow ? STATUS_ERROR_MEMORY : STATUS_OK;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+#include "telemetry.h"
+#include "proxy_handler.h"
+#include "wifi_hotspot.h"
+
+// Prometheus text exposition
+// metrics_server.cpp fills a snapshot from the live modules; the renderer
+// here turns it into text format 0.0.4 in a caller-provided buffer, with
+// no allocation. Pure logic; test/test_metrics.cpp checks the output.
+
+#define METRICS_PREFIX          "esp32_auto_"
+
+// USB core counters, copied by metrics_server.cpp from the OTG driver's
+// event stats so the renderer does not depend on the driver
+typedef struct {
+    uint32_t event_polls;           // Polls that found core events
+    uint32_t resets;
+    uint32_t enum_done;
+    uint32_t in_ep;
+    uint32_t out_ep;
+    uint32_t transfers;
+    uint32_t rx_packets;
+    uint32_t tx_fifo_full;
+} metrics_usb_stats_t;
+
+typedef struct {
+    uint64_t uptime_ms;
+
+    // Proxy, current connection unless noted
+    bool proxy_active;
+    bool client_connected;
+    uint32_t to_phone_bytes;
+    uint32_t to_car_bytes;
+    proxy_traffic_stats_t traffic;
+    latency_histogram_t to_phone_latency;   // Since boot
+    latency_histogram_t to_car_latency;
+    uint32_t chunk_size;                    // As tuned
+    uint32_t poll_interval_ms;
+    uint32_t stalls[STALL_STAGE_COUNT];     // Since boot
+    uint32_t slo_breaches[2];               // To phone, to car
+
+    metrics_usb_stats_t usb;
+    bool usb_connected;
+
+    uint8_t wifi_channel;
+    size_t station_count;
+    wifi_station_stats_t stations[WIFI_HOTSPOT_MAX_STATIONS];
+
+    // Heap, bytes
+    size_t internal_free;
+    size_t internal_min_free;
+    size_t internal_largest;
+    size_t dma_free;
+    size_t psram_free;
+} metrics_snapshot_t;
+
+// Metrics functions
+// STATUS_ERROR_MEMORY when the text does not fit; *length is then the
+// part that did, cut at a line boundary.
+status_t metrics_render(const metrics_snapshot_t *snapshot, char *buffer, size_t capacity, size_t *length);
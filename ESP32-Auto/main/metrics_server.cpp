@@ -0,0 +1,295 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+#include "lwip/sockets.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "config_store.h"
+#include "esp32_usb_otg.h"
+#include "mem_plan.h"
+#include "task_plan.h"
+
+static const char *TAG = "METRICS_SERVER";
+
+// The server runs every handler on its one task, so these need no lock
+static httpd_handle_t g_server = NULL;
+static metrics_snapshot_t g_snapshot;
+static char g_body[METRICS_BUFFER_SIZE];
+#if METRICS_CONFIG_ENABLE
+static char g_config_body[METRICS_CONFIG_BODY_MAX + 1];
+#endif
+static bool g_regions_added = false;
+static bool g_overflow_logged = false;
+
+// esp_http_server cannot bind to one interface; with IPv6 enabled it
+// listens dual stack, so IPv4 arrives mapped
+static bool metrics_on_hotspot(httpd_req_t *req) {
+    struct sockaddr_storage local;
+    socklen_t length = sizeof(local);
+    uint32_t address;
+
+    if (getsockname(httpd_req_to_sockfd(req), (struct sockaddr*)&local, &length) != 0) {
+        return false;
+    }
+    if (local.ss_family == AF_INET) {
+        address = ((struct sockaddr_in*)&local)->sin_addr.s_addr;
+    } else if (local.ss_family == AF_INET6) {
+        address = ((struct sockaddr_in6*)&local)->sin6_addr.un.u32_addr[3];
+    } else {
+        return false;
+    }
+
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t *ap = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    return ap != NULL && esp_netif_get_ip_info(ap, &ip_info) == ESP_OK && ip_info.ip.addr == address;
+}
+
+static void metrics_take_snapshot(metrics_snapshot_t *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->uptime_ms = (uint64_t)(esp_timer_get_time() / 1000);
+
+    snapshot->proxy_active = proxy_is_active();
+    snapshot->client_connected = proxy_is_client_connected();
+    proxy_get_byte_counts(&snapshot->to_phone_bytes, &snapshot->to_car_bytes);
+    proxy_get_traffic_stats(&snapshot->traffic);
+    proxy_get_latency(&snapshot->to_phone_latency, &snapshot->to_car_latency);
+    proxy_get_tuning(&snapshot->chunk_size, &snapshot->poll_interval_ms);
+    proxy_get_stall_counts(snapshot->stalls, snapshot->slo_breaches);
+
+    usb_otg_event_stats_t usb;
+    esp32_usb_otg_get_event_stats(&usb);
+    snapshot->usb.event_polls = usb.polls;
+    snapshot->usb.resets = usb.resets;
+    snapshot->usb.enum_done = usb.enum_done;
+    snapshot->usb.in_ep = usb.in_ep;
+    snapshot->usb.out_ep = usb.out_ep;
+    snapshot->usb.transfers = usb.transfers;
+    snapshot->usb.rx_packets = usb.rx_packets;
+    snapshot->usb.tx_fifo_full = usb.tx_fifo_full;
+    snapshot->usb_connected = esp32_usb_otg_is_connected();
+
+    snapshot->wifi_channel = wifi_hotspot_get_channel();
+    if (wifi_hotspot_get_station_stats(snapshot->stations, WIFI_HOTSPOT_MAX_STATIONS,
+                                       &snapshot->station_count) != STATUS_OK) {
+        snapshot->station_count = 0;
+    }
+
+    snapshot->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    snapshot->internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    snapshot->internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    snapshot->dma_free = heap_caps_get_free_size(MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    snapshot->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+static esp_err_t metrics_get_handler(httpd_req_t *req) {
+    if (!metrics_on_hotspot(req)) {
+        httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "Hotspot only");
+        return ESP_OK;
+    }
+
+    size_t length = 0;
+    metrics_take_snapshot(&g_snapshot);
+
+    // What fits is still valid exposition; a larger buffer gets the rest
+    if (metrics_render(&g_snapshot, g_body, sizeof(g_body), &length) != STATUS_OK && !g_overflow_logged) {
+        ESP_LOGW(TAG, "Metrics truncated at %u bytes", (unsigned)length);
+        g_overflow_logged = true;
+    }
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+    return httpd_resp_send(req, g_body, length);
+}
+
+#if METRICS_CONFIG_ENABLE
+// Parses "name=value" pairs separated by '&' or newlines. Nothing is set
+// unless every pair names a key and is in range; error gets the reason.
+static int metrics_parse_config(char *body, config_key_t *keys, uint32_t *values, int max,
+                                char *error, size_t error_size) {
+    int count = 0;
+    char *save = NULL;
+
+    for (char *pair = strtok_r(body, "&\r\n", &save); pair != NULL; pair = strtok_r(NULL, "&\r\n", &save)) {
+        char *value = strchr(pair, '=');
+        if (value == NULL) {
+            snprintf(error, error_size, "Expected name=value: %s", pair);
+            return -1;
+        }
+        *value++ = '\0';
+
+        config_key_t key;
+        if (config_find(pair, &key) != STATUS_OK) {
+            snprintf(error, error_size, "Unknown key: %s", pair);
+            return -1;
+        }
+
+        char *end = NULL;
+        unsigned long number = strtoul(value, &end, 10);
+        const config_param_t *param = config_get_param(key);
+        if (*value == '\0' || *end != '\0' || number < param->min || number > param->max) {
+            snprintf(error, error_size, "%s must be %lu..%lu", param->name,
+                     (unsigned long)param->min, (unsigned long)param->max);
+            return -1;
+        }
+
+        if (count == max) {
+            snprintf(error, error_size, "More than %d keys", max);
+            return -1;
+        }
+        keys[count] = key;
+        values[count] = (uint32_t)number;
+        count++;
+    }
+
+    if (count == 0) {
+        snprintf(error, error_size, "No keys given");
+        return -1;
+    }
+    return count;
+}
+
+static esp_err_t metrics_config_handler(httpd_req_t *req) {
+    if (!metrics_on_hotspot(req)) {
+        httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "Hotspot only");
+        return ESP_OK;
+    }
+
+    if (req->content_len > METRICS_CONFIG_BODY_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body too long");
+        return ESP_OK;
+    }
+
+    // A client that stops sending mid-body would hold the server's only task
+    size_t received = 0;
+    int timeouts = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, g_config_body + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            if (++timeouts < METRICS_CONFIG_RECV_RETRIES) {
+                continue;
+            }
+            httpd_resp_send_408(req);
+            return ESP_FAIL;
+        }
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        received += ret;
+        timeouts = 0;
+    }
+    g_config_body[received] = '\0';
+
+    config_key_t keys[CONFIG_KEY_COUNT];
+    uint32_t values[CONFIG_KEY_COUNT];
+    char error[64];
+    int count = metrics_parse_config(g_config_body, keys, values, CONFIG_KEY_COUNT, error, sizeof(error));
+    if (count < 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_OK;
+    }
+
+    bool wifi_changed = false;
+    for (int i = 0; i < count; i++) {
+        config_set(keys[i], values[i]);
+        wifi_changed |= (keys[i] == CONFIG_WIFI_PROFILE);
+        ESP_LOGI(TAG, "Config %s = %lu", config_get_param(keys[i])->name, (unsigned long)values[i]);
+    }
+
+    // Live, with the calls main.cpp makes at bring-up; the Wi-Fi buffer
+    // budget still waits for the next boot
+    proxy_reconfigure();
+    if (wifi_changed) {
+        wifi_hotspot_set_profile((wifi_profile_t)config_get(CONFIG_WIFI_PROFILE));
+        proxy_set_tcp_nodelay(wifi_hotspot_get_profile_params()->tcp_nodelay);
+    }
+
+    // Every key as it now stands; a handful of short lines always fit
+    size_t length = 0;
+    for (int key = 0; key < CONFIG_KEY_COUNT; key++) {
+        length += snprintf(g_body + length, sizeof(g_body) - length, "%s=%lu\n",
+                           config_get_param((config_key_t)key)->name,
+                           (unsigned long)config_get((config_key_t)key));
+    }
+
+    httpd_resp_set_type(req, "text/plain; charset=utf-8");
+    return httpd_resp_send(req, g_body, length);
+}
+#endif
+
+static const httpd_uri_t g_metrics_uri = {
+    .uri = "/metrics",
+    .method = HTTP_GET,
+    .handler = metrics_get_handler,
+    .user_ctx = NULL,
+};
+
+#if METRICS_CONFIG_ENABLE
+static const httpd_uri_t g_config_uri = {
+    .uri = "/config",
+    .method = HTTP_POST,
+    .handler = metrics_config_handler,
+    .user_ctx = NULL,
+};
+#endif
+
+status_t metrics_server_start(void) {
+    if (g_server != NULL) {
+        return STATUS_OK;
+    }
+
+    if (!g_regions_added) {
+        mem_plan_add_object("metrics_body", MEM_KIND_INTERNAL, g_body, sizeof(g_body), NULL);
+        mem_plan_add_object("metrics_snapshot", MEM_KIND_INTERNAL, &g_snapshot, sizeof(g_snapshot), NULL);
+#if METRICS_CONFIG_ENABLE
+        mem_plan_add_object("metrics_config", MEM_KIND_INTERNAL, g_config_body, sizeof(g_config_body), NULL);
+#endif
+        g_regions_added = true;
+    }
+
+    // One scraper at a time; the proxy port stays free of HTTP
+    const task_placement_t *plan = task_plan_get(TASK_ID_METRICS);
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = METRICS_SERVER_PORT;
+    config.ctrl_port = METRICS_SERVER_PORT + 1;
+    config.max_open_sockets = 2;
+    config.max_uri_handlers = 2;
+    config.lru_purge_enable = true;
+    config.task_priority = plan->priority;
+    config.stack_size = plan->stack_size;
+    config.core_id = plan->core;
+
+    esp_err_t ret = httpd_start(&g_server, &config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start HTTP server: %s", esp_err_to_name(ret));
+        g_server = NULL;
+        return STATUS_ERROR_INIT;
+    }
+
+    ret = httpd_register_uri_handler(g_server, &g_metrics_uri);
+#if METRICS_CONFIG_ENABLE
+    if (ret == ESP_OK) {
+        ret = httpd_register_uri_handler(g_server, &g_config_uri);
+    }
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register handlers: %s", esp_err_to_name(ret));
+        httpd_stop(g_server);
+        g_server = NULL;
+        return STATUS_ERROR_INIT;
+    }
+
+    ESP_LOGI(TAG, "Metrics%s on port %d", METRICS_CONFIG_ENABLE ? " and /config" : "", METRICS_SERVER_PORT);
+    return STATUS_OK;
+}
+
+status_t metrics_server_stop(void) {
+    if (g_server != NULL) {
+        httpd_stop(g_server);
+        g_server = NULL;
+    }
+    return STATUS_OK;
+}
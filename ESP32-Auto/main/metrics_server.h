@@ -0,0 +1,31 @@
+#pragma once
+
+#include "common.h"
+
+// Prometheus metrics over HTTP
+// GET /metrics on the hotspot serves proxy, USB, Wi-Fi and heap metrics
+// (metrics.h) for a laptop in the car to scrape through a drive. Requests
+// that did not arrive on the hotspot address are refused. The text is
+// rendered into a static buffer; the server's task comes from the task plan.
+//
+// Bench builds with METRICS_CONFIG_ENABLE=1 also take POST /config, which
+// changes config_store keys live, e.g.
+//     curl -d 'proxy_chunk=2048&stall_recover=1' http://192.168.4.1:8080/config
+// Every pair is checked before any is set; the reply lists all keys. The
+// proxy and the Wi-Fi profile are reconfigured at once, and the store
+// writes the change to NVS. Anyone on the hotspot could do the same, so
+// it is off by default.
+
+#ifndef METRICS_CONFIG_ENABLE
+#define METRICS_CONFIG_ENABLE 0
+#endif
+
+#define METRICS_SERVER_PORT     8080
+#define METRICS_BUFFER_SIZE     (8 * 1024)
+#define METRICS_CONFIG_BODY_MAX 256
+#define METRICS_CONFIG_RECV_RETRIES 3   // Receive timeouts in a row before answering 408
+
+// Metrics server functions
+// Start after the hotspot netif exists.
+status_t metrics_server_start(void);
+status_t metrics_server_stop(void);
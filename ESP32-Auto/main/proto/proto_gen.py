@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""Generate fixed-layout structs and constexpr field tables from a .proto file.
+
+Usage: proto_gen.py <input.proto> <output.pb.h>
+
+Handles the proto2 subset used by android_auto.proto: top-level and nested
+enums, messages, and required/optional scalar, string, bytes, enum and
+message fields. The output is consumed by the table-driven codec in
+proto_wire.cpp.
+"""
+
+import os
+import re
+import sys
+
+SCALAR_TYPES = {
+    # proto type: (C type, descriptor type)
+    "int32": ("int32_t", "PROTO_TYPE_INT32"),
+    "int64": ("int64_t", "PROTO_TYPE_INT64"),
+    "uint32": ("uint32_t", "PROTO_TYPE_UINT32"),
+    "uint64": ("uint64_t", "PROTO_TYPE_UINT64"),
+    "bool": ("bool", "PROTO_TYPE_BOOL"),
+    "string": ("proto_string_t", "PROTO_TYPE_STRING"),
+    "bytes": ("proto_string_t", "PROTO_TYPE_BYTES"),
+}
+
+MAX_FIELDS = 32  # required_mask is 32 bits wide
+
+TOKEN_RE = re.compile(r'"[^"]*"|[A-Za-z_][A-Za-z0-9_.]*|-?\d+|[{}=;\[\]()<>,]')
+
+
+class ProtoError(Exception):
+    pass
+
+
+class Enum:
+    def __init__(self, name, parent):
+        self.name = name
+        self.c_name = f"{parent}_{name}" if parent else name
+        self.values = []
+
+
+class Field:
+    def __init__(self, label, type_name, name, number):
+        self.label = label
+        self.type_name = type_name
+        self.name = name
+        self.number = number
+        self.kind = None      # "scalar", "enum" or "message"
+        self.target = None    # resolved Enum or Message
+
+
+class Message:
+    def __init__(self, name):
+        self.name = name
+        self.fields = []
+        self.enums = []
+
+
+def tokenize(text):
+    text = re.sub(r"//[^\n]*", "", text)
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return TOKEN_RE.findall(text)
+
+
+class Parser:
+    def __init__(self, tokens):
+        self.tokens = tokens
+        self.pos = 0
+        self.enums = []
+        self.messages = []
+
+    def peek(self):
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else None
+
+    def next(self):
+        token = self.peek()
+        if token is None:
+            raise ProtoError("unexpected end of file")
+        self.pos += 1
+        return token
+
+    def expect(self, expected):
+        token = self.next()
+        if token != expected:
+            raise ProtoError(f"expected '{expected}', got '{token}'")
+
+    def skip_statement(self):
+        while self.next() != ";":
+            pass
+
+    def parse(self):
+        while self.peek() is not None:
+            token = self.next()
+            if token in ("syntax", "option", "package", "import"):
+                self.skip_statement()
+            elif token == "enum":
+                self.enums.append(self.parse_enum(None))
+            elif token == "message":
+                self.messages.append(self.parse_message())
+            else:
+                raise ProtoError(f"unsupported top-level token '{token}'")
+
+    def parse_enum(self, parent):
+        enum = Enum(self.next(), parent)
+        self.expect("{")
+        while self.peek() != "}":
+            if self.peek() == "option":
+                self.next()
+                self.skip_statement()
+                continue
+            name = self.next()
+            self.expect("=")
+            enum.values.append((name, int(self.next())))
+            self.expect(";")
+        self.expect("}")
+        return enum
+
+    def parse_message(self):
+        message = Message(self.next())
+        self.expect("{")
+        while self.peek() != "}":
+            token = self.next()
+            if token == "enum":
+                message.enums.append(self.parse_enum(message.name))
+            elif token == "option":
+                self.skip_statement()
+            elif token in ("required", "optional"):
+                type_name = self.next()
+                name = self.next()
+                self.expect("=")
+                number = int(self.next())
+                if self.peek() == "[":
+                    while self.next() != "]":
+                        pass
+                self.expect(";")
+                message.fields.append(Field(token, type_name, name, number))
+            else:
+                raise ProtoError(f"unsupported token '{token}' in message {message.name}")
+        self.expect("}")
+        return message
+
+
+def resolve(parser):
+    enums = {e.name: e for e in parser.enums}
+    messages = {m.name: m for m in parser.messages}
+    for message in parser.messages:
+        nested = {e.name: e for e in message.enums}
+        numbers = set()
+        if len(message.fields) > MAX_FIELDS:
+            raise ProtoError(f"{message.name} has more than {MAX_FIELDS} fields")
+        for field in message.fields:
+            if field.number > 0xFFFF:
+                raise ProtoError(f"{message.name}.{field.name}: field number above 65535")
+            if field.number in numbers:
+                raise ProtoError(f"{message.name}.{field.name}: duplicate field number")
+            numbers.add(field.number)
+            if field.type_name in SCALAR_TYPES:
+                field.kind = "scalar"
+            elif field.type_name in nested:
+                field.kind, field.target = "enum", nested[field.type_name]
+            elif field.type_name in enums:
+                field.kind, field.target = "enum", enums[field.type_name]
+            elif field.type_name in messages:
+                field.kind, field.target = "message", messages[field.type_name]
+            else:
+                raise ProtoError(f"{message.name}.{field.name}: unknown type '{field.type_name}'")
+
+
+def order_messages(messages):
+    # Embedded sub-messages must be declared before their parents
+    ordered, visiting = [], set()
+
+    def visit(message):
+        if message in ordered:
+            return
+        if message in visiting:
+            raise ProtoError(f"recursive message '{message.name}' cannot be embedded")
+        visiting.add(message)
+        for field in message.fields:
+            if field.kind == "message":
+                visit(field.target)
+        visiting.discard(message)
+        ordered.append(message)
+
+    for message in messages:
+        visit(message)
+    return ordered
+
+
+def c_type(field):
+    if field.kind == "scalar":
+        return SCALAR_TYPES[field.type_name][0]
+    if field.kind == "enum":
+        return "int32_t"
+    return field.target.name
+
+
+def desc_type(field):
+    if field.kind == "scalar":
+        return SCALAR_TYPES[field.type_name][1]
+    if field.kind == "enum":
+        return "PROTO_TYPE_ENUM"
+    return "PROTO_TYPE_MESSAGE"
+
+
+def generate(parser, source_name):
+    out = []
+    emit = out.append
+
+    emit(f"// Generated by proto_gen.py from {source_name}. Do not edit.")
+    emit("#pragma once")
+    emit("")
+    emit("#include <stdint.h>")
+    emit("#include <stdbool.h>")
+    emit("#include <stddef.h>")
+    emit('#include "proto_wire.h"')
+    emit("")
+
+    all_enums = list(parser.enums)
+    for message in parser.messages:
+        all_enums.extend(message.enums)
+
+    for enum in all_enums:
+        emit("typedef enum {")
+        for name, value in enum.values:
+            emit(f"    {enum.c_name}_{name} = {value},")
+        emit(f"}} {enum.c_name};")
+        emit("")
+
+    messages = order_messages(parser.messages)
+
+    for message in messages:
+        emit("typedef struct {")
+        for field in message.fields:
+            if field.label == "optional":
+                emit(f"    bool has_{field.name};")
+            emit(f"    {c_type(field)} {field.name};")
+        emit(f"}} {message.name};")
+        emit("")
+
+    for message in messages:
+        required = 0
+        emit(f"inline constexpr proto_field_desc_t {message.name}_fields[] = {{")
+        for index, field in enumerate(message.fields):
+            if field.label == "required":
+                required |= 1 << index
+            has_offset = (f"offsetof({message.name}, has_{field.name})"
+                          if field.label == "optional" else "PROTO_NO_HAS_FIELD")
+            sub = f"&{field.target.name}_desc" if field.kind == "message" else "nullptr"
+            emit(f"    {{{field.number}, {desc_type(field)}, "
+                 f"offsetof({message.name}, {field.name}), {has_offset}, {sub}}},")
+        emit("};")
+        emit("")
+        emit(f"inline constexpr proto_message_desc_t {message.name}_desc = {{")
+        emit(f'    "{message.name}",')
+        emit(f"    {message.name}_fields,")
+        emit(f"    {len(message.fields)},")
+        emit(f"    0x{required:08X}u,")
+        emit(f"    sizeof({message.name}),")
+        emit("};")
+        emit("")
+        emit("template <>")
+        emit(f"struct proto_message_traits<{message.name}> {{")
+        emit(f"    static constexpr const proto_message_desc_t *desc = &{message.name}_desc;")
+        emit("};")
+        emit("")
+
+    return "\n".join(out)
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__.strip().splitlines()[2], file=sys.stderr)
+        return 2
+
+    source, output = argv[1], argv[2]
+    with open(source, encoding="utf-8") as f:
+        parser = Parser(tokenize(f.read()))
+
+    try:
+        parser.parse()
+        resolve(parser)
+        text = generate(parser, os.path.basename(source))
+    except ProtoError as e:
+        print(f"{source}: {e}", file=sys.stderr)
+        return 1
+
+    os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+    with open(output, "w", encoding="utf-8") as f:
+        f.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,99 @@
+#include <string.h>
+#include <stdlib.h>
+#include "proto_arena.h"
+
+status_t proto_arena_init(proto_arena_t *arena, void *buffer, size_t capacity) {
+    if (arena == NULL || buffer == NULL || capacity == 0) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    memset(arena, 0, sizeof(proto_arena_t));
+    arena->base = (uint8_t*)buffer;
+    arena->capacity = capacity;
+    arena->stats.capacity = capacity;
+    return STATUS_OK;
+}
+
+status_t proto_arena_create(proto_arena_t *arena, size_t capacity) {
+    if (arena == NULL || capacity == 0) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    void *buffer = malloc(capacity);
+    if (buffer == NULL) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    proto_arena_init(arena, buffer, capacity);
+    arena->owns_buffer = true;
+    return STATUS_OK;
+}
+
+void proto_arena_destroy(proto_arena_t *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    if (arena->owns_buffer) {
+        free(arena->base);
+    }
+    memset(arena, 0, sizeof(proto_arena_t));
+}
+
+void proto_arena_reset(proto_arena_t *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    arena->used = 0;
+    arena->stats.used = 0;
+    arena->stats.resets++;
+}
+
+void* proto_arena_alloc(proto_arena_t *arena, size_t size) {
+    if (arena == NULL || arena->base == NULL) {
+        return NULL;
+    }
+
+    // Keep every allocation aligned for the widest message field (uint64_t)
+    size_t offset = (arena->used + PROTO_ARENA_ALIGNMENT - 1) & ~(size_t)(PROTO_ARENA_ALIGNMENT - 1);
+    if (offset > arena->capacity || size > arena->capacity - offset) {
+        arena->stats.failures++;
+        return NULL;
+    }
+
+    arena->used = offset + size;
+    arena->stats.allocations++;
+    arena->stats.used = arena->used;
+    if (arena->used > arena->stats.peak) {
+        arena->stats.peak = arena->used;
+    }
+
+    return arena->base + offset;
+}
+
+size_t proto_arena_mark(const proto_arena_t *arena) {
+    return (arena != NULL) ? arena->used : 0;
+}
+
+// Release everything allocated after mark, e.g. when a decode fails part-way
+void proto_arena_rewind(proto_arena_t *arena, size_t mark) {
+    if (arena != NULL && mark <= arena->used) {
+        arena->used = mark;
+        arena->stats.used = mark;
+    }
+}
+
+void* proto_arena_copy(proto_arena_t *arena, const void *data, size_t size) {
+    void *copy = proto_arena_alloc(arena, size > 0 ? size : 1);
+    if (copy != NULL && size > 0) {
+        memcpy(copy, data, size);
+    }
+    return copy;
+}
+
+void proto_arena_get_stats(const proto_arena_t *arena, proto_arena_stats_t *stats) {
+    if (arena != NULL && stats != NULL) {
+        *stats = arena->stats;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Bump allocator for protocol messages.
+// Messages, nested fields and copied strings are carved out of one block and
+// released together by proto_arena_reset(), so a handshake never fragments
+// the heap. Pure logic; the backing block is either caller-supplied or a
+// single heap allocation.
+
+#define PROTO_ARENA_ALIGNMENT       8
+#define PROTO_ARENA_SESSION_SIZE    2048    // Enough for a full wireless handshake
+
+typedef struct {
+    uint32_t allocations;       // Successful allocations since init
+    uint32_t failures;          // Allocations refused because the block was full
+    uint32_t resets;
+    size_t used;                // Bytes in use now
+    size_t peak;                // High-water mark across resets
+    size_t capacity;
+} proto_arena_stats_t;
+
+typedef struct {
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+    bool owns_buffer;
+    proto_arena_stats_t stats;
+} proto_arena_t;
+
+// Arena functions
+status_t proto_arena_init(proto_arena_t *arena, void *buffer, size_t capacity);
+status_t proto_arena_create(proto_arena_t *arena, size_t capacity);
+void proto_arena_destroy(proto_arena_t *arena);
+void proto_arena_reset(proto_arena_t *arena);
+void* proto_arena_alloc(proto_arena_t *arena, size_t size);
+size_t proto_arena_mark(const proto_arena_t *arena);
+void proto_arena_rewind(proto_arena_t *arena, size_t mark);
+void* proto_arena_copy(proto_arena_t *arena, const void *data, size_t size);
+void proto_arena_get_stats(const proto_arena_t *arena, proto_arena_stats_t *stats);
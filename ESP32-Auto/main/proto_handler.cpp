@@ -1,58 +1,49 @@
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include <string.h>
 #include <stdlib.h>
 #include "proto_handler.h"
+#include "proto_stream.h"
 #include "common.h"
+#include "mem_plan.h"
 
 static const char *TAG = "PROTO_HANDLER";
 
-// Simplified protobuf implementation for ESP32
-// In a real implementation, you would use nanopb or protobuf-c
+// Message helpers for proto/android_auto.proto
+// Encoding and decoding go through the table-driven codec in proto_wire.cpp.
 
-// Message structure definitions
-typedef struct {
-    char ip_address[64];
-    int32_t port;
-} WifiStartRequestImpl;
+static bool g_proto_initialized = false;
+static proto_arena_t g_session_arena;
+static uint8_t g_session_arena_buffer[PROTO_ARENA_SESSION_SIZE] __attribute__((aligned(PROTO_ARENA_ALIGNMENT)));
+static bool g_regions_added = false;
+static proto_memory_stats_t g_memory_stats;
+static uint32_t g_session_alloc_base = 0;     // Arena allocation count at the last reset
+static proto_codec_stats_t g_codec_stats;
 
-typedef struct {
-    char ssid[64];
-    char key[64];
-    char bssid[18];
-    int32_t security_mode;
-    int32_t access_point_type;
-} WifiInfoResponseImpl;
+static size_t proto_arena_high_water(void) {
+    return g_session_arena.stats.peak;
+}
 
-typedef struct {
-    char manufacturer[256];
-    char model[256];
-    char description[256];
-    char version[64];
-    char serial[64];
-} DeviceInfoImpl;
+status_t proto_init(void) {
+    ESP_LOGI(TAG, "Initializing Protocol Buffers handler");
 
-typedef struct {
-    int32_t type;
-    WifiStartRequestImpl *wifi_start_request;
-    WifiInfoResponseImpl *wifi_info_response;
-    DeviceInfoImpl *device_info;
-    int32_t connection_status;
-    uint64_t timestamp;
-} AndroidAutoMessageImpl;
-
-// Forward declarations for implementation
-typedef WifiStartRequestImpl WifiStartRequest;
-typedef WifiInfoResponseImpl WifiInfoResponse;
-typedef DeviceInfoImpl DeviceInfo;
-typedef AndroidAutoMessageImpl AndroidAutoMessage;
+    memset(&g_memory_stats, 0, sizeof(g_memory_stats));
+    memset(&g_codec_stats, 0, sizeof(g_codec_stats));
+    g_session_alloc_base = 0;
 
-static bool g_proto_initialized = false;
+    // One static block for the whole session
+    if (proto_arena_init(&g_session_arena, g_session_arena_buffer, sizeof(g_session_arena_buffer)) != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to set up session arena");
+        return STATUS_ERROR_MEMORY;
+    }
+    if (!g_regions_added) {
+        mem_plan_add_object("proto_arena", MEM_KIND_INTERNAL, g_session_arena_buffer,
+                            sizeof(g_session_arena_buffer), proto_arena_high_water);
+        g_regions_added = true;
+    }
 
-status_t proto_init(void) {
-    ESP_LOGI(TAG, "Initializing Protocol Buffers handler");
-    
     g_proto_initialized = true;
     ESP_LOGI(TAG, "Protocol Buffers handler initialized");
     return STATUS_OK;
@@ -60,269 +51,255 @@ status_t proto_init(void) {
 
 status_t proto_deinit(void) {
     ESP_LOGI(TAG, "Deinitializing Protocol Buffers handler");
-    
+
+    proto_arena_destroy(&g_session_arena);
     g_proto_initialized = false;
     ESP_LOGI(TAG, "Protocol Buffers handler deinitialized");
     return STATUS_OK;
 }
 
-WifiStartRequest* proto_create_wifi_start_request(const char *ip_address, int32_t port) {
-    if (ip_address == NULL) {
-        return NULL;
-    }
-    
-    WifiStartRequest *request = (WifiStartRequest*)malloc(sizeof(WifiStartRequest));
+// WifiStartRequest
+
+void proto_init_wifi_start_request(WifiStartRequest *request, const char *ip_address, int32_t port) {
     if (request == NULL) {
-        return NULL;
+        return;
     }
-    
-    strncpy(request->ip_address, ip_address, sizeof(request->ip_address) - 1);
-    request->ip_address[sizeof(request->ip_address) - 1] = '\0';
+
+    request->ip_address = proto_string(ip_address);
     request->port = port;
-    
-    return request;
 }
 
-void proto_destroy_wifi_start_request(WifiStartRequest *request) {
-    if (request != NULL) {
-        free(request);
+// WifiInfoResponse
+
+void proto_init_wifi_info_response(WifiInfoResponse *response, const char *ssid, const char *key, const char *bssid, int security_mode, int access_point_type) {
+    if (response == NULL) {
+        return;
     }
+
+    response->ssid = proto_string(ssid);
+    response->key = proto_string(key);
+    response->bssid = proto_string(bssid != NULL ? bssid : "00:00:00:00:00:00");
+    response->security_mode = security_mode;
+    response->access_point_type = access_point_type;
 }
 
-status_t proto_serialize_wifi_start_request(const WifiStartRequest *request, uint8_t **buffer, size_t *size) {
-    if (request == NULL || buffer == NULL || size == NULL) {
-        return STATUS_ERROR_PROTOCOL;
-    }
-    
-    // Simple serialization for demonstration
-    // Format: [type:4][ip_len:4][ip_data][port:4]
-    *size = sizeof(int32_t) + sizeof(int32_t) + strlen(request->ip_address) + sizeof(int32_t);
-    *buffer = (uint8_t*)malloc(*size);
-    
-    if (*buffer == NULL) {
-        return STATUS_ERROR_MEMORY;
+// DeviceInfo
+
+void proto_init_device_info(DeviceInfo *device_info, const char *manufacturer, const char *model, const char *description, const char *version, const char *serial) {
+    if (device_info == NULL) {
+        return;
     }
-    
-    uint8_t *ptr = *buffer;
-    
-    // Message type
-    *((int32_t*)ptr) = PROTO_MESSAGE_TYPE_WIFI_START_REQUEST;
-    ptr += sizeof(int32_t);
-    
-    // IP address length and data
-    *((int32_t*)ptr) = strlen(request->ip_address);
-    ptr += sizeof(int32_t);
-    strcpy((char*)ptr, request->ip_address);
-    ptr += strlen(request->ip_address);
-    
-    // Port
-    *((int32_t*)ptr) = request->port;
-    
-    return STATUS_OK;
+
+    device_info->manufacturer = proto_string(manufacturer);
+    device_info->model = proto_string(model);
+    device_info->description = proto_string(description);
+    device_info->version = proto_string(version != NULL ? version : "1.0");
+    device_info->serial = proto_string(serial != NULL ? serial : "ESP32AA001");
 }
 
-WifiStartRequest* proto_deserialize_wifi_start_request(const uint8_t *buffer, size_t size) {
-    if (buffer == NULL || size < sizeof(int32_t) * 3) {
-        return NULL;
-    }
-    
-    const uint8_t *ptr = buffer;
-    
-    // Skip message type
-    ptr += sizeof(int32_t);
-    
-    // Read IP address
-    int32_t ip_len = *((int32_t*)ptr);
-    ptr += sizeof(int32_t);
-    
-    if (size < sizeof(int32_t) * 3 + ip_len) {
-        return NULL;
-    }
-    
-    WifiStartRequest *request = (WifiStartRequest*)malloc(sizeof(WifiStartRequest));
-    if (request == NULL) {
-        return NULL;
-    }
-    
-    strncpy(request->ip_address, (char*)ptr, ip_len);
-    request->ip_address[ip_len] = '\0';
-    ptr += ip_len;
-    
-    // Read port
-    request->port = *((int32_t*)ptr);
-    
-    return request;
+static proto_string_t proto_identity_string(const device_identity_t *identity, device_identity_field_t field) {
+    proto_string_t result;
+    result.data = device_identity_get(identity, field);
+    result.size = device_identity_length(identity, field);
+    return result;
 }
 
-WifiInfoResponse* proto_create_wifi_info_response(const char *ssid, const char *key, const char *bssid, int security_mode, int access_point_type) {
-    if (ssid == NULL || key == NULL) {
-        return NULL;
-    }
-    
-    WifiInfoResponse *response = (WifiInfoResponse*)malloc(sizeof(WifiInfoResponse));
-    if (response == NULL) {
-        return NULL;
-    }
-    
-    strncpy(response->ssid, ssid, sizeof(response->ssid) - 1);
-    response->ssid[sizeof(response->ssid) - 1] = '\0';
-    
-    strncpy(response->key, key, sizeof(response->key) - 1);
-    response->key[sizeof(response->key) - 1] = '\0';
-    
-    if (bssid != NULL) {
-        strncpy(response->bssid, bssid, sizeof(response->bssid) - 1);
-        response->bssid[sizeof(response->bssid) - 1] = '\0';
-    } else {
-        strcpy(response->bssid, "00:00:00:00:00:00");
+void proto_init_device_info_from_identity(DeviceInfo *device_info, const device_identity_t *identity) {
+    if (device_info == NULL || identity == NULL) {
+        return;
     }
-    
-    response->security_mode = security_mode;
-    response->access_point_type = access_point_type;
-    
-    return response;
+
+    device_info->manufacturer = proto_identity_string(identity, DEVICE_IDENTITY_MANUFACTURER);
+    device_info->model = proto_identity_string(identity, DEVICE_IDENTITY_MODEL);
+    device_info->description = proto_identity_string(identity, DEVICE_IDENTITY_DESCRIPTION);
+    device_info->version = proto_identity_string(identity, DEVICE_IDENTITY_VERSION);
+    device_info->serial = proto_identity_string(identity, DEVICE_IDENTITY_SERIAL);
 }
 
-void proto_destroy_wifi_info_response(WifiInfoResponse *response) {
-    if (response != NULL) {
-        free(response);
+// AndroidAutoMessage
+
+void proto_init_message(AndroidAutoMessage *message, int message_type) {
+    if (message == NULL) {
+        return;
     }
+
+    memset(message, 0, sizeof(AndroidAutoMessage));
+    message->type = message_type;
+    message->has_timestamp = true;
+    message->timestamp = proto_get_timestamp();
 }
 
-DeviceInfo* proto_create_device_info(const char *manufacturer, const char *model, const char *description, const char *version, const char *serial) {
-    if (manufacturer == NULL || model == NULL || description == NULL) {
-        return NULL;
-    }
-    
-    DeviceInfo *device_info = (DeviceInfo*)malloc(sizeof(DeviceInfo));
-    if (device_info == NULL) {
+AndroidAutoMessage* proto_create_message(int message_type) {
+    AndroidAutoMessage *message = (AndroidAutoMessage*)malloc(sizeof(AndroidAutoMessage));
+    if (message == NULL) {
         return NULL;
     }
-    
-    strncpy(device_info->manufacturer, manufacturer, sizeof(device_info->manufacturer) - 1);
-    device_info->manufacturer[sizeof(device_info->manufacturer) - 1] = '\0';
-    
-    strncpy(device_info->model, model, sizeof(device_info->model) - 1);
-    device_info->model[sizeof(device_info->model) - 1] = '\0';
-    
-    strncpy(device_info->description, description, sizeof(device_info->description) - 1);
-    device_info->description[sizeof(device_info->description) - 1] = '\0';
-    
-    if (version != NULL) {
-        strncpy(device_info->version, version, sizeof(device_info->version) - 1);
-        device_info->version[sizeof(device_info->version) - 1] = '\0';
-    } else {
-        strcpy(device_info->version, "1.0");
-    }
-    
-    if (serial != NULL) {
-        strncpy(device_info->serial, serial, sizeof(device_info->serial) - 1);
-        device_info->serial[sizeof(device_info->serial) - 1] = '\0';
-    } else {
-        strcpy(device_info->serial, "ESP32AA001");
-    }
-    
-    return device_info;
+
+    g_memory_stats.heap_allocations++;
+    proto_init_message(message, message_type);
+    return message;
 }
 
-void proto_destroy_device_info(DeviceInfo *device_info) {
-    if (device_info != NULL) {
-        free(device_info);
+void proto_destroy_message(AndroidAutoMessage *message) {
+    // Nested messages are embedded; string fields are borrowed
+    if (message != NULL) {
+        g_memory_stats.heap_frees++;
     }
+    free(message);
 }
 
-AndroidAutoMessage* proto_create_message(int message_type) {
-    AndroidAutoMessage *message = (AndroidAutoMessage*)malloc(sizeof(AndroidAutoMessage));
+AndroidAutoMessage* proto_arena_create_message(proto_arena_t *arena, int message_type) {
+    AndroidAutoMessage *message = (AndroidAutoMessage*)proto_arena_alloc(arena, sizeof(AndroidAutoMessage));
     if (message == NULL) {
         return NULL;
     }
-    
-    memset(message, 0, sizeof(AndroidAutoMessage));
-    message->type = message_type;
-    message->timestamp = proto_get_timestamp();
-    
+
+    g_memory_stats.arena_messages++;
+    proto_init_message(message, message_type);
     return message;
 }
 
-void proto_destroy_message(AndroidAutoMessage *message) {
-    if (message == NULL) {
-        return;
+status_t proto_arena_deserialize_message(proto_arena_t *arena, const uint8_t *buffer, size_t size, AndroidAutoMessage **message) {
+    if (arena == NULL || buffer == NULL || message == NULL) {
+        return STATUS_ERROR_PROTOCOL;
     }
-    
-    // Clean up nested messages
-    if (message->wifi_start_request != NULL) {
-        free(message->wifi_start_request);
-        message->wifi_start_request = NULL;
+
+    // Allocate the message first so a failed decode can hand back the copy
+    size_t mark = proto_arena_mark(arena);
+    AndroidAutoMessage *decoded = (AndroidAutoMessage*)proto_arena_alloc(arena, sizeof(AndroidAutoMessage));
+    const uint8_t *copy = (const uint8_t*)proto_arena_copy(arena, buffer, size);
+    if (decoded == NULL || copy == NULL) {
+        proto_arena_rewind(arena, mark);
+        return STATUS_ERROR_MEMORY;
     }
-    
-    if (message->wifi_info_response != NULL) {
-        free(message->wifi_info_response);
-        message->wifi_info_response = NULL;
+
+    status_t ret = proto_deserialize_message(copy, size, decoded);
+    if (ret != STATUS_OK) {
+        proto_arena_rewind(arena, mark);
+        return ret;
     }
-    
-    if (message->device_info != NULL) {
-        free(message->device_info);
-        message->device_info = NULL;
+
+    g_memory_stats.arena_messages++;
+    *message = decoded;
+    return STATUS_OK;
+}
+
+proto_arena_t* proto_get_session_arena(void) {
+    return &g_session_arena;
+}
+
+void proto_session_reset(void) {
+    ESP_LOGI(TAG, "Session used %u bytes in %u allocations (peak %u)",
+             (unsigned)g_session_arena.used,
+             (unsigned)(g_session_arena.stats.allocations - g_session_alloc_base),
+             (unsigned)g_session_arena.stats.peak);
+
+    g_session_alloc_base = g_session_arena.stats.allocations;
+    proto_arena_reset(&g_session_arena);
+}
+
+void proto_get_memory_stats(proto_memory_stats_t *stats) {
+    if (stats == NULL) {
+        return;
     }
-    
-    free(message);
+
+    *stats = g_memory_stats;
+    stats->session_allocations = g_session_arena.stats.allocations - g_session_alloc_base;
+    stats->session_peak = g_session_arena.stats.peak;
+    stats->free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    stats->largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    stats->fragmentation_pct = (stats->free_heap > 0)
+        ? (uint8_t)(100 - (stats->largest_free_block * 100) / stats->free_heap)
+        : 0;
 }
 
-status_t proto_serialize_message(const AndroidAutoMessage *message, uint8_t **buffer, size_t *size) {
-    if (message == NULL || buffer == NULL || size == NULL) {
-        return STATUS_ERROR_PROTOCOL;
+void proto_log_memory_stats(void) {
+    proto_memory_stats_t stats;
+    proto_get_memory_stats(&stats);
+
+    ESP_LOGI(TAG, "Messages: %u heap (%u freed), %u arena; session %u allocs, peak %u/%u bytes",
+             (unsigned)stats.heap_allocations, (unsigned)stats.heap_frees,
+             (unsigned)stats.arena_messages, (unsigned)stats.session_allocations,
+             (unsigned)stats.session_peak, (unsigned)g_session_arena.capacity);
+    ESP_LOGI(TAG, "Heap: %u free, largest block %u, fragmentation %u%%",
+             (unsigned)stats.free_heap, (unsigned)stats.largest_free_block,
+             (unsigned)stats.fragmentation_pct);
+}
+
+status_t proto_serialize_message(const AndroidAutoMessage *message, uint8_t *buffer, size_t capacity, size_t *size) {
+    int64_t start = esp_timer_get_time();
+    status_t ret = proto_encode(message, buffer, capacity, size);
+
+    g_codec_stats.encode_time_us += esp_timer_get_time() - start;
+    if (ret == STATUS_OK) {
+        g_codec_stats.encoded_messages++;
+        g_codec_stats.encoded_bytes += *size;
+    } else {
+        g_codec_stats.encode_errors++;
     }
-    
-    // For now, just serialize the nested message
-    switch (message->type) {
-        case PROTO_MESSAGE_TYPE_WIFI_START_REQUEST:
-            if (message->wifi_start_request) {
-                return proto_serialize_wifi_start_request(message->wifi_start_request, buffer, size);
-            }
-            break;
-            
-        default:
-            ESP_LOGW(TAG, "Unknown message type for serialization: %d", message->type);
-            break;
-    }
-    
-    return STATUS_ERROR_PROTOCOL;
-}
-
-AndroidAutoMessage* proto_deserialize_message(const uint8_t *buffer, size_t size) {
-    if (buffer == NULL || size < sizeof(int32_t)) {
-        return NULL;
+    return ret;
+}
+
+status_t proto_get_serialized_size(const AndroidAutoMessage *message, size_t *size) {
+    return proto_encoded_size(message, size);
+}
+
+status_t proto_deserialize_message(const uint8_t *buffer, size_t size, AndroidAutoMessage *message) {
+    int64_t start = esp_timer_get_time();
+    status_t ret = proto_decode(buffer, size, message);
+
+    g_codec_stats.decode_time_us += esp_timer_get_time() - start;
+    if (ret == STATUS_OK) {
+        g_codec_stats.decoded_messages++;
+        g_codec_stats.decoded_bytes += size;
+    } else {
+        g_codec_stats.decode_errors++;
     }
-    
-    int32_t message_type = *((int32_t*)buffer);
-    AndroidAutoMessage *message = proto_create_message(message_type);
-    if (message == NULL) {
-        return NULL;
+    return ret;
+}
+
+void proto_get_codec_stats(proto_codec_stats_t *stats) {
+    if (stats != NULL) {
+        *stats = g_codec_stats;
+        // Heap messages plus arena allocations
+        stats->allocations = g_memory_stats.heap_allocations + g_session_arena.stats.allocations;
     }
-    
-    switch (message_type) {
-        case PROTO_MESSAGE_TYPE_WIFI_START_REQUEST:
-            message->wifi_start_request = proto_deserialize_wifi_start_request(buffer, size);
-            if (message->wifi_start_request == NULL) {
-                proto_destroy_message(message);
-                return NULL;
-            }
-            break;
-            
-        default:
-            ESP_LOGW(TAG, "Unknown message type for deserialization: %d", message_type);
-            proto_destroy_message(message);
-            return NULL;
-    }
-    
-    return message;
+}
+
+void proto_log_codec_stats(void) {
+    static proto_codec_stats_t last;
+    static int64_t last_time = 0;
+
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - last_time;
+    if (last_time == 0 || elapsed <= 0) {
+        elapsed = now > 0 ? now : 1;
+    }
+
+    proto_codec_stats_t cur;
+    proto_get_codec_stats(&cur);
+    uint32_t messages = (cur.encoded_messages - last.encoded_messages) + (cur.decoded_messages - last.decoded_messages);
+    uint64_t bytes = (cur.encoded_bytes - last.encoded_bytes) + (cur.decoded_bytes - last.decoded_bytes);
+    uint64_t busy = (cur.encode_time_us - last.encode_time_us) + (cur.decode_time_us - last.decode_time_us);
+    uint32_t allocations = cur.allocations - last.allocations;
+
+    ESP_LOGI(TAG, "Codec: %u msg/s, %u B/s, %u us/msg, %u.%02u allocs/msg, %u decode errors",
+             (unsigned)(messages * 1000000ULL / elapsed),
+             (unsigned)(bytes * 1000000ULL / elapsed),
+             (unsigned)(messages > 0 ? busy / messages : 0),
+             (unsigned)(messages > 0 ? allocations / messages : 0),
+             (unsigned)(messages > 0 ? (allocations * 100 / messages) % 100 : 0),
+             (unsigned)cur.decode_errors);
+
+    last = cur;
+    last_time = now;
 }
 
 status_t proto_get_message_type(const AndroidAutoMessage *message, int *type) {
     if (message == NULL || type == NULL) {
         return STATUS_ERROR_PROTOCOL;
     }
-    
+
     *type = message->type;
     return STATUS_OK;
 }
@@ -334,70 +311,246 @@ uint64_t proto_get_timestamp(void) {
 void proto_set_timestamp(AndroidAutoMessage *message, uint64_t timestamp) {
     if (message != NULL) {
         message->timestamp = timestamp;
+        message->has_timestamp = true;
     }
 }
 
+// Dispatch registry
+
+#define PROTO_HEARTBEAT_REPLY_SIZE 32
+#define PROTO_NO_PAYLOAD 0xFFFF
+
+typedef struct {
+    const char *name;
+    uint16_t payload_offset;    // has_<field> that must be set for this type
+    proto_message_handler_t handler;
+    void *ctx;
+    proto_dispatch_stats_t stats;
+} proto_message_entry_t;
+
+static proto_message_entry_t g_message_table[PROTO_MESSAGE_TYPE_COUNT] = {
+    { "UNKNOWN", PROTO_NO_PAYLOAD, NULL, NULL, {} },
+    { "WIFI_START_REQUEST", offsetof(AndroidAutoMessage, has_wifi_start_request), NULL, NULL, {} },
+    { "WIFI_INFO_RESPONSE", offsetof(AndroidAutoMessage, has_wifi_info_response), NULL, NULL, {} },
+    { "DEVICE_INFO", offsetof(AndroidAutoMessage, has_device_info), NULL, NULL, {} },
+    { "CONNECTION_STATUS", offsetof(AndroidAutoMessage, has_connection_status), NULL, NULL, {} },
+    { "HEARTBEAT", PROTO_NO_PAYLOAD, NULL, NULL, {} },
+};
+
+static proto_send_fn_t g_reply_send = NULL;
+static void *g_reply_ctx = NULL;
+static uint32_t g_invalid_messages = 0;
+
+static const proto_message_entry_t* proto_lookup(const AndroidAutoMessage *message) {
+    if (message->type <= PROTO_MESSAGE_TYPE_UNKNOWN || message->type >= PROTO_MESSAGE_TYPE_COUNT) {
+        return NULL;
+    }
+
+    const proto_message_entry_t *entry = &g_message_table[message->type];
+    if (entry->payload_offset != PROTO_NO_PAYLOAD &&
+        !*((const bool*)message + entry->payload_offset)) {
+        return NULL;  // Type says WIFI_START_REQUEST etc. but the payload is missing
+    }
+
+    return entry;
+}
+
 bool proto_validate_message(const uint8_t *buffer, size_t size) {
-    if (buffer == NULL || size < sizeof(int32_t)) {
+    AndroidAutoMessage message;
+    if (proto_deserialize_message(buffer, size, &message) != STATUS_OK) {
         return false;
     }
-    
-    int32_t message_type = *((int32_t*)buffer);
-    
-    // Validate message type
-    switch (message_type) {
-        case PROTO_MESSAGE_TYPE_WIFI_START_REQUEST:
-        case PROTO_MESSAGE_TYPE_WIFI_INFO_RESPONSE:
-        case PROTO_MESSAGE_TYPE_DEVICE_INFO:
-        case PROTO_MESSAGE_TYPE_CONNECTION_STATUS:
-        case PROTO_MESSAGE_TYPE_HEARTBEAT:
-            return true;
-            
-        default:
-            ESP_LOGW(TAG, "Unknown message type: %d", message_type);
-            return false;
+
+    if (proto_lookup(&message) == NULL) {
+        ESP_LOGW(TAG, "Unknown message type: %d", (int)message.type);
+        return false;
     }
+
+    return true;
 }
 
-status_t proto_set_device_info(AndroidAutoMessage *message, const DeviceInfo *device_info) {
-    if (message == NULL || device_info == NULL) {
+status_t proto_register_handler(int message_type, proto_message_handler_t handler, void *ctx) {
+    if (message_type <= PROTO_MESSAGE_TYPE_UNKNOWN || message_type >= PROTO_MESSAGE_TYPE_COUNT) {
         return STATUS_ERROR_PROTOCOL;
     }
-    
-    // Clean up existing device info
-    if (message->device_info != NULL) {
-        free(message->device_info);
+
+    g_message_table[message_type].handler = handler;
+    g_message_table[message_type].ctx = ctx;
+    return STATUS_OK;
+}
+
+void proto_set_reply_sink(proto_send_fn_t send, void *ctx) {
+    g_reply_send = send;
+    g_reply_ctx = ctx;
+}
+
+static status_t proto_answer_heartbeat(void) {
+    if (g_reply_send == NULL) {
+        return STATUS_OK;
     }
-    
-    // Create copy of device info
-    message->device_info = (DeviceInfo*)malloc(sizeof(DeviceInfo));
-    if (message->device_info == NULL) {
-        return STATUS_ERROR_MEMORY;
+
+    // Type and timestamp only, length-prefixed like everything on the
+    // stream transports; fits a small stack buffer
+    AndroidAutoMessage reply;
+    proto_init_message(&reply, PROTO_MESSAGE_TYPE_HEARTBEAT);
+
+    uint8_t buffer[PROTO_HEARTBEAT_REPLY_SIZE];
+    size_t size;
+    status_t ret = proto_stream_encode(&reply, buffer, sizeof(buffer), &size);
+    if (ret == STATUS_OK) {
+        ret = g_reply_send(buffer, size, g_reply_ctx);
     }
-    
-    memcpy(message->device_info, device_info, sizeof(DeviceInfo));
-    message->type = PROTO_MESSAGE_TYPE_DEVICE_INFO;
-    
+    return ret;
+}
+
+status_t proto_dispatch_message(const AndroidAutoMessage *message) {
+    if (message == NULL) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    if (proto_lookup(message) == NULL) {
+        g_invalid_messages++;
+        ESP_LOGW(TAG, "Dropping invalid message type %d", (int)message->type);
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    proto_message_entry_t *entry = &g_message_table[message->type];
+    entry->stats.received++;
+
+    int64_t start = esp_timer_get_time();
+    status_t ret = STATUS_OK;
+
+    // Heartbeat fast path: reply first, then let an optional handler observe it
+    if (message->type == PROTO_MESSAGE_TYPE_HEARTBEAT) {
+        ret = proto_answer_heartbeat();
+    } else if (entry->handler == NULL) {
+        entry->stats.unhandled++;
+        ESP_LOGD(TAG, "No handler for %s", entry->name);
+        return STATUS_OK;
+    }
+
+    if (ret == STATUS_OK && entry->handler != NULL) {
+        ret = entry->handler(message, entry->ctx);
+    }
+
+    uint32_t latency = (uint32_t)(esp_timer_get_time() - start);
+    entry->stats.last_latency_us = latency;
+    entry->stats.total_latency_us += latency;
+    if (latency > entry->stats.max_latency_us) {
+        entry->stats.max_latency_us = latency;
+    }
+
+    if (ret == STATUS_OK) {
+        entry->stats.handled++;
+    } else {
+        entry->stats.errors++;
+        ESP_LOGW(TAG, "%s handler failed: %d", entry->name, ret);
+    }
+
+    return ret;
+}
+
+status_t proto_dispatch(const uint8_t *buffer, size_t size) {
+    if (!g_proto_initialized) {
+        return STATUS_ERROR_INIT;
+    }
+
+    // Decoded once into the session arena, off the transport task's small
+    // stack; the message and its strings are released when the handler returns
+    size_t mark = proto_arena_mark(&g_session_arena);
+    AndroidAutoMessage *message;
+    status_t ret = proto_arena_deserialize_message(&g_session_arena, buffer, size, &message);
+    if (ret != STATUS_OK) {
+        if (ret == STATUS_ERROR_PROTOCOL) {
+            g_invalid_messages++;
+        }
+        return ret;
+    }
+
+    ret = proto_dispatch_message(message);
+    proto_arena_rewind(&g_session_arena, mark);
+    return ret;
+}
+
+status_t proto_dispatch_stream_cb(const uint8_t *data, size_t size, void *ctx) {
+    (void)ctx;
+    proto_dispatch(data, size);
+    return STATUS_OK;  // A bad message does not desynchronise the stream
+}
+
+status_t proto_get_dispatch_stats(int message_type, proto_dispatch_stats_t *stats) {
+    if (stats == NULL || message_type < 0 || message_type >= PROTO_MESSAGE_TYPE_COUNT) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    *stats = g_message_table[message_type].stats;
     return STATUS_OK;
 }
 
-status_t proto_get_device_info(const AndroidAutoMessage *message, DeviceInfo **device_info) {
-    if (message == NULL || device_info == NULL) {
+uint32_t proto_get_invalid_count(void) {
+    return g_invalid_messages;
+}
+
+status_t proto_set_wifi_start_request(AndroidAutoMessage *message, const WifiStartRequest *request) {
+    if (message == NULL || request == NULL) {
         return STATUS_ERROR_PROTOCOL;
     }
-    
-    if (message->device_info == NULL) {
+
+    message->wifi_start_request = *request;
+    message->has_wifi_start_request = true;
+    message->type = PROTO_MESSAGE_TYPE_WIFI_START_REQUEST;
+
+    return STATUS_OK;
+}
+
+status_t proto_get_wifi_start_request(const AndroidAutoMessage *message, const WifiStartRequest **request) {
+    if (message == NULL || request == NULL || !message->has_wifi_start_request) {
         return STATUS_ERROR_PROTOCOL;
     }
-    
-    // Create copy for caller
-    *device_info = (DeviceInfo*)malloc(sizeof(DeviceInfo));
-    if (*device_info == NULL) {
-        return STATUS_ERROR_MEMORY;
+
+    *request = &message->wifi_start_request;
+    return STATUS_OK;
+}
+
+status_t proto_set_wifi_info_response(AndroidAutoMessage *message, const WifiInfoResponse *response) {
+    if (message == NULL || response == NULL) {
+        return STATUS_ERROR_PROTOCOL;
     }
-    
-    memcpy(*device_info, message->device_info, sizeof(DeviceInfo));
-    
+
+    message->wifi_info_response = *response;
+    message->has_wifi_info_response = true;
+    message->type = PROTO_MESSAGE_TYPE_WIFI_INFO_RESPONSE;
+
+    return STATUS_OK;
+}
+
+status_t proto_get_wifi_info_response(const AndroidAutoMessage *message, const WifiInfoResponse **response) {
+    if (message == NULL || response == NULL || !message->has_wifi_info_response) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    *response = &message->wifi_info_response;
+    return STATUS_OK;
+}
+
+status_t proto_set_device_info(AndroidAutoMessage *message, const DeviceInfo *device_info) {
+    if (message == NULL || device_info == NULL) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    message->device_info = *device_info;
+    message->has_device_info = true;
+    message->type = PROTO_MESSAGE_TYPE_DEVICE_INFO;
+
+    return STATUS_OK;
+}
+
+status_t proto_get_device_info(const AndroidAutoMessage *message, const DeviceInfo **device_info) {
+    if (message == NULL || device_info == NULL || !message->has_device_info) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    *device_info = &message->device_info;
     return STATUS_OK;
 }
 
@@ -405,18 +558,19 @@ status_t proto_set_connection_status(AndroidAutoMessage *message, int connection
     if (message == NULL) {
         return STATUS_ERROR_PROTOCOL;
     }
-    
+
     message->connection_status = connection_status;
+    message->has_connection_status = true;
     message->type = PROTO_MESSAGE_TYPE_CONNECTION_STATUS;
-    
+
     return STATUS_OK;
 }
 
 status_t proto_get_connection_status(const AndroidAutoMessage *message, int *connection_status) {
-    if (message == NULL || connection_status == NULL) {
+    if (message == NULL || connection_status == NULL || !message->has_connection_status) {
         return STATUS_ERROR_PROTOCOL;
     }
-    
+
     *connection_status = message->connection_status;
     return STATUS_OK;
-}
\ No newline at end of file
+}
@@ -3,53 +3,119 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "common.h"
+#include "proto_wire.h"
+#include "proto_arena.h"
+#include "device_identity.h"
 
-// Forward declarations for protobuf types
-typedef struct WifiStartRequest WifiStartRequest;
-typedef struct WifiInfoResponse WifiInfoResponse;
-typedef struct DeviceInfo DeviceInfo;
-typedef struct AndroidAutoMessage AndroidAutoMessage;
+// Message structs, enums and field tables are generated from
+// proto/android_auto.proto at build time. String fields are views;
+// see proto_wire.h for ownership.
+#include "android_auto.pb.h"
 
 // Protocol buffer functions
 status_t proto_init(void);
 status_t proto_deinit(void);
 
-// WiFi Start Request
-WifiStartRequest* proto_create_wifi_start_request(const char *ip_address, int32_t port);
-void proto_destroy_wifi_start_request(WifiStartRequest *request);
-status_t proto_serialize_wifi_start_request(const WifiStartRequest *request, uint8_t **buffer, size_t *size);
-WifiStartRequest* proto_deserialize_wifi_start_request(const uint8_t *buffer, size_t size);
+// Memory accounting for the control plane
+typedef struct {
+    uint32_t heap_allocations;      // proto_create_message() calls
+    uint32_t heap_frees;
+    uint32_t arena_messages;        // Messages built or decoded in an arena
+    uint32_t session_allocations;   // Session arena allocations since the last reset
+    size_t session_peak;            // Session arena high-water mark, bytes
+    size_t free_heap;               // 8-bit capable heap
+    size_t largest_free_block;
+    uint8_t fragmentation_pct;      // 100 - largest block as a share of free heap
+} proto_memory_stats_t;
 
-// WiFi Info Response
-WifiInfoResponse* proto_create_wifi_info_response(const char *ssid, const char *key, const char *bssid, int security_mode, int access_point_type);
-void proto_destroy_wifi_info_response(WifiInfoResponse *response);
-status_t proto_serialize_wifi_info_response(const WifiInfoResponse *response, uint8_t **buffer, size_t *size);
-WifiInfoResponse* proto_deserialize_wifi_info_response(const uint8_t *buffer, size_t size);
+// Codec throughput, counted at the serialize/deserialize entry points
+typedef struct {
+    uint32_t encoded_messages;
+    uint32_t decoded_messages;
+    uint32_t encode_errors;
+    uint32_t decode_errors;         // Malformed or truncated input
+    uint64_t encoded_bytes;
+    uint64_t decoded_bytes;
+    uint64_t encode_time_us;
+    uint64_t decode_time_us;
+    uint32_t allocations;           // Heap messages plus arena allocations
+} proto_codec_stats_t;
 
-// Device Info
-DeviceInfo* proto_create_device_info(const char *manufacturer, const char *model, const char *description, const char *version, const char *serial);
-void proto_destroy_device_info(DeviceInfo *device_info);
-status_t proto_serialize_device_info(const DeviceInfo *device_info, uint8_t **buffer, size_t *size);
-DeviceInfo* proto_deserialize_device_info(const uint8_t *buffer, size_t size);
+void proto_get_codec_stats(proto_codec_stats_t *stats);
+void proto_log_codec_stats(void);  // Rates since the previous call
+
+// Session arena: everything built during one handshake is released by
+// proto_session_reset(), which also logs the handshake's allocation count.
+// The bootstrap transport resets it when the phone disconnects.
+proto_arena_t* proto_get_session_arena(void);
+void proto_session_reset(void);
+void proto_get_memory_stats(proto_memory_stats_t *stats);
+void proto_log_memory_stats(void);
+
+// Any generated message can be encoded with proto_encode() and decoded with
+// proto_decode() (see proto_wire.h). Decoders never allocate: string fields
+// borrow from the input buffer, which must outlive the decoded message.
+
+void proto_init_wifi_start_request(WifiStartRequest *request, const char *ip_address, int32_t port);
+void proto_init_wifi_info_response(WifiInfoResponse *response, const char *ssid, const char *key, const char *bssid, int security_mode, int access_point_type);
+void proto_init_device_info(DeviceInfo *device_info, const char *manufacturer, const char *model, const char *description, const char *version, const char *serial);
+// Views into the identity; no strings are copied
+void proto_init_device_info_from_identity(DeviceInfo *device_info, const device_identity_t *identity);
 
 // Android Auto Message wrapper
+void proto_init_message(AndroidAutoMessage *message, int message_type);
 AndroidAutoMessage* proto_create_message(int message_type);
 void proto_destroy_message(AndroidAutoMessage *message);
-status_t proto_serialize_message(const AndroidAutoMessage *message, uint8_t **buffer, size_t *size);
-AndroidAutoMessage* proto_deserialize_message(const uint8_t *buffer, size_t size);
+AndroidAutoMessage* proto_arena_create_message(proto_arena_t *arena, int message_type);
+// Copies the input into the arena first, so the decoded strings stay valid
+// until the arena is reset rather than borrowing from the receive buffer.
+status_t proto_arena_deserialize_message(proto_arena_t *arena, const uint8_t *buffer, size_t size, AndroidAutoMessage **message);
+status_t proto_serialize_message(const AndroidAutoMessage *message, uint8_t *buffer, size_t capacity, size_t *size);
+status_t proto_get_serialized_size(const AndroidAutoMessage *message, size_t *size);
+status_t proto_deserialize_message(const uint8_t *buffer, size_t size, AndroidAutoMessage *message);
 
 // Message field accessors
+// Getters return views into the message; nothing is copied or allocated.
 status_t proto_set_wifi_start_request(AndroidAutoMessage *message, const WifiStartRequest *request);
 status_t proto_set_wifi_info_response(AndroidAutoMessage *message, const WifiInfoResponse *response);
 status_t proto_set_device_info(AndroidAutoMessage *message, const DeviceInfo *device_info);
 status_t proto_set_connection_status(AndroidAutoMessage *message, int connection_status);
 
-status_t proto_get_wifi_start_request(const AndroidAutoMessage *message, WifiStartRequest **request);
-status_t proto_get_wifi_info_response(const AndroidAutoMessage *message, WifiInfoResponse **response);
-status_t proto_get_device_info(const AndroidAutoMessage *message, DeviceInfo **device_info);
+status_t proto_get_wifi_start_request(const AndroidAutoMessage *message, const WifiStartRequest **request);
+status_t proto_get_wifi_info_response(const AndroidAutoMessage *message, const WifiInfoResponse **response);
+status_t proto_get_device_info(const AndroidAutoMessage *message, const DeviceInfo **device_info);
 status_t proto_get_connection_status(const AndroidAutoMessage *message, int *connection_status);
 status_t proto_get_message_type(const AndroidAutoMessage *message, int *type);
 
+// Message dispatch
+// Handlers are looked up by message type in a fixed table. Each message is
+// decoded and validated once into the session arena, then handed to its
+// handler as a view that is valid until the handler returns.
+// Heartbeats are answered inside proto_dispatch() through the reply sink,
+// length-prefixed and without allocating, whether or not a handler is
+// registered. The wireless bootstrap registers its handlers and the sink.
+typedef status_t (*proto_message_handler_t)(const AndroidAutoMessage *message, void *ctx);
+typedef status_t (*proto_send_fn_t)(const uint8_t *data, size_t size, void *ctx);
+
+typedef struct {
+    uint32_t received;
+    uint32_t handled;
+    uint32_t errors;            // Handler returned an error
+    uint32_t unhandled;         // No handler registered
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    uint64_t total_latency_us;
+} proto_dispatch_stats_t;
+
+status_t proto_register_handler(int message_type, proto_message_handler_t handler, void *ctx);
+void proto_set_reply_sink(proto_send_fn_t send, void *ctx);
+status_t proto_dispatch(const uint8_t *buffer, size_t size);
+status_t proto_dispatch_message(const AndroidAutoMessage *message);
+status_t proto_dispatch_stream_cb(const uint8_t *data, size_t size, void *ctx);  // proto_stream_cb_t
+status_t proto_get_dispatch_stats(int message_type, proto_dispatch_stats_t *stats);
+uint32_t proto_get_invalid_count(void);
+
 // Utility functions
 bool proto_validate_message(const uint8_t *buffer, size_t size);
 uint64_t proto_get_timestamp(void);
@@ -62,6 +128,7 @@ void proto_set_timestamp(AndroidAutoMessage *message, uint64_t timestamp);
 #define PROTO_MESSAGE_TYPE_DEVICE_INFO 3
 #define PROTO_MESSAGE_TYPE_CONNECTION_STATUS 4
 #define PROTO_MESSAGE_TYPE_HEARTBEAT 5
+#define PROTO_MESSAGE_TYPE_COUNT 6
 
 #define PROTO_SECURITY_MODE_UNKNOWN 0
 #define PROTO_SECURITY_MODE_OPEN 1
@@ -80,4 +147,4 @@ void proto_set_timestamp(AndroidAutoMessage *message, uint64_t timestamp);
 #define PROTO_CONNECTION_STATUS_DISCONNECTED 0
 #define PROTO_CONNECTION_STATUS_CONNECTING 1
 #define PROTO_CONNECTION_STATUS_CONNECTED 2
-#define PROTO_CONNECTION_STATUS_ERROR 3
\ No newline at end of file
+#define PROTO_CONNECTION_STATUS_ERROR 3
@@ -0,0 +1,161 @@
+#include <string.h>
+#include "proto_stream.h"
+
+// Length prefixes are limited to 32 bits (5 varint bytes)
+#define PROTO_STREAM_LENGTH_MAX_SHIFT 35
+
+status_t proto_stream_init(proto_stream_t *stream, uint8_t *buffer, size_t max_message_size,
+                           proto_stream_cb_t callback, void *ctx) {
+    if (stream == NULL || buffer == NULL || max_message_size == 0 || callback == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    memset(stream, 0, sizeof(proto_stream_t));
+    stream->buffer = buffer;
+    stream->max_message_size = max_message_size;
+    stream->callback = callback;
+    stream->ctx = ctx;
+    return STATUS_OK;
+}
+
+void proto_stream_reset(proto_stream_t *stream) {
+    if (stream == NULL) {
+        return;
+    }
+
+    stream->state = PROTO_STREAM_LENGTH;
+    stream->length = 0;
+    stream->length_shift = 0;
+    stream->filled = 0;
+}
+
+static status_t proto_stream_deliver(proto_stream_t *stream, const uint8_t *data, size_t size) {
+    stream->state = PROTO_STREAM_LENGTH;
+    stream->length = 0;
+    stream->length_shift = 0;
+    stream->filled = 0;
+    stream->stats.messages++;
+
+    status_t ret = stream->callback(data, size, stream->ctx);
+    if (ret != STATUS_OK) {
+        stream->stats.errors++;
+        stream->state = PROTO_STREAM_ERROR;
+    }
+    return ret;
+}
+
+status_t proto_stream_feed(proto_stream_t *stream, const uint8_t *data, size_t size) {
+    if (stream == NULL || (data == NULL && size > 0)) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    // A corrupt prefix leaves the stream unsynchronised until reset
+    if (stream->state == PROTO_STREAM_ERROR) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    stream->stats.bytes += size;
+
+    while (size > 0) {
+        if (stream->state == PROTO_STREAM_LENGTH) {
+            uint8_t byte = *data++;
+            size--;
+
+            // The 5th prefix byte may only carry the top 4 bits of a 32-bit length
+            if (stream->length_shift == 28 && (byte & 0x70) != 0) {
+                stream->stats.errors++;
+                stream->state = PROTO_STREAM_ERROR;
+                return STATUS_ERROR_PROTOCOL;
+            }
+
+            stream->length |= (uint32_t)(byte & 0x7F) << stream->length_shift;
+            stream->length_shift += 7;
+
+            if (byte & 0x80) {
+                if (stream->length_shift >= PROTO_STREAM_LENGTH_MAX_SHIFT) {
+                    stream->stats.errors++;
+                    stream->state = PROTO_STREAM_ERROR;
+                    return STATUS_ERROR_PROTOCOL;
+                }
+                continue;
+            }
+
+            // Reject before buffering a single payload byte
+            if (stream->length > stream->max_message_size) {
+                stream->stats.oversized++;
+                stream->state = PROTO_STREAM_ERROR;
+                return STATUS_ERROR_PROTOCOL;
+            }
+
+            // Whole message in this chunk: deliver without copying
+            if (size >= stream->length) {
+                size_t length = stream->length;
+                stream->stats.zero_copy++;
+                status_t ret = proto_stream_deliver(stream, data, length);
+                if (ret != STATUS_OK) {
+                    return ret;
+                }
+                data += length;
+                size -= length;
+                continue;
+            }
+
+            stream->state = PROTO_STREAM_PAYLOAD;
+            stream->filled = 0;
+            continue;
+        }
+
+        // Reassemble a message split across chunks
+        size_t needed = stream->length - stream->filled;
+        size_t chunk = (size < needed) ? size : needed;
+        memcpy(stream->buffer + stream->filled, data, chunk);
+        stream->filled += chunk;
+        stream->stats.copied_bytes += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (stream->filled == stream->length) {
+            status_t ret = proto_stream_deliver(stream, stream->buffer, stream->length);
+            if (ret != STATUS_OK) {
+                return ret;
+            }
+        }
+    }
+
+    return STATUS_OK;
+}
+
+bool proto_stream_idle(const proto_stream_t *stream) {
+    return stream != NULL && stream->state == PROTO_STREAM_LENGTH && stream->length_shift == 0;
+}
+
+void proto_stream_get_stats(const proto_stream_t *stream, proto_stream_stats_t *stats) {
+    if (stream != NULL && stats != NULL) {
+        *stats = stream->stats;
+    }
+}
+
+status_t proto_stream_encode(const proto_message_desc_t *desc, const void *message,
+                             uint8_t *buffer, size_t capacity, size_t *size) {
+    if (desc == NULL || message == NULL || buffer == NULL || size == NULL) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    size_t length;
+    status_t ret = proto_encoded_size_table(desc, message, &length);
+    if (ret != STATUS_OK) {
+        return ret;
+    }
+
+    proto_writer_t writer;
+    proto_writer_init(&writer, buffer, capacity);
+    ret = proto_write_varint(&writer, length);
+    if (ret != STATUS_OK) {
+        return ret;
+    }
+
+    size_t body;
+    ret = proto_encode_table(desc, message, buffer + writer.size, capacity - writer.size, &body);
+    *size = (ret == STATUS_OK) ? writer.size + body : 0;
+    return ret;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+#include "proto_wire.h"
+
+// Incremental decoder for varint length-prefixed protobuf messages.
+// Accepts a byte stream in arbitrary chunks (TCP, BLE) and calls back once
+// per complete message. A message that arrives whole inside one chunk is
+// handed over in place; only messages split across chunks are copied into
+// the reassembly buffer, which never needs to exceed the largest message.
+
+// Called for each complete message payload. The data is only valid during
+// the call. Returning anything but STATUS_OK stops the stream.
+typedef status_t (*proto_stream_cb_t)(const uint8_t *data, size_t size, void *ctx);
+
+typedef enum {
+    PROTO_STREAM_LENGTH = 0,
+    PROTO_STREAM_PAYLOAD,
+    PROTO_STREAM_ERROR
+} proto_stream_state_t;
+
+typedef struct {
+    uint32_t messages;          // Complete messages delivered
+    uint32_t zero_copy;         // Messages delivered straight from the input chunk
+    uint32_t oversized;         // Length prefixes above max_message_size
+    uint32_t errors;            // Malformed prefixes and callback failures
+    uint64_t bytes;             // Stream bytes consumed
+    uint64_t copied_bytes;      // Bytes that went through the reassembly buffer
+} proto_stream_stats_t;
+
+typedef struct {
+    uint8_t *buffer;
+    size_t max_message_size;
+    proto_stream_cb_t callback;
+    void *ctx;
+    proto_stream_state_t state;
+    uint32_t length;            // Current message length, possibly still being read
+    uint8_t length_shift;
+    size_t filled;              // Payload bytes buffered so far
+    proto_stream_stats_t stats;
+} proto_stream_t;
+
+// Stream functions
+status_t proto_stream_init(proto_stream_t *stream, uint8_t *buffer, size_t max_message_size,
+                           proto_stream_cb_t callback, void *ctx);
+void proto_stream_reset(proto_stream_t *stream);
+status_t proto_stream_feed(proto_stream_t *stream, const uint8_t *data, size_t size);
+bool proto_stream_idle(const proto_stream_t *stream);
+void proto_stream_get_stats(const proto_stream_t *stream, proto_stream_stats_t *stats);
+
+// Writes the length prefix and message, ready for a single send
+status_t proto_stream_encode(const proto_message_desc_t *desc, const void *message,
+                             uint8_t *buffer, size_t capacity, size_t *size);
+
+template <typename T>
+inline status_t proto_stream_encode(const T *message, uint8_t *buffer, size_t capacity, size_t *size) {
+    return proto_stream_encode(proto_message_traits<T>::desc, message, buffer, capacity, size);
+}
@@ -0,0 +1,413 @@
+#include <string.h>
+#include "proto_wire.h"
+
+proto_string_t proto_string(const char *str) {
+    proto_string_t result;
+    result.data = str;
+    result.size = (str != NULL) ? strlen(str) : 0;
+    return result;
+}
+
+bool proto_string_equals(const proto_string_t *str, const char *other) {
+    if (str == NULL || other == NULL) {
+        return false;
+    }
+
+    size_t other_size = strlen(other);
+    return str->size == other_size && (other_size == 0 || memcmp(str->data, other, other_size) == 0);
+}
+
+void proto_writer_init(proto_writer_t *writer, uint8_t *buffer, size_t capacity) {
+    writer->buffer = buffer;
+    writer->capacity = (buffer != NULL) ? capacity : 0;
+    writer->size = 0;
+}
+
+size_t proto_varint_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+status_t proto_write_varint(proto_writer_t *writer, uint64_t value) {
+    if (writer->buffer == NULL) {
+        writer->size += proto_varint_size(value);
+        return STATUS_OK;
+    }
+
+    do {
+        if (writer->size >= writer->capacity) {
+            return STATUS_ERROR_MEMORY;
+        }
+
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (value != 0) {
+            byte |= 0x80;
+        }
+        writer->buffer[writer->size++] = byte;
+    } while (value != 0);
+
+    return STATUS_OK;
+}
+
+status_t proto_write_tag(proto_writer_t *writer, uint32_t field, uint8_t wire_type) {
+    return proto_write_varint(writer, ((uint64_t)field << 3) | wire_type);
+}
+
+status_t proto_write_raw(proto_writer_t *writer, const void *data, size_t size) {
+    if (writer->buffer != NULL) {
+        if (size > writer->capacity - writer->size) {
+            return STATUS_ERROR_MEMORY;
+        }
+        if (size > 0) {
+            memcpy(writer->buffer + writer->size, data, size);
+        }
+    }
+
+    writer->size += size;
+    return STATUS_OK;
+}
+
+status_t proto_write_string(proto_writer_t *writer, uint32_t field, const proto_string_t *str) {
+    size_t size = (str->data != NULL) ? str->size : 0;
+
+    status_t ret = proto_write_tag(writer, field, PROTO_WIRE_LENGTH_DELIMITED);
+    if (ret == STATUS_OK) ret = proto_write_varint(writer, size);
+    if (ret == STATUS_OK) ret = proto_write_raw(writer, str->data, size);
+    return ret;
+}
+
+void proto_reader_init(proto_reader_t *reader, const uint8_t *buffer, size_t size) {
+    reader->ptr = buffer;
+    reader->end = buffer + size;
+}
+
+bool proto_reader_done(const proto_reader_t *reader) {
+    return reader->ptr >= reader->end;
+}
+
+status_t proto_read_varint(proto_reader_t *reader, uint64_t *value) {
+    uint64_t result = 0;
+
+    for (int shift = 0; shift < 7 * PROTO_VARINT_MAX_SIZE; shift += 7) {
+        if (reader->ptr >= reader->end) {
+            return STATUS_ERROR_PROTOCOL;  // Truncated
+        }
+
+        uint8_t byte = *reader->ptr++;
+
+        // The 10th byte may only carry the top bit of a 64-bit value
+        if (shift == 63 && byte > 0x01) {
+            return STATUS_ERROR_PROTOCOL;
+        }
+
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return STATUS_OK;
+        }
+    }
+
+    return STATUS_ERROR_PROTOCOL;  // Longer than 10 bytes
+}
+
+status_t proto_read_tag(proto_reader_t *reader, uint32_t *field, uint8_t *wire_type) {
+    uint64_t tag;
+    status_t ret = proto_read_varint(reader, &tag);
+    if (ret != STATUS_OK) {
+        return ret;
+    }
+
+    // Field numbers are limited to 29 bits; 0 is reserved
+    if ((tag >> 3) == 0 || (tag >> 3) > 0x1FFFFFFF) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    *field = (uint32_t)(tag >> 3);
+    *wire_type = (uint8_t)(tag & 0x07);
+    return STATUS_OK;
+}
+
+status_t proto_read_length_delimited(proto_reader_t *reader, const uint8_t **data, size_t *size) {
+    uint64_t length;
+    status_t ret = proto_read_varint(reader, &length);
+    if (ret != STATUS_OK) {
+        return ret;
+    }
+
+    if (length > (uint64_t)(reader->end - reader->ptr)) {
+        return STATUS_ERROR_PROTOCOL;  // Claims more bytes than remain
+    }
+
+    *data = reader->ptr;
+    *size = (size_t)length;
+    reader->ptr += length;
+    return STATUS_OK;
+}
+
+status_t proto_skip_field(proto_reader_t *reader, uint8_t wire_type) {
+    uint64_t value;
+    const uint8_t *data;
+    size_t size;
+
+    switch (wire_type) {
+        case PROTO_WIRE_VARINT:
+            return proto_read_varint(reader, &value);
+
+        case PROTO_WIRE_LENGTH_DELIMITED:
+            return proto_read_length_delimited(reader, &data, &size);
+
+        case PROTO_WIRE_FIXED64:
+            if (reader->end - reader->ptr < 8) {
+                return STATUS_ERROR_PROTOCOL;
+            }
+            reader->ptr += 8;
+            return STATUS_OK;
+
+        case PROTO_WIRE_FIXED32:
+            if (reader->end - reader->ptr < 4) {
+                return STATUS_ERROR_PROTOCOL;
+            }
+            reader->ptr += 4;
+            return STATUS_OK;
+
+        default:
+            // Groups (3, 4) are not used by android_auto.proto
+            return STATUS_ERROR_PROTOCOL;
+    }
+}
+
+// Table-driven codec
+
+static bool proto_field_present(const proto_field_desc_t *field, const uint8_t *message) {
+    if (field->has_offset == PROTO_NO_HAS_FIELD) {
+        return true;  // Required fields are always encoded
+    }
+
+    return *(const bool*)(message + field->has_offset);
+}
+
+static uint8_t proto_wire_type_for(uint8_t type) {
+    switch (type) {
+        case PROTO_TYPE_STRING:
+        case PROTO_TYPE_BYTES:
+        case PROTO_TYPE_MESSAGE:
+            return PROTO_WIRE_LENGTH_DELIMITED;
+        default:
+            return PROTO_WIRE_VARINT;
+    }
+}
+
+static status_t proto_encode_fields(proto_writer_t *writer, const proto_message_desc_t *desc,
+                                    const uint8_t *message, int depth) {
+    if (depth > PROTO_MAX_NESTING) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    for (uint8_t i = 0; i < desc->field_count; i++) {
+        const proto_field_desc_t *field = &desc->fields[i];
+        if (!proto_field_present(field, message)) {
+            continue;
+        }
+
+        const uint8_t *value = message + field->offset;
+        status_t ret = STATUS_OK;
+
+        if (field->type != PROTO_TYPE_STRING && field->type != PROTO_TYPE_BYTES) {
+            ret = proto_write_tag(writer, field->number, proto_wire_type_for(field->type));
+        }
+
+        if (ret == STATUS_OK) {
+            switch (field->type) {
+                case PROTO_TYPE_INT32:
+                case PROTO_TYPE_ENUM:
+                    // Negative values are sign-extended to 10 bytes, as in protobuf
+                    ret = proto_write_varint(writer, (uint64_t)(int64_t)*(const int32_t*)value);
+                    break;
+
+                case PROTO_TYPE_INT64:
+                    ret = proto_write_varint(writer, (uint64_t)*(const int64_t*)value);
+                    break;
+
+                case PROTO_TYPE_UINT32:
+                    ret = proto_write_varint(writer, *(const uint32_t*)value);
+                    break;
+
+                case PROTO_TYPE_UINT64:
+                    ret = proto_write_varint(writer, *(const uint64_t*)value);
+                    break;
+
+                case PROTO_TYPE_BOOL:
+                    ret = proto_write_varint(writer, *(const bool*)value ? 1 : 0);
+                    break;
+
+                case PROTO_TYPE_STRING:
+                case PROTO_TYPE_BYTES:
+                    ret = proto_write_string(writer, field->number, (const proto_string_t*)value);
+                    break;
+
+                case PROTO_TYPE_MESSAGE: {
+                    // Size pass first, so the length prefix can be written in place
+                    proto_writer_t sizer;
+                    proto_writer_init(&sizer, NULL, 0);
+                    ret = proto_encode_fields(&sizer, field->message, value, depth + 1);
+                    if (ret == STATUS_OK) ret = proto_write_varint(writer, sizer.size);
+                    if (ret == STATUS_OK) ret = proto_encode_fields(writer, field->message, value, depth + 1);
+                    break;
+                }
+
+                default:
+                    ret = STATUS_ERROR_PROTOCOL;
+                    break;
+            }
+        }
+
+        if (ret != STATUS_OK) {
+            return ret;
+        }
+    }
+
+    return STATUS_OK;
+}
+
+status_t proto_encode_table(const proto_message_desc_t *desc, const void *message, uint8_t *buffer, size_t capacity, size_t *size) {
+    if (desc == NULL || message == NULL || buffer == NULL || size == NULL) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    proto_writer_t writer;
+    proto_writer_init(&writer, buffer, capacity);
+
+    status_t ret = proto_encode_fields(&writer, desc, (const uint8_t*)message, 0);
+    *size = (ret == STATUS_OK) ? writer.size : 0;
+    return ret;
+}
+
+status_t proto_encoded_size_table(const proto_message_desc_t *desc, const void *message, size_t *size) {
+    if (desc == NULL || message == NULL || size == NULL) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    proto_writer_t sizer;
+    proto_writer_init(&sizer, NULL, 0);
+
+    status_t ret = proto_encode_fields(&sizer, desc, (const uint8_t*)message, 0);
+    *size = sizer.size;
+    return ret;
+}
+
+static status_t proto_decode_fields(const proto_message_desc_t *desc, const uint8_t *buffer,
+                                    size_t size, uint8_t *message, int depth) {
+    if (depth > PROTO_MAX_NESTING) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    memset(message, 0, desc->size);
+
+    proto_reader_t reader;
+    proto_reader_init(&reader, buffer, size);
+    uint32_t seen = 0;
+
+    while (!proto_reader_done(&reader)) {
+        uint32_t number;
+        uint8_t wire_type;
+        status_t ret = proto_read_tag(&reader, &number, &wire_type);
+        if (ret != STATUS_OK) {
+            return ret;
+        }
+
+        uint8_t index = 0;
+        while (index < desc->field_count && desc->fields[index].number != number) {
+            index++;
+        }
+
+        if (index == desc->field_count) {
+            ret = proto_skip_field(&reader, wire_type);
+            if (ret != STATUS_OK) {
+                return ret;
+            }
+            continue;
+        }
+
+        const proto_field_desc_t *field = &desc->fields[index];
+        if (wire_type != proto_wire_type_for(field->type)) {
+            return STATUS_ERROR_PROTOCOL;
+        }
+
+        uint8_t *value = message + field->offset;
+        uint64_t raw = 0;
+        const uint8_t *data = NULL;
+        size_t data_size = 0;
+
+        if (wire_type == PROTO_WIRE_VARINT) {
+            ret = proto_read_varint(&reader, &raw);
+        } else {
+            ret = proto_read_length_delimited(&reader, &data, &data_size);
+        }
+
+        if (ret != STATUS_OK) {
+            return ret;
+        }
+
+        switch (field->type) {
+            case PROTO_TYPE_INT32:
+            case PROTO_TYPE_ENUM:
+                *(int32_t*)value = (int32_t)(uint32_t)raw;
+                break;
+
+            case PROTO_TYPE_INT64:
+                *(int64_t*)value = (int64_t)raw;
+                break;
+
+            case PROTO_TYPE_UINT32:
+                *(uint32_t*)value = (uint32_t)raw;
+                break;
+
+            case PROTO_TYPE_UINT64:
+                *(uint64_t*)value = raw;
+                break;
+
+            case PROTO_TYPE_BOOL:
+                *(bool*)value = (raw != 0);
+                break;
+
+            case PROTO_TYPE_STRING:
+            case PROTO_TYPE_BYTES:
+                ((proto_string_t*)value)->data = (const char*)data;
+                ((proto_string_t*)value)->size = data_size;
+                break;
+
+            case PROTO_TYPE_MESSAGE:
+                ret = proto_decode_fields(field->message, data, data_size, value, depth + 1);
+                break;
+
+            default:
+                ret = STATUS_ERROR_PROTOCOL;
+                break;
+        }
+
+        if (ret != STATUS_OK) {
+            return ret;
+        }
+
+        if (field->has_offset != PROTO_NO_HAS_FIELD) {
+            *(bool*)(message + field->has_offset) = true;
+        }
+        seen |= 1u << index;
+    }
+
+    // All required fields must be present
+    return ((seen & desc->required_mask) == desc->required_mask) ? STATUS_OK : STATUS_ERROR_PROTOCOL;
+}
+
+status_t proto_decode_table(const proto_message_desc_t *desc, const uint8_t *buffer, size_t size, void *message) {
+    if (desc == NULL || message == NULL || (buffer == NULL && size > 0)) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    return proto_decode_fields(desc, buffer, size, (uint8_t*)message, 0);
+}
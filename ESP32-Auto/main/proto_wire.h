@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Protobuf wire-format primitives
+// Writers and readers work on caller-supplied buffers and never allocate.
+// Every read checks its bounds as part of decoding.
+
+// Wire types
+#define PROTO_WIRE_VARINT            0
+#define PROTO_WIRE_FIXED64           1
+#define PROTO_WIRE_LENGTH_DELIMITED  2
+#define PROTO_WIRE_FIXED32           5
+
+#define PROTO_VARINT_MAX_SIZE        10
+
+// String view; not NUL-terminated. Decoded strings borrow from the input buffer.
+typedef struct {
+    const char *data;
+    size_t size;
+} proto_string_t;
+
+// Output span. With a NULL buffer the writer only counts bytes.
+typedef struct {
+    uint8_t *buffer;
+    size_t capacity;
+    size_t size;
+} proto_writer_t;
+
+// Input span
+typedef struct {
+    const uint8_t *ptr;
+    const uint8_t *end;
+} proto_reader_t;
+
+// String helpers
+proto_string_t proto_string(const char *str);
+bool proto_string_equals(const proto_string_t *str, const char *other);
+
+// Writer functions
+void proto_writer_init(proto_writer_t *writer, uint8_t *buffer, size_t capacity);
+size_t proto_varint_size(uint64_t value);
+status_t proto_write_varint(proto_writer_t *writer, uint64_t value);
+status_t proto_write_tag(proto_writer_t *writer, uint32_t field, uint8_t wire_type);
+status_t proto_write_raw(proto_writer_t *writer, const void *data, size_t size);
+status_t proto_write_string(proto_writer_t *writer, uint32_t field, const proto_string_t *str);
+
+// Table-driven codec
+// Field tables are generated from proto/android_auto.proto by proto_gen.py
+// at build time (see android_auto.pb.h). One encoder and one decoder serve
+// every message; test/bench_proto_codec.cpp times them against a
+// hand-written codec for the largest bootstrap message.
+
+#define PROTO_NO_HAS_FIELD           0xFFFF
+#define PROTO_MAX_NESTING            8
+
+typedef enum {
+    PROTO_TYPE_INT32 = 0,
+    PROTO_TYPE_INT64,
+    PROTO_TYPE_UINT32,
+    PROTO_TYPE_UINT64,
+    PROTO_TYPE_BOOL,
+    PROTO_TYPE_ENUM,
+    PROTO_TYPE_STRING,
+    PROTO_TYPE_BYTES,
+    PROTO_TYPE_MESSAGE
+} proto_field_type_t;
+
+typedef struct proto_message_desc_t proto_message_desc_t;
+
+typedef struct {
+    uint16_t number;
+    uint8_t type;                           // proto_field_type_t
+    uint16_t offset;                        // Offset of the value in the struct
+    uint16_t has_offset;                    // Offset of has_<field>, or PROTO_NO_HAS_FIELD
+    const proto_message_desc_t *message;    // Sub-message table for PROTO_TYPE_MESSAGE
+} proto_field_desc_t;
+
+struct proto_message_desc_t {
+    const char *name;
+    const proto_field_desc_t *fields;
+    uint8_t field_count;
+    uint32_t required_mask;                 // Bit i set when fields[i] is required
+    uint16_t size;
+};
+
+// Reader functions
+void proto_reader_init(proto_reader_t *reader, const uint8_t *buffer, size_t size);
+bool proto_reader_done(const proto_reader_t *reader);
+status_t proto_read_varint(proto_reader_t *reader, uint64_t *value);
+status_t proto_read_tag(proto_reader_t *reader, uint32_t *field, uint8_t *wire_type);
+status_t proto_read_length_delimited(proto_reader_t *reader, const uint8_t **data, size_t *size);
+status_t proto_skip_field(proto_reader_t *reader, uint8_t wire_type);
+
+// Encode/decode any message described by a field table
+status_t proto_encode_table(const proto_message_desc_t *desc, const void *message, uint8_t *buffer, size_t capacity, size_t *size);
+status_t proto_encoded_size_table(const proto_message_desc_t *desc, const void *message, size_t *size);
+status_t proto_decode_table(const proto_message_desc_t *desc, const uint8_t *buffer, size_t size, void *message);
+
+// Typed front end; specialised for every message in android_auto.pb.h
+template <typename T>
+struct proto_message_traits;
+
+template <typename T>
+inline status_t proto_encode(const T *message, uint8_t *buffer, size_t capacity, size_t *size) {
+    return proto_encode_table(proto_message_traits<T>::desc, message, buffer, capacity, size);
+}
+
+template <typename T>
+inline status_t proto_encoded_size(const T *message, size_t *size) {
+    return proto_encoded_size_table(proto_message_traits<T>::desc, message, size);
+}
+
+template <typename T>
+inline status_t proto_decode(const uint8_t *buffer, size_t size, T *message) {
+    return proto_decode_table(proto_message_traits<T>::desc, buffer, size, message);
+}
@@ -7,36 +7,135 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "freertos/queue.h"
 #include "common.h"
 #include "usb_gadget.h"
+#include "esp32_usb_otg.h"
+#include "config_store.h"
+#include "proxy_tuner.h"
+#include "stall_watch.h"
+#include "bluetooth_manager.h"
+#include "proxy_handler.h"
+#include "aa_traffic_class.h"
+#include "telemetry.h"
+#include "task_plan.h"
+#include "mem_plan.h"
+#include "hot_path.h"
+#include "trace.h"
 
 static const char *TAG = "PROXY_HANDLER";
 
 // Proxy configuration
-#define PROXY_BUFFER_SIZE        4096
 #define PROXY_TCP_PORT           5277
-#define PROXY_TASK_STACK_SIZE    8192
-#define PROXY_TASK_PRIORITY      12
-#define PROXY_QUEUE_SIZE         10
-#define PROXY_CONNECTION_TIMEOUT  5000
+#define PROXY_JOIN_TIMEOUT_MS    1000
+#define PROXY_SOCKET_TIMEOUT_MS  100        // Bounds a forwarding task's recv() and send()
+#define PROXY_STALL_PERIOD_MS    100
+#define PROXY_USB_EP_NUM         1          // USB_EP1_IN_ADDR / USB_EP1_OUT_ADDR
+#define PROXY_SERVER_FAIL_LIMIT  3          // Failed listens in a row before reporting
+#define PROXY_USB_ERROR_LIMIT    10         // Failed transfers in a row before reporting
+
+// Tunables, see config_store.h
+typedef struct {
+    size_t chunk_size;
+    uint32_t accept_timeout_ms;
+    uint32_t stats_interval_ms;
+    uint32_t poll_interval_ms;
+    bool autotune;
+    uint32_t latency_target_us;
+    uint32_t usb_fifo_timeout_us;
+    uint32_t stall_ms[STALL_STAGE_COUNT];
+    bool stall_recover;
+} proxy_config_t;
 
 // Proxy state
 static bool g_proxy_active = false;
 static TaskHandle_t g_proxy_task_handle = NULL;
 static TaskHandle_t g_usb_task_handle = NULL;
 static TaskHandle_t g_tcp_task_handle = NULL;
+static StaticSemaphore_t g_proxy_mutex_buffer;
 static SemaphoreHandle_t g_proxy_mutex = NULL;
-static QueueHandle_t g_usb_to_tcp_queue = NULL;
-static QueueHandle_t g_tcp_to_usb_queue = NULL;
 static int g_server_socket = -1;
 static int g_client_socket = -1;
+static proxy_event_cb_t g_event_callback = NULL;
+static void *g_event_ctx = NULL;
+static bool g_tcp_nodelay = false;
+static int64_t g_connect_time_us = 0;
 
-// Data packet structure
+// Consecutive failures behind PROXY_EVENT_FAILED and PROXY_EVENT_USB_FAILED.
+// Each USB direction belongs to one forwarding task. Only a direction that
+// has worked on this connection can fail: before the head unit configures
+// the endpoints every transfer is refused. A timeout is back-pressure, left
+// to the stall watch; any other error means the gadget is gone.
 typedef struct {
-    uint8_t data[PROXY_BUFFER_SIZE];
-    size_t length;
-} proxy_packet_t;
+    bool working;
+    uint32_t errors;
+} proxy_usb_health_t;
+
+static uint32_t g_server_failures = 0;
+static proxy_usb_health_t g_usb_read_health;
+static proxy_usb_health_t g_usb_write_health;
+static volatile bool g_usb_failure_reported = false;
+
+// In effect now; a pending one is applied by the proxy task between
+// connections, or by its connection monitor between stats windows
+static proxy_config_t g_config;
+static proxy_config_t g_next_config;
+static bool g_config_pending = false;
+static portMUX_TYPE g_config_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Read size and poll interval actually used; start from g_config on each
+// connection and, with autotune, follow proxy_tuner from there
+static proxy_tuner_limits_t g_tuner_limits;
+static proxy_tuner_state_t g_tuner;
+static latency_histogram_t g_tuner_latency_prev;
+static uint32_t g_tuner_reads_prev;
+static uint32_t g_tuner_full_prev;
+
+// Stage progress of both directions. The forwarding tasks report their own
+// stages and the TCP one samples its socket's receive queue; the watchdog
+// timer samples the USB RX FIFO and checks the thresholds. Stall counts last
+// from boot.
+//
+// Restarts are only requested by the timer: the TCP forwarding task owns
+// the IN endpoint and resets it before its next write, and whichever
+// forwarding task sees a TCP restart first shuts the connection down.
+static stall_watch_t g_stall_watch;
+static uint32_t g_stall_counts[STALL_STAGE_COUNT];
+static portMUX_TYPE g_stall_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t g_stall_timer = NULL;
+static volatile bool g_usb_write_reset = false;
+static volatile bool g_tcp_restart = false;
+
+// Windows whose p99 exceeded the latency target, per direction, from boot
+static uint32_t g_slo_breaches[2];
+static latency_histogram_t g_slo_prev[2];
+
+// Outgoing traffic tagging; the TOS is only changed where the class changes
+static aa_frame_scanner_t g_tcp_scanner;
+static int g_socket_tos = -1;
+static proxy_traffic_stats_t g_traffic_stats;
+
+// Read to written, per direction; each is only written by its forwarding task
+static latency_histogram_t g_to_phone_latency;
+static latency_histogram_t g_to_car_latency;
+
+// CPU cycles per forwarded packet, with HOT_PATH_PROFILE
+static latency_histogram_t g_to_phone_cycles;
+static latency_histogram_t g_to_car_cycles;
+
+// Reads that returned data on this connection, per direction; each is only
+// written by its forwarding task, and the tuner sums them
+typedef struct {
+    uint32_t reads;
+    uint32_t full_reads;            // ... that filled the whole chunk
+} proxy_read_counts_t;
+
+static proxy_read_counts_t g_usb_reads;
+static proxy_read_counts_t g_tcp_reads;
+
+// One packet buffer per direction, each owned by its forwarding task
+MEM_PLAN_DMA static uint8_t g_usb_rx_buffer[PROXY_BUFFER_SIZE];
+MEM_PLAN_DMA static uint8_t g_tcp_rx_buffer[PROXY_BUFFER_SIZE];
+static bool g_regions_added = false;
 
 // Proxy context
 typedef struct {
@@ -56,8 +155,16 @@ static void tcp_forward_task(void *pvParameters);
 static status_t proxy_create_server_socket(void);
 static status_t proxy_wait_for_client(void);
 static void proxy_cleanup_connection(void);
+static void proxy_notify(proxy_event_t event);
 static status_t proxy_forward_usb_to_tcp(void);
 static status_t proxy_forward_tcp_to_usb(void);
+static bool proxy_apply_config(void);
+static void proxy_tuner_start(void);
+static void proxy_tune(uint32_t window_ms, uint32_t bytes);
+static void proxy_stall_timer_cb(void *arg);
+static void proxy_reset_usb_write(void);
+static void proxy_restart_tcp(void);
+static void proxy_check_latency_slo(void);
 
 status_t proxy_init(void) {
     ESP_LOGI(TAG, "Initializing proxy handler");
@@ -71,27 +178,39 @@ status_t proxy_init(void) {
     
     memset(&g_proxy_context, 0, sizeof(proxy_context_t));
     
+    // Not active yet, so this applies at once
+    proxy_reconfigure();
+    
     // Create mutex for thread safety
-    g_proxy_mutex = xSemaphoreCreateMutex();
+    g_proxy_mutex = xSemaphoreCreateMutexStatic(&g_proxy_mutex_buffer);
     if (g_proxy_mutex == NULL) {
         ESP_LOGE(TAG, "Failed to create proxy mutex");
         return STATUS_ERROR_MEMORY;
     }
     
-    // Create queues for data forwarding
-    g_usb_to_tcp_queue = xQueueCreate(PROXY_QUEUE_SIZE, sizeof(proxy_packet_t));
-    if (g_usb_to_tcp_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create USB to TCP queue");
-        vSemaphoreDelete(g_proxy_mutex);
-        return STATUS_ERROR_MEMORY;
+    // Once per boot; a proxy restart keeps the same regions
+    if (!g_regions_added) {
+        mem_plan_add_buffer("proxy_usb_rx", MEM_KIND_DMA, g_usb_rx_buffer, sizeof(g_usb_rx_buffer));
+        mem_plan_add_buffer("proxy_tcp_rx", MEM_KIND_DMA, g_tcp_rx_buffer, sizeof(g_tcp_rx_buffer));
+        mem_plan_add_object("latency_phone", MEM_KIND_INTERNAL, &g_to_phone_latency,
+                            sizeof(g_to_phone_latency), NULL);
+        mem_plan_add_object("latency_car", MEM_KIND_INTERNAL, &g_to_car_latency,
+                            sizeof(g_to_car_latency), NULL);
+        g_regions_added = true;
     }
     
-    g_tcp_to_usb_queue = xQueueCreate(PROXY_QUEUE_SIZE, sizeof(proxy_packet_t));
-    if (g_tcp_to_usb_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create TCP to USB queue");
-        vQueueDelete(g_usb_to_tcp_queue);
-        vSemaphoreDelete(g_proxy_mutex);
-        return STATUS_ERROR_MEMORY;
+    if (g_stall_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = proxy_stall_timer_cb,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "proxy_stall",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&args, &g_stall_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create stall timer");
+            return STATUS_ERROR_MEMORY;
+        }
     }
     
     ESP_LOGI(TAG, "Proxy handler initialized");
@@ -148,8 +267,8 @@ static status_t proxy_wait_for_client(void) {
     FD_SET(g_server_socket, &read_fds);
     
     struct timeval timeout;
-    timeout.tv_sec = PROXY_CONNECTION_TIMEOUT / 1000;
-    timeout.tv_usec = (PROXY_CONNECTION_TIMEOUT % 1000) * 1000;
+    timeout.tv_sec = g_config.accept_timeout_ms / 1000;
+    timeout.tv_usec = (g_config.accept_timeout_ms % 1000) * 1000;
     
     int select_ret = select(g_server_socket + 1, &read_fds, NULL, NULL, &timeout);
     if (select_ret <= 0) {
@@ -163,13 +282,29 @@ static status_t proxy_wait_for_client(void) {
         return STATUS_ERROR_CONNECTION;
     }
     
+    g_connect_time_us = esp_timer_get_time();
     ESP_LOGI(TAG, "Client connected from %s:%d", 
              inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
     
     // Set client socket options
     int opt = 1;
     setsockopt(g_client_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (g_tcp_nodelay) {
+        setsockopt(g_client_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
+    
+    // The forwarding tasks come back to check for a stop or a restart
+    struct timeval io_timeout;
+    io_timeout.tv_sec = 0;
+    io_timeout.tv_usec = PROXY_SOCKET_TIMEOUT_MS * 1000;
+    setsockopt(g_client_socket, SOL_SOCKET, SO_RCVTIMEO, &io_timeout, sizeof(io_timeout));
+    setsockopt(g_client_socket, SOL_SOCKET, SO_SNDTIMEO, &io_timeout, sizeof(io_timeout));
     
+    // Every connection starts at a frame boundary with the default TOS
+    aa_frame_scanner_init(&g_tcp_scanner);
+    g_socket_tos = -1;
+    
+    proxy_notify(PROXY_EVENT_CLIENT_CONNECTED);
     return STATUS_OK;
 }
 
@@ -178,28 +313,117 @@ static void proxy_cleanup_connection(void) {
         close(g_client_socket);
         g_client_socket = -1;
         ESP_LOGI(TAG, "Client connection closed");
+        proxy_notify(PROXY_EVENT_CLIENT_DISCONNECTED);
     }
 }
 
-static status_t proxy_forward_usb_to_tcp(void) {
-    uint8_t buffer[PROXY_BUFFER_SIZE];
+static void proxy_notify(proxy_event_t event) {
+    if (g_event_callback != NULL) {
+        g_event_callback(event, g_event_ctx);
+    }
+}
+
+// Reported once per connection; the connection manager restarts USB
+static HOT_PATH void proxy_usb_result(proxy_usb_health_t *health, esp_err_t ret) {
+    if (ret == ESP_OK || ret == ESP_ERR_TIMEOUT) {
+        health->working |= (ret == ESP_OK);
+        health->errors = 0;
+        return;
+    }
+    
+    if (health->working && ++health->errors >= PROXY_USB_ERROR_LIMIT && !g_usb_failure_reported) {
+        g_usb_failure_reported = true;
+        ESP_LOGE(TAG, "USB transfers failing: %s", esp_err_to_name(ret));
+        proxy_notify(PROXY_EVENT_USB_FAILED);
+    }
+}
+
+static HOT_PATH void proxy_stall_pending(stall_stage_t stage, uint32_t bytes) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    taskENTER_CRITICAL(&g_stall_lock);
+    stall_watch_pending(&g_stall_watch, stage, bytes, now_ms);
+    taskEXIT_CRITICAL(&g_stall_lock);
+}
+
+static HOT_PATH void proxy_stall_progress(stall_stage_t stage) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    taskENTER_CRITICAL(&g_stall_lock);
+    stall_watch_progress(&g_stall_watch, stage, now_ms);
+    taskEXIT_CRITICAL(&g_stall_lock);
+}
+
+// Sends one run of a single traffic class, retagging the socket first if
+// the class differs from the previous run. lwIP stamps the TOS as segments
+// are emitted, so with Nagle on a short run can share a segment with its
+// neighbours; TCP_NODELAY keeps the tagging tight.
+static HOT_PATH status_t proxy_send_tagged(const uint8_t *data, size_t length, aa_traffic_class_t traffic_class) {
+    int tos = aa_traffic_class_tos(traffic_class);
+    if (tos != g_socket_tos) {
+        if (setsockopt(g_client_socket, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) == 0) {
+            TRACE("TOS 0x%02x for class %u", tos, traffic_class);
+            g_socket_tos = tos;
+            g_traffic_stats.tos_changes++;
+        } else {
+            ESP_LOGW(TAG, "Failed to set IP_TOS 0x%02x: errno %d", tos, errno);
+        }
+    }
+    
+    size_t offset = 0;
+    while (offset < length) {
+        int sent = send(g_client_socket, data + offset, length - offset, MSG_NOSIGNAL);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+            g_proxy_context.running && !g_tcp_restart) {
+            continue;
+        }
+        if (sent < 0) {
+            ESP_LOGE(TAG, "Failed to send to TCP: errno %d", errno);
+            return STATUS_ERROR_CONNECTION;
+        }
+        offset += sent;
+    }
+    
+    g_proxy_context.tcp_bytes_sent += length;
+    g_traffic_stats.bytes[traffic_class] += length;
+    g_traffic_stats.runs[traffic_class]++;
+    return STATUS_OK;
+}
+
+static HOT_PATH status_t proxy_forward_usb_to_tcp(void) {
+    uint8_t *buffer = g_usb_rx_buffer;
+    size_t chunk_size = g_tuner.chunk_size;
     size_t transferred;
     
-    // Read from USB
-    esp_err_t ret = usb_bulk_transfer(USB_EP1_OUT_ADDR, buffer, PROXY_BUFFER_SIZE, &transferred);
+    // Read from USB; the cycle count starts with data in hand, as for TCP
+    esp_err_t ret = usb_bulk_transfer(USB_EP1_OUT_ADDR, buffer, chunk_size, &transferred);
+    proxy_usb_result(&g_usb_read_health, ret);
     if (ret == ESP_OK && transferred > 0) {
-        ESP_LOGD(TAG, "Read %d bytes from USB", transferred);
+        hot_path_sample_t sample;
+        hot_path_begin(&sample);
+        int64_t read_us = esp_timer_get_time();
+        TRACE("Read %u bytes from USB", transferred);
+        g_usb_reads.reads++;
+        if (transferred >= chunk_size) {
+            g_usb_reads.full_reads++;
+        }
+        proxy_stall_progress(STALL_STAGE_USB_READ);
         
-        // Send to TCP
+        // Send to TCP, one run per traffic class
         if (g_client_socket >= 0) {
-            int sent = send(g_client_socket, buffer, transferred, MSG_NOSIGNAL);
-            if (sent > 0) {
-                g_proxy_context.tcp_bytes_sent += sent;
-                ESP_LOGD(TAG, "Sent %d bytes to TCP", sent);
-            } else if (sent < 0) {
-                ESP_LOGE(TAG, "Failed to send to TCP: errno %d", errno);
-                return STATUS_ERROR_CONNECTION;
+            proxy_stall_pending(STALL_STAGE_TCP_SEND, transferred);
+            size_t offset = 0;
+            while (offset < transferred) {
+                aa_traffic_class_t traffic_class;
+                size_t run = aa_frame_scanner_next(&g_tcp_scanner, buffer + offset,
+                                                   transferred - offset, &traffic_class);
+                if (proxy_send_tagged(buffer + offset, run, traffic_class) != STATUS_OK) {
+                    return STATUS_ERROR_CONNECTION;
+                }
+                offset += run;
             }
+            proxy_stall_progress(STALL_STAGE_TCP_SEND);
+            latency_histogram_record(&g_to_phone_latency, (uint32_t)(esp_timer_get_time() - read_us));
+            hot_path_end(&sample, &g_to_phone_cycles);
+            TRACE("Sent %u bytes to TCP", transferred);
         }
         
         g_proxy_context.usb_bytes_received += transferred;
@@ -208,27 +432,53 @@ static status_t proxy_forward_usb_to_tcp(void) {
     return STATUS_OK;
 }
 
-static status_t proxy_forward_tcp_to_usb(void) {
-    uint8_t buffer[PROXY_BUFFER_SIZE];
+static HOT_PATH status_t proxy_forward_tcp_to_usb(void) {
+    uint8_t *buffer = g_tcp_rx_buffer;
+    size_t chunk_size = g_tuner.chunk_size;
     
     if (g_client_socket < 0) {
         return STATUS_OK;  // No client connected
     }
     
     // Read from TCP
-    int received = recv(g_client_socket, buffer, PROXY_BUFFER_SIZE, MSG_NOSIGNAL);
+    int received = recv(g_client_socket, buffer, chunk_size, MSG_NOSIGNAL);
     if (received > 0) {
-        ESP_LOGD(TAG, "Read %d bytes from TCP", received);
+        hot_path_sample_t sample;
+        hot_path_begin(&sample);
+        int64_t read_us = esp_timer_get_time();
+        TRACE("Read %d bytes from TCP", received);
+        g_tcp_reads.reads++;
+        if ((size_t)received >= chunk_size) {
+            g_tcp_reads.full_reads++;
+        }
+        proxy_stall_progress(STALL_STAGE_TCP_RECV);
         
-        // Send to USB
+        // Send to USB; a failed write stays pending until a later one succeeds
         size_t transferred;
+        if (g_usb_write_reset) {
+            proxy_reset_usb_write();
+        }
+        proxy_stall_pending(STALL_STAGE_USB_WRITE, received);
         esp_err_t ret = usb_bulk_transfer(USB_EP1_IN_ADDR, buffer, received, &transferred);
+        proxy_usb_result(&g_usb_write_health, ret);
         if (ret == ESP_OK) {
+            proxy_stall_progress(STALL_STAGE_USB_WRITE);
+            latency_histogram_record(&g_to_car_latency, (uint32_t)(esp_timer_get_time() - read_us));
+            hot_path_end(&sample, &g_to_car_cycles);
             g_proxy_context.usb_bytes_sent += transferred;
-            ESP_LOGD(TAG, "Sent %d bytes to USB", transferred);
+            TRACE("Sent %u bytes to USB", transferred);
+        }
+        
+        // What waits in front of the next recv(); only this task touches the
+        // socket's receive side, so the watchdog does not have to
+        int queued = 0;
+        if (ioctl(g_client_socket, FIONREAD, &queued) == 0 && queued > 0) {
+            proxy_stall_pending(STALL_STAGE_TCP_RECV, (uint32_t)queued);
         }
         
         g_proxy_context.tcp_bytes_received += received;
+    } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return STATUS_OK;  // Nothing within the socket timeout
     } else if (received < 0) {
         ESP_LOGE(TAG, "Failed to receive from TCP: errno %d", errno);
         return STATUS_ERROR_CONNECTION;
@@ -240,48 +490,285 @@ static status_t proxy_forward_tcp_to_usb(void) {
     return STATUS_OK;
 }
 
-static void usb_forward_task(void *pvParameters) {
+static HOT_PATH void usb_forward_task(void *pvParameters) {
     ESP_LOGI(TAG, "USB forward task started");
     
     while (g_proxy_context.running) {
+        if (g_tcp_restart) {
+            proxy_restart_tcp();
+            break;
+        }
         if (proxy_forward_usb_to_tcp() != STATUS_OK) {
             ESP_LOGE(TAG, "USB to TCP forwarding failed");
             break;
         }
-        vTaskDelay(pdMS_TO_TICKS(1));  // Small delay to prevent busy loop
+        vTaskDelay(pdMS_TO_TICKS(g_tuner.poll_interval_ms));  // Small delay to prevent busy loop
     }
     
     ESP_LOGI(TAG, "USB forward task stopped");
-    vTaskDelete(NULL);
+    task_plan_exit(TASK_ID_USB_FORWARD);
 }
 
-static void tcp_forward_task(void *pvParameters) {
+static HOT_PATH void tcp_forward_task(void *pvParameters) {
     ESP_LOGI(TAG, "TCP forward task started");
     
     while (g_proxy_context.running) {
+        if (g_tcp_restart) {
+            proxy_restart_tcp();
+            break;
+        }
         if (proxy_forward_tcp_to_usb() != STATUS_OK) {
             ESP_LOGE(TAG, "TCP to USB forwarding failed");
             break;
         }
-        vTaskDelay(pdMS_TO_TICKS(1));  // Small delay to prevent busy loop
+        vTaskDelay(pdMS_TO_TICKS(g_tuner.poll_interval_ms));  // Small delay to prevent busy loop
     }
     
     ESP_LOGI(TAG, "TCP forward task stopped");
-    vTaskDelete(NULL);
+    task_plan_exit(TASK_ID_TCP_FORWARD);
+}
+
+// The socket timeouts bound every recv() and send(), so both tasks see
+// running cleared and park before the socket is closed: while they run,
+// nothing else closes it. Their slots are then free for the next connection.
+static void proxy_stop_forwarding(void) {
+    g_proxy_context.running = false;
+    esp_timer_stop(g_stall_timer);
+    
+    if (task_plan_join(TASK_ID_USB_FORWARD, PROXY_JOIN_TIMEOUT_MS) != STATUS_OK ||
+        task_plan_join(TASK_ID_TCP_FORWARD, PROXY_JOIN_TIMEOUT_MS) != STATUS_OK) {
+        ESP_LOGE(TAG, "Forward tasks did not stop");
+    }
+    proxy_cleanup_connection();
+    g_usb_task_handle = NULL;
+    g_tcp_task_handle = NULL;
+}
+
+// Both directions; every count is a word with one writer, so no lock
+static void proxy_read_totals(uint32_t *reads, uint32_t *full_reads) {
+    *reads = g_usb_reads.reads + g_tcp_reads.reads;
+    *full_reads = g_usb_reads.full_reads + g_tcp_reads.full_reads;
+}
+
+static void proxy_tuner_start(void) {
+    const config_param_t *chunk = config_get_param(CONFIG_PROXY_CHUNK_SIZE);
+    
+    // The configured poll interval is the slowest the tuner relaxes to
+    g_tuner_limits.chunk_min = chunk->min;
+    g_tuner_limits.chunk_max = chunk->max;
+    g_tuner_limits.poll_min_ms = 1;
+    g_tuner_limits.poll_max_ms = g_config.poll_interval_ms;
+    g_tuner_limits.latency_target_us = g_config.latency_target_us;
+    proxy_tuner_init(&g_tuner, &g_tuner_limits, g_config.chunk_size, g_config.poll_interval_ms);
+    
+    g_tuner_latency_prev = g_to_phone_latency;
+    proxy_read_totals(&g_tuner_reads_prev, &g_tuner_full_prev);
+    
+    if (g_config.autotune) {
+        ESP_LOGI(TAG, "Tuner limits: chunk %lu..%lu poll %lu..%lu ms target %lu us, start chunk %lu poll %lu",
+                 (unsigned long)g_tuner_limits.chunk_min, (unsigned long)g_tuner_limits.chunk_max,
+                 (unsigned long)g_tuner_limits.poll_min_ms, (unsigned long)g_tuner_limits.poll_max_ms,
+                 (unsigned long)g_tuner_limits.latency_target_us,
+                 (unsigned long)g_tuner.chunk_size, (unsigned long)g_tuner.poll_interval_ms);
+    }
+}
+
+// One tuner window. The forwarding tasks pick up the new values on their
+// next read; the log line is what tools/tuner_replay.cpp replays.
+static void proxy_tune(uint32_t window_ms, uint32_t bytes) {
+    proxy_tuner_metrics_t metrics;
+    latency_histogram_t now = g_to_phone_latency;
+    latency_histogram_t window;
+    
+    latency_histogram_delta(&now, &g_tuner_latency_prev, &window);
+    g_tuner_latency_prev = now;
+    
+    uint32_t reads;
+    uint32_t full_reads;
+    proxy_read_totals(&reads, &full_reads);
+    metrics.window_ms = window_ms;
+    metrics.reads = reads - g_tuner_reads_prev;
+    metrics.full_reads = full_reads - g_tuner_full_prev;
+    metrics.bytes = bytes;
+    metrics.latency_p99_us = latency_histogram_percentile(&window, 99);
+    g_tuner_reads_prev = reads;
+    g_tuner_full_prev = full_reads;
+    
+    // Word-sized fields; the forwarding tasks never see a torn value
+    proxy_tuner_action_t action = proxy_tuner_step(&g_tuner, &g_tuner_limits, &metrics);
+    
+    ESP_LOGI(TAG, "Tune %s: window %lu reads %lu full %lu bytes %lu p99 %lu -> chunk %lu poll %lu",
+             proxy_tuner_action_name(action), (unsigned long)metrics.window_ms,
+             (unsigned long)metrics.reads, (unsigned long)metrics.full_reads,
+             (unsigned long)metrics.bytes, (unsigned long)metrics.latency_p99_us,
+             (unsigned long)g_tuner.chunk_size, (unsigned long)g_tuner.poll_interval_ms);
+}
+
+static void proxy_stall_start(void) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    
+    taskENTER_CRITICAL(&g_stall_lock);
+    stall_watch_init(&g_stall_watch, now_ms);
+    taskEXIT_CRITICAL(&g_stall_lock);
+    
+    // Not fatal: the connection just runs unwatched
+    if (esp_timer_start_periodic(g_stall_timer, PROXY_STALL_PERIOD_MS * 1000) != ESP_OK) {
+        ESP_LOGW(TAG, "Stall watch not started");
+    }
+}
+
+// Only the stalled stage is restarted: a TCP stage ends the connection,
+// which the phone redials without touching USB or Wi-Fi; a USB write stall
+// flushes and re-arms the IN endpoint, from the TCP forwarding task. A USB
+// read stall is reported only, as flushing the shared RX FIFO would cut
+// frames in half.
+static void proxy_stall_recover(stall_stage_t stage) {
+    switch (stage) {
+        case STALL_STAGE_TCP_SEND:
+        case STALL_STAGE_TCP_RECV:
+            g_tcp_restart = true;
+            break;
+        case STALL_STAGE_USB_WRITE:
+            g_usb_write_reset = true;
+            break;
+        default:
+            return;
+    }
+    ESP_LOGW(TAG, "Restart of %s requested", stall_stage_name(stage));
+}
+
+// In a forwarding task, which is using the socket and so knows it is open.
+// The other task and the connection monitor then see it end as usual.
+static void proxy_restart_tcp(void) {
+    g_tcp_restart = false;
+    shutdown(g_client_socket, SHUT_RDWR);
+    ESP_LOGW(TAG, "Restarted the TCP connection");
+    if (g_proxy_task_handle != NULL) {
+        xTaskNotifyGive(g_proxy_task_handle);
+    }
+}
+
+// In the TCP forwarding task, before a write: no transfer is in flight
+static void proxy_reset_usb_write(void) {
+    g_usb_write_reset = false;
+    esp32_usb_otg_disable_endpoint(PROXY_USB_EP_NUM, true);
+    esp32_usb_otg_flush_tx_fifo(PROXY_USB_EP_NUM);
+    esp32_usb_otg_enable_endpoint(PROXY_USB_EP_NUM, true);
+    ESP_LOGW(TAG, "Restarted %s", stall_stage_name(STALL_STAGE_USB_WRITE));
 }
 
+// Runs in the esp_timer task, so it can log but must not block for long.
+// It reads registers and the watch; sockets and the endpoints are left to
+// the forwarding tasks.
+static void proxy_stall_timer_cb(void *arg) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    
+    // Bytes waiting in the USB RX FIFO; everything else reports its own
+    uint16_t usb_pending = esp32_usb_otg_rx_pending(PROXY_USB_EP_NUM);
+    
+    stall_watch_t watch;
+    taskENTER_CRITICAL(&g_stall_lock);
+    stall_watch_pending(&g_stall_watch, STALL_STAGE_USB_READ, usb_pending, now_ms);
+    uint32_t stalled = stall_watch_check(&g_stall_watch, g_config.stall_ms, now_ms);
+    watch = g_stall_watch;
+    taskEXIT_CRITICAL(&g_stall_lock);
+    
+    if (stalled == 0) {
+        return;
+    }
+    
+    for (int stage = 0; stage < STALL_STAGE_COUNT; stage++) {
+        if (!(stalled & (1u << stage))) {
+            continue;
+        }
+        const stall_stage_state_t *state = &watch.stages[stage];
+        g_stall_counts[stage]++;
+        TRACE("Stall at stage %u, %u bytes pending", stage, state->pending);
+        ESP_LOGW(TAG, "Stall: %s, %lu bytes pending for %lu ms (threshold %lu ms)",
+                 stall_stage_name((stall_stage_t)stage), (unsigned long)state->pending,
+                 (unsigned long)(now_ms - state->since_ms), (unsigned long)g_config.stall_ms[stage]);
+    }
+    
+    // One register snapshot covers both USB stages
+    if (stalled & ((1u << STALL_STAGE_USB_READ) | (1u << STALL_STAGE_USB_WRITE))) {
+        esp32_usb_otg_trace_state(PROXY_USB_EP_NUM);
+    }
+    
+    if (g_config.stall_recover) {
+        for (int stage = 0; stage < STALL_STAGE_COUNT; stage++) {
+            if (stalled & (1u << stage)) {
+                proxy_stall_recover((stall_stage_t)stage);
+            }
+        }
+    }
+}
+
+// Per stats window, both directions against the same target as the tuner
+static void proxy_check_latency_slo(void) {
+    static const char *names[2] = { "to phone", "to car" };
+    latency_histogram_t now[2] = { g_to_phone_latency, g_to_car_latency };
+    latency_histogram_t window;
+    
+    for (int direction = 0; direction < 2; direction++) {
+        latency_histogram_delta(&now[direction], &g_slo_prev[direction], &window);
+        g_slo_prev[direction] = now[direction];
+        
+        uint32_t p99 = latency_histogram_percentile(&window, 99);
+        if (p99 > g_config.latency_target_us) {
+            g_slo_breaches[direction]++;
+            TRACE("Latency SLO breach, direction %u p99 %u us", direction, p99);
+            ESP_LOGW(TAG, "Latency SLO: %s p99 %lu us over %lu us",
+                     names[direction], (unsigned long)p99, (unsigned long)g_config.latency_target_us);
+        }
+    }
+}
+
+#if HOT_PATH_PROFILE
+// Cycles per packet over the last window. Samples include preemption by
+// Wi-Fi and lwIP, so compare the same load with HOT_PATH_IRAM=0 and 1: the
+// difference, mostly in p99, is flash cache refills.
+static void proxy_log_cycles(void) {
+    static latency_histogram_t prev_phone, prev_car, window;
+    latency_histogram_t now;
+    uint32_t phone_p50, phone_p99;
+    
+    now = g_to_phone_cycles;
+    latency_histogram_delta(&now, &prev_phone, &window);
+    prev_phone = now;
+    phone_p50 = latency_histogram_percentile(&window, 50);
+    phone_p99 = latency_histogram_percentile(&window, 99);
+    
+    now = g_to_car_cycles;
+    latency_histogram_delta(&now, &prev_car, &window);
+    prev_car = now;
+    
+    ESP_LOGI(TAG, "Cycles/packet (%s) to phone p50 %lu p99 %lu | to car p50 %lu p99 %lu",
+             HOT_PATH_IRAM ? "iram" : "flash",
+             (unsigned long)phone_p50, (unsigned long)phone_p99,
+             (unsigned long)latency_histogram_percentile(&window, 50),
+             (unsigned long)latency_histogram_percentile(&window, 99));
+}
+#endif
+
 static void proxy_task(void *pvParameters) {
     ESP_LOGI(TAG, "Main proxy task started");
     
     g_proxy_context.running = true;
     
     while (g_proxy_context.running && g_proxy_active) {
+        // Between connections, so both forwarding tasks see one configuration
+        proxy_apply_config();
+        
         // Create server socket
         if (proxy_create_server_socket() != STATUS_OK) {
             ESP_LOGE(TAG, "Failed to create server socket, retrying...");
+            if (++g_server_failures == PROXY_SERVER_FAIL_LIMIT) {
+                proxy_notify(PROXY_EVENT_FAILED);
+            }
             vTaskDelay(pdMS_TO_TICKS(1000));
             continue;
         }
+        g_server_failures = 0;
         
         // Wait for client connection
         if (proxy_wait_for_client() != STATUS_OK) {
@@ -293,17 +780,22 @@ static void proxy_task(void *pvParameters) {
             continue;
         }
         
-        // Start forwarding tasks
-        BaseType_t ret = xTaskCreate(
-            usb_forward_task,
-            "usb_forward",
-            PROXY_TASK_STACK_SIZE / 2,
-            NULL,
-            PROXY_TASK_PRIORITY,
-            &g_usb_task_handle
-        );
+        // Every connection starts from the configured values. The forwarding
+        // tasks are not running, so their counters can be cleared here.
+        memset(&g_usb_reads, 0, sizeof(g_usb_reads));
+        memset(&g_tcp_reads, 0, sizeof(g_tcp_reads));
+        proxy_tuner_start();
+        memset(&g_usb_read_health, 0, sizeof(g_usb_read_health));
+        memset(&g_usb_write_health, 0, sizeof(g_usb_write_health));
+        g_usb_failure_reported = false;
+        g_usb_write_reset = false;
+        g_tcp_restart = false;
+        g_slo_prev[0] = g_to_phone_latency;
+        g_slo_prev[1] = g_to_car_latency;
         
-        if (ret != pdPASS) {
+        // Start forwarding tasks
+        status_t ret = task_plan_create(TASK_ID_USB_FORWARD, usb_forward_task, NULL, &g_usb_task_handle);
+        if (ret != STATUS_OK) {
             ESP_LOGE(TAG, "Failed to create USB forward task");
             proxy_cleanup_connection();
             close(g_server_socket);
@@ -312,36 +804,63 @@ static void proxy_task(void *pvParameters) {
             continue;
         }
         
-        ret = xTaskCreate(
-            tcp_forward_task,
-            "tcp_forward",
-            PROXY_TASK_STACK_SIZE / 2,
-            NULL,
-            PROXY_TASK_PRIORITY,
-            &g_tcp_task_handle
-        );
-        
-        if (ret != pdPASS) {
+        ret = task_plan_create(TASK_ID_TCP_FORWARD, tcp_forward_task, NULL, &g_tcp_task_handle);
+        if (ret != STATUS_OK) {
             ESP_LOGE(TAG, "Failed to create TCP forward task");
-            if (g_usb_task_handle) {
-                vTaskDelete(g_usb_task_handle);
-                g_usb_task_handle = NULL;
-            }
-            proxy_cleanup_connection();
+            proxy_stop_forwarding();
+            g_proxy_context.running = true;
             close(g_server_socket);
             g_server_socket = -1;
             vTaskDelay(pdMS_TO_TICKS(1000));
             continue;
         }
         
+        proxy_stall_start();
+        
         // Monitor connection
+        uint32_t last_tcp_bytes = g_proxy_context.tcp_bytes_received + g_proxy_context.tcp_bytes_sent;
         while (g_proxy_context.running && g_proxy_active && g_client_socket >= 0) {
+            int64_t window_start_us = esp_timer_get_time();
+            
             // Print statistics periodically
             ESP_LOGI(TAG, "Stats - USB: RX %d, TX %d | TCP: RX %d, TX %d", 
                      g_proxy_context.usb_bytes_received, g_proxy_context.usb_bytes_sent,
                      g_proxy_context.tcp_bytes_received, g_proxy_context.tcp_bytes_sent);
             
-            vTaskDelay(pdMS_TO_TICKS(5000));  // Stats every 5 seconds
+            // Stats every interval; proxy_stop() and proxy_reconfigure() wake
+            // it early, so rates use the window actually measured
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(g_config.stats_interval_ms));
+            if (!g_proxy_active) {
+                break;
+            }
+            uint32_t window_ms = (uint32_t)((esp_timer_get_time() - window_start_us) / 1000);
+            if (window_ms == 0) {
+                window_ms = 1;
+            }
+            
+            // Wi-Fi throughput next to the BLE advertising sharing its radio
+            uint32_t tcp_bytes = g_proxy_context.tcp_bytes_received + g_proxy_context.tcp_bytes_sent;
+            adv_airtime_stats_t adv;
+            bluetooth_get_adv_stats(&adv);
+            ESP_LOGI(TAG, "Throughput %u kbit/s | BLE adv %s, %u.%u events/s (avg %u.%u)",
+                     (unsigned)((uint64_t)(tcp_bytes - last_tcp_bytes) * 8 / window_ms), adv_mode_params(adv.mode)->name,
+                     (unsigned)(adv.rate_x10 / 10), (unsigned)(adv.rate_x10 % 10),
+                     (unsigned)(adv.avg_rate_x10 / 10), (unsigned)(adv.avg_rate_x10 % 10));
+            if (g_config.autotune) {
+                proxy_tune(window_ms, tcp_bytes - last_tcp_bytes);
+            }
+            proxy_check_latency_slo();
+            last_tcp_bytes = tcp_bytes;
+            
+            // A change made during the connection applies from the next
+            // window; the tuner restarts from the new values
+            if (proxy_apply_config()) {
+                proxy_tuner_start();
+            }
+            task_plan_log_load();
+#if HOT_PATH_PROFILE
+            proxy_log_cycles();
+#endif
             
             // Check if connection is still alive
             char test_buf;
@@ -353,19 +872,7 @@ static void proxy_task(void *pvParameters) {
         }
         
         // Cleanup this connection
-        g_proxy_context.running = false;
-        
-        if (g_usb_task_handle) {
-            vTaskDelete(g_usb_task_handle);
-            g_usb_task_handle = NULL;
-        }
-        
-        if (g_tcp_task_handle) {
-            vTaskDelete(g_tcp_task_handle);
-            g_tcp_task_handle = NULL;
-        }
-        
-        proxy_cleanup_connection();
+        proxy_stop_forwarding();
         
         if (g_server_socket >= 0) {
             close(g_server_socket);
@@ -376,11 +883,14 @@ static void proxy_task(void *pvParameters) {
         memset(&g_proxy_context, 0, sizeof(proxy_context_t));
         g_proxy_context.running = true;
         
+        // The lead-up to a disconnect, for tools/trace_decode.py
+        trace_dump();
+        
         ESP_LOGI(TAG, "Connection ended, ready for new client");
     }
     
     ESP_LOGI(TAG, "Main proxy task stopped");
-    vTaskDelete(NULL);
+    task_plan_exit(TASK_ID_PROXY);
 }
 
 status_t proxy_start(void) {
@@ -396,23 +906,16 @@ status_t proxy_start(void) {
     
     ESP_LOGI(TAG, "Starting proxy on port %d", PROXY_TCP_PORT);
     
-    // Create main proxy task
-    BaseType_t ret = xTaskCreate(
-        proxy_task,
-        "proxy_task",
-        PROXY_TASK_STACK_SIZE,
-        NULL,
-        PROXY_TASK_PRIORITY,
-        &g_proxy_task_handle
-    );
-    
-    if (ret != pdPASS) {
+    // Create main proxy task; active first, as its loop checks the flag
+    g_proxy_active = true;
+    status_t ret = task_plan_create(TASK_ID_PROXY, proxy_task, NULL, &g_proxy_task_handle);
+    if (ret != STATUS_OK) {
         ESP_LOGE(TAG, "Failed to create proxy task");
+        g_proxy_active = false;
         xSemaphoreGive(g_proxy_mutex);
         return STATUS_ERROR_MEMORY;
     }
     
-    g_proxy_active = true;
     xSemaphoreGive(g_proxy_mutex);
     
     ESP_LOGI(TAG, "Proxy started successfully");
@@ -434,22 +937,17 @@ status_t proxy_stop(void) {
     g_proxy_active = false;
     g_proxy_context.running = false;
     
-    // Wait for tasks to finish
+    // The proxy task stops the forwarding tasks on its way out; waiting for
+    // it keeps a restart from finding its slot still in use. It may sit out
+    // one accept timeout first.
     if (g_proxy_task_handle) {
-        vTaskDelay(pdMS_TO_TICKS(100));
+        xTaskNotifyGive(g_proxy_task_handle);
+        if (task_plan_join(TASK_ID_PROXY, g_config.accept_timeout_ms + PROXY_JOIN_TIMEOUT_MS) != STATUS_OK) {
+            ESP_LOGE(TAG, "Proxy task did not stop");
+        }
         g_proxy_task_handle = NULL;
     }
     
-    if (g_usb_task_handle) {
-        vTaskDelay(pdMS_TO_TICKS(100));
-        g_usb_task_handle = NULL;
-    }
-    
-    if (g_tcp_task_handle) {
-        vTaskDelay(pdMS_TO_TICKS(100));
-        g_tcp_task_handle = NULL;
-    }
-    
     // Cleanup connections
     proxy_cleanup_connection();
     
@@ -471,16 +969,6 @@ status_t proxy_deinit(void) {
         proxy_stop();
     }
     
-    if (g_usb_to_tcp_queue) {
-        vQueueDelete(g_usb_to_tcp_queue);
-        g_usb_to_tcp_queue = NULL;
-    }
-    
-    if (g_tcp_to_usb_queue) {
-        vQueueDelete(g_tcp_to_usb_queue);
-        g_tcp_to_usb_queue = NULL;
-    }
-    
     if (g_proxy_mutex) {
         vSemaphoreDelete(g_proxy_mutex);
         g_proxy_mutex = NULL;
@@ -494,16 +982,24 @@ bool proxy_is_active(void) {
     return g_proxy_active;
 }
 
+bool proxy_is_client_connected(void) {
+    return g_client_socket >= 0;
+}
+
 int proxy_get_tcp_port(void) {
     return PROXY_TCP_PORT;
 }
 
+int64_t proxy_get_connect_time_us(void) {
+    return g_connect_time_us;
+}
+
 status_t proxy_send_to_usb(const uint8_t *data, size_t length) {
     if (!g_proxy_active || data == NULL) {
         return STATUS_ERROR_CONNECTION;
     }
     
-    ESP_LOGD(TAG, "Sending %d bytes to USB", length);
+    TRACE("Sending %u bytes to USB", length);
     
     size_t transferred;
     esp_err_t ret = usb_bulk_transfer(USB_EP1_IN_ADDR, (uint8_t*)data, length, &transferred);
@@ -515,7 +1011,7 @@ status_t proxy_send_to_tcp(const uint8_t *data, size_t length) {
         return STATUS_ERROR_CONNECTION;
     }
     
-    ESP_LOGD(TAG, "Sending %d bytes to TCP", length);
+    TRACE("Sending %u bytes to TCP", length);
     
     if (g_client_socket >= 0) {
         int sent = send(g_client_socket, data, length, MSG_NOSIGNAL);
@@ -523,4 +1019,118 @@ status_t proxy_send_to_tcp(const uint8_t *data, size_t length) {
     }
     
     return STATUS_ERROR_CONNECTION;
+}
+
+void proxy_set_event_callback(proxy_event_cb_t callback, void *ctx) {
+    g_event_callback = callback;
+    g_event_ctx = ctx;
+}
+
+void proxy_set_tcp_nodelay(bool enable) {
+    // Applied to the next client connection
+    g_tcp_nodelay = enable;
+}
+
+status_t proxy_reconfigure(void) {
+    proxy_config_t config;
+    config.chunk_size = config_get(CONFIG_PROXY_CHUNK_SIZE);
+    config.accept_timeout_ms = config_get(CONFIG_PROXY_ACCEPT_TIMEOUT_MS);
+    config.stats_interval_ms = config_get(CONFIG_PROXY_STATS_INTERVAL_MS);
+    config.poll_interval_ms = config_get(CONFIG_PROXY_POLL_INTERVAL_MS);
+    config.autotune = config_get(CONFIG_PROXY_AUTOTUNE) != 0;
+    config.latency_target_us = config_get(CONFIG_PROXY_LATENCY_TARGET_US);
+    config.usb_fifo_timeout_us = config_get(CONFIG_USB_FIFO_TIMEOUT_US);
+    for (int stage = 0; stage < STALL_STAGE_COUNT; stage++) {
+        config.stall_ms[stage] = config_get((config_key_t)(CONFIG_STALL_USB_READ_MS + stage));
+    }
+    config.stall_recover = config_get(CONFIG_STALL_RECOVER) != 0;
+    
+    taskENTER_CRITICAL(&g_config_lock);
+    g_next_config = config;
+    g_config_pending = true;
+    taskEXIT_CRITICAL(&g_config_lock);
+    
+    // Idle means the proxy task is at most waiting for a client; it applies
+    // the change before the next accept. With a client, the connection
+    // monitor applies it as soon as it wakes.
+    if (!g_proxy_active) {
+        proxy_apply_config();
+    } else if (g_client_socket >= 0 && g_proxy_task_handle != NULL) {
+        xTaskNotifyGive(g_proxy_task_handle);
+    }
+    return STATUS_OK;
+}
+
+static bool proxy_apply_config(void) {
+    // The stall timer reads its thresholds word by word; one check seeing
+    // a mix of old and new ones is harmless
+    taskENTER_CRITICAL(&g_config_lock);
+    bool pending = g_config_pending;
+    if (pending) {
+        g_config = g_next_config;
+        g_config_pending = false;
+    }
+    taskEXIT_CRITICAL(&g_config_lock);
+    
+    if (!pending) {
+        return false;
+    }
+    
+    esp32_usb_otg_set_fifo_timeout(g_config.usb_fifo_timeout_us);
+    ESP_LOGI(TAG, "Config: chunk %u, accept %lu ms, stats %lu ms, poll %lu ms, autotune %s (%lu us), USB FIFO %lu us",
+             (unsigned)g_config.chunk_size, (unsigned long)g_config.accept_timeout_ms,
+             (unsigned long)g_config.stats_interval_ms, (unsigned long)g_config.poll_interval_ms,
+             g_config.autotune ? "on" : "off", (unsigned long)g_config.latency_target_us,
+             (unsigned long)g_config.usb_fifo_timeout_us);
+    ESP_LOGI(TAG, "Stall thresholds: USB read %lu, TCP send %lu, TCP recv %lu, USB write %lu ms, recovery %s",
+             (unsigned long)g_config.stall_ms[STALL_STAGE_USB_READ],
+             (unsigned long)g_config.stall_ms[STALL_STAGE_TCP_SEND],
+             (unsigned long)g_config.stall_ms[STALL_STAGE_TCP_RECV],
+             (unsigned long)g_config.stall_ms[STALL_STAGE_USB_WRITE],
+             g_config.stall_recover ? "on" : "off");
+    return true;
+}
+
+void proxy_get_traffic_stats(proxy_traffic_stats_t *stats) {
+    if (stats != NULL) {
+        *stats = g_traffic_stats;
+        stats->frames = g_tcp_scanner.frames;
+    }
+}
+
+void proxy_get_byte_counts(uint32_t *to_phone, uint32_t *to_car) {
+    if (to_phone != NULL) {
+        *to_phone = g_proxy_context.tcp_bytes_sent;
+    }
+    if (to_car != NULL) {
+        *to_car = g_proxy_context.usb_bytes_sent;
+    }
+}
+
+void proxy_get_latency(latency_histogram_t *to_phone, latency_histogram_t *to_car) {
+    // Copies without locking; the forwarding tasks never wait on a reader
+    if (to_phone != NULL) {
+        *to_phone = g_to_phone_latency;
+    }
+    if (to_car != NULL) {
+        *to_car = g_to_car_latency;
+    }
+}
+
+void proxy_get_tuning(uint32_t *chunk_size, uint32_t *poll_interval_ms) {
+    if (chunk_size != NULL) {
+        *chunk_size = g_tuner.chunk_size;
+    }
+    if (poll_interval_ms != NULL) {
+        *poll_interval_ms = g_tuner.poll_interval_ms;
+    }
+}
+
+void proxy_get_stall_counts(uint32_t counts[STALL_STAGE_COUNT], uint32_t slo_breaches[2]) {
+    if (counts != NULL) {
+        memcpy(counts, g_stall_counts, sizeof(g_stall_counts));
+    }
+    if (slo_breaches != NULL) {
+        memcpy(slo_breaches, g_slo_breaches, sizeof(g_slo_breaches));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+#include "aa_traffic_class.h"
+#include "telemetry.h"
+#include "stall_watch.h"
+
+// Proxy events reported to the connection manager
+typedef enum {
+    PROXY_EVENT_CLIENT_CONNECTED = 0,
+    PROXY_EVENT_CLIENT_DISCONNECTED,
+    PROXY_EVENT_FAILED,                 // Listening socket cannot be set up
+    PROXY_EVENT_USB_FAILED              // USB transfers fail: the gadget is down
+} proxy_event_t;
+
+typedef void (*proxy_event_cb_t)(proxy_event_t event, void *ctx);
+
+// Static packet buffer per direction; CONFIG_PROXY_CHUNK_SIZE picks how
+// much of it each read uses
+#define PROXY_BUFFER_SIZE        8192
+
+// Proxy functions
+status_t proxy_init(void);
+status_t proxy_start(void);
+status_t proxy_stop(void);
+status_t proxy_deinit(void);
+bool proxy_is_active(void);
+bool proxy_is_client_connected(void);
+int proxy_get_tcp_port(void);
+int64_t proxy_get_connect_time_us(void);   // esp_timer time of the last accept; 0 if none
+status_t proxy_send_to_usb(const uint8_t *data, size_t length);
+status_t proxy_send_to_tcp(const uint8_t *data, size_t length);
+void proxy_set_event_callback(proxy_event_cb_t callback, void *ctx);
+void proxy_set_tcp_nodelay(bool enable);
+// Takes the proxy and USB knobs from the config store. Applied at once
+// when no phone is connected, otherwise by the connection monitor at its
+// next wake-up, which this triggers; the accept timeout waits for the next
+// connection.
+status_t proxy_reconfigure(void);
+
+// Traffic to the phone (USB to TCP) by class; each class is sent with its
+// own IP TOS so the radio queues it in the matching WMM access category
+typedef struct {
+    uint32_t bytes[AA_TRAFFIC_CLASS_COUNT];
+    uint32_t runs[AA_TRAFFIC_CLASS_COUNT];     // Sends of one class
+    uint32_t tos_changes;                      // IP_TOS updates on the socket
+    uint32_t frames;                           // Frames seen on the current connection
+} proxy_traffic_stats_t;
+
+void proxy_get_traffic_stats(proxy_traffic_stats_t *stats);
+
+// Bytes forwarded on the current connection; reset when it ends
+void proxy_get_byte_counts(uint32_t *to_phone, uint32_t *to_car);
+// Cumulative forwarding latency, read to written, per direction
+void proxy_get_latency(latency_histogram_t *to_phone, latency_histogram_t *to_car);
+// Read size and poll interval in use, after proxy_tuner
+void proxy_get_tuning(uint32_t *chunk_size, uint32_t *poll_interval_ms);
+// Since boot: stalls per stall_stage_t, and stats windows whose p99 went
+// over the latency target, to phone then to car
+void proxy_get_stall_counts(uint32_t counts[STALL_STAGE_COUNT], uint32_t slo_breaches[2]);
@@ -0,0 +1,83 @@
+#include "proxy_tuner.h"
+
+static uint32_t tuner_clamp(uint32_t value, uint32_t min, uint32_t max) {
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+void proxy_tuner_init(proxy_tuner_state_t *state, const proxy_tuner_limits_t *limits,
+                      uint32_t chunk_size, uint32_t poll_interval_ms) {
+    if (state == NULL || limits == NULL) {
+        return;
+    }
+
+    state->chunk_size = tuner_clamp(chunk_size, limits->chunk_min, limits->chunk_max);
+    state->poll_interval_ms = tuner_clamp(poll_interval_ms, limits->poll_min_ms, limits->poll_max_ms);
+    state->streak = 0;
+}
+
+proxy_tuner_action_t proxy_tuner_step(proxy_tuner_state_t *state, const proxy_tuner_limits_t *limits,
+                                      const proxy_tuner_metrics_t *metrics) {
+    if (state == NULL || limits == NULL || metrics == NULL) {
+        return PROXY_TUNER_HOLD;
+    }
+
+    // Nothing flowed: no evidence about the read size, and polling fast
+    // only burns CPU
+    if (metrics->reads == 0) {
+        state->streak = 0;
+        if (state->poll_interval_ms >= limits->poll_max_ms) {
+            return PROXY_TUNER_HOLD;
+        }
+        state->poll_interval_ms = tuner_clamp(state->poll_interval_ms + 1, limits->poll_min_ms, limits->poll_max_ms);
+        return PROXY_TUNER_RELAX;
+    }
+
+    uint32_t full_reads = (metrics->full_reads < metrics->reads) ? metrics->full_reads : metrics->reads;
+    uint32_t full_pct = (uint32_t)((uint64_t)full_reads * 100 / metrics->reads);
+    bool backlog = full_pct >= PROXY_TUNER_FULL_HIGH_PCT;
+    bool over = metrics->latency_p99_us > limits->latency_target_us;
+
+    // Waiting data is not read sooner by waiting for more windows
+    bool faster = false;
+    if (backlog && state->poll_interval_ms > limits->poll_min_ms) {
+        state->poll_interval_ms = tuner_clamp(state->poll_interval_ms / 2, limits->poll_min_ms, limits->poll_max_ms);
+        faster = true;
+    }
+
+    if (backlog && !over) {
+        state->streak = (state->streak > 0) ? state->streak + 1 : 1;
+    } else if (over && full_pct <= PROXY_TUNER_FULL_LOW_PCT) {
+        state->streak = (state->streak < 0) ? state->streak - 1 : -1;
+    } else {
+        state->streak = 0;
+    }
+
+    if (state->streak >= PROXY_TUNER_STREAK) {
+        state->streak = 0;
+        if (state->chunk_size < limits->chunk_max) {
+            state->chunk_size = tuner_clamp(state->chunk_size * 2, limits->chunk_min, limits->chunk_max);
+            return PROXY_TUNER_GROW;
+        }
+    } else if (state->streak <= -PROXY_TUNER_STREAK) {
+        state->streak = 0;
+        if (state->chunk_size > limits->chunk_min) {
+            state->chunk_size = tuner_clamp(state->chunk_size / 2, limits->chunk_min, limits->chunk_max);
+            return PROXY_TUNER_SHRINK;
+        }
+    }
+
+    return faster ? PROXY_TUNER_FASTER : PROXY_TUNER_HOLD;
+}
+
+const char* proxy_tuner_action_name(proxy_tuner_action_t action) {
+    switch (action) {
+        case PROXY_TUNER_HOLD: return "hold";
+        case PROXY_TUNER_GROW: return "grow";
+        case PROXY_TUNER_SHRINK: return "shrink";
+        case PROXY_TUNER_FASTER: return "faster";
+        case PROXY_TUNER_RELAX: return "relax";
+        default: return "unknown";
+    }
+}
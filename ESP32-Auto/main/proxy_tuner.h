@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Closed-loop tuning of the proxy read size and poll interval
+// Called once per stats window with what the forwarding tasks measured.
+// A read that fills the whole chunk means more data was already waiting,
+// so the share of full reads stands in for queue occupancy:
+//  - backlog (many full reads): poll faster at once; if egress latency is
+//    within target, also double the read size
+//  - latency over target without backlog: halve the read size, since a
+//    smaller read is sent sooner
+//  - an idle window relaxes the poll interval back towards its limit
+// Read size steps need PROXY_TUNER_STREAK windows in a row agreeing, so a
+// single burst does not make it oscillate. Pure logic; logged windows can
+// be replayed off target with tools/tuner_replay.cpp.
+
+#define PROXY_TUNER_FULL_HIGH_PCT   50      // Full reads at or above this are backlog
+#define PROXY_TUNER_FULL_LOW_PCT    20      // ... at or below this, reads are not the limit
+#define PROXY_TUNER_STREAK          2
+
+typedef struct {
+    uint32_t chunk_min;
+    uint32_t chunk_max;
+    uint32_t poll_min_ms;
+    uint32_t poll_max_ms;
+    uint32_t latency_target_us;             // Egress p99, read to written
+} proxy_tuner_limits_t;
+
+typedef struct {
+    uint32_t window_ms;
+    uint32_t reads;                         // Reads that returned data, both directions
+    uint32_t full_reads;                    // ... of which filled the whole chunk
+    uint32_t bytes;                         // Forwarded, both directions
+    uint32_t latency_p99_us;                // Towards the phone; 0 without samples
+} proxy_tuner_metrics_t;
+
+typedef struct {
+    uint32_t chunk_size;
+    uint32_t poll_interval_ms;
+    int8_t streak;                          // Windows in a row asking to grow (+) or shrink (-)
+} proxy_tuner_state_t;
+
+typedef enum {
+    PROXY_TUNER_HOLD = 0,
+    PROXY_TUNER_GROW,                       // Larger reads
+    PROXY_TUNER_SHRINK,                     // Smaller reads
+    PROXY_TUNER_FASTER,                     // Shorter poll interval only
+    PROXY_TUNER_RELAX                       // Longer poll interval
+} proxy_tuner_action_t;
+
+// Proxy tuner functions
+// Starting values are clamped to the limits.
+void proxy_tuner_init(proxy_tuner_state_t *state, const proxy_tuner_limits_t *limits,
+                      uint32_t chunk_size, uint32_t poll_interval_ms);
+proxy_tuner_action_t proxy_tuner_step(proxy_tuner_state_t *state, const proxy_tuner_limits_t *limits,
+                                      const proxy_tuner_metrics_t *metrics);
+const char* proxy_tuner_action_name(proxy_tuner_action_t action);
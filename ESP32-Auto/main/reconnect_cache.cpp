@@ -0,0 +1,220 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "reconnect_cache.h"
+
+static const char *TAG = "RECONNECT_CACHE";
+
+#define CACHE_NAMESPACE         "reconnect"
+#define CACHE_KEY               "last_phone"
+#define CACHE_MAGIC             0x5243      // "RC"
+
+// Blob: magic(2) version(1) payload length(1) payload crc32(4), little endian
+#define CACHE_HEADER_SIZE       4
+#define CACHE_PAYLOAD_SIZE      26
+#define CACHE_CRC_SIZE          4
+#define CACHE_BLOB_SIZE         (CACHE_HEADER_SIZE + CACHE_PAYLOAD_SIZE + CACHE_CRC_SIZE)
+
+static reconnect_cache_t g_entry;
+static uint8_t g_blob[CACHE_BLOB_SIZE];     // g_entry as stored
+static bool g_warm = false;
+
+static uint8_t* put_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t* put_u32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+status_t reconnect_cache_pack(const reconnect_cache_t *entry, uint8_t *buffer, size_t capacity, size_t *size) {
+    if (entry == NULL || buffer == NULL || capacity < CACHE_BLOB_SIZE) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    uint8_t *p = put_u16(buffer, CACHE_MAGIC);
+    *p++ = RECONNECT_CACHE_VERSION;
+    *p++ = CACHE_PAYLOAD_SIZE;
+
+    memcpy(p, entry->phone_mac, RECONNECT_CACHE_MAC_SIZE);
+    p += RECONNECT_CACHE_MAC_SIZE;
+    memcpy(p, entry->ble_addr, RECONNECT_CACHE_MAC_SIZE);
+    p += RECONNECT_CACHE_MAC_SIZE;
+    *p++ = entry->wifi_channel;
+    p = put_u16(p, entry->aoa_version);
+    *p++ = entry->audio_mode;
+    p = put_u16(p, entry->tcp_port);
+    p = put_u32(p, entry->sessions);
+    p = put_u32(p, entry->last_connect_ms);
+
+    put_u32(p, esp_rom_crc32_le(0, buffer, CACHE_HEADER_SIZE + CACHE_PAYLOAD_SIZE));
+
+    if (size != NULL) {
+        *size = CACHE_BLOB_SIZE;
+    }
+    return STATUS_OK;
+}
+
+status_t reconnect_cache_unpack(const uint8_t *buffer, size_t size, reconnect_cache_t *entry) {
+    if (buffer == NULL || entry == NULL || size != CACHE_BLOB_SIZE) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    // A different version means a different layout; never reinterpret it
+    if (get_u16(buffer) != CACHE_MAGIC || buffer[2] != RECONNECT_CACHE_VERSION ||
+        buffer[3] != CACHE_PAYLOAD_SIZE) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    const uint8_t *crc = buffer + CACHE_HEADER_SIZE + CACHE_PAYLOAD_SIZE;
+    if (get_u32(crc) != esp_rom_crc32_le(0, buffer, CACHE_HEADER_SIZE + CACHE_PAYLOAD_SIZE)) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    const uint8_t *p = buffer + CACHE_HEADER_SIZE;
+    memcpy(entry->phone_mac, p, RECONNECT_CACHE_MAC_SIZE);
+    p += RECONNECT_CACHE_MAC_SIZE;
+    memcpy(entry->ble_addr, p, RECONNECT_CACHE_MAC_SIZE);
+    p += RECONNECT_CACHE_MAC_SIZE;
+    entry->wifi_channel = *p++;
+    entry->aoa_version = get_u16(p);
+    p += 2;
+    entry->audio_mode = *p++;
+    entry->tcp_port = get_u16(p);
+    p += 2;
+    entry->sessions = get_u32(p);
+    p += 4;
+    entry->last_connect_ms = get_u32(p);
+
+    return STATUS_OK;
+}
+
+status_t reconnect_cache_init(void) {
+    nvs_handle_t handle;
+    size_t size = sizeof(g_blob);
+
+    g_warm = false;
+    memset(&g_entry, 0, sizeof(g_entry));
+
+    esp_err_t ret = nvs_open(CACHE_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "No reconnect cache, cold start");
+        return STATUS_OK;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    ret = nvs_get_blob(handle, CACHE_KEY, g_blob, &size);
+    nvs_close(handle);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "No reconnect cache, cold start");
+        return STATUS_OK;
+    }
+
+    // A stale or damaged blob only costs a cold start; it is overwritten later
+    if (ret != ESP_OK || reconnect_cache_unpack(g_blob, size, &g_entry) != STATUS_OK) {
+        ESP_LOGW(TAG, "Ignoring stale reconnect cache (%u bytes)", (unsigned)size);
+        memset(&g_entry, 0, sizeof(g_entry));
+        return STATUS_OK;
+    }
+
+    g_warm = true;
+    ESP_LOGI(TAG, "Warm start: phone %02x:%02x:%02x:%02x:%02x:%02x, channel %d, AOA %d, %lu sessions, last connect %lu ms",
+             g_entry.phone_mac[0], g_entry.phone_mac[1], g_entry.phone_mac[2],
+             g_entry.phone_mac[3], g_entry.phone_mac[4], g_entry.phone_mac[5],
+             g_entry.wifi_channel, g_entry.aoa_version,
+             (unsigned long)g_entry.sessions, (unsigned long)g_entry.last_connect_ms);
+    return STATUS_OK;
+}
+
+bool reconnect_cache_get(reconnect_cache_t *entry) {
+    if (!g_warm) {
+        return false;
+    }
+    if (entry != NULL) {
+        *entry = g_entry;
+    }
+    return true;
+}
+
+bool reconnect_cache_is_warm(void) {
+    return g_warm;
+}
+
+status_t reconnect_cache_store(const reconnect_cache_t *entry) {
+    if (entry == NULL) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    uint8_t blob[CACHE_BLOB_SIZE];
+    size_t size;
+    status_t status = reconnect_cache_pack(entry, blob, sizeof(blob), &size);
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    // Every write costs flash wear; skip it when nothing changed
+    if (g_warm && memcmp(blob, g_blob, sizeof(g_blob)) == 0) {
+        return STATUS_OK;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    ret = nvs_set_blob(handle, CACHE_KEY, blob, size);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write reconnect cache: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    g_entry = *entry;
+    memcpy(g_blob, blob, sizeof(g_blob));
+    g_warm = true;
+    ESP_LOGI(TAG, "Reconnect cache updated");
+    return STATUS_OK;
+}
+
+status_t reconnect_cache_clear(void) {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return STATUS_ERROR_INIT;
+    }
+
+    ret = nvs_erase_key(handle, CACHE_KEY);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    g_warm = false;
+    memset(&g_entry, 0, sizeof(g_entry));
+    return (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND) ? STATUS_OK : STATUS_ERROR_INIT;
+}
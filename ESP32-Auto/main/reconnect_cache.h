@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Warm reconnect cache
+// What was learned about the last phone is kept in NVS as one versioned
+// blob under a single key. It is loaded once at boot; afterwards lookups
+// are a copy from RAM. A blob written by a different layout version, or
+// one that fails its CRC, is ignored and the boot is cold.
+
+#define RECONNECT_CACHE_VERSION     1
+#define RECONNECT_CACHE_MAC_SIZE    6
+
+typedef struct {
+    uint8_t phone_mac[RECONNECT_CACHE_MAC_SIZE];    // Wi-Fi station address
+    uint8_t ble_addr[RECONNECT_CACHE_MAC_SIZE];     // BLE peer address; zero if never seen
+    uint8_t wifi_channel;                           // AP channel the phone joined on
+    uint16_t aoa_version;                           // Negotiated AOA protocol version
+    uint8_t audio_mode;                             // aoa_audio_mode_t in effect
+    uint16_t tcp_port;                              // Proxy port the phone connected to
+    uint32_t sessions;                              // Sessions streamed with this phone
+    uint32_t last_connect_ms;                       // Session ready to streaming, last time
+} reconnect_cache_t;
+
+// Blob framing; exposed so the layout can be checked off target
+status_t reconnect_cache_pack(const reconnect_cache_t *entry, uint8_t *buffer, size_t capacity, size_t *size);
+status_t reconnect_cache_unpack(const uint8_t *buffer, size_t size, reconnect_cache_t *entry);
+
+// Reconnect cache functions
+// reconnect_cache_init() needs NVS to be initialised.
+status_t reconnect_cache_init(void);
+bool reconnect_cache_get(reconnect_cache_t *entry);   // false on a cold boot
+bool reconnect_cache_is_warm(void);
+status_t reconnect_cache_store(const reconnect_cache_t *entry);  // Skips the write when unchanged
+status_t reconnect_cache_clear(void);
@@ -0,0 +1,66 @@
+#include <string.h>
+#include "stall_watch.h"
+
+// The write that drains a read's buffer; none after a write
+static stall_stage_t stall_stage_next(int stage) {
+    switch (stage) {
+        case STALL_STAGE_USB_READ: return STALL_STAGE_TCP_SEND;
+        case STALL_STAGE_TCP_RECV: return STALL_STAGE_USB_WRITE;
+        default: return STALL_STAGE_COUNT;
+    }
+}
+
+void stall_watch_init(stall_watch_t *watch, uint32_t now_ms) {
+    memset(watch, 0, sizeof(*watch));
+    for (int stage = 0; stage < STALL_STAGE_COUNT; stage++) {
+        watch->stages[stage].since_ms = now_ms;
+    }
+}
+
+void stall_watch_pending(stall_watch_t *watch, stall_stage_t stage, uint32_t bytes, uint32_t now_ms) {
+    stall_stage_state_t *state = &watch->stages[stage];
+    if (state->pending == 0 && bytes > 0) {
+        state->since_ms = now_ms;
+    }
+    state->pending = bytes;
+}
+
+void stall_watch_progress(stall_watch_t *watch, stall_stage_t stage, uint32_t now_ms) {
+    stall_stage_state_t *state = &watch->stages[stage];
+    state->pending = 0;
+    state->since_ms = now_ms;
+    state->stalled = false;
+}
+
+uint32_t stall_watch_check(stall_watch_t *watch, const uint32_t *thresholds_ms, uint32_t now_ms) {
+    uint32_t stalled = 0;
+
+    for (int stage = 0; stage < STALL_STAGE_COUNT; stage++) {
+        stall_stage_state_t *state = &watch->stages[stage];
+        if (state->pending == 0 || state->stalled) {
+            continue;
+        }
+        // Its clock restarts when the write moves on
+        stall_stage_t next = stall_stage_next(stage);
+        if (next != STALL_STAGE_COUNT && watch->stages[next].pending > 0) {
+            state->since_ms = now_ms;
+            continue;
+        }
+        // Unsigned difference; the millisecond clock wraps after 49 days
+        if (now_ms - state->since_ms >= thresholds_ms[stage]) {
+            state->stalled = true;
+            stalled |= 1u << stage;
+        }
+    }
+    return stalled;
+}
+
+const char* stall_stage_name(stall_stage_t stage) {
+    switch (stage) {
+        case STALL_STAGE_USB_READ: return "usb_read";
+        case STALL_STAGE_TCP_SEND: return "tcp_send";
+        case STALL_STAGE_TCP_RECV: return "tcp_recv";
+        case STALL_STAGE_USB_WRITE: return "usb_write";
+        default: return "unknown";
+    }
+}
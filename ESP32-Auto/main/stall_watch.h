@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Data-path stall detection
+// Each forwarding direction has two stages, and every stage records the
+// bytes waiting at it and when it last made progress. A stage stalls when
+// bytes have been waiting for longer than its threshold with no progress;
+// it is reported once, and clears on its next progress. A read held up by
+// the write after it is back-pressure, not a stall of its own. The forwarding
+// tasks report their own stages and what waits in the socket receive buffer
+// after each write; the USB RX FIFO is sampled by the watchdog. Pure logic,
+// and placed in IRAM with the rest of the data path (linker.lf).
+
+typedef enum {
+    STALL_STAGE_USB_READ = 0,               // USB OUT FIFO -> proxy, towards the phone
+    STALL_STAGE_TCP_SEND,                   // proxy -> socket
+    STALL_STAGE_TCP_RECV,                   // socket -> proxy, towards the car
+    STALL_STAGE_USB_WRITE,                  // proxy -> USB IN FIFO
+    STALL_STAGE_COUNT
+} stall_stage_t;
+
+typedef struct {
+    uint32_t since_ms;                      // Last progress, or when bytes started waiting
+    uint32_t pending;                       // Bytes waiting; 0 when idle
+    bool stalled;                           // Reported, until the next progress
+} stall_stage_state_t;
+
+typedef struct {
+    stall_stage_state_t stages[STALL_STAGE_COUNT];
+} stall_watch_t;
+
+// Stall watch functions
+void stall_watch_init(stall_watch_t *watch, uint32_t now_ms);
+// Bytes now waiting at a stage; an idle stage starts its wait at now_ms
+void stall_watch_pending(stall_watch_t *watch, stall_stage_t stage, uint32_t bytes, uint32_t now_ms);
+// The stage moved its bytes on
+void stall_watch_progress(stall_watch_t *watch, stall_stage_t stage, uint32_t now_ms);
+// Bit per stage that stalled since the last check; thresholds in ms, per stage
+uint32_t stall_watch_check(stall_watch_t *watch, const uint32_t *thresholds_ms, uint32_t now_ms);
+const char* stall_stage_name(stall_stage_t stage);
@@ -0,0 +1,259 @@
+#include <string.h>
+#include "esp_log.h"
+#include "mem_plan.h"
+#include "task_plan.h"
+
+static const char *TAG = "TASK_PLAN";
+
+#if TASK_PLAN_PINNED
+#define PLAN_CORE(core) (core)
+#else
+#define PLAN_CORE(core) tskNO_AFFINITY
+#endif
+
+// Indexed by task_id_t. Priorities, highest first: forwarding sits below
+// lwIP (18) so TCP is never starved by the tasks feeding it. Input from the car (USB OUT) is small and
+// latency bound, so it preempts the bulk video path on core 1.
+//
+// tcp_forward carries the video and most of the CPU time. tools/sched_sim.py
+// shows it does best floating: pinned next to Wi-Fi and lwIP its p99 roughly
+// doubles, and pinned to core 1 it delays input.
+//
+// The forwarding tasks keep their packet buffers in static DMA memory
+// (proxy_handler.cpp), so their stacks only hold call frames.
+static const task_placement_t g_plan[TASK_ID_COUNT] = {
+    { "proxy_task",   8192, 12, PLAN_CORE(TASK_PLAN_CORE_NET), false },
+    { "usb_forward",  3072, 13, PLAN_CORE(TASK_PLAN_CORE_USB), false },
+    { "tcp_forward",  3072, 12, tskNO_AFFINITY,                false },
+    { "conn_manager", 4096,  6, tskNO_AFFINITY,                false },
+    { "WiFi",         4096,  5, PLAN_CORE(TASK_PLAN_CORE_NET), true },
+    { "Bluetooth",    4096,  5, tskNO_AFFINITY,                true },
+    { "USB",          4096,  5, PLAN_CORE(TASK_PLAN_CORE_USB), true },
+    { "wifi_monitor", 3072,  2, PLAN_CORE(TASK_PLAN_CORE_NET), false },
+    { "telemetry",    3072,  1, tskNO_AFFINITY,                false },
+    { "httpd",        4096,  2, PLAN_CORE(TASK_PLAN_CORE_NET), true },
+};
+
+#define TASK_PLAN_PARK_WAIT_MS  100
+#define TASK_PLAN_JOIN_POLL_MS  10
+
+typedef enum {
+    TASK_SLOT_FREE = 0,
+    TASK_SLOT_RUNNING,
+    TASK_SLOT_PARKED                        // Suspended in task_plan_exit(), stack still in use
+} task_slot_state_t;
+
+// Stacks must stay in internal RAM; the pool is carved once by task_plan_init
+static StackType_t g_stack_pool[TASK_PLAN_STACK_POOL] __attribute__((aligned(16)));
+static StackType_t *g_stacks[TASK_ID_COUNT];
+static StaticTask_t g_tcbs[TASK_ID_COUNT];
+static TaskHandle_t g_handles[TASK_ID_COUNT];
+static volatile task_slot_state_t g_slots[TASK_ID_COUNT];
+
+const task_placement_t* task_plan_get(task_id_t id) {
+    return (id < TASK_ID_COUNT) ? &g_plan[id] : NULL;
+}
+
+status_t task_plan_init(void) {
+    size_t offset = 0;
+
+    for (int id = 0; id < TASK_ID_COUNT; id++) {
+        if (g_plan[id].boot_only) {
+            continue;
+        }
+        if (offset + g_plan[id].stack_size > TASK_PLAN_STACK_POOL) {
+            ESP_LOGE(TAG, "Stack pool too small for %s", g_plan[id].name);
+            return STATUS_ERROR_MEMORY;
+        }
+
+        // StackType_t is a byte on this port, as is stack_size
+        g_stacks[id] = &g_stack_pool[offset];
+        offset += (g_plan[id].stack_size + 15) & ~15u;
+        mem_plan_add_stack(g_plan[id].name, g_stacks[id], g_plan[id].stack_size);
+    }
+
+    mem_plan_add_object("task_tcbs", MEM_KIND_INTERNAL, g_tcbs, sizeof(g_tcbs), NULL);
+    ESP_LOGI(TAG, "Static stacks: %u of %u bytes", (unsigned)offset, (unsigned)TASK_PLAN_STACK_POOL);
+    return STATUS_OK;
+}
+
+// A parked task is suspended, so deleting it from here finishes at once and
+// leaves nothing on the idle task's termination list referencing the slot
+static status_t task_plan_reclaim(task_id_t id) {
+    TaskHandle_t parked = g_handles[id];
+    int waited = 0;
+
+    while (eTaskGetState(parked) != eSuspended) {
+        if (waited >= TASK_PLAN_PARK_WAIT_MS) {
+            ESP_LOGE(TAG, "%s did not park", g_plan[id].name);
+            return STATUS_ERROR_INIT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+        waited++;
+    }
+
+    vTaskDelete(parked);
+    g_handles[id] = NULL;
+    g_slots[id] = TASK_SLOT_FREE;
+    return STATUS_OK;
+}
+
+status_t task_plan_create(task_id_t id, TaskFunction_t function, void *arg, TaskHandle_t *handle) {
+    const task_placement_t *plan = task_plan_get(id);
+    if (plan == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    if (g_slots[id] == TASK_SLOT_RUNNING) {
+        ESP_LOGE(TAG, "%s is still running", plan->name);
+        return STATUS_ERROR_INIT;
+    }
+    if (g_slots[id] == TASK_SLOT_PARKED && task_plan_reclaim(id) != STATUS_OK) {
+        return STATUS_ERROR_INIT;
+    }
+
+    // Running before it starts, so an immediate task_plan_exit() is seen
+    g_slots[id] = TASK_SLOT_RUNNING;
+
+    TaskHandle_t created = NULL;
+    if (plan->boot_only) {
+        if (xTaskCreatePinnedToCore(function, plan->name, plan->stack_size, arg, plan->priority,
+                                    &created, plan->core) != pdPASS) {
+            created = NULL;
+        }
+    } else if (g_stacks[id] != NULL) {
+        created = xTaskCreateStaticPinnedToCore(function, plan->name, plan->stack_size, arg, plan->priority,
+                                                g_stacks[id], &g_tcbs[id], plan->core);
+    }
+
+    if (created == NULL) {
+        g_slots[id] = TASK_SLOT_FREE;
+        ESP_LOGE(TAG, "Failed to create %s", plan->name);
+        return STATUS_ERROR_MEMORY;
+    }
+
+    g_handles[id] = created;
+    if (handle != NULL) {
+        *handle = created;
+    }
+    return STATUS_OK;
+}
+
+void task_plan_exit(task_id_t id) {
+    if (id < TASK_ID_COUNT && !g_plan[id].boot_only) {
+        // Self-deletion would leave the TCB on the termination list until the
+        // idle task runs; parking lets the next create reuse the slot safely
+        g_slots[id] = TASK_SLOT_PARKED;
+        for (;;) {
+            vTaskSuspend(NULL);
+        }
+    }
+
+    if (id < TASK_ID_COUNT) {
+        g_slots[id] = TASK_SLOT_FREE;
+    }
+    vTaskDelete(NULL);
+}
+
+bool task_plan_is_running(task_id_t id) {
+    return id < TASK_ID_COUNT && g_slots[id] == TASK_SLOT_RUNNING;
+}
+
+status_t task_plan_join(task_id_t id, uint32_t timeout_ms) {
+    uint32_t waited = 0;
+
+    while (task_plan_is_running(id)) {
+        if (waited >= timeout_ms) {
+            ESP_LOGW(TAG, "%s still running after %u ms", g_plan[id].name, (unsigned)timeout_ms);
+            return STATUS_ERROR_CONNECTION;
+        }
+        vTaskDelay(pdMS_TO_TICKS(TASK_PLAN_JOIN_POLL_MS));
+        waited += TASK_PLAN_JOIN_POLL_MS;
+    }
+    return STATUS_OK;
+}
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+#define TASK_PLAN_MAX_TASKS 40
+
+// Static: the snapshot is far too large for the caller's stack
+static TaskStatus_t g_status[TASK_PLAN_MAX_TASKS];
+static configRUN_TIME_COUNTER_TYPE g_prev_total = 0;
+static configRUN_TIME_COUNTER_TYPE g_prev_idle[portNUM_PROCESSORS];
+static configRUN_TIME_COUNTER_TYPE g_prev_task[TASK_ID_COUNT];
+
+static uint8_t task_plan_pct(configRUN_TIME_COUNTER_TYPE part, configRUN_TIME_COUNTER_TYPE whole) {
+    if (whole == 0) {
+        return 0;
+    }
+    uint64_t pct = (uint64_t)part * 100 / whole;
+    return (uint8_t)(pct > 100 ? 100 : pct);
+}
+
+status_t task_plan_sample_load(task_plan_load_t *load) {
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    configRUN_TIME_COUNTER_TYPE idle[portNUM_PROCESSORS] = {};
+    configRUN_TIME_COUNTER_TYPE tasks[TASK_ID_COUNT] = {};
+
+    if (load == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    UBaseType_t count = uxTaskGetSystemState(g_status, TASK_PLAN_MAX_TASKS, &total);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, load not sampled", TASK_PLAN_MAX_TASKS);
+        return STATUS_ERROR_MEMORY;
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            if (g_status[i].xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+                idle[core] = g_status[i].ulRunTimeCounter;
+            }
+        }
+        // By name: forwarding tasks come and go with each connection
+        for (int id = 0; id < TASK_ID_COUNT; id++) {
+            if (strcmp(g_status[i].pcTaskName, g_plan[id].name) == 0) {
+                tasks[id] = g_status[i].ulRunTimeCounter;
+            }
+        }
+    }
+
+    configRUN_TIME_COUNTER_TYPE window = total - g_prev_total;
+    memset(load, 0, sizeof(*load));
+    load->window_us = (uint32_t)window;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        load->core_load_pct[core] = 100 - task_plan_pct(idle[core] - g_prev_idle[core], window);
+        g_prev_idle[core] = idle[core];
+    }
+    for (int id = 0; id < TASK_ID_COUNT; id++) {
+        // A task recreated since the last sample restarts its counter
+        configRUN_TIME_COUNTER_TYPE used = (tasks[id] >= g_prev_task[id]) ? tasks[id] - g_prev_task[id] : tasks[id];
+        load->task_pct[id] = task_plan_pct(used, window);
+        g_prev_task[id] = tasks[id];
+    }
+    g_prev_total = total;
+    return STATUS_OK;
+}
+
+#else
+
+status_t task_plan_sample_load(task_plan_load_t *load) {
+    return STATUS_ERROR_INIT;
+}
+
+#endif
+
+void task_plan_log_load(void) {
+    task_plan_load_t load;
+    if (task_plan_sample_load(&load) != STATUS_OK) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Load (%s) core0 %d%% core1 %d%% | usb_fwd %d%% tcp_fwd %d%%",
+             TASK_PLAN_PINNED ? "pinned" : "floating",
+             load.core_load_pct[0], portNUM_PROCESSORS > 1 ? load.core_load_pct[portNUM_PROCESSORS - 1] : 0,
+             load.task_pct[TASK_ID_USB_FORWARD], load.task_pct[TASK_ID_TCP_FORWARD]);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "common.h"
+
+// Task placement plan
+// Every task the firmware creates takes its core, priority and stack from
+// one table. Core 0 carries the Wi-Fi driver (priority 23) and lwIP
+// (priority 18, pinned by sdkconfig), so network-side work sits next to
+// them; core 1 takes the USB interrupt and USB-side forwarding. tools/sched_sim.py compares the plan against floating tasks.
+//
+// Build with TASK_PLAN_PINNED=0 to create every task without affinity,
+// the baseline for comparing per-core load.
+//
+// Long-lived tasks run on static stacks and control blocks carved from
+// one pool at boot, so restarting them never touches the heap. Such a task
+// ends with task_plan_exit(), which parks it; the next task_plan_create()
+// for the same id reclaims the slot. Boot-only tasks use the heap and give
+// it back when they end; the USB entry is reused for gadget restarts.
+
+#ifndef TASK_PLAN_PINNED
+#define TASK_PLAN_PINNED 1
+#endif
+
+#define TASK_PLAN_CORE_NET      0           // Wi-Fi, lwIP
+#define TASK_PLAN_CORE_USB      1           // USB event polling and endpoint I/O
+
+#define TASK_PLAN_STACK_POOL    (24 * 1024) // Sum of the static stacks
+
+typedef enum {
+    TASK_ID_PROXY = 0,                      // Accept and connection monitor
+    TASK_ID_USB_FORWARD,                    // USB OUT -> TCP
+    TASK_ID_TCP_FORWARD,                    // TCP -> USB IN
+    TASK_ID_CONN_MANAGER,
+    TASK_ID_INIT_WIFI,
+    TASK_ID_INIT_BLUETOOTH,
+    TASK_ID_INIT_USB,                       // USB bring-up and restarts, next to the endpoint I/O
+    TASK_ID_WIFI_MONITOR,
+    TASK_ID_TELEMETRY,
+    TASK_ID_METRICS,                        // Created by esp_http_server from this entry
+    TASK_ID_COUNT
+} task_id_t;
+
+typedef struct {
+    const char *name;
+    uint32_t stack_size;
+    UBaseType_t priority;
+    BaseType_t core;                        // tskNO_AFFINITY to float
+    bool boot_only;                         // Heap stack: bring-up tasks, and tasks an IDF component creates
+} task_placement_t;
+
+// Carves the static stacks; call once before the first task_plan_create()
+status_t task_plan_init(void);
+const task_placement_t* task_plan_get(task_id_t id);
+// Fails while the previous task with the same id is still running
+status_t task_plan_create(task_id_t id, TaskFunction_t function, void *arg, TaskHandle_t *handle);
+// Last call of every planned task, in place of vTaskDelete(NULL)
+void task_plan_exit(task_id_t id);
+bool task_plan_is_running(task_id_t id);
+// Waits for a task to reach task_plan_exit()
+status_t task_plan_join(task_id_t id, uint32_t timeout_ms);
+
+// Per-core load since the previous call, plus the share of each planned
+// task. Needs CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+typedef struct {
+    uint8_t core_load_pct[portNUM_PROCESSORS];
+    uint8_t task_pct[TASK_ID_COUNT];        // Of one core's time
+    uint32_t window_us;
+} task_plan_load_t;
+
+status_t task_plan_sample_load(task_plan_load_t *load);
+void task_plan_log_load(void);
@@ -0,0 +1,218 @@
+#include <string.h>
+#include "telemetry.h"
+
+// Latency histogram
+
+static uint32_t latency_bucket(uint32_t latency_us) {
+    if (latency_us > TELEMETRY_LATENCY_MAX_US) {
+        latency_us = TELEMETRY_LATENCY_MAX_US;
+    }
+    if (latency_us < (1u << TELEMETRY_LATENCY_SUB_BITS)) {
+        return latency_us;
+    }
+
+    uint32_t msb = 31 - __builtin_clz(latency_us);
+    uint32_t sub = (latency_us >> (msb - TELEMETRY_LATENCY_SUB_BITS)) & ((1u << TELEMETRY_LATENCY_SUB_BITS) - 1);
+    return ((msb - TELEMETRY_LATENCY_SUB_BITS + 1) << TELEMETRY_LATENCY_SUB_BITS) + sub;
+}
+
+// Largest latency that falls into a bucket
+static uint32_t latency_bucket_upper(uint32_t bucket) {
+    if (bucket < (1u << TELEMETRY_LATENCY_SUB_BITS)) {
+        return bucket;
+    }
+
+    uint32_t msb = (bucket >> TELEMETRY_LATENCY_SUB_BITS) + TELEMETRY_LATENCY_SUB_BITS - 1;
+    uint32_t sub = bucket & ((1u << TELEMETRY_LATENCY_SUB_BITS) - 1);
+    uint32_t shift = msb - TELEMETRY_LATENCY_SUB_BITS;
+    return ((((1u << TELEMETRY_LATENCY_SUB_BITS) | sub) + 1) << shift) - 1;
+}
+
+void latency_histogram_record(latency_histogram_t *histogram, uint32_t latency_us) {
+    // Plain increments: a reader may see a bucket one count ahead of count
+    histogram->buckets[latency_bucket(latency_us)]++;
+    histogram->count++;
+    histogram->sum_us += latency_us;
+}
+
+void latency_histogram_delta(const latency_histogram_t *now, const latency_histogram_t *before,
+                             latency_histogram_t *delta) {
+    for (int i = 0; i < TELEMETRY_LATENCY_BUCKETS; i++) {
+        delta->buckets[i] = now->buckets[i] - before->buckets[i];
+    }
+    delta->count = now->count - before->count;
+    delta->sum_us = now->sum_us - before->sum_us;
+}
+
+uint32_t latency_histogram_percentile(const latency_histogram_t *histogram, uint8_t percentile) {
+    // Summed from the buckets rather than taken from count, which may lag
+    uint64_t total = 0;
+    for (int i = 0; i < TELEMETRY_LATENCY_BUCKETS; i++) {
+        total += histogram->buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (total * (percentile > 100 ? 100 : percentile) + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < TELEMETRY_LATENCY_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            return latency_bucket_upper(i);
+        }
+    }
+    return TELEMETRY_LATENCY_MAX_US;
+}
+
+uint32_t latency_histogram_count_le(const latency_histogram_t *histogram, uint32_t bound_us) {
+    uint32_t count = 0;
+    for (int i = 0; i < TELEMETRY_LATENCY_BUCKETS; i++) {
+        if (latency_bucket_upper(i) > bound_us) {
+            break;
+        }
+        count += histogram->buckets[i];
+    }
+    return count;
+}
+
+// Record encoding
+
+static void put_u16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *out, uint32_t value) {
+    put_u16(out, (uint16_t)value);
+    put_u16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *in) {
+    return get_u16(in) | ((uint32_t)get_u16(in + 2) << 16);
+}
+
+void telemetry_record_pack(const telemetry_record_t *record, uint8_t out[TELEMETRY_RECORD_SIZE]) {
+    out[0] = TELEMETRY_RECORD_VERSION;
+    out[1] = record->conn_state;
+    put_u16(out + 2, record->sequence);
+    put_u32(out + 4, record->uptime_ms);
+    put_u16(out + 8, record->to_phone_kbps);
+    put_u16(out + 10, record->to_car_kbps);
+    for (int i = 0; i < 3; i++) {
+        put_u16(out + 12 + i * 2, record->to_phone_us[i]);
+        put_u16(out + 18 + i * 2, record->to_car_us[i]);
+    }
+    out[24] = (uint8_t)record->rssi;
+    out[25] = record->adv_mode;
+    put_u16(out + 26, record->dropped);
+}
+
+status_t telemetry_record_unpack(const uint8_t *data, size_t size, telemetry_record_t *record) {
+    if (data == NULL || record == NULL || size < TELEMETRY_RECORD_SIZE ||
+        data[0] != TELEMETRY_RECORD_VERSION) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    record->conn_state = data[1];
+    record->sequence = get_u16(data + 2);
+    record->uptime_ms = get_u32(data + 4);
+    record->to_phone_kbps = get_u16(data + 8);
+    record->to_car_kbps = get_u16(data + 10);
+    for (int i = 0; i < 3; i++) {
+        record->to_phone_us[i] = get_u16(data + 12 + i * 2);
+        record->to_car_us[i] = get_u16(data + 18 + i * 2);
+    }
+    record->rssi = (int8_t)data[24];
+    record->adv_mode = data[25];
+    record->dropped = get_u16(data + 26);
+    return STATUS_OK;
+}
+
+// Queue and batching
+
+void telemetry_queue_init(telemetry_queue_t *queue) {
+    memset(queue, 0, sizeof(*queue));
+    queue->config.period_ms = TELEMETRY_DEFAULT_PERIOD_MS;
+    queue->config.flush_ms = TELEMETRY_DEFAULT_FLUSH_MS;
+}
+
+status_t telemetry_config_parse(const uint8_t *data, size_t size, telemetry_config_t *config) {
+    if (data == NULL || config == NULL || (size != 2 && size != 4)) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+
+    uint16_t period = get_u16(data);
+    uint16_t flush = (size == 4) ? get_u16(data + 2) : config->flush_ms;
+
+    if (period != 0 && (period < TELEMETRY_PERIOD_MIN_MS || period > TELEMETRY_PERIOD_MAX_MS)) {
+        return STATUS_ERROR_PROTOCOL;
+    }
+    // Flushing faster than sampling would send one record at a time anyway
+    if (period != 0 && flush < period) {
+        flush = period;
+    }
+
+    config->period_ms = period;
+    config->flush_ms = flush;
+    return STATUS_OK;
+}
+
+void telemetry_queue_push(telemetry_queue_t *queue, const telemetry_record_t *record, int64_t now_us) {
+    if (queue->count == TELEMETRY_QUEUE_RECORDS) {
+        // Keep the newest; a reader that fell behind wants the current picture
+        queue->head = (queue->head + 1) % TELEMETRY_QUEUE_RECORDS;
+        queue->count--;
+        queue->dropped++;
+        queue->oldest_us = now_us;
+    }
+
+    uint16_t tail = (queue->head + queue->count) % TELEMETRY_QUEUE_RECORDS;
+    telemetry_record_pack(record, queue->records[tail]);
+    if (queue->count == 0) {
+        queue->oldest_us = now_us;
+    }
+    queue->count++;
+}
+
+bool telemetry_queue_due(const telemetry_queue_t *queue, size_t payload_size, int64_t now_us) {
+    size_t per_notify = payload_size / TELEMETRY_RECORD_SIZE;
+    if (queue->count == 0 || per_notify == 0) {
+        return false;
+    }
+    return queue->count >= per_notify ||
+           now_us - queue->oldest_us >= (int64_t)queue->config.flush_ms * 1000;
+}
+
+size_t telemetry_queue_peek(const telemetry_queue_t *queue, uint8_t *out, size_t payload_size) {
+    size_t records = payload_size / TELEMETRY_RECORD_SIZE;
+    if (records > queue->count) {
+        records = queue->count;
+    }
+
+    for (size_t i = 0; i < records; i++) {
+        memcpy(out + i * TELEMETRY_RECORD_SIZE,
+               queue->records[(queue->head + i) % TELEMETRY_QUEUE_RECORDS], TELEMETRY_RECORD_SIZE);
+    }
+    return records * TELEMETRY_RECORD_SIZE;
+}
+
+void telemetry_queue_commit(telemetry_queue_t *queue, size_t size, int64_t now_us) {
+    uint16_t records = (uint16_t)(size / TELEMETRY_RECORD_SIZE);
+    if (records > queue->count) {
+        records = queue->count;
+    }
+
+    queue->head = (queue->head + records) % TELEMETRY_QUEUE_RECORDS;
+    queue->count -= records;
+    // Records still queued were sampled later; restart their wait
+    queue->oldest_us = now_us;
+}
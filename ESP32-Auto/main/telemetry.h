@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// Dongle telemetry
+// Pure logic for the BLE telemetry service: a latency histogram the data
+// path can update without locks, a fixed little-endian record, and a queue
+// that packs records into notifications of the negotiated MTU.
+
+// Latency histogram: 4 linear sub-buckets per power of two, so any
+// percentile is within 25% of the true value
+#define TELEMETRY_LATENCY_SUB_BITS  2
+#define TELEMETRY_LATENCY_MAX_US    ((1u << 24) - 1)
+#define TELEMETRY_LATENCY_BUCKETS   92
+
+// One writer (the forwarding task) and any number of readers; readers work
+// on copies and subtract an earlier copy to get a window. sum_us is two
+// words on the ESP32: a copy taken while its low word carries is 2^32 us
+// short, once every 71 minutes of summed latency.
+typedef struct {
+    uint32_t buckets[TELEMETRY_LATENCY_BUCKETS];
+    uint32_t count;
+    uint64_t sum_us;                // Latencies as recorded, not clamped
+} latency_histogram_t;
+
+void latency_histogram_record(latency_histogram_t *histogram, uint32_t latency_us);
+// now - before, bucket by bucket
+void latency_histogram_delta(const latency_histogram_t *now, const latency_histogram_t *before,
+                             latency_histogram_t *delta);
+// Upper bound of the bucket holding the given percentile; 0 when empty
+uint32_t latency_histogram_percentile(const latency_histogram_t *histogram, uint8_t percentile);
+// Samples in buckets wholly at or below bound_us; exact when bound_us is
+// one less than a power of two
+uint32_t latency_histogram_count_le(const latency_histogram_t *histogram, uint32_t bound_us);
+
+// Record, version 2, 28 bytes little endian:
+//   0 version       1 conn state    2 sequence(2)   4 uptime ms(4)
+//   8 to phone kbit/s(2)            10 to car kbit/s(2)
+//  12 to phone latency p50/p90/p99 us(2 each)
+//  18 to car latency p50/p90/p99 us(2 each)
+//  24 RSSI(int8)    25 adv mode     26 records dropped(2)
+// Version 1 was 32 bytes with audio buffer state at 24-27.
+#define TELEMETRY_RECORD_VERSION    2
+#define TELEMETRY_RECORD_SIZE       28
+
+typedef struct {
+    uint8_t conn_state;
+    uint16_t sequence;
+    uint32_t uptime_ms;
+    uint16_t to_phone_kbps;
+    uint16_t to_car_kbps;
+    uint16_t to_phone_us[3];        // p50, p90, p99, saturated at 65535
+    uint16_t to_car_us[3];
+    int8_t rssi;
+    uint8_t adv_mode;
+    uint16_t dropped;
+} telemetry_record_t;
+
+void telemetry_record_pack(const telemetry_record_t *record, uint8_t out[TELEMETRY_RECORD_SIZE]);
+status_t telemetry_record_unpack(const uint8_t *data, size_t size, telemetry_record_t *record);
+
+// Record queue and batching
+#define TELEMETRY_QUEUE_RECORDS     32
+#define TELEMETRY_PERIOD_MIN_MS     100
+#define TELEMETRY_PERIOD_MAX_MS     60000
+#define TELEMETRY_DEFAULT_PERIOD_MS 1000
+#define TELEMETRY_DEFAULT_FLUSH_MS  5000
+
+// Written to the control characteristic: period(2), optional flush(2),
+// little endian. A period of 0 stops sampling.
+typedef struct {
+    uint16_t period_ms;             // Sampling period
+    uint16_t flush_ms;              // Longest a record waits for a fuller notification
+} telemetry_config_t;
+
+typedef struct {
+    uint8_t records[TELEMETRY_QUEUE_RECORDS][TELEMETRY_RECORD_SIZE];
+    uint16_t head;
+    uint16_t count;
+    int64_t oldest_us;              // Queue time of records[head]
+    uint32_t dropped;               // Overwritten before they were sent
+    telemetry_config_t config;
+} telemetry_queue_t;
+
+void telemetry_queue_init(telemetry_queue_t *queue);
+status_t telemetry_config_parse(const uint8_t *data, size_t size, telemetry_config_t *config);
+// Oldest record is overwritten when full
+void telemetry_queue_push(telemetry_queue_t *queue, const telemetry_record_t *record, int64_t now_us);
+// A notification is due once a full payload is queued or the oldest record has waited flush_ms
+bool telemetry_queue_due(const telemetry_queue_t *queue, size_t payload_size, int64_t now_us);
+// Copies as many whole records as fit payload_size; returns the bytes written.
+// Nothing leaves the queue until telemetry_queue_commit().
+size_t telemetry_queue_peek(const telemetry_queue_t *queue, uint8_t *out, size_t payload_size);
+void telemetry_queue_commit(telemetry_queue_t *queue, size_t size, int64_t now_us);
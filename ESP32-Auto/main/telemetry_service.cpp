@@ -0,0 +1,364 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_gatts_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "telemetry_service.h"
+#include "connection_manager.h"
+#include "bluetooth_manager.h"
+#include "proxy_handler.h"
+#include "wifi_hotspot.h"
+#include "task_plan.h"
+#include "mem_plan.h"
+
+static const char *TAG = "TELEMETRY";
+
+#define TELEMETRY_IDLE_POLL_MS      1000    // Config check while sampling is off
+
+// 128-bit UUIDs, little endian; same base as the bootstrap service
+static const uint8_t g_service_uuid[16] = {
+    0x9b, 0x4c, 0x1e, 0x6a, 0x52, 0x38, 0x41, 0x9d, 0xa3, 0x6f, 0x0c, 0x7e, 0x00, 0x02, 0xaa, 0xe5
+};
+static const uint8_t g_data_uuid[16] = {
+    0x9b, 0x4c, 0x1e, 0x6a, 0x52, 0x38, 0x41, 0x9d, 0xa3, 0x6f, 0x0c, 0x7e, 0x01, 0x02, 0xaa, 0xe5
+};
+static const uint8_t g_control_uuid[16] = {
+    0x9b, 0x4c, 0x1e, 0x6a, 0x52, 0x38, 0x41, 0x9d, 0xa3, 0x6f, 0x0c, 0x7e, 0x02, 0x02, 0xaa, 0xe5
+};
+
+static const uint16_t g_primary_service_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t g_char_decl_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t g_cccd_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint8_t g_data_props = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t g_control_props = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+static uint8_t g_cccd_value[2] = { 0x00, 0x00 };
+
+enum {
+    TELEMETRY_IDX_SERVICE = 0,
+    TELEMETRY_IDX_DATA_DECL,
+    TELEMETRY_IDX_DATA_VALUE,
+    TELEMETRY_IDX_DATA_CCCD,
+    TELEMETRY_IDX_CONTROL_DECL,
+    TELEMETRY_IDX_CONTROL_VALUE,
+    TELEMETRY_IDX_COUNT
+};
+
+static const esp_gatts_attr_db_t g_attr_table[TELEMETRY_IDX_COUNT] = {
+    {   // TELEMETRY_IDX_SERVICE
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_primary_service_uuid, ESP_GATT_PERM_READ,
+          sizeof(g_service_uuid), sizeof(g_service_uuid), (uint8_t*)g_service_uuid }
+    },
+    {   // TELEMETRY_IDX_DATA_DECL
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_char_decl_uuid, ESP_GATT_PERM_READ,
+          sizeof(uint8_t), sizeof(uint8_t), (uint8_t*)&g_data_props }
+    },
+    {   // TELEMETRY_IDX_DATA_VALUE
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_128, (uint8_t*)g_data_uuid, ESP_GATT_PERM_READ,
+          TELEMETRY_RECORD_SIZE, 0, NULL }
+    },
+    {   // TELEMETRY_IDX_DATA_CCCD
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_cccd_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+          sizeof(g_cccd_value), sizeof(g_cccd_value), g_cccd_value }
+    },
+    {   // TELEMETRY_IDX_CONTROL_DECL
+        { ESP_GATT_AUTO_RSP },
+        { ESP_UUID_LEN_16, (uint8_t*)&g_char_decl_uuid, ESP_GATT_PERM_READ,
+          sizeof(uint8_t), sizeof(uint8_t), (uint8_t*)&g_control_props }
+    },
+    // Answered by hand so a bad config is rejected instead of stored
+    {   // TELEMETRY_IDX_CONTROL_VALUE
+        { ESP_GATT_RSP_BY_APP },
+        { ESP_UUID_LEN_128, (uint8_t*)g_control_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+          sizeof(telemetry_config_t), 0, NULL }
+    },
+};
+
+// Record history waiting for a subscriber; drained at most once per flush
+MEM_PLAN_PSRAM static telemetry_queue_t g_queue;
+static StaticSemaphore_t g_queue_mutex_buffer;
+static SemaphoreHandle_t g_queue_mutex = NULL;
+static bool g_regions_added = false;
+static TaskHandle_t g_task_handle = NULL;
+static uint16_t g_handles[TELEMETRY_IDX_COUNT];
+static esp_gatt_if_t g_gatts_if = ESP_GATT_IF_NONE;
+static uint16_t g_conn_id = 0;
+static uint16_t g_mtu = 23;
+static volatile bool g_subscribed = false;
+static volatile bool g_congested = false;
+
+// Sampler state; static to keep the histograms off the task stack
+static latency_histogram_t g_to_phone_now, g_to_phone_prev, g_to_car_now, g_to_car_prev, g_window;
+static uint32_t g_prev_to_phone_bytes = 0;
+static uint32_t g_prev_to_car_bytes = 0;
+static int64_t g_prev_sample_us = 0;
+static uint16_t g_sequence = 0;
+
+static uint16_t saturate_u16(uint32_t value) {
+    return (value > 0xFFFF) ? 0xFFFF : (uint16_t)value;
+}
+
+static void telemetry_percentiles(const latency_histogram_t *now, const latency_histogram_t *prev, uint16_t out[3]) {
+    static const uint8_t percentiles[3] = { 50, 90, 99 };
+
+    latency_histogram_delta(now, prev, &g_window);
+    for (int i = 0; i < 3; i++) {
+        out[i] = saturate_u16(latency_histogram_percentile(&g_window, percentiles[i]));
+    }
+}
+
+// kbit/s from a byte counter that restarts with each proxy connection
+static uint16_t telemetry_rate_kbps(uint32_t now, uint32_t prev, int64_t elapsed_us) {
+    uint32_t bytes = (now >= prev) ? now - prev : now;
+    return (elapsed_us > 0) ? saturate_u16((uint32_t)((uint64_t)bytes * 8000 / elapsed_us)) : 0;
+}
+
+static void telemetry_sample(telemetry_record_t *record) {
+    int64_t now = esp_timer_get_time();
+    memset(record, 0, sizeof(*record));
+
+    record->conn_state = (uint8_t)connection_manager_get_state();
+    record->sequence = g_sequence++;
+    record->uptime_ms = (uint32_t)(now / 1000);
+
+    uint32_t to_phone, to_car;
+    proxy_get_byte_counts(&to_phone, &to_car);
+    record->to_phone_kbps = telemetry_rate_kbps(to_phone, g_prev_to_phone_bytes, now - g_prev_sample_us);
+    record->to_car_kbps = telemetry_rate_kbps(to_car, g_prev_to_car_bytes, now - g_prev_sample_us);
+    g_prev_to_phone_bytes = to_phone;
+    g_prev_to_car_bytes = to_car;
+    g_prev_sample_us = now;
+
+    proxy_get_latency(&g_to_phone_now, &g_to_car_now);
+    telemetry_percentiles(&g_to_phone_now, &g_to_phone_prev, record->to_phone_us);
+    telemetry_percentiles(&g_to_car_now, &g_to_car_prev, record->to_car_us);
+    g_to_phone_prev = g_to_phone_now;
+    g_to_car_prev = g_to_car_now;
+
+    wifi_station_stats_t station;
+    size_t stations = 0;
+    if (wifi_hotspot_get_station_stats(&station, 1, &stations) == STATUS_OK && stations > 0) {
+        record->rssi = station.rssi;
+    }
+
+    record->adv_mode = (uint8_t)bluetooth_get_adv_mode();
+    record->dropped = saturate_u16(g_queue.dropped);
+}
+
+// Sends at most one notification; never waits on the stack
+static void telemetry_flush(void) {
+    static uint8_t payload[TELEMETRY_QUEUE_RECORDS * TELEMETRY_RECORD_SIZE];
+
+    if (!g_subscribed || g_congested) {
+        return;
+    }
+
+    size_t payload_size = g_mtu - 3;
+    if (payload_size > sizeof(payload)) {
+        payload_size = sizeof(payload);
+    }
+
+    xSemaphoreTake(g_queue_mutex, portMAX_DELAY);
+    size_t size = 0;
+    if (telemetry_queue_due(&g_queue, payload_size, esp_timer_get_time())) {
+        size = telemetry_queue_peek(&g_queue, payload, payload_size);
+    }
+    xSemaphoreGive(g_queue_mutex);
+
+    if (size == 0) {
+        return;
+    }
+
+    esp_err_t ret = esp_ble_gatts_send_indicate(g_gatts_if, g_conn_id, g_handles[TELEMETRY_IDX_DATA_VALUE],
+                                                (uint16_t)size, payload, false);
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Notify failed: %s", esp_err_to_name(ret));
+        return;  // Records stay queued for the next attempt
+    }
+
+    xSemaphoreTake(g_queue_mutex, portMAX_DELAY);
+    telemetry_queue_commit(&g_queue, size, esp_timer_get_time());
+    xSemaphoreGive(g_queue_mutex);
+}
+
+static void telemetry_task(void *pvParameters) {
+    ESP_LOGI(TAG, "Telemetry task started");
+    g_prev_sample_us = esp_timer_get_time();
+
+    while (1) {
+        uint16_t period_ms = g_queue.config.period_ms;
+        vTaskDelay(pdMS_TO_TICKS(period_ms != 0 ? period_ms : TELEMETRY_IDLE_POLL_MS));
+        if (period_ms == 0) {
+            continue;
+        }
+
+        telemetry_record_t record;
+        telemetry_sample(&record);
+
+        xSemaphoreTake(g_queue_mutex, portMAX_DELAY);
+        telemetry_queue_push(&g_queue, &record, esp_timer_get_time());
+        xSemaphoreGive(g_queue_mutex);
+
+        telemetry_flush();
+    }
+}
+
+static void telemetry_handle_control_write(esp_ble_gatts_cb_param_t *param) {
+    telemetry_config_t config;
+
+    xSemaphoreTake(g_queue_mutex, portMAX_DELAY);
+    config = g_queue.config;
+    status_t ret = telemetry_config_parse(param->write.value, param->write.len, &config);
+    if (ret == STATUS_OK) {
+        g_queue.config = config;
+    }
+    xSemaphoreGive(g_queue_mutex);
+
+    if (ret == STATUS_OK) {
+        ESP_LOGI(TAG, "Sampling every %d ms, flushing within %d ms", config.period_ms, config.flush_ms);
+    } else {
+        ESP_LOGW(TAG, "Rejected telemetry config (%d bytes)", param->write.len);
+    }
+
+    if (param->write.need_rsp) {
+        esp_ble_gatts_send_response(g_gatts_if, param->write.conn_id, param->write.trans_id,
+                                    ret == STATUS_OK ? ESP_GATT_OK : ESP_GATT_OUT_OF_RANGE, NULL);
+    }
+}
+
+static void telemetry_handle_control_read(esp_ble_gatts_cb_param_t *param) {
+    esp_gatt_rsp_t rsp;
+    telemetry_config_t config;
+
+    telemetry_service_get_config(&config);
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.attr_value.handle = param->read.handle;
+    rsp.attr_value.len = 4;
+    rsp.attr_value.value[0] = (uint8_t)config.period_ms;
+    rsp.attr_value.value[1] = (uint8_t)(config.period_ms >> 8);
+    rsp.attr_value.value[2] = (uint8_t)config.flush_ms;
+    rsp.attr_value.value[3] = (uint8_t)(config.flush_ms >> 8);
+    esp_ble_gatts_send_response(g_gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
+}
+
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                                esp_ble_gatts_cb_param_t *param) {
+    // Events for the other GATT apps arrive here too
+    if (event != ESP_GATTS_REG_EVT && gatts_if != g_gatts_if) {
+        return;
+    }
+
+    switch (event) {
+        case ESP_GATTS_REG_EVT:
+            if (param->reg.app_id != TELEMETRY_SERVICE_APP_ID) {
+                break;
+            }
+            if (param->reg.status != ESP_GATT_OK) {
+                ESP_LOGE(TAG, "GATT app registration failed: %d", param->reg.status);
+                break;
+            }
+            g_gatts_if = gatts_if;
+            esp_ble_gatts_create_attr_tab(g_attr_table, gatts_if, TELEMETRY_IDX_COUNT, 0);
+            break;
+
+        case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+            if (param->add_attr_tab.status != ESP_GATT_OK || param->add_attr_tab.num_handle != TELEMETRY_IDX_COUNT) {
+                ESP_LOGE(TAG, "Failed to create attribute table: %d", param->add_attr_tab.status);
+                break;
+            }
+            memcpy(g_handles, param->add_attr_tab.handles, sizeof(g_handles));
+            esp_ble_gatts_start_service(g_handles[TELEMETRY_IDX_SERVICE]);
+            ESP_LOGI(TAG, "Telemetry service started");
+            break;
+
+        case ESP_GATTS_CONNECT_EVT:
+            g_conn_id = param->connect.conn_id;
+            g_mtu = 23;
+            g_congested = false;
+            break;
+
+        case ESP_GATTS_MTU_EVT:
+            g_mtu = param->mtu.mtu;
+            break;
+
+        case ESP_GATTS_CONGEST_EVT:
+            g_congested = param->congest.congested;
+            break;
+
+        case ESP_GATTS_READ_EVT:
+            if (param->read.handle == g_handles[TELEMETRY_IDX_CONTROL_VALUE]) {
+                telemetry_handle_control_read(param);
+            }
+            break;
+
+        case ESP_GATTS_WRITE_EVT:
+            if (param->write.is_prep) {
+                break;
+            }
+            if (param->write.handle == g_handles[TELEMETRY_IDX_DATA_CCCD] && param->write.len == 2) {
+                g_subscribed = (param->write.value[0] & 0x01) != 0;
+                ESP_LOGI(TAG, "Telemetry notifications %s", g_subscribed ? "enabled" : "disabled");
+            } else if (param->write.handle == g_handles[TELEMETRY_IDX_CONTROL_VALUE]) {
+                telemetry_handle_control_write(param);
+            }
+            break;
+
+        case ESP_GATTS_DISCONNECT_EVT:
+            g_subscribed = false;
+            g_congested = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+status_t telemetry_service_init(void) {
+    telemetry_queue_init(&g_queue);
+
+    g_queue_mutex = xSemaphoreCreateMutexStatic(&g_queue_mutex_buffer);
+    if (g_queue_mutex == NULL) {
+        return STATUS_ERROR_MEMORY;
+    }
+
+    if (!g_regions_added) {
+        mem_plan_add_object("telemetry_queue", MEM_KIND_PSRAM, &g_queue, sizeof(g_queue), NULL);
+        g_regions_added = true;
+    }
+
+    if (bluetooth_register_gatts_handler(gatts_event_handler) != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to register GATTS handler");
+        return STATUS_ERROR_INIT;
+    }
+
+    esp_err_t ret = esp_ble_gatts_app_register(TELEMETRY_SERVICE_APP_ID);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GATT app: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_INIT;
+    }
+
+    if (task_plan_create(TASK_ID_TELEMETRY, telemetry_task, NULL, &g_task_handle) != STATUS_OK) {
+        ESP_LOGE(TAG, "Failed to create telemetry task");
+        return STATUS_ERROR_MEMORY;
+    }
+
+    return STATUS_OK;
+}
+
+bool telemetry_service_is_subscribed(void) {
+    return g_subscribed;
+}
+
+void telemetry_service_get_config(telemetry_config_t *config) {
+    if (config == NULL || g_queue_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(g_queue_mutex, portMAX_DELAY);
+    *config = g_queue.config;
+    xSemaphoreGive(g_queue_mutex);
+}
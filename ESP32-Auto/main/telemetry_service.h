@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+#include "telemetry.h"
+
+// BLE GATT telemetry service
+// A low-priority task samples proxy throughput, latency and link state
+// into telemetry records. Subscribed phones get them as notifications
+// packed to the negotiated MTU; the control characteristic reads and
+// writes the telemetry_config_t.
+
+#define TELEMETRY_SERVICE_APP_ID    0x42
+
+// Telemetry service functions
+status_t telemetry_service_init(void);
+bool telemetry_service_is_subscribed(void);
+void telemetry_service_get_config(telemetry_config_t *config);
@@ -0,0 +1,48 @@
+#include "esp_log.h"
+#include "trace.h"
+#include "mem_plan.h"
+
+#if TRACE_ENABLED
+
+static const char *TAG = "TRACE";
+
+// Written on every packet, so internal RAM
+trace_ring_t g_trace_rings[portNUM_PROCESSORS];
+
+static size_t trace_high_water(void) {
+    size_t used = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t head = __atomic_load_n(&g_trace_rings[core].head, __ATOMIC_RELAXED);
+        used += (head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE) * sizeof(trace_record_t);
+    }
+    return used;
+}
+
+void trace_init(void) {
+    mem_plan_add_object("trace_rings", MEM_KIND_INTERNAL, g_trace_rings, sizeof(g_trace_rings),
+                        trace_high_water);
+}
+
+void trace_dump(void) {
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const trace_ring_t *ring = &g_trace_rings[core];
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint32_t count = (head < TRACE_RING_SIZE) ? head : TRACE_RING_SIZE;
+
+        // Writers keep going; a slot rewritten mid-dump prints as one newer record
+        ESP_LOGI(TAG, "begin core %d records %lu mhz %d", core, (unsigned long)count,
+                 CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+        for (uint32_t i = head - count; i != head; i++) {
+            trace_record_t record = ring->records[i & (TRACE_RING_SIZE - 1)];
+            if (record.id == 0) {
+                continue;               // Reserved but not yet written
+            }
+            ESP_LOGI(TAG, "r %d %08lx %08lx %08lx %08lx", core, (unsigned long)record.id,
+                     (unsigned long)record.cycles, (unsigned long)record.args[0],
+                     (unsigned long)record.args[1]);
+        }
+    }
+    ESP_LOGI(TAG, "end");
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <type_traits>
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+
+// Tokenised binary trace for the data path
+// TRACE("fmt", a, b) stores a 32-bit hash of the format string, the CPU
+// cycle counter and up to two integer arguments as one 16-byte record in
+// the ring of the core it runs on. The hash is computed by the compiler
+// and the format string never reaches the binary; tools/trace_decode.py
+// rebuilds the hash table from the sources and decodes a trace_dump().
+//
+// A record costs a cycle-counter read, an atomic increment and four
+// stores, and is safe from tasks and IRAM interrupts alike. Release
+// builds (NDEBUG, i.e. assertions disabled) compile TRACE() out without
+// evaluating its arguments; TRACE_ENABLED overrides either way.
+
+#ifndef TRACE_ENABLED
+#ifdef NDEBUG
+#define TRACE_ENABLED 0
+#else
+#define TRACE_ENABLED 1
+#endif
+#endif
+
+#define TRACE_RING_SIZE     256             // Records per core, power of two
+
+typedef struct {
+    uint32_t id;                            // Format hash; written last
+    uint32_t cycles;                        // CCOUNT of the writing core
+    uint32_t args[2];
+} trace_record_t;
+
+typedef struct {
+    uint32_t head;                          // Records ever reserved
+    trace_record_t records[TRACE_RING_SIZE];
+} trace_ring_t;
+
+// 32-bit FNV-1a; tools/trace_decode.py must hash identically
+constexpr uint32_t trace_hash(const char *text) {
+    uint32_t hash = 2166136261u;
+    while (*text != '\0') {
+        hash = (hash ^ (uint8_t)*text++) * 16777619u;
+    }
+    return hash;
+}
+
+// Forces the hash to a compile-time constant
+#define TRACE_ID(fmt) (std::integral_constant<uint32_t, trace_hash(fmt)>::value)
+
+#if TRACE_ENABLED
+
+extern trace_ring_t g_trace_rings[portNUM_PROCESSORS];
+
+static inline __attribute__((always_inline)) void trace_write(uint32_t id, uint32_t a = 0, uint32_t b = 0) {
+    // A writer preempted between reserving and filling its slot only
+    // delays that record; another core's writer reserves a different one
+    trace_ring_t *ring = &g_trace_rings[esp_cpu_get_core_id()];
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED) & (TRACE_RING_SIZE - 1);
+    trace_record_t *record = &ring->records[slot];
+
+    record->cycles = esp_cpu_get_cycle_count();
+    record->args[0] = a;
+    record->args[1] = b;
+    __atomic_store_n(&record->id, id, __ATOMIC_RELEASE);
+}
+
+#define TRACE(fmt, ...) trace_write(TRACE_ID(fmt), ##__VA_ARGS__)
+
+// Registers the rings with the memory plan
+void trace_init(void);
+// Prints both rings, oldest first, for tools/trace_decode.py
+void trace_dump(void);
+
+#else
+
+#define TRACE(fmt, ...) do { } while (0)
+
+static inline void trace_init(void) {
+}
+
+static inline void trace_dump(void) {
+}
+
+#endif
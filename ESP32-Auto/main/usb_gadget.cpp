@@ -7,6 +7,9 @@
 #include "usb_gadget.h"
 #include "esp32_usb_otg.h"
 #include "common.h"
+#include "device_identity.h"
+#include "hot_path.h"
+#include "trace.h"
 
 static const char *TAG = "USB_GADGET";
 
@@ -102,7 +105,7 @@ static const usb_endpoint_descriptor_t g_ep1_out_desc = {
 static const usb_endpoint_descriptor_t g_ep2_in_desc = {
     .bLength = sizeof(usb_endpoint_descriptor_t),
     .bDescriptorType = USB_DESC_TYPE_ENDPOINT,
-    .bEndpointAddress = 0x82,
+    .bEndpointAddress = USB_EP2_IN_ADDR,
     .bmAttributes = 0x02,                 // Bulk
     .wMaxPacketSize = USB_BULK_EP_SIZE,
     .bInterval = 0
@@ -111,16 +114,23 @@ static const usb_endpoint_descriptor_t g_ep2_in_desc = {
 static const usb_endpoint_descriptor_t g_ep2_out_desc = {
     .bLength = sizeof(usb_endpoint_descriptor_t),
     .bDescriptorType = USB_DESC_TYPE_ENDPOINT,
-    .bEndpointAddress = 0x02,
+    .bEndpointAddress = USB_EP2_OUT_ADDR,
     .bmAttributes = 0x02,                 // Bulk
     .wMaxPacketSize = USB_BULK_EP_SIZE,
     .bInterval = 0
 };
 
-// String descriptors
-static const char *g_string_manufacturer = "DIY Wireless Dongle";
-static const char *g_string_product = "ESP32 AA Dongle";
-static const char *g_string_serial = "ESP32AA001";
+// String descriptors, served from the shared device identity
+#define USB_STRING_LANGID_EN_US    0x0409
+
+static const device_identity_t *g_identity = NULL;
+
+// Descriptor string index -> identity field (0 is the language table)
+static const device_identity_field_t g_string_fields[] = {
+    DEVICE_IDENTITY_MANUFACTURER,   // iManufacturer = 1
+    DEVICE_IDENTITY_MODEL,          // iProduct = 2
+    DEVICE_IDENTITY_SERIAL          // iSerialNumber = 3
+};
 
 esp_err_t usb_otg_init_peripheral(void) {
     ESP_LOGI(TAG, "Initializing ESP32-S3 USB OTG peripheral mode");
@@ -218,12 +228,12 @@ esp_err_t usb_otg_configure_endpoints(void) {
     return ESP_OK;
 }
 
-esp_err_t usb_otg_ep_write(uint8_t ep_num, uint8_t *data, size_t length) {
+HOT_PATH esp_err_t usb_otg_ep_write(uint8_t ep_num, uint8_t *data, size_t length) {
     if (data == NULL || length == 0) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGD(TAG, "Writing %d bytes to EP %d", length, ep_num);
+    TRACE("Writing %u bytes to EP %u", length, ep_num);
     
     uint16_t transferred = 0;
     esp_err_t ret = esp32_usb_otg_write_endpoint(ep_num, data, length, &transferred);
@@ -239,13 +249,11 @@ esp_err_t usb_otg_ep_write(uint8_t ep_num, uint8_t *data, size_t length) {
     return ESP_OK;
 }
 
-esp_err_t usb_otg_ep_read(uint8_t ep_num, uint8_t *data, size_t length, size_t *received) {
+HOT_PATH esp_err_t usb_otg_ep_read(uint8_t ep_num, uint8_t *data, size_t length, size_t *received) {
     if (data == NULL || received == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGD(TAG, "Reading from EP %d", ep_num);
-    
     uint16_t bytes_read = 0;
     esp_err_t ret = esp32_usb_otg_read_endpoint(ep_num, data, length, &bytes_read);
     if (ret != ESP_OK) {
@@ -254,7 +262,10 @@ esp_err_t usb_otg_ep_read(uint8_t ep_num, uint8_t *data, size_t length, size_t *
     }
     
     *received = bytes_read;
-    ESP_LOGD(TAG, "Read %d bytes from EP %d", bytes_read, ep_num);
+    // Polled every millisecond; empty reads would flush the trace ring
+    if (bytes_read > 0) {
+        TRACE("Read %u bytes from EP %u", bytes_read, ep_num);
+    }
     
     return ESP_OK;
 }
@@ -316,6 +327,49 @@ esp_err_t usb_set_device_descriptor(uint16_t vid, uint16_t pid) {
     return ESP_OK;
 }
 
+void usb_set_device_identity(const device_identity_t *identity) {
+    g_identity = identity;
+}
+
+esp_err_t usb_build_string_descriptor(uint8_t index, uint8_t *buffer, size_t capacity, size_t *size) {
+    if (buffer == NULL || size == NULL || capacity < 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t length = 2;
+    if (index == 0) {
+        if (capacity < 4) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        buffer[2] = USB_STRING_LANGID_EN_US & 0xFF;
+        buffer[3] = USB_STRING_LANGID_EN_US >> 8;
+        length = 4;
+    } else if (index <= sizeof(g_string_fields) / sizeof(g_string_fields[0]) && g_identity != NULL) {
+        device_identity_field_t field = g_string_fields[index - 1];
+        const char *str = device_identity_get(g_identity, field);
+        size_t chars = device_identity_length(g_identity, field);
+
+        // ASCII to UTF-16LE, limited to the 255-byte descriptor size
+        if (chars > 126) {
+            chars = 126;
+        }
+        length = 2 + chars * 2;
+
+        // The host may ask for a prefix; bLength still reports the full size
+        for (size_t i = 0; i < chars && 2 + i * 2 + 1 < capacity; i++) {
+            buffer[2 + i * 2] = (uint8_t)str[i];
+            buffer[2 + i * 2 + 1] = 0;
+        }
+    } else {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    buffer[0] = (uint8_t)length;
+    buffer[1] = USB_DESC_TYPE_STRING;
+    *size = (length < capacity) ? length : capacity;
+    return ESP_OK;
+}
+
 esp_err_t usb_get_connected_device_info(usb_device_info_t *info) {
     if (info == NULL) {
         return ESP_ERR_INVALID_ARG;
@@ -327,7 +381,7 @@ esp_err_t usb_get_connected_device_info(usb_device_info_t *info) {
     return ESP_OK;
 }
 
-esp_err_t usb_bulk_transfer(uint8_t endpoint, uint8_t *data, size_t length, size_t *transferred) {
+HOT_PATH esp_err_t usb_bulk_transfer(uint8_t endpoint, uint8_t *data, size_t length, size_t *transferred) {
     if (data == NULL || transferred == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
@@ -359,7 +413,15 @@ esp_err_t usb_control_transfer(uint8_t bmRequestType, uint8_t bRequest, uint16_t
         switch (bRequest) {
             case USB_REQ_GET_DESCRIPTOR:
                 ESP_LOGI(TAG, "GET_DESCRIPTOR request");
-                // TODO: Handle descriptor requests
+                if ((wValue >> 8) == USB_DESC_TYPE_STRING && data != NULL) {
+                    size_t size;
+                    esp_err_t ret = usb_build_string_descriptor(wValue & 0xFF, data, length, &size);
+                    if (ret == ESP_OK && transferred != NULL) {
+                        *transferred = size;
+                    }
+                    return ret;
+                }
+                // TODO: Handle other descriptor requests
                 break;
                 
             case USB_REQ_SET_ADDRESS:
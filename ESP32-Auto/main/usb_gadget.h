@@ -2,7 +2,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
+#include "device_identity.h"
 
 // USB Device configuration
 #define USB_VID_GOOGLE           0x18D1
@@ -18,6 +20,8 @@
 #define USB_EP0_ADDR                     0x00
 #define USB_EP1_IN_ADDR                 0x81
 #define USB_EP1_OUT_ADDR                0x01
+#define USB_EP2_IN_ADDR                 0x82
+#define USB_EP2_OUT_ADDR                0x02
 
 // USB Request Types
 #define USB_REQ_TYPE_STANDARD          (0x00 << 5)
@@ -109,6 +113,8 @@ esp_err_t usb_gadget_init(void);
 esp_err_t usb_gadget_deinit(void);
 esp_err_t usb_set_device_descriptor(uint16_t vid, uint16_t pid);
 esp_err_t usb_get_connected_device_info(usb_device_info_t *info);
+void usb_set_device_identity(const device_identity_t *identity);
+esp_err_t usb_build_string_descriptor(uint8_t index, uint8_t *buffer, size_t capacity, size_t *size);
 esp_err_t usb_bulk_transfer(uint8_t endpoint, uint8_t *data, size_t length, size_t *transferred);
 esp_err_t usb_control_transfer(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, 
                             uint16_t wIndex, uint8_t *data, size_t length, size_t *transferred);
@@ -1,12 +1,112 @@
+#include <string.h>
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_netif.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "common.h"
+#include "wifi_hotspot.h"
+#include "task_plan.h"
+#include "mem_plan.h"
+#include "channel_scorer.h"
 
 static const char *TAG = "ESP32_WIFI_HOTSPOT";
 static esp_netif_t *g_ap_netif = NULL;
 static bool g_is_hotspot_active = false;
+static uint8_t g_channel = WIFI_HOTSPOT_DEFAULT_CHANNEL;
+static bool g_auto_channel = true;
+static uint8_t g_station_mac[6];
+static bool g_has_station = false;
+static volatile uint8_t g_station_count = 0;
+static TaskHandle_t g_monitor_task = NULL;
+
+// Channel selection
+#define CHANNEL_SCAN_MAX_APS        32
+#define CHANNEL_SCAN_DWELL_MS       80      // Active scan time per channel
+#define CHANNEL_RECHECK_MS          (5 * 60 * 1000)
+#define CHANNEL_HYSTERESIS_PCT      25
+#define LINK_STATS_INTERVAL_MS      30000
+
+// Static so a scan does not need a large stack; used every few minutes,
+// so PSRAM rather than internal RAM
+MEM_PLAN_PSRAM static wifi_ap_record_t g_scan_aps[CHANNEL_SCAN_MAX_APS];
+MEM_PLAN_PSRAM static channel_scan_record_t g_scan_records[CHANNEL_SCAN_MAX_APS];
+static bool g_regions_added = false;
+
+// AP profiles, indexed by wifi_profile_t
+static const wifi_profile_params_t g_profiles[WIFI_PROFILE_COUNT] = {
+    {
+        .name = "max-throughput",
+        .bandwidth = WIFI_BW_HT40,
+        .protocols = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N,
+        .power_save = WIFI_PS_NONE,
+        .max_tx_power = 80,             // 20 dBm
+        .inactive_time_s = 300,
+        .static_rx_buf_num = 16,
+        .dynamic_rx_buf_num = 64,
+        .dynamic_tx_buf_num = 64,
+        .rx_ba_win = 32,
+        .ampdu_rx = true,
+        .ampdu_tx = true,
+        .tcp_nodelay = false,
+    },
+    {
+        // Fewer frames per aggregate and no TX aggregation: frames leave as
+        // soon as they are queued. A silent phone is noticed within a minute.
+        .name = "low-latency",
+        .bandwidth = WIFI_BW_HT20,
+        .protocols = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N,
+        .power_save = WIFI_PS_NONE,
+        .max_tx_power = 80,
+        .inactive_time_s = 60,
+        .static_rx_buf_num = 10,
+        .dynamic_rx_buf_num = 32,
+        .dynamic_tx_buf_num = 32,
+        .rx_ba_win = 6,
+        .ampdu_rx = true,
+        .ampdu_tx = false,
+        .tcp_nodelay = true,
+    },
+    {
+        .name = "power-saver",
+        .bandwidth = WIFI_BW_HT20,
+        .protocols = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N,
+        .power_save = WIFI_PS_MAX_MODEM,
+        .max_tx_power = 60,             // 15 dBm
+        .inactive_time_s = 300,
+        .static_rx_buf_num = 6,
+        .dynamic_rx_buf_num = 16,
+        .dynamic_tx_buf_num = 16,
+        .rx_ba_win = 6,
+        .ampdu_rx = true,
+        .ampdu_tx = true,
+        .tcp_nodelay = false,
+    },
+};
+
+static wifi_profile_t g_profile = WIFI_PROFILE_MAX_THROUGHPUT;
+
+// 802.11n MCS 0-7 (one stream, long GI) and 802.11g rates, with typical
+// minimum RSSI for each; HT40 needs about 3 dB more
+typedef struct {
+    int8_t min_rssi;
+    uint16_t rate_100kbps;
+} phy_rate_step_t;
+
+static const phy_rate_step_t g_ht20_rates[] = {
+    { -64, 650 }, { -65, 585 }, { -66, 520 }, { -70, 390 },
+    { -74, 260 }, { -77, 195 }, { -79, 130 }, { -82, 65 },
+};
+
+static const phy_rate_step_t g_11g_rates[] = {
+    { -65, 540 }, { -66, 480 }, { -70, 360 }, { -74, 240 },
+    { -77, 180 }, { -79, 120 }, { -81, 90 }, { -82, 60 },
+};
+
+#define PHY_RATE_STEPS (sizeof(g_ht20_rates) / sizeof(g_ht20_rates[0]))
+#define HT40_RSSI_PENALTY 3
 
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data) {
@@ -14,18 +114,158 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
         ESP_LOGI(TAG, "Station "MACSTR" joined, AID=%d",
                  MAC2STR(event->mac), event->aid);
+        memcpy(g_station_mac, event->mac, sizeof(g_station_mac));
+        g_has_station = true;
+        g_station_count++;
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
         wifi_event_ap_stadisconnected_t* event = (wifi_event_ap_stadisconnected_t*) event_data;
         ESP_LOGI(TAG, "Station "MACSTR" left, AID=%d",
                  MAC2STR(event->mac), event->aid);
+        if (g_station_count > 0) {
+            g_station_count--;
+        }
     }
 }
 
+// Scans every channel and scores the result. The STA interface must be
+// enabled (STA or APSTA mode) and WiFi started.
+static status_t wifi_hotspot_scan(channel_scores_t *scores) {
+    wifi_scan_config_t scan_config;
+    memset(&scan_config, 0, sizeof(scan_config));
+    scan_config.show_hidden = true;
+    scan_config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan_config.scan_time.active.max = CHANNEL_SCAN_DWELL_MS;
+    
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = esp_wifi_scan_start(&scan_config, true);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Channel scan failed: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_CONNECTION;
+    }
+    
+    uint16_t count = CHANNEL_SCAN_MAX_APS;
+    ret = esp_wifi_scan_get_ap_records(&count, g_scan_aps);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to read scan results: %s", esp_err_to_name(ret));
+        return STATUS_ERROR_CONNECTION;
+    }
+    
+    for (uint16_t i = 0; i < count; i++) {
+        g_scan_records[i].channel = g_scan_aps[i].primary;
+        g_scan_records[i].rssi = g_scan_aps[i].rssi;
+    }
+    channel_scorer_score(g_scan_records, count, scores);
+    
+    ESP_LOGI(TAG, "Scanned %d APs in %lld ms", count, (esp_timer_get_time() - start) / 1000);
+    return STATUS_OK;
+}
+
+// Picks the starting channel before the AP exists, in STA mode
+static void wifi_hotspot_select_channel(void) {
+    channel_scores_t scores;
+    
+    if (esp_wifi_set_mode(WIFI_MODE_STA) != ESP_OK || esp_wifi_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Cannot scan, staying on channel %d", g_channel);
+        return;
+    }
+    
+    status_t status = wifi_hotspot_scan(&scores);
+    esp_wifi_stop();
+    
+    if (status == STATUS_OK) {
+        g_channel = channel_scorer_pick(&scores, 0, 0);
+        ESP_LOGI(TAG, "Least congested channel: %d (%d APs on it)", g_channel, scores.ap_count[g_channel]);
+    }
+}
+
+// Moving the AP would drop a phone, so this only runs while nobody is joined
+status_t wifi_hotspot_reevaluate_channel(void) {
+    if (!g_is_hotspot_active || g_station_count > 0) {
+        return STATUS_OK;
+    }
+    
+    channel_scores_t scores;
+    esp_err_t ret = esp_wifi_set_mode(WIFI_MODE_APSTA);
+    if (ret != ESP_OK) {
+        return STATUS_ERROR_CONNECTION;
+    }
+    status_t status = wifi_hotspot_scan(&scores);
+    esp_wifi_set_mode(WIFI_MODE_AP);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    
+    uint8_t best = channel_scorer_pick(&scores, g_channel, CHANNEL_HYSTERESIS_PCT);
+    if (best == g_channel || g_station_count > 0) {
+        return STATUS_OK;
+    }
+    
+    wifi_config_t ap_config;
+    ret = esp_wifi_get_config(WIFI_IF_AP, &ap_config);
+    if (ret == ESP_OK) {
+        ap_config.ap.channel = best;
+        ret = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to move to channel %d: %s", best, esp_err_to_name(ret));
+        return STATUS_ERROR_CONNECTION;
+    }
+    
+    ESP_LOGI(TAG, "Moved hotspot from channel %d to %d", g_channel, best);
+    g_channel = best;
+    return STATUS_OK;
+}
+
+// Reports link state while a phone is joined; re-checks the channel while idle
+static void monitor_task(void *pvParameters) {
+    int64_t last_scan = esp_timer_get_time();
+    
+    while (g_is_hotspot_active) {
+        vTaskDelay(pdMS_TO_TICKS(LINK_STATS_INTERVAL_MS));
+        if (!g_is_hotspot_active) {
+            break;
+        }
+        
+        if (g_station_count > 0) {
+            wifi_hotspot_log_link_stats();
+        } else if (esp_timer_get_time() - last_scan >= (int64_t)CHANNEL_RECHECK_MS * 1000) {
+            wifi_hotspot_reevaluate_channel();
+            last_scan = esp_timer_get_time();
+        }
+    }
+    
+    g_monitor_task = NULL;
+    task_plan_exit(TASK_ID_WIFI_MONITOR);
+}
+
+// Settings the driver accepts while the AP is running
+static void wifi_hotspot_apply_runtime_profile(void) {
+    const wifi_profile_params_t *profile = &g_profiles[g_profile];
+    
+    esp_wifi_set_ps((wifi_ps_type_t)profile->power_save);
+    if (esp_wifi_set_max_tx_power(profile->max_tx_power) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set TX power");
+    }
+    if (esp_wifi_set_inactive_time(WIFI_IF_AP, profile->inactive_time_s) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set inactivity timeout");
+    }
+    
+    ESP_LOGI(TAG, "Profile %s: %s, TX power %d dBm, inactivity %d s", profile->name,
+             profile->bandwidth == WIFI_BW_HT40 ? "HT40" : "HT20",
+             profile->max_tx_power / 4, profile->inactive_time_s);
+}
+
 status_t wifi_hotspot_init(void) {
     ESP_LOGI(TAG, "Initializing WiFi Hotspot");
     
     esp_err_t ret;
     
+    if (!g_regions_added) {
+        mem_plan_add_object("scan_aps", MEM_KIND_PSRAM, g_scan_aps, sizeof(g_scan_aps), NULL);
+        mem_plan_add_object("scan_records", MEM_KIND_PSRAM, g_scan_records, sizeof(g_scan_records), NULL);
+        g_regions_added = true;
+    }
+    
     // Initialize network interface
     ret = esp_netif_init();
     if (ret != ESP_OK) return STATUS_ERROR_INIT;
@@ -44,8 +284,15 @@ status_t wifi_hotspot_init(void) {
         return STATUS_ERROR_INIT;
     }
     
-    // Initialize WiFi
+    // Initialize WiFi with the profile's buffer budget
+    const wifi_profile_params_t *profile = &g_profiles[g_profile];
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    cfg.static_rx_buf_num = profile->static_rx_buf_num;
+    cfg.dynamic_rx_buf_num = profile->dynamic_rx_buf_num;
+    cfg.dynamic_tx_buf_num = profile->dynamic_tx_buf_num;
+    cfg.rx_ba_win = profile->rx_ba_win;
+    cfg.ampdu_rx_enable = profile->ampdu_rx;
+    cfg.ampdu_tx_enable = profile->ampdu_tx;
     ret = esp_wifi_init(&cfg);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize WiFi: %s", esp_err_to_name(ret));
@@ -70,7 +317,11 @@ status_t wifi_hotspot_start(const char *ssid, const char *password) {
     }
     
     ESP_LOGI(TAG, "Starting WiFi hotspot");
-    ESP_LOGI(TAG, "SSID: %s", ssid ? ssid : "ESP32-AA-Dongle");
+    
+    if (g_auto_channel) {
+        wifi_hotspot_select_channel();
+    }
+    ESP_LOGI(TAG, "SSID: %s, channel %d", ssid ? ssid : "ESP32-AA-Dongle", g_channel);
     
     esp_err_t ret;
     
@@ -81,11 +332,21 @@ status_t wifi_hotspot_start(const char *ssid, const char *password) {
         return STATUS_ERROR_CONNECTION;
     }
     
+    // Protocols and bandwidth must be set before the AP starts
+    const wifi_profile_params_t *profile = &g_profiles[g_profile];
+    ret = esp_wifi_set_protocol(WIFI_IF_AP, profile->protocols);
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_bandwidth(WIFI_IF_AP, (wifi_bandwidth_t)profile->bandwidth);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to apply %s radio settings: %s", profile->name, esp_err_to_name(ret));
+    }
+    
     // Configure AP
     wifi_config_t ap_config = {
         .ap = {
             .ssid_len = 0,
-            .channel = 1,
+            .channel = g_channel,
             .max_connection = 1,
             .authmode = WIFI_AUTH_WPA_WPA2_PSK,
             .pmf_cfg = {
@@ -124,6 +385,14 @@ status_t wifi_hotspot_start(const char *ssid, const char *password) {
     }
     
     g_is_hotspot_active = true;
+    g_station_count = 0;
+    wifi_hotspot_apply_runtime_profile();
+    
+    // Re-check the air while idle; a car moves between very different places
+    if (g_monitor_task == NULL &&
+        task_plan_create(TASK_ID_WIFI_MONITOR, monitor_task, NULL, &g_monitor_task) != STATUS_OK) {
+        ESP_LOGW(TAG, "Failed to create monitor task, channel is fixed");
+    }
     
     // Get and print IP info
     esp_netif_ip_info_t ip_info;
@@ -145,13 +414,15 @@ status_t wifi_hotspot_stop(void) {
     
     ESP_LOGI(TAG, "Stopping WiFi hotspot");
     
+    // Cleared first: an AP stop while still active is a driver failure
+    g_is_hotspot_active = false;
     esp_err_t ret = esp_wifi_stop();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to stop WiFi: %s", esp_err_to_name(ret));
+        g_is_hotspot_active = true;
         return STATUS_ERROR_CONNECTION;
     }
     
-    g_is_hotspot_active = false;
     ESP_LOGI(TAG, "WiFi hotspot stopped");
     
     return STATUS_OK;
@@ -159,4 +430,119 @@ status_t wifi_hotspot_stop(void) {
 
 bool wifi_hotspot_is_active(void) {
     return g_is_hotspot_active;
+}
+
+status_t wifi_hotspot_set_channel(uint8_t channel) {
+    if (channel > CHANNEL_MAX) {
+        return STATUS_ERROR_CONNECTION;
+    }
+    
+    // Takes effect on the next wifi_hotspot_start()
+    g_auto_channel = (channel == WIFI_HOTSPOT_CHANNEL_AUTO);
+    if (!g_auto_channel) {
+        g_channel = channel;
+    }
+    return STATUS_OK;
+}
+
+uint8_t wifi_hotspot_get_channel(void) {
+    return g_channel;
+}
+
+bool wifi_hotspot_get_station_mac(uint8_t mac[6]) {
+    if (!g_has_station) {
+        return false;
+    }
+    memcpy(mac, g_station_mac, sizeof(g_station_mac));
+    return true;
+}
+
+status_t wifi_hotspot_set_profile(wifi_profile_t profile) {
+    if (profile >= WIFI_PROFILE_COUNT) {
+        return STATUS_ERROR_INIT;
+    }
+    
+    g_profile = profile;
+    if (g_is_hotspot_active) {
+        wifi_hotspot_apply_runtime_profile();
+    }
+    return STATUS_OK;
+}
+
+wifi_profile_t wifi_hotspot_get_profile(void) {
+    return g_profile;
+}
+
+const wifi_profile_params_t* wifi_hotspot_get_profile_params(void) {
+    return &g_profiles[g_profile];
+}
+
+status_t wifi_hotspot_profile_from_name(const char *name, wifi_profile_t *profile) {
+    if (name == NULL || profile == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+    
+    for (int i = 0; i < WIFI_PROFILE_COUNT; i++) {
+        if (strcmp(name, g_profiles[i].name) == 0) {
+            *profile = (wifi_profile_t)i;
+            return STATUS_OK;
+        }
+    }
+    return STATUS_ERROR_INIT;
+}
+
+uint32_t wifi_hotspot_estimate_phy_rate(int8_t rssi, bool phy_11n, bool ht40) {
+    const phy_rate_step_t *table = phy_11n ? g_ht20_rates : g_11g_rates;
+    int penalty = (phy_11n && ht40) ? HT40_RSSI_PENALTY : 0;
+    
+    for (size_t i = 0; i < PHY_RATE_STEPS; i++) {
+        if (rssi >= table[i].min_rssi + penalty) {
+            uint32_t kbps = table[i].rate_100kbps * 100u;
+            // HT40 carries 108 data subcarriers against 52
+            return (phy_11n && ht40) ? kbps * 108 / 52 : kbps;
+        }
+    }
+    return 0;  // Below the lowest rate's sensitivity
+}
+
+status_t wifi_hotspot_get_station_stats(wifi_station_stats_t *stats, size_t capacity, size_t *count) {
+    if (stats == NULL || count == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+    *count = 0;
+    
+    wifi_sta_list_t list;
+    esp_err_t ret = esp_wifi_ap_get_sta_list(&list);
+    if (ret != ESP_OK) {
+        return STATUS_ERROR_CONNECTION;
+    }
+    
+    wifi_bandwidth_t bandwidth = WIFI_BW_HT20;
+    esp_wifi_get_bandwidth(WIFI_IF_AP, &bandwidth);
+    
+    for (int i = 0; i < list.num && *count < capacity; i++) {
+        wifi_station_stats_t *station = &stats[*count];
+        memcpy(station->mac, list.sta[i].mac, sizeof(station->mac));
+        station->rssi = list.sta[i].rssi;
+        station->phy_11n = list.sta[i].phy_11n;
+        station->est_phy_rate_kbps = wifi_hotspot_estimate_phy_rate(station->rssi, station->phy_11n,
+                                                                   bandwidth == WIFI_BW_HT40);
+        (*count)++;
+    }
+    return STATUS_OK;
+}
+
+void wifi_hotspot_log_link_stats(void) {
+    wifi_station_stats_t stats[WIFI_HOTSPOT_MAX_STATIONS];
+    size_t count;
+    
+    if (wifi_hotspot_get_station_stats(stats, WIFI_HOTSPOT_MAX_STATIONS, &count) != STATUS_OK) {
+        return;
+    }
+    
+    ESP_LOGI(TAG, "Profile %s, channel %d, %d station(s)", g_profiles[g_profile].name, g_channel, (int)count);
+    for (size_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "  "MACSTR" RSSI %d dBm, %s, ~%lu kbps", MAC2STR(stats[i].mac), stats[i].rssi,
+                 stats[i].phy_11n ? "11n" : "11b/g", (unsigned long)stats[i].est_phy_rate_kbps);
+    }
 }
\ No newline at end of file
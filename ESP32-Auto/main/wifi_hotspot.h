@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+// WiFi hotspot functions
+status_t wifi_hotspot_init(void);
+status_t wifi_hotspot_start(const char *ssid, const char *password);
+status_t wifi_hotspot_stop(void);
+bool wifi_hotspot_is_active(void);
+
+// Channel selection
+// With WIFI_HOTSPOT_CHANNEL_AUTO (the default) wifi_hotspot_start() scans
+// first and starts on the least congested channel; a fixed channel (1-13)
+// skips that scan. Either way the channel is re-evaluated periodically
+// while no station is joined.
+#define WIFI_HOTSPOT_CHANNEL_AUTO    0
+#define WIFI_HOTSPOT_DEFAULT_CHANNEL 1      // When the scan fails
+status_t wifi_hotspot_set_channel(uint8_t channel);
+uint8_t wifi_hotspot_get_channel(void);
+status_t wifi_hotspot_reevaluate_channel(void);
+// Address of the last station that joined; false if none has
+bool wifi_hotspot_get_station_mac(uint8_t mac[6]);
+
+// AP profiles
+// A profile sets the radio (bandwidth, protocols, power save, TX power,
+// station inactivity timeout) and the driver buffer budget as one unit.
+// Radio settings apply on the next wifi_hotspot_start(), or at once for
+// those the driver can change while running; the buffer budget applies on
+// the next wifi_hotspot_init(). Call before init to get the whole profile.
+typedef enum {
+    WIFI_PROFILE_MAX_THROUGHPUT = 0,    // HT40, deep aggregation, large buffers
+    WIFI_PROFILE_LOW_LATENCY,           // HT20, shallow aggregation, TCP_NODELAY
+    WIFI_PROFILE_POWER_SAVER,           // HT20, modem sleep, reduced TX power
+    WIFI_PROFILE_COUNT
+} wifi_profile_t;
+
+typedef struct {
+    const char *name;
+    uint8_t bandwidth;              // wifi_bandwidth_t
+    uint8_t protocols;              // WIFI_PROTOCOL_* bitmap
+    uint8_t power_save;             // wifi_ps_type_t; used while a STA interface is up
+    int8_t max_tx_power;            // 0.25 dBm units
+    uint16_t inactive_time_s;       // Silent stations are dropped after this
+    // Driver buffer budget
+    uint8_t static_rx_buf_num;
+    uint8_t dynamic_rx_buf_num;
+    uint8_t dynamic_tx_buf_num;
+    uint8_t rx_ba_win;              // Block-ack window; <= dynamic_rx_buf_num
+    bool ampdu_rx;
+    bool ampdu_tx;
+    bool tcp_nodelay;               // For sockets carrying the session
+} wifi_profile_params_t;
+
+status_t wifi_hotspot_set_profile(wifi_profile_t profile);
+wifi_profile_t wifi_hotspot_get_profile(void);
+const wifi_profile_params_t* wifi_hotspot_get_profile_params(void);
+status_t wifi_hotspot_profile_from_name(const char *name, wifi_profile_t *profile);
+
+// Per-station link state, for correlating throughput with the radio. The
+// driver keeps no per-station rate or retry counters, so the PHY rate is
+// estimated from RSSI, bandwidth and PHY mode.
+#define WIFI_HOTSPOT_MAX_STATIONS 4
+
+typedef struct {
+    uint8_t mac[6];
+    int8_t rssi;                    // dBm
+    bool phy_11n;
+    uint32_t est_phy_rate_kbps;
+} wifi_station_stats_t;
+
+status_t wifi_hotspot_get_station_stats(wifi_station_stats_t *stats, size_t capacity, size_t *count);
+uint32_t wifi_hotspot_estimate_phy_rate(int8_t rssi, bool phy_11n, bool ht40);
+void wifi_hotspot_log_link_stats(void);
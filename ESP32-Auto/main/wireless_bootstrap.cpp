@@ -0,0 +1,206 @@
+#include <string.h>
+#include "wireless_bootstrap.h"
+
+static const char *g_state_names[] = {
+    "idle",
+    "connected",
+    "offered",
+    "joining",
+    "joined",
+    "failed"
+};
+
+// Offer = framed WifiStartRequest + framed WifiInfoResponse. Built without
+// timestamps; a pre-encoded timestamp would only ever be stale.
+static status_t bootstrap_encode_offer(wireless_bootstrap_t *bootstrap, const wireless_bootstrap_config_t *config) {
+    AndroidAutoMessage message;
+    WifiStartRequest request;
+    WifiInfoResponse response;
+    size_t size;
+
+    proto_init_wifi_start_request(&request, config->ip_address, config->port);
+    memset(&message, 0, sizeof(message));
+    proto_set_wifi_start_request(&message, &request);
+
+    status_t ret = proto_stream_encode(&message, bootstrap->offer, sizeof(bootstrap->offer), &size);
+    if (ret != STATUS_OK) {
+        return ret;
+    }
+    bootstrap->offer_size = size;
+
+    proto_init_wifi_info_response(&response, config->ssid, config->key, config->bssid,
+                                  config->security_mode, config->access_point_type);
+    memset(&message, 0, sizeof(message));
+    proto_set_wifi_info_response(&message, &response);
+
+    ret = proto_stream_encode(&message, bootstrap->offer + bootstrap->offer_size,
+                              sizeof(bootstrap->offer) - bootstrap->offer_size, &size);
+    if (ret != STATUS_OK) {
+        return ret;
+    }
+    bootstrap->offer_size += size;
+    return STATUS_OK;
+}
+
+static status_t bootstrap_send_offer(wireless_bootstrap_t *bootstrap) {
+    status_t ret = bootstrap->send(bootstrap->offer, bootstrap->offer_size, bootstrap->send_ctx);
+    if (ret != STATUS_OK) {
+        bootstrap->stats.errors++;
+        return ret;
+    }
+
+    bootstrap->state = BOOTSTRAP_STATE_OFFERED;
+    bootstrap->awaiting_tcp = true;
+    bootstrap->stats.offers++;
+    bootstrap->stats.last_offer_us = bootstrap->now_us - bootstrap->connected_us;
+    return STATUS_OK;
+}
+
+static status_t bootstrap_handle_status(wireless_bootstrap_t *bootstrap, int status) {
+    bootstrap->stats.status_messages++;
+
+    switch (status) {
+        case PROTO_CONNECTION_STATUS_CONNECTING:
+            bootstrap->state = BOOTSTRAP_STATE_JOINING;
+            return STATUS_OK;
+
+        case PROTO_CONNECTION_STATUS_CONNECTED:
+            bootstrap->state = BOOTSTRAP_STATE_JOINED;
+            bootstrap->stats.last_join_us = bootstrap->now_us - bootstrap->connected_us;
+            return STATUS_OK;
+
+        case PROTO_CONNECTION_STATUS_ERROR:
+            // Usually a join that timed out; offer again a few times
+            if (bootstrap->retries >= BOOTSTRAP_MAX_RETRIES) {
+                bootstrap->state = BOOTSTRAP_STATE_FAILED;
+                return STATUS_OK;
+            }
+            bootstrap->retries++;
+            return bootstrap_send_offer(bootstrap);
+
+        default:
+            return STATUS_OK;
+    }
+}
+
+// proto_message_handler_t for CONNECTION_STATUS
+static status_t bootstrap_on_status(const AndroidAutoMessage *message, void *ctx) {
+    return bootstrap_handle_status((wireless_bootstrap_t*)ctx, message->connection_status);
+}
+
+// proto_message_handler_t for HEARTBEAT; the reply has already gone out
+static status_t bootstrap_on_heartbeat(const AndroidAutoMessage *message, void *ctx) {
+    (void)message;
+    ((wireless_bootstrap_t*)ctx)->stats.heartbeats++;
+    return STATUS_OK;
+}
+
+// proto_stream_cb_t; one call per complete message from the phone
+static status_t bootstrap_on_message(const uint8_t *data, size_t size, void *ctx) {
+    wireless_bootstrap_t *bootstrap = (wireless_bootstrap_t*)ctx;
+
+    status_t ret = proto_dispatch(data, size);
+    if (ret == STATUS_ERROR_PROTOCOL || ret == STATUS_ERROR_MEMORY) {
+        bootstrap->stats.errors++;
+        return STATUS_OK;  // Framing is intact; skip the message
+    }
+    return ret;
+}
+
+status_t wireless_bootstrap_init(wireless_bootstrap_t *bootstrap, const wireless_bootstrap_config_t *config,
+                                 proto_send_fn_t send, void *send_ctx) {
+    if (bootstrap == NULL || config == NULL || send == NULL) {
+        return STATUS_ERROR_INIT;
+    }
+
+    memset(bootstrap, 0, sizeof(*bootstrap));
+    bootstrap->send = send;
+    bootstrap->send_ctx = send_ctx;
+
+    status_t ret = bootstrap_encode_offer(bootstrap, config);
+    if (ret != STATUS_OK) {
+        return ret;  // Does not fit BOOTSTRAP_OFFER_MAX_SIZE
+    }
+
+    ret = proto_stream_init(&bootstrap->stream, bootstrap->rx_buffer, sizeof(bootstrap->rx_buffer),
+                            bootstrap_on_message, bootstrap);
+    if (ret != STATUS_OK) {
+        return ret;
+    }
+
+    proto_register_handler(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, bootstrap_on_status, bootstrap);
+    proto_register_handler(PROTO_MESSAGE_TYPE_HEARTBEAT, bootstrap_on_heartbeat, bootstrap);
+    proto_set_reply_sink(send, send_ctx);
+    return STATUS_OK;
+}
+
+void wireless_bootstrap_connected(wireless_bootstrap_t *bootstrap, int64_t now_us) {
+    if (bootstrap == NULL) {
+        return;
+    }
+
+    proto_stream_reset(&bootstrap->stream);
+    bootstrap->state = BOOTSTRAP_STATE_CONNECTED;
+    bootstrap->retries = 0;
+    bootstrap->awaiting_tcp = false;
+    bootstrap->connected_us = now_us;
+    bootstrap->now_us = now_us;
+    bootstrap->stats.connections++;
+}
+
+status_t wireless_bootstrap_ready(wireless_bootstrap_t *bootstrap, int64_t now_us) {
+    if (bootstrap == NULL || bootstrap->state != BOOTSTRAP_STATE_CONNECTED) {
+        return STATUS_ERROR_CONNECTION;
+    }
+
+    bootstrap->now_us = now_us;
+    return bootstrap_send_offer(bootstrap);
+}
+
+status_t wireless_bootstrap_receive(wireless_bootstrap_t *bootstrap, const uint8_t *data, size_t size, int64_t now_us) {
+    if (bootstrap == NULL || bootstrap->state == BOOTSTRAP_STATE_IDLE) {
+        return STATUS_ERROR_CONNECTION;
+    }
+
+    bootstrap->now_us = now_us;
+    status_t ret = proto_stream_feed(&bootstrap->stream, data, size);
+    if (ret != STATUS_OK) {
+        // Oversized or malformed framing; start over at the next write
+        bootstrap->stats.errors++;
+        proto_stream_reset(&bootstrap->stream);
+    }
+    return ret;
+}
+
+void wireless_bootstrap_disconnected(wireless_bootstrap_t *bootstrap) {
+    if (bootstrap != NULL) {
+        // connected_us is kept: the phone often drops Bluetooth before its
+        // TCP connection arrives
+        bootstrap->state = BOOTSTRAP_STATE_IDLE;
+    }
+}
+
+void wireless_bootstrap_tcp_connected(wireless_bootstrap_t *bootstrap, int64_t tcp_us) {
+    // Counted once per offered connection; later TCP reconnects are not bootstraps
+    if (bootstrap == NULL || !bootstrap->awaiting_tcp || tcp_us < bootstrap->connected_us) {
+        return;
+    }
+
+    int64_t elapsed = tcp_us - bootstrap->connected_us;
+    bootstrap->awaiting_tcp = false;
+    bootstrap->stats.completed++;
+    bootstrap->stats.last_tcp_us = elapsed;
+    if (elapsed > bootstrap->stats.max_tcp_us) {
+        bootstrap->stats.max_tcp_us = elapsed;
+    }
+}
+
+void wireless_bootstrap_get_stats(const wireless_bootstrap_t *bootstrap, bootstrap_stats_t *stats) {
+    if (bootstrap != NULL && stats != NULL) {
+        *stats = bootstrap->stats;
+    }
+}
+
+const char* wireless_bootstrap_state_name(bootstrap_state_t state) {
+    return (state <= BOOTSTRAP_STATE_FAILED) ? g_state_names[state] : "unknown";
+}
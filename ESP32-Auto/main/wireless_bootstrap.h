@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+#include "proto_handler.h"
+#include "proto_stream.h"
+
+// Wireless Android Auto bootstrap
+// Tells the phone over Bluetooth how to reach the proxy: a WifiStartRequest
+// (IP and port) followed by a WifiInfoResponse (SSID, key, BSSID). Both are
+// encoded once, length-prefixed back to back, when the bootstrap is
+// initialised, so each offer is a single write. The phone answers with
+// CONNECTION_STATUS messages; an ERROR gets the offer again.
+//
+// Messages from the phone go through proto_dispatch(): init registers the
+// CONNECTION_STATUS and HEARTBEAT handlers and makes the send callback the
+// reply sink, so heartbeats are answered by the dispatch fast path. There
+// is one bootstrap, and proto_init() must have run.
+//
+// Transport agnostic: bytes go out through a send callback and come in
+// through wireless_bootstrap_receive(). Time is passed in and nothing is
+// logged here (the transport logs from the state and stats), so the logic
+// runs the same over BLE GATT on the device and a socketpair on a host.
+
+#define BOOTSTRAP_OFFER_MAX_SIZE    256
+#define BOOTSTRAP_MAX_MESSAGE_SIZE  128     // Largest message accepted from the phone
+#define BOOTSTRAP_MAX_RETRIES       3
+
+typedef struct {
+    const char *ssid;
+    const char *key;
+    const char *bssid;              // "aa:bb:cc:dd:ee:ff"
+    const char *ip_address;
+    int32_t port;
+    int security_mode;              // PROTO_SECURITY_MODE_*
+    int access_point_type;          // PROTO_ACCESS_POINT_TYPE_*
+} wireless_bootstrap_config_t;
+
+typedef enum {
+    BOOTSTRAP_STATE_IDLE = 0,       // No phone on the transport
+    BOOTSTRAP_STATE_CONNECTED,      // Transport up, not yet writable
+    BOOTSTRAP_STATE_OFFERED,        // Offer written, waiting for the phone
+    BOOTSTRAP_STATE_JOINING,        // Phone reported CONNECTING
+    BOOTSTRAP_STATE_JOINED,         // Phone reported CONNECTED
+    BOOTSTRAP_STATE_FAILED          // Phone reported ERROR too often
+} bootstrap_state_t;
+
+typedef struct {
+    uint32_t connections;
+    uint32_t offers;                // Offers written, retries included
+    uint32_t status_messages;
+    uint32_t heartbeats;
+    uint32_t errors;                // Send failures and malformed input
+    uint32_t completed;             // Phone reached the proxy over TCP
+    int64_t last_offer_us;          // Transport connect to offer written
+    int64_t last_join_us;           // Transport connect to CONNECTED status
+    int64_t last_tcp_us;            // Transport connect to TCP connect on the proxy
+    int64_t max_tcp_us;
+} bootstrap_stats_t;
+
+typedef struct {
+    uint8_t offer[BOOTSTRAP_OFFER_MAX_SIZE];
+    size_t offer_size;
+    uint8_t rx_buffer[BOOTSTRAP_MAX_MESSAGE_SIZE];
+    proto_stream_t stream;
+    proto_send_fn_t send;
+    void *send_ctx;
+    bootstrap_state_t state;
+    uint8_t retries;
+    bool awaiting_tcp;              // Offer written, TCP connect not yet seen
+    int64_t connected_us;
+    int64_t now_us;                 // Time of the input being processed
+    bootstrap_stats_t stats;
+} wireless_bootstrap_t;
+
+// Wireless bootstrap functions
+status_t wireless_bootstrap_init(wireless_bootstrap_t *bootstrap, const wireless_bootstrap_config_t *config,
+                                 proto_send_fn_t send, void *send_ctx);
+void wireless_bootstrap_connected(wireless_bootstrap_t *bootstrap, int64_t now_us);
+status_t wireless_bootstrap_ready(wireless_bootstrap_t *bootstrap, int64_t now_us);  // Writes the offer
+status_t wireless_bootstrap_receive(wireless_bootstrap_t *bootstrap, const uint8_t *data, size_t size, int64_t now_us);
+void wireless_bootstrap_disconnected(wireless_bootstrap_t *bootstrap);
+// The phone's TCP connection reached the proxy at tcp_us
+void wireless_bootstrap_tcp_connected(wireless_bootstrap_t *bootstrap, int64_t tcp_us);
+void wireless_bootstrap_get_stats(const wireless_bootstrap_t *bootstrap, bootstrap_stats_t *stats);
+const char* wireless_bootstrap_state_name(bootstrap_state_t state);
@@ -0,0 +1,218 @@
+// Encode/decode cost of the table-driven codec against a hand-written one
+//
+// proto_wire.cpp walks generated field tables, so every message shares one
+// encoder and one decoder. The alternative is a generated encode/decode
+// pair per message, which unrolls the table walk. This times both on the
+// bootstrap's largest message (WifiInfoResponse inside AndroidAutoMessage)
+// and checks they agree byte for byte.
+//
+//     bench_proto_codec [iterations]
+//
+// Exits 1 when the two codecs disagree.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "proto_wire.h"
+#include "android_auto.pb.h"
+
+#define BENCH_BUFFER_SIZE 256
+
+static volatile size_t g_sink;
+
+static void build_message(AndroidAutoMessage *msg) {
+    memset(msg, 0, sizeof(*msg));
+    msg->type = AndroidAutoMessage_MessageType_WIFI_INFO_RESPONSE;
+    msg->has_wifi_info_response = true;
+    msg->wifi_info_response.ssid = proto_string("AndroidAuto-3F2A");
+    msg->wifi_info_response.key = proto_string("k3y-for-the-hotspot");
+    msg->wifi_info_response.bssid = proto_string("24:6f:28:aa:bb:cc");
+    msg->wifi_info_response.security_mode = SecurityMode_WPA2_PERSONAL;
+    msg->wifi_info_response.access_point_type = AccessPointType_DYNAMIC;
+    msg->has_timestamp = true;
+    msg->timestamp = 1234567890123ull;
+}
+
+// Hand-written codec for the same message, built on the same primitives
+
+static status_t hand_encode_info(proto_writer_t *w, const WifiInfoResponse *info) {
+    status_t ret = proto_write_string(w, 1, &info->ssid);
+    if (ret == STATUS_OK) ret = proto_write_string(w, 2, &info->key);
+    if (ret == STATUS_OK) ret = proto_write_string(w, 3, &info->bssid);
+    if (ret == STATUS_OK) ret = proto_write_tag(w, 4, PROTO_WIRE_VARINT);
+    if (ret == STATUS_OK) ret = proto_write_varint(w, (uint64_t)(int64_t)info->security_mode);
+    if (ret == STATUS_OK) ret = proto_write_tag(w, 5, PROTO_WIRE_VARINT);
+    if (ret == STATUS_OK) ret = proto_write_varint(w, (uint64_t)(int64_t)info->access_point_type);
+    return ret;
+}
+
+static status_t hand_encode(const AndroidAutoMessage *msg, uint8_t *buffer, size_t capacity, size_t *size) {
+    proto_writer_t w;
+    proto_writer_init(&w, buffer, capacity);
+
+    status_t ret = proto_write_tag(&w, 1, PROTO_WIRE_VARINT);
+    if (ret == STATUS_OK) ret = proto_write_varint(&w, (uint64_t)(int64_t)msg->type);
+    if (ret == STATUS_OK && msg->has_wifi_info_response) {
+        proto_writer_t counter;
+        proto_writer_init(&counter, NULL, 0);
+        hand_encode_info(&counter, &msg->wifi_info_response);
+        ret = proto_write_tag(&w, 3, PROTO_WIRE_LENGTH_DELIMITED);
+        if (ret == STATUS_OK) ret = proto_write_varint(&w, counter.size);
+        if (ret == STATUS_OK) ret = hand_encode_info(&w, &msg->wifi_info_response);
+    }
+    if (ret == STATUS_OK && msg->has_timestamp) {
+        ret = proto_write_tag(&w, 6, PROTO_WIRE_VARINT);
+        if (ret == STATUS_OK) ret = proto_write_varint(&w, msg->timestamp);
+    }
+
+    *size = w.size;
+    return ret;
+}
+
+static status_t hand_read_string(proto_reader_t *r, proto_string_t *out) {
+    const uint8_t *data;
+    size_t size;
+    status_t ret = proto_read_length_delimited(r, &data, &size);
+    out->data = (const char *)data;
+    out->size = size;
+    return ret;
+}
+
+static status_t hand_decode_info(const uint8_t *buffer, size_t size, WifiInfoResponse *info) {
+    proto_reader_t r;
+    proto_reader_init(&r, buffer, size);
+    uint32_t seen = 0;
+
+    while (!proto_reader_done(&r)) {
+        uint32_t field;
+        uint8_t wire_type;
+        uint64_t value;
+        status_t ret = proto_read_tag(&r, &field, &wire_type);
+        if (ret != STATUS_OK) return ret;
+
+        switch (field) {
+            case 1: ret = hand_read_string(&r, &info->ssid); break;
+            case 2: ret = hand_read_string(&r, &info->key); break;
+            case 3: ret = hand_read_string(&r, &info->bssid); break;
+            case 4: ret = proto_read_varint(&r, &value); info->security_mode = (int32_t)value; break;
+            case 5: ret = proto_read_varint(&r, &value); info->access_point_type = (int32_t)value; break;
+            default: ret = proto_skip_field(&r, wire_type); break;
+        }
+        if (ret != STATUS_OK) return ret;
+        if (field <= 5) seen |= 1u << (field - 1);
+    }
+    return (seen == 0x1F) ? STATUS_OK : STATUS_ERROR_PROTOCOL;
+}
+
+static status_t hand_decode(const uint8_t *buffer, size_t size, AndroidAutoMessage *msg) {
+    proto_reader_t r;
+    proto_reader_init(&r, buffer, size);
+    memset(msg, 0, sizeof(*msg));
+    bool has_type = false;
+
+    while (!proto_reader_done(&r)) {
+        uint32_t field;
+        uint8_t wire_type;
+        uint64_t value;
+        const uint8_t *data;
+        size_t length;
+        status_t ret = proto_read_tag(&r, &field, &wire_type);
+        if (ret != STATUS_OK) return ret;
+
+        switch (field) {
+            case 1:
+                ret = proto_read_varint(&r, &value);
+                msg->type = (int32_t)value;
+                has_type = true;
+                break;
+            case 3:
+                ret = proto_read_length_delimited(&r, &data, &length);
+                if (ret == STATUS_OK) ret = hand_decode_info(data, length, &msg->wifi_info_response);
+                msg->has_wifi_info_response = true;
+                break;
+            case 6:
+                ret = proto_read_varint(&r, &msg->timestamp);
+                msg->has_timestamp = true;
+                break;
+            default:
+                ret = proto_skip_field(&r, wire_type);
+                break;
+        }
+        if (ret != STATUS_OK) return ret;
+    }
+    return has_type ? STATUS_OK : STATUS_ERROR_PROTOCOL;
+}
+
+static bool same_message(const AndroidAutoMessage *a, const AndroidAutoMessage *b) {
+    const WifiInfoResponse *x = &a->wifi_info_response;
+    const WifiInfoResponse *y = &b->wifi_info_response;
+    return a->type == b->type && a->has_wifi_info_response == b->has_wifi_info_response &&
+           x->ssid.size == y->ssid.size && memcmp(x->ssid.data, y->ssid.data, x->ssid.size) == 0 &&
+           x->key.size == y->key.size && memcmp(x->key.data, y->key.data, x->key.size) == 0 &&
+           x->bssid.size == y->bssid.size && memcmp(x->bssid.data, y->bssid.data, x->bssid.size) == 0 &&
+           x->security_mode == y->security_mode && x->access_point_type == y->access_point_type &&
+           a->has_timestamp == b->has_timestamp && a->timestamp == b->timestamp;
+}
+
+template <typename F>
+static double time_ns(long iterations, F fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char **argv) {
+    long iterations = (argc > 1) ? strtol(argv[1], NULL, 0) : 1000000;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 2;
+    }
+
+    AndroidAutoMessage msg;
+    build_message(&msg);
+
+    uint8_t table_buf[BENCH_BUFFER_SIZE], hand_buf[BENCH_BUFFER_SIZE];
+    size_t table_size = 0, hand_size = 0;
+    if (proto_encode(&msg, table_buf, sizeof(table_buf), &table_size) != STATUS_OK ||
+        hand_encode(&msg, hand_buf, sizeof(hand_buf), &hand_size) != STATUS_OK ||
+        table_size != hand_size || memcmp(table_buf, hand_buf, table_size) != 0) {
+        fprintf(stderr, "encoders disagree (%zu vs %zu bytes)\n", table_size, hand_size);
+        return 1;
+    }
+
+    AndroidAutoMessage table_out, hand_out;
+    if (proto_decode(table_buf, table_size, &table_out) != STATUS_OK ||
+        hand_decode(table_buf, table_size, &hand_out) != STATUS_OK ||
+        !same_message(&msg, &table_out) || !same_message(&msg, &hand_out)) {
+        fprintf(stderr, "decoders disagree\n");
+        return 1;
+    }
+
+    double table_enc = time_ns(iterations, [&] {
+        size_t size;
+        proto_encode(&msg, table_buf, sizeof(table_buf), &size);
+        g_sink = size;
+    });
+    double hand_enc = time_ns(iterations, [&] {
+        size_t size;
+        hand_encode(&msg, hand_buf, sizeof(hand_buf), &size);
+        g_sink = size;
+    });
+    double table_dec = time_ns(iterations, [&] {
+        proto_decode(table_buf, table_size, &table_out);
+        g_sink = table_out.wifi_info_response.ssid.size;
+    });
+    double hand_dec = time_ns(iterations, [&] {
+        hand_decode(table_buf, table_size, &hand_out);
+        g_sink = hand_out.wifi_info_response.ssid.size;
+    });
+
+    printf("%zu-byte AndroidAutoMessage, %ld iterations\n", table_size, iterations);
+    printf("  encode  table %7.1f ns  hand %7.1f ns  (%.2fx)\n", table_enc, hand_enc, table_enc / hand_enc);
+    printf("  decode  table %7.1f ns  hand %7.1f ns  (%.2fx)\n", table_dec, hand_dec, table_dec / hand_dec);
+    return 0;
+}
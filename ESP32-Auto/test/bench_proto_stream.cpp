@@ -0,0 +1,133 @@
+// Stream decoder and dispatch cost
+//
+// The bootstrap receives the phone's messages in GATT writes of at most
+// 20 bytes (default ATT MTU), so most messages are reassembled; over a
+// socket they usually arrive whole and are delivered without copying.
+// This times proto_stream_feed() both ways on a run of status and
+// heartbeat messages, framing only and with full dispatch.
+//
+//     bench_proto_stream [iterations]
+//
+// Exits 1 when chunked and whole feeds deliver different messages.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "proto_stream.h"
+#include "proto_handler.h"
+#include "wireless_bootstrap.h"
+
+#define BENCH_MESSAGES      64
+#define BENCH_WIRE_SIZE     (BENCH_MESSAGES * 32)
+#define BENCH_GATT_CHUNK    20
+
+static uint8_t g_wire[BENCH_WIRE_SIZE];
+static size_t g_wire_size;
+static uint8_t g_rx[BOOTSTRAP_MAX_MESSAGE_SIZE];
+
+static volatile size_t g_sink;
+static uint32_t g_delivered;
+
+static status_t count_message(const uint8_t *data, size_t size, void *ctx) {
+    (void)data;
+    (void)ctx;
+    g_delivered++;
+    g_sink = size;
+    return STATUS_OK;
+}
+
+static status_t dispatch_message(const uint8_t *data, size_t size, void *ctx) {
+    (void)ctx;
+    g_delivered++;
+    proto_dispatch(data, size);
+    return STATUS_OK;
+}
+
+static status_t on_status(const AndroidAutoMessage *message, void *ctx) {
+    (void)ctx;
+    g_sink = message->connection_status;
+    return STATUS_OK;
+}
+
+static status_t discard_reply(const uint8_t *data, size_t size, void *ctx) {
+    (void)data;
+    (void)ctx;
+    g_sink = size;
+    return STATUS_OK;
+}
+
+static void build_wire(void) {
+    AndroidAutoMessage message;
+    g_wire_size = 0;
+    for (int i = 0; i < BENCH_MESSAGES; i++) {
+        if (i % 4 == 3) {
+            proto_init_message(&message, PROTO_MESSAGE_TYPE_HEARTBEAT);
+        } else {
+            proto_init_message(&message, PROTO_MESSAGE_TYPE_CONNECTION_STATUS);
+            proto_set_connection_status(&message, PROTO_CONNECTION_STATUS_CONNECTING + i % 3);
+        }
+        proto_set_timestamp(&message, 1700000000000ull + i);
+
+        size_t size;
+        if (proto_stream_encode(&message, g_wire + g_wire_size, sizeof(g_wire) - g_wire_size, &size) != STATUS_OK) {
+            fprintf(stderr, "wire buffer too small\n");
+            exit(1);
+        }
+        g_wire_size += size;
+    }
+}
+
+static uint32_t feed(proto_stream_cb_t callback, size_t chunk) {
+    proto_stream_t stream;
+    proto_stream_init(&stream, g_rx, sizeof(g_rx), callback, NULL);
+    g_delivered = 0;
+    for (size_t offset = 0; offset < g_wire_size; offset += chunk) {
+        size_t n = (g_wire_size - offset < chunk) ? g_wire_size - offset : chunk;
+        proto_stream_feed(&stream, g_wire + offset, n);
+    }
+    return g_delivered;
+}
+
+template <typename F>
+static double time_ns(long iterations, F fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char **argv) {
+    long iterations = (argc > 1) ? strtol(argv[1], NULL, 0) : 20000;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 2;
+    }
+
+    proto_init();
+    proto_register_handler(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, on_status, NULL);
+    proto_set_reply_sink(discard_reply, NULL);
+    build_wire();
+
+    if (feed(count_message, g_wire_size) != BENCH_MESSAGES ||
+        feed(count_message, BENCH_GATT_CHUNK) != BENCH_MESSAGES ||
+        feed(dispatch_message, BENCH_GATT_CHUNK) != BENCH_MESSAGES ||
+        proto_get_invalid_count() != 0) {
+        fprintf(stderr, "stream delivered the wrong messages\n");
+        return 1;
+    }
+
+    double whole = time_ns(iterations, [] { feed(count_message, g_wire_size); });
+    double gatt = time_ns(iterations, [] { feed(count_message, BENCH_GATT_CHUNK); });
+    double byte = time_ns(iterations, [] { feed(count_message, 1); });
+    double dispatched = time_ns(iterations, [] { feed(dispatch_message, BENCH_GATT_CHUNK); });
+
+    printf("%d messages, %zu bytes, %ld iterations\n", BENCH_MESSAGES, g_wire_size, iterations);
+    printf("  framing, whole        %7.1f ns/msg\n", whole / BENCH_MESSAGES);
+    printf("  framing, %2d-byte GATT %7.1f ns/msg\n", BENCH_GATT_CHUNK, gatt / BENCH_MESSAGES);
+    printf("  framing, 1-byte       %7.1f ns/msg\n", byte / BENCH_MESSAGES);
+    printf("  dispatch, %2d-byte GATT %6.1f ns/msg\n", BENCH_GATT_CHUNK, dispatched / BENCH_MESSAGES);
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Fuzz target for the length-prefixed stream decoder and dispatch
+//
+// The first input byte picks the reassembly buffer size and how the rest
+// is cut into chunks. Fed whole and fed in chunks, the stream must hand
+// the same messages to dispatch and end in the same state: reassembly is
+// invisible to the layer above.
+
+#include <string.h>
+#include <stdlib.h>
+#include "proto_stream.h"
+#include "proto_handler.h"
+#include "esp_log.h"
+
+#define FUZZ_MAX_MESSAGE 256
+
+typedef struct {
+    uint32_t messages;
+    uint64_t hash;              // FNV-1a over every delivered message, in order
+} fuzz_trace_t;
+
+static status_t fuzz_on_message(const uint8_t *data, size_t size, void *ctx) {
+    fuzz_trace_t *trace = (fuzz_trace_t*)ctx;
+    trace->messages++;
+    trace->hash = (trace->hash ^ size) * 0x100000001B3ull;
+    for (size_t i = 0; i < size; i++) {
+        trace->hash = (trace->hash ^ data[i]) * 0x100000001B3ull;
+    }
+
+    // Same path as the bootstrap: decode into the session arena, look up
+    // the handler, rewind
+    size_t used = proto_get_session_arena()->used;
+    proto_dispatch(data, size);
+    if (proto_get_session_arena()->used != used) {
+        abort();
+    }
+    return STATUS_OK;
+}
+
+static status_t fuzz_feed(const uint8_t *data, size_t size, size_t max_message, uint8_t pattern,
+                          fuzz_trace_t *trace) {
+    static uint8_t buffer[FUZZ_MAX_MESSAGE];
+    proto_stream_t stream;
+    memset(trace, 0, sizeof(*trace));
+    trace->hash = 0xCBF29CE484222325ull;
+    proto_stream_init(&stream, buffer, max_message, fuzz_on_message, trace);
+
+    status_t ret = STATUS_OK;
+    size_t offset = 0;
+    while (offset < size && ret == STATUS_OK) {
+        // pattern 0 feeds everything at once; otherwise chunks of 1..8 bytes
+        size_t chunk = (pattern == 0) ? size : (size_t)((pattern >> (offset % 5)) & 7) + 1;
+        if (chunk > size - offset) {
+            chunk = size - offset;
+        }
+        ret = proto_stream_feed(&stream, data + offset, chunk);
+        offset += chunk;
+    }
+
+    // Callbacks never fail here, so only bad framing stops the stream
+    if ((ret == STATUS_OK) != (stream.state != PROTO_STREAM_ERROR)) {
+        abort();
+    }
+    return ret;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static bool initialized = false;
+    if (!initialized) {
+        g_host_log_quiet = true;
+        proto_init();
+        initialized = true;
+    }
+    if (size < 1) {
+        return 0;
+    }
+
+    size_t max_message = 16 + (data[0] & 0x0F) * 15;   // 16..241
+    uint8_t pattern = (uint8_t)(data[0] | 0x01);
+    data++;
+    size--;
+
+    fuzz_trace_t whole, chunked;
+    status_t whole_ret = fuzz_feed(data, size, max_message, 0, &whole);
+    status_t chunked_ret = fuzz_feed(data, size, max_message, pattern, &chunked);
+    if (whole_ret != chunked_ret || whole.messages != chunked.messages || whole.hash != chunked.hash) {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Corpus replay for builds without libFuzzer
+//
+//     fuzz_<target> <file or directory>...
+//
+// Runs every file through LLVMFuzzerTestOneInput once, so the seeds and
+// any crash reproducers are checked by ctest with the host compiler.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static bool replay_file(const std::filesystem::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        std::filesystem::path path(argv[i]);
+        if (std::filesystem::is_directory(path)) {
+            for (const auto &entry : std::filesystem::directory_iterator(path)) {
+                if (entry.is_regular_file()) {
+                    if (!replay_file(entry.path())) return 1;
+                    files++;
+                }
+            }
+        } else {
+            if (!replay_file(path)) return 1;
+            files++;
+        }
+    }
+
+    if (files == 0) {
+        fprintf(stderr, "usage: %s <file or directory>...\n", argv[0]);
+        return 2;
+    }
+    printf("%d inputs replayed\n", files);
+    return 0;
+}
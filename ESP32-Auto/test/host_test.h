@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Host test checks
+// The pure modules under main/ build unchanged with the host compiler.
+// A test is a plain function; a failed check reports where and exits 1,
+// which ctest counts as a failure.
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+    long long actual_ = (long long)(actual); \
+    long long expected_ = (long long)(expected); \
+    if (actual_ != expected_) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+                __FILE__, __LINE__, #actual, #expected, actual_, expected_); \
+        exit(1); \
+    } \
+} while (0)
+
+#define RUN_TEST(test) do { \
+    test(); \
+    printf("ok   %s\n", #test); \
+} while (0)
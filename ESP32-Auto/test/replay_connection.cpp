@@ -0,0 +1,250 @@
+// Replays connection loss scenarios through main/connection_fsm.cpp
+//
+// Each scenario is a timeline of events from the outside world (the phone
+// leaving the hotspot, a subsystem failing). A simulated device answers the
+// FSM's actions the way connection_manager.cpp and main.cpp do, with fixed
+// costs for a session start, each subsystem restart and the phone's TCP
+// redial. Every scenario runs under each strategy and the reconnect
+// latency, loss of streaming to streaming again, is printed side by side.
+//
+//     replay_connection
+//
+// Exits 1 when a strategy does not get back to streaming, or when it stops
+// the USB session for a loss it should ride out: Bluetooth under any
+// strategy, the phone or the hotspot under USB_FIRST.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <queue>
+#include <vector>
+#include "connection_fsm.h"
+
+#define MS                      1000LL
+#define REPLAY_END_US           (60 * 1000 * MS)
+#define REPLAY_TICK_US          (1000 * MS)     // CONN_TICK_MS
+#define STREAM_AT_US            (10 * 1000 * MS)
+
+// Costs of the simulated device
+#define SESSION_START_US        (300 * MS)      // AOA switch and proxy start
+#define PHONE_REDIAL_US         (500 * MS)      // Session ready to TCP connect
+#define PHONE_REJOIN_US         (1500 * MS)     // Association after the AP is back
+
+static const int64_t g_restart_us[CONN_SUBSYS_COUNT] = {
+    2000 * MS,                                  // Wi-Fi: AP stop, start and scan
+    200 * MS,                                   // Bluetooth: advertising restart
+    400 * MS,                                   // USB: gadget deinit and init
+    100 * MS                                    // Proxy: listener re-created
+};
+
+static const char *g_strategy_names[] = { "dongle", "phone_first", "usb_first" };
+
+typedef struct {
+    int64_t at_us;
+    conn_event_t event;
+} timed_event_t;
+
+struct later {
+    bool operator()(const timed_event_t &a, const timed_event_t &b) const {
+        return a.at_us > b.at_us;
+    }
+};
+
+typedef struct {
+    const char *name;
+    const char *description;
+    std::vector<timed_event_t> events;      // After STREAM_AT_US
+    bool fails_first_start;                 // The first start after the loss fails
+} scenario_t;
+
+typedef struct {
+    conn_fsm_t fsm;
+    std::priority_queue<timed_event_t, std::vector<timed_event_t>, later> queue;
+    bool phone_joined;
+    bool client_connected;
+    bool start_fails;
+    uint32_t stops;
+} device_t;
+
+static void post(device_t *device, int64_t at_us, conn_event_type_t type, conn_subsystem_t subsystem) {
+    timed_event_t timed;
+    timed.at_us = at_us;
+    timed.event.type = type;
+    timed.event.subsystem = subsystem;
+    device->queue.push(timed);
+}
+
+// What connection_manager.cpp and main.cpp do with the FSM's actions
+static void execute(device_t *device, uint32_t actions, int64_t now_us) {
+    if (actions & CONN_ACTION_STOP_SESSION) {
+        device->stops++;
+    }
+
+    for (int i = 0; i < CONN_SUBSYS_COUNT; i++) {
+        if (actions & CONN_ACTION_RESTART(i)) {
+            post(device, now_us + g_restart_us[i], CONN_EVENT_SUBSYS_UP, (conn_subsystem_t)i);
+            // A restarted hotspot drops and re-admits the phone
+            if (i == CONN_SUBSYS_WIFI && device->phone_joined) {
+                post(device, now_us, CONN_EVENT_PHONE_LEFT, CONN_SUBSYS_WIFI);
+                post(device, now_us + g_restart_us[i] + PHONE_REJOIN_US, CONN_EVENT_PHONE_JOINED, CONN_SUBSYS_WIFI);
+            }
+        }
+    }
+
+    if (actions & CONN_ACTION_START_SESSION) {
+        bool fails = device->start_fails;
+        device->start_fails = false;
+        post(device, now_us + SESSION_START_US,
+             fails ? CONN_EVENT_SESSION_FAILED : CONN_EVENT_SESSION_STARTED, CONN_SUBSYS_USB);
+    }
+}
+
+static void handle(device_t *device, const conn_event_t *event, int64_t now_us) {
+    conn_state_t before = device->fsm.state;
+    switch (event->type) {
+        case CONN_EVENT_PHONE_JOINED:
+            device->phone_joined = true;
+            break;
+        case CONN_EVENT_PHONE_LEFT:
+            // The proxy connection goes with the phone
+            if (device->client_connected) {
+                post(device, now_us, CONN_EVENT_CLIENT_DISCONNECTED, CONN_SUBSYS_PROXY);
+            }
+            device->phone_joined = false;
+            break;
+        case CONN_EVENT_CLIENT_CONNECTED:
+            device->client_connected = true;
+            break;
+        case CONN_EVENT_CLIENT_DISCONNECTED:
+            device->client_connected = false;
+            break;
+        default:
+            break;
+    }
+
+    execute(device, conn_fsm_handle(&device->fsm, event, now_us), now_us);
+
+    // The phone dials the proxy once it is on the hotspot and the session
+    // is listening, and again after its connection was dropped
+    bool listening = device->fsm.state == CONN_STATE_READY;
+    bool became_reachable = (before != CONN_STATE_READY && listening) ||
+                            (listening && event->type == CONN_EVENT_PHONE_JOINED);
+    if (became_reachable && device->phone_joined) {
+        post(device, now_us + PHONE_REDIAL_US, CONN_EVENT_CLIENT_CONNECTED, CONN_SUBSYS_PROXY);
+    }
+}
+
+// Runs one scenario; returns the reconnect latency in us, 0 if streaming
+// was never lost, or -1 if it did not come back
+static int64_t replay(const scenario_t *scenario, connection_strategy_t strategy, uint32_t *stops) {
+    device_t device;
+    conn_fsm_init(&device.fsm, strategy, 0);
+    device.phone_joined = false;
+    device.client_connected = false;
+    device.start_fails = false;
+    device.stops = 0;
+
+    // Bring-up: everything up, the phone joins, streaming by STREAM_AT_US
+    for (int i = 0; i < CONN_SUBSYS_COUNT; i++) {
+        post(&device, 100 * MS, CONN_EVENT_SUBSYS_UP, (conn_subsystem_t)i);
+    }
+    post(&device, 3000 * MS, CONN_EVENT_PHONE_JOINED, CONN_SUBSYS_WIFI);
+    for (int64_t t = REPLAY_TICK_US; t < REPLAY_END_US; t += REPLAY_TICK_US) {
+        post(&device, t, CONN_EVENT_TICK, CONN_SUBSYS_WIFI);
+    }
+
+    bool injected = false;
+    while (!device.queue.empty() && device.queue.top().at_us < REPLAY_END_US) {
+        timed_event_t timed = device.queue.top();
+        device.queue.pop();
+
+        if (!injected && timed.at_us >= STREAM_AT_US) {
+            injected = true;
+            if (device.fsm.state != CONN_STATE_STREAMING) {
+                fprintf(stderr, "%s/%s: not streaming before the scenario\n",
+                        scenario->name, g_strategy_names[strategy]);
+                return -1;
+            }
+            device.start_fails = scenario->fails_first_start;
+            for (const timed_event_t &event : scenario->events) {
+                post(&device, STREAM_AT_US + event.at_us, event.event.type, event.event.subsystem);
+            }
+            device.queue.push(timed);
+            continue;
+        }
+        handle(&device, &timed.event, timed.at_us);
+    }
+
+    *stops = device.stops;
+    conn_fsm_stats_t stats;
+    conn_fsm_get_stats(&device.fsm, REPLAY_END_US, &stats);
+    if (device.fsm.state != CONN_STATE_STREAMING) {
+        return -1;
+    }
+    return stats.reconnects > 0 ? stats.max_reconnect_us : 0;
+}
+
+static timed_event_t at(int64_t at_ms, conn_event_type_t type, conn_subsystem_t subsystem) {
+    timed_event_t timed;
+    timed.at_us = at_ms * MS;
+    timed.event.type = type;
+    timed.event.subsystem = subsystem;
+    return timed;
+}
+
+int main(void) {
+    const scenario_t scenarios[] = {
+        { "phone_roams", "phone leaves the hotspot for 3 s",
+          { at(0, CONN_EVENT_PHONE_LEFT, CONN_SUBSYS_WIFI),
+            at(3000, CONN_EVENT_PHONE_JOINED, CONN_SUBSYS_WIFI) }, false },
+        { "tcp_drop", "phone drops its TCP connection and redials",
+          { at(0, CONN_EVENT_CLIENT_DISCONNECTED, CONN_SUBSYS_PROXY),
+            at(800, CONN_EVENT_CLIENT_CONNECTED, CONN_SUBSYS_PROXY) }, false },
+        { "usb_failed", "USB transfers fail, gadget restarted",
+          { at(0, CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_USB) }, false },
+        { "wifi_failed", "AP stops under the session, hotspot restarted",
+          { at(0, CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_WIFI) }, false },
+        { "proxy_failed", "listener cannot be re-created, proxy restarted",
+          { at(0, CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_PROXY) }, false },
+        { "bluetooth_failed", "advertising fails, restarted",
+          { at(0, CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_BLUETOOTH) }, false },
+        { "usb_failed_retry", "USB restarted, first session start fails",
+          { at(0, CONN_EVENT_SUBSYS_FAILED, CONN_SUBSYS_USB) }, true },
+    };
+    const size_t scenario_count = sizeof(scenarios) / sizeof(scenarios[0]);
+    int failures = 0;
+
+    printf("Reconnect latency, ms ('-': streaming never lost)\n");
+    printf("%-18s %10s %12s %10s\n", "scenario", g_strategy_names[0], g_strategy_names[1], g_strategy_names[2]);
+
+    for (size_t i = 0; i < scenario_count; i++) {
+        const scenario_t *scenario = &scenarios[i];
+        printf("%-18s", scenario->name);
+
+        for (int strategy = 0; strategy < 3; strategy++) {
+            uint32_t stops = 0;
+            int64_t latency = replay(scenario, (connection_strategy_t)strategy, &stops);
+            int width = (strategy == 1) ? 13 : 11;
+
+            if (latency < 0) {
+                printf("%*s", width, "FAIL");
+                failures++;
+                continue;
+            }
+            latency == 0 ? printf("%*s", width, "-") : printf("%*lld", width, latency / MS);
+
+            // Bluetooth only bootstraps; USB_FIRST keeps the head unit's session
+            // while the phone is off the hotspot
+            bool rides_out = strcmp(scenario->name, "bluetooth_failed") == 0 ||
+                             (strategy == CONNECTION_STRATEGY_USB_FIRST &&
+                              (strcmp(scenario->name, "phone_roams") == 0 || strcmp(scenario->name, "wifi_failed") == 0));
+            if (rides_out && stops > 0) {
+                fprintf(stderr, "\n%s/%s: session stopped\n", scenario->name, g_strategy_names[strategy]);
+                failures++;
+            }
+        }
+        printf("   %s\n", scenario->description);
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for esp_attr.h: placement attributes mean nothing here
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define DMA_ATTR
+#define EXT_RAM_BSS_ATTR
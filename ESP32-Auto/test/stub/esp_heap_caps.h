@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for esp_heap_caps.h; reports a fixed, unfragmented heap
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_DMA          (1 << 3)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+
+#define HOST_HEAP_SIZE          (256 * 1024)
+
+static inline size_t heap_caps_get_free_size(uint32_t caps) { (void)caps; return HOST_HEAP_SIZE; }
+static inline size_t heap_caps_get_minimum_free_size(uint32_t caps) { (void)caps; return HOST_HEAP_SIZE; }
+static inline size_t heap_caps_get_largest_free_block(uint32_t caps) { (void)caps; return HOST_HEAP_SIZE; }
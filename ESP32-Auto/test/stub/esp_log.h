@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// Host stand-in for esp_log.h: errors and warnings go to stderr, the rest
+// is compiled but never printed, so format strings are still checked.
+// Fuzz targets turn the warnings off; every bad input would log one.
+extern bool g_host_log_quiet;
+
+#define ESP_LOG_HOST(level, tag, fmt, ...) do { \
+    if (!g_host_log_quiet) fprintf(stderr, level " (%s) " fmt "\n", tag, ##__VA_ARGS__); \
+} while (0)
+#define ESP_LOG_HOST_QUIET(tag, fmt, ...) do { \
+    if (0) fprintf(stderr, "%s" fmt, tag, ##__VA_ARGS__); \
+} while (0)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_HOST("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_HOST("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_HOST_QUIET(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_HOST_QUIET(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOG_HOST_QUIET(tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,19 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+
+bool g_host_log_quiet = false;
+
+// Fake clock behind esp_timer_get_time()
+static int64_t g_now_us = 0;
+
+int64_t esp_timer_get_time(void) {
+    return g_now_us;
+}
+
+void host_timer_set(int64_t now_us) {
+    g_now_us = now_us;
+}
+
+void host_timer_advance(int64_t delta_us) {
+    g_now_us += delta_us;
+}
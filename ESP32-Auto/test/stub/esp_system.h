@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand-in for esp_system.h
+#include "esp_err.h"
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host stand-in for esp_timer.h. The clock only moves when a test moves
+// it, so timings in the code under test are reproducible.
+int64_t esp_timer_get_time(void);
+
+void host_timer_set(int64_t now_us);
+void host_timer_advance(int64_t delta_us);
@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS critical sections; the host tests are
+// single threaded
+typedef struct {
+    int owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define taskENTER_CRITICAL(mux)         ((void)(mux))
+#define taskEXIT_CRITICAL(mux)          ((void)(mux))
@@ -0,0 +1,160 @@
+// Traffic classes: channel to class and TOS, and the frame scanner over
+// headers split between reads, extended first-fragment headers and reads
+// that change class part way
+
+#include <string.h>
+#include <vector>
+#include "host_test.h"
+#include "aa_traffic_class.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+// One frame: channel, flags, 16-bit length, payload of fill bytes. The
+// first fragment of a multi-frame message also carries a 32-bit total.
+static void add_frame(bytes_t *out, uint8_t channel, uint8_t flags, uint16_t length, uint8_t fill) {
+    out->push_back(channel);
+    out->push_back(flags);
+    out->push_back((uint8_t)(length >> 8));
+    out->push_back((uint8_t)length);
+    if ((flags & AA_FRAME_FLAG_FIRST) && !(flags & AA_FRAME_FLAG_LAST)) {
+        const uint8_t total[4] = { 0x00, 0x01, 0x00, 0x00 };
+        out->insert(out->end(), total, total + sizeof(total));
+    }
+    out->insert(out->end(), length, fill);
+}
+
+#define WHOLE (AA_FRAME_FLAG_FIRST | AA_FRAME_FLAG_LAST)
+
+static void test_channel_classes(void) {
+    CHECK_EQ(aa_traffic_class_for_channel(AA_CHANNEL_INPUT), AA_TRAFFIC_CLASS_INPUT);
+    CHECK_EQ(aa_traffic_class_for_channel(AA_CHANNEL_CONTROL), AA_TRAFFIC_CLASS_INPUT);
+    CHECK_EQ(aa_traffic_class_for_channel(AA_CHANNEL_AV_INPUT), AA_TRAFFIC_CLASS_AUDIO);
+    CHECK_EQ(aa_traffic_class_for_channel(AA_CHANNEL_VIDEO), AA_TRAFFIC_CLASS_BEST_EFFORT);
+    CHECK_EQ(aa_traffic_class_for_channel(0xEE), AA_TRAFFIC_CLASS_BEST_EFFORT);
+
+    CHECK_EQ(aa_traffic_class_tos(AA_TRAFFIC_CLASS_INPUT), 0xC0);
+    CHECK_EQ(aa_traffic_class_tos(AA_TRAFFIC_CLASS_AUDIO), 0x88);
+    CHECK_EQ(aa_traffic_class_tos(AA_TRAFFIC_CLASS_COUNT), 0);
+    CHECK(strcmp(aa_traffic_class_name(AA_TRAFFIC_CLASS_COUNT), "unknown") == 0);
+}
+
+static void test_header_split_between_reads(void) {
+    bytes_t stream;
+    add_frame(&stream, AA_CHANNEL_INPUT, WHOLE, 6, 0x03);
+    add_frame(&stream, AA_CHANNEL_VIDEO, WHOLE, 2, 0x01);
+
+    aa_frame_scanner_t scanner;
+    aa_traffic_class_t traffic_class;
+    aa_frame_scanner_init(&scanner);
+
+    // Channel byte only, then the rest of the header and part of the payload
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data(), 1, &traffic_class), 1);
+    CHECK_EQ(traffic_class, AA_TRAFFIC_CLASS_INPUT);
+    CHECK_EQ(scanner.header_len, 1);
+
+    // The payload bytes look like a video channel; they are not a new frame
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data() + 1, 6, &traffic_class), 6);
+    CHECK_EQ(traffic_class, AA_TRAFFIC_CLASS_INPUT);
+    CHECK_EQ(scanner.remaining, 3);
+    CHECK_EQ(scanner.frames, 1);
+
+    // Rest of the payload, then the next frame's header split after its length
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data() + 7, 6, &traffic_class), 3);
+    CHECK_EQ(traffic_class, AA_TRAFFIC_CLASS_INPUT);
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data() + 10, 3, &traffic_class), 3);
+    CHECK_EQ(traffic_class, AA_TRAFFIC_CLASS_BEST_EFFORT);
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data() + 13, 3, &traffic_class), 3);
+    CHECK_EQ(traffic_class, AA_TRAFFIC_CLASS_BEST_EFFORT);
+    CHECK_EQ(scanner.remaining, 0);
+    CHECK_EQ(scanner.header_len, 0);
+    CHECK_EQ(scanner.frames, 2);
+}
+
+static void test_extended_first_fragment(void) {
+    bytes_t stream;
+    add_frame(&stream, AA_CHANNEL_MEDIA_AUDIO, AA_FRAME_FLAG_FIRST, 5, 0x01);
+    add_frame(&stream, AA_CHANNEL_MEDIA_AUDIO, 0, 3, 0x01);
+    add_frame(&stream, AA_CHANNEL_MEDIA_AUDIO, AA_FRAME_FLAG_LAST, 2, 0x01);
+    add_frame(&stream, AA_CHANNEL_INPUT, WHOLE, 1, 0x00);
+    CHECK_EQ(stream.size(), (8 + 5) + (4 + 3) + (4 + 2) + (4 + 1));
+
+    aa_frame_scanner_t scanner;
+    aa_traffic_class_t traffic_class;
+    aa_frame_scanner_init(&scanner);
+
+    // The 8-byte header is consumed whole: the total length is not payload,
+    // so the audio run ends exactly where the input frame starts
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data(), stream.size(), &traffic_class), 26);
+    CHECK_EQ(traffic_class, AA_TRAFFIC_CLASS_AUDIO);
+    CHECK_EQ(scanner.frames, 3);
+
+    // An extended header split inside its total length
+    aa_frame_scanner_init(&scanner);
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data(), 6, &traffic_class), 6);
+    CHECK_EQ(scanner.header_size, AA_FRAME_EXT_HEADER_SIZE);
+    CHECK_EQ(scanner.remaining, 0);
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data() + 6, 3, &traffic_class), 3);
+    CHECK_EQ(scanner.remaining, 4);
+    CHECK_EQ(traffic_class, AA_TRAFFIC_CLASS_AUDIO);
+}
+
+static void test_class_change_splits_read(void) {
+    bytes_t stream;
+    add_frame(&stream, AA_CHANNEL_SPEECH_AUDIO, WHOLE, 4, 0x09);
+    add_frame(&stream, AA_CHANNEL_AV_INPUT, WHOLE, 2, 0x09);
+    add_frame(&stream, AA_CHANNEL_INPUT, WHOLE, 3, 0x09);
+    add_frame(&stream, AA_CHANNEL_SENSOR, WHOLE, 1, 0x09);
+    add_frame(&stream, AA_CHANNEL_VIDEO, WHOLE, 10, 0x09);
+
+    aa_frame_scanner_t scanner;
+    aa_traffic_class_t traffic_class;
+    aa_frame_scanner_init(&scanner);
+
+    // Runs as the proxy sends them: each covers whole frames of one class
+    const struct {
+        size_t length;
+        aa_traffic_class_t traffic_class;
+    } expected[] = {
+        { 8 + 6, AA_TRAFFIC_CLASS_AUDIO },
+        { 7 + 5, AA_TRAFFIC_CLASS_INPUT },
+        { 14, AA_TRAFFIC_CLASS_BEST_EFFORT },
+    };
+
+    size_t offset = 0;
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        size_t run = aa_frame_scanner_next(&scanner, stream.data() + offset, stream.size() - offset,
+                                           &traffic_class);
+        CHECK_EQ(run, expected[i].length);
+        CHECK_EQ(traffic_class, expected[i].traffic_class);
+        offset += run;
+    }
+    CHECK_EQ(offset, stream.size());
+    CHECK_EQ(scanner.frames, 5);
+    CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data(), 0, &traffic_class), 0);
+}
+
+static void test_byte_at_a_time(void) {
+    bytes_t stream;
+    add_frame(&stream, AA_CHANNEL_VIDEO, AA_FRAME_FLAG_FIRST, 3, 0x01);
+    add_frame(&stream, AA_CHANNEL_INPUT, WHOLE, 2, 0x03);
+
+    aa_frame_scanner_t scanner;
+    aa_traffic_class_t traffic_class;
+    aa_frame_scanner_init(&scanner);
+
+    // Same classes as one read would give, byte for byte
+    for (size_t i = 0; i < stream.size(); i++) {
+        CHECK_EQ(aa_frame_scanner_next(&scanner, stream.data() + i, 1, &traffic_class), 1);
+        CHECK_EQ(traffic_class, (i < 11) ? AA_TRAFFIC_CLASS_BEST_EFFORT : AA_TRAFFIC_CLASS_INPUT);
+    }
+    CHECK_EQ(scanner.frames, 2);
+}
+
+int main(void) {
+    RUN_TEST(test_channel_classes);
+    RUN_TEST(test_header_split_between_reads);
+    RUN_TEST(test_extended_first_fragment);
+    RUN_TEST(test_class_change_splits_read);
+    RUN_TEST(test_byte_at_a_time);
+    return 0;
+}
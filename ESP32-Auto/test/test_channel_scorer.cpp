@@ -0,0 +1,180 @@
+// Channel scorer: RSSI to load, overlap spread, skipped records, tie-breaking
+// towards 1/6/11 and the hysteresis that keeps the current channel
+
+#include <string.h>
+#include "host_test.h"
+#include "channel_scorer.h"
+
+// Every channel at the same load, then individual channels adjusted
+static void fill_scores(channel_scores_t *scores, uint32_t load) {
+    memset(scores, 0, sizeof(*scores));
+    for (int channel = CHANNEL_MIN; channel <= CHANNEL_MAX; channel++) {
+        scores->load[channel] = load;
+    }
+}
+
+static void test_rssi_sets_load(void) {
+    channel_scan_record_t records[] = { { 6, -30 } };
+    channel_scores_t scores;
+
+    // -30 dBm or stronger counts 71, times 100% on the primary
+    channel_scorer_score(records, 1, &scores);
+    CHECK_EQ(scores.load[6], 7100);
+    records[0].rssi = -10;
+    channel_scorer_score(records, 1, &scores);
+    CHECK_EQ(scores.load[6], 7100);
+
+    // Linear down to -100 dBm, which counts 1 like anything weaker
+    records[0].rssi = -65;
+    channel_scorer_score(records, 1, &scores);
+    CHECK_EQ(scores.load[6], 3600);
+    records[0].rssi = -100;
+    channel_scorer_score(records, 1, &scores);
+    CHECK_EQ(scores.load[6], 100);
+    records[0].rssi = -128;
+    channel_scorer_score(records, 1, &scores);
+    CHECK_EQ(scores.load[6], 100);
+}
+
+static void test_overlap_spreads_load(void) {
+    channel_scan_record_t records[] = { { 6, -30 } };
+    channel_scores_t scores;
+    channel_scorer_score(records, 1, &scores);
+
+    // 100, 70, 40, 20 and 5 percent at 0-4 channels, symmetric
+    const uint32_t expected[CHANNEL_MAX + 1] = { 0, 0, 355, 1420, 2840, 4970, 7100, 4970, 2840, 1420, 355, 0, 0, 0 };
+    for (int channel = CHANNEL_MIN; channel <= CHANNEL_MAX; channel++) {
+        CHECK_EQ(scores.load[channel], expected[channel]);
+    }
+    CHECK_EQ(scores.ap_count[6], 1);
+    CHECK_EQ(scores.records, 1);
+}
+
+static void test_overlap_clipped_at_band_edges(void) {
+    channel_scan_record_t records[] = { { 1, -30 }, { 13, -30 } };
+    channel_scores_t scores;
+    channel_scorer_score(records, 2, &scores);
+
+    CHECK_EQ(scores.load[1], 7100);
+    CHECK_EQ(scores.load[5], 355);
+    CHECK_EQ(scores.load[6], 0);
+    CHECK_EQ(scores.load[8], 0);
+    CHECK_EQ(scores.load[9], 355);
+    CHECK_EQ(scores.load[13], 7100);
+}
+
+static void test_loads_add_up(void) {
+    channel_scan_record_t records[] = { { 6, -30 }, { 6, -100 }, { 7, -65 } };
+    channel_scores_t scores;
+    channel_scorer_score(records, 3, &scores);
+
+    CHECK_EQ(scores.load[6], 7100 + 100 + 36 * 70);
+    CHECK_EQ(scores.load[7], 71 * 70 + 70 + 3600);
+    CHECK_EQ(scores.ap_count[6], 2);
+    CHECK_EQ(scores.ap_count[7], 1);
+    CHECK_EQ(scores.records, 3);
+}
+
+static void test_skips_out_of_band_records(void) {
+    channel_scan_record_t records[] = { { 0, -30 }, { 14, -30 }, { 36, -30 }, { 11, -50 } };
+    channel_scores_t scores;
+    channel_scorer_score(records, 4, &scores);
+
+    CHECK_EQ(scores.records, 1);
+    CHECK_EQ(scores.ap_count[11], 1);
+    CHECK_EQ(scores.load[1], 0);
+    CHECK_EQ(scores.load[13], 51 * 40);
+
+    // No table at all: every channel scores zero
+    channel_scorer_score(NULL, 4, &scores);
+    CHECK_EQ(scores.records, 0);
+    for (int channel = CHANNEL_MIN; channel <= CHANNEL_MAX; channel++) {
+        CHECK_EQ(scores.load[channel], 0);
+    }
+}
+
+static void test_picks_lowest_load(void) {
+    channel_scores_t scores;
+    fill_scores(&scores, 1000);
+    scores.load[4] = 300;
+    scores.load[9] = 200;
+    CHECK_EQ(channel_scorer_pick(&scores, 0, 20), 9);
+}
+
+static void test_tie_prefers_non_overlapping(void) {
+    channel_scores_t scores;
+
+    // Nothing heard: channel 1
+    fill_scores(&scores, 0);
+    CHECK_EQ(channel_scorer_pick(&scores, 0, 20), 1);
+
+    // 9-12 tie; 11 wins even though 9 and 10 come first
+    fill_scores(&scores, 1000);
+    scores.load[9] = scores.load[10] = scores.load[11] = scores.load[12] = 100;
+    CHECK_EQ(channel_scorer_pick(&scores, 0, 20), 11);
+
+    // Between two preferred channels the lower one wins
+    fill_scores(&scores, 1000);
+    scores.load[6] = scores.load[11] = 100;
+    CHECK_EQ(channel_scorer_pick(&scores, 0, 20), 6);
+
+    // The same from a real scan: APs on 1 and 6 leave 11-13 empty
+    channel_scan_record_t records[] = { { 1, -40 }, { 6, -40 } };
+    channel_scorer_score(records, 2, &scores);
+    CHECK_EQ(channel_scorer_pick(&scores, 0, 20), 11);
+}
+
+static void test_hysteresis_keeps_current(void) {
+    channel_scores_t scores;
+    fill_scores(&scores, 1000);
+
+    // 20%: channel 1 must be below 800 for the AP to leave channel 6
+    scores.load[1] = 850;
+    CHECK_EQ(channel_scorer_pick(&scores, 6, 20), 6);
+    scores.load[1] = 800;
+    CHECK_EQ(channel_scorer_pick(&scores, 6, 20), 6);
+    scores.load[1] = 799;
+    CHECK_EQ(channel_scorer_pick(&scores, 6, 20), 1);
+
+    // No hysteresis: any strictly lower load moves, a tie does not
+    scores.load[1] = 999;
+    CHECK_EQ(channel_scorer_pick(&scores, 6, 0), 1);
+    scores.load[1] = 1000;
+    CHECK_EQ(channel_scorer_pick(&scores, 6, 0), 6);
+
+    // Over 100% is capped: an empty channel is not enough to move
+    scores.load[1] = 0;
+    CHECK_EQ(channel_scorer_pick(&scores, 6, 100), 6);
+    CHECK_EQ(channel_scorer_pick(&scores, 6, 255), 6);
+
+    // Already on the best channel
+    CHECK_EQ(channel_scorer_pick(&scores, 1, 20), 1);
+}
+
+static void test_invalid_current_is_ignored(void) {
+    channel_scores_t scores;
+    fill_scores(&scores, 1000);
+    scores.load[11] = 900;
+
+    // Out of range: no hysteresis applies
+    CHECK_EQ(channel_scorer_pick(&scores, 0, 50), 11);
+    CHECK_EQ(channel_scorer_pick(&scores, 14, 50), 11);
+
+    // No scores: keep a valid channel, otherwise channel 1
+    CHECK_EQ(channel_scorer_pick(NULL, 6, 20), 6);
+    CHECK_EQ(channel_scorer_pick(NULL, 0, 20), 1);
+    CHECK_EQ(channel_scorer_pick(NULL, 36, 20), 1);
+}
+
+int main(void) {
+    RUN_TEST(test_rssi_sets_load);
+    RUN_TEST(test_overlap_spreads_load);
+    RUN_TEST(test_overlap_clipped_at_band_edges);
+    RUN_TEST(test_loads_add_up);
+    RUN_TEST(test_skips_out_of_band_records);
+    RUN_TEST(test_picks_lowest_load);
+    RUN_TEST(test_tie_prefers_non_overlapping);
+    RUN_TEST(test_hysteresis_keeps_current);
+    RUN_TEST(test_invalid_current_is_ignored);
+    return 0;
+}
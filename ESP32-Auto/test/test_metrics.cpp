@@ -0,0 +1,174 @@
+// Metrics: Prometheus text rendering of a snapshot, the latency histogram
+// with its sum, and the cut at a line boundary when the buffer is short
+
+#include <string.h>
+#include <string>
+#include "host_test.h"
+#include "metrics.h"
+#include "metrics_server.h"
+
+static char g_text[METRICS_BUFFER_SIZE];
+
+static metrics_snapshot_t sample_snapshot(void) {
+    metrics_snapshot_t snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.uptime_ms = 61234;
+    snapshot.proxy_active = true;
+    snapshot.client_connected = true;
+    snapshot.to_phone_bytes = 1000;
+    snapshot.to_car_bytes = 2000;
+    snapshot.chunk_size = 4096;
+    snapshot.poll_interval_ms = 5;
+    snapshot.stalls[STALL_STAGE_TCP_SEND] = 3;
+    snapshot.slo_breaches[1] = 2;
+
+    // 3 x 10 us and 1 ms to the phone
+    for (int i = 0; i < 3; i++) {
+        latency_histogram_record(&snapshot.to_phone_latency, 10);
+    }
+    latency_histogram_record(&snapshot.to_phone_latency, 1000);
+
+    snapshot.usb.event_polls = 7;
+    snapshot.usb.rx_packets = 42;
+    snapshot.usb.tx_fifo_full = 1;
+    snapshot.usb_connected = true;
+
+    snapshot.wifi_channel = 6;
+    snapshot.station_count = 1;
+    const uint8_t mac[6] = { 0x02, 0xab, 0x00, 0x10, 0x20, 0xff };
+    memcpy(snapshot.stations[0].mac, mac, sizeof(mac));
+    snapshot.stations[0].rssi = -55;
+    snapshot.stations[0].est_phy_rate_kbps = 72200;
+
+    snapshot.internal_free = 123456;
+    return snapshot;
+}
+
+static std::string render(const metrics_snapshot_t *snapshot) {
+    size_t length = 0;
+    CHECK_EQ(metrics_render(snapshot, g_text, sizeof(g_text), &length), STATUS_OK);
+    CHECK_EQ(strlen(g_text), length);
+    return std::string(g_text, length);
+}
+
+// A whole line of the text, prefix included
+static bool has_line(const std::string &text, const std::string &line) {
+    std::string full = METRICS_PREFIX + line;
+    return text.compare(0, full.size() + 1, full + "\n") == 0 ||
+           text.find("\n" + full + "\n") != std::string::npos;
+}
+
+static void test_values(void) {
+    metrics_snapshot_t snapshot = sample_snapshot();
+    std::string text = render(&snapshot);
+
+    CHECK(has_line(text, "uptime_seconds 61.234"));
+    CHECK(has_line(text, "proxy_active 1"));
+    CHECK(has_line(text, "proxy_bytes_total{direction=\"to_car\"} 2000"));
+    CHECK(has_line(text, "proxy_poll_interval_seconds 0.005"));
+    CHECK(has_line(text, "proxy_stalls_total{stage=\"tcp_send\"} 3"));
+    CHECK(has_line(text, "proxy_latency_slo_breaches_total{direction=\"to_car\"} 2"));
+    CHECK(has_line(text, "usb_events_total{event=\"any\"} 7"));
+    CHECK(has_line(text, "usb_fifo_total{event=\"rx_packet\"} 42"));
+    CHECK(has_line(text, "usb_fifo_total{event=\"tx_full\"} 1"));
+    CHECK(has_line(text, "wifi_station_rssi_dbm{mac=\"02:ab:00:10:20:ff\"} -55"));
+    CHECK(has_line(text, "wifi_station_phy_rate_bps{mac=\"02:ab:00:10:20:ff\"} 72200000"));
+    CHECK(has_line(text, "heap_free_bytes{region=\"internal\"} 123456"));
+}
+
+static void test_latency_histogram(void) {
+    metrics_snapshot_t snapshot = sample_snapshot();
+    std::string text = render(&snapshot);
+
+    CHECK(has_line(text, "proxy_latency_seconds_bucket{direction=\"to_phone\",le=\"0.000255\"} 3"));
+    CHECK(has_line(text, "proxy_latency_seconds_bucket{direction=\"to_phone\",le=\"0.000511\"} 3"));
+    CHECK(has_line(text, "proxy_latency_seconds_bucket{direction=\"to_phone\",le=\"0.001023\"} 4"));
+    CHECK(has_line(text, "proxy_latency_seconds_bucket{direction=\"to_phone\",le=\"0.131071\"} 4"));
+    CHECK(has_line(text, "proxy_latency_seconds_bucket{direction=\"to_phone\",le=\"+Inf\"} 4"));
+    CHECK(has_line(text, "proxy_latency_seconds_count{direction=\"to_phone\"} 4"));
+    CHECK(has_line(text, "proxy_latency_seconds_sum{direction=\"to_phone\"} 0.001030"));
+
+    // Empty, and a sum past a second
+    CHECK(has_line(text, "proxy_latency_seconds_count{direction=\"to_car\"} 0"));
+    CHECK(has_line(text, "proxy_latency_seconds_sum{direction=\"to_car\"} 0.000000"));
+    latency_histogram_record(&snapshot.to_car_latency, 2500000);
+    latency_histogram_record(&snapshot.to_car_latency, 7);
+    text = render(&snapshot);
+    CHECK(has_line(text, "proxy_latency_seconds_sum{direction=\"to_car\"} 2.500007"));
+    CHECK(has_line(text, "proxy_latency_seconds_bucket{direction=\"to_car\",le=\"0.131071\"} 1"));
+    CHECK(has_line(text, "proxy_latency_seconds_bucket{direction=\"to_car\",le=\"+Inf\"} 2"));
+}
+
+static void test_every_sample_has_a_family(void) {
+    metrics_snapshot_t snapshot = sample_snapshot();
+    std::string text = render(&snapshot);
+    std::string family;
+    size_t start = 0;
+    int samples = 0;
+
+    CHECK(!text.empty() && text.back() == '\n');
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+
+        if (line.compare(0, 7, "# HELP ") == 0) {
+            family = line.substr(7, line.find(' ', 7) - 7);
+            CHECK(family.compare(0, strlen(METRICS_PREFIX), METRICS_PREFIX) == 0);
+            continue;
+        }
+        if (line.compare(0, 7, "# TYPE ") == 0) {
+            CHECK(line.compare(7, family.size() + 1, family + " ") == 0);
+            continue;
+        }
+
+        // Samples belong to the family just declared; histograms add suffixes
+        std::string name = line.substr(0, line.find_first_of("{ "));
+        CHECK(name == family || name == family + "_bucket" || name == family + "_count" ||
+              name == family + "_sum");
+        samples++;
+    }
+    CHECK(samples > 50);
+}
+
+static void test_station_count_clamped(void) {
+    metrics_snapshot_t snapshot = sample_snapshot();
+    snapshot.station_count = WIFI_HOTSPOT_MAX_STATIONS + 3;
+    std::string text = render(&snapshot);
+
+    char line[64];
+    snprintf(line, sizeof(line), "wifi_stations %d", WIFI_HOTSPOT_MAX_STATIONS);
+    CHECK(has_line(text, line));
+}
+
+static void test_overflow_cuts_at_line(void) {
+    metrics_snapshot_t snapshot = sample_snapshot();
+    size_t full = render(&snapshot).size();
+
+    for (size_t capacity = 1; capacity < full; capacity += 97) {
+        char buffer[METRICS_BUFFER_SIZE];
+        size_t length = 12345;
+        CHECK_EQ(metrics_render(&snapshot, buffer, capacity, &length), STATUS_ERROR_MEMORY);
+        CHECK(length < capacity);
+        CHECK_EQ(strlen(buffer), length);
+        CHECK(length == 0 || buffer[length - 1] == '\n');
+        CHECK(memcmp(buffer, g_text, length) == 0);
+    }
+
+    size_t length = 0;
+    char buffer[METRICS_BUFFER_SIZE];
+    CHECK_EQ(metrics_render(&snapshot, buffer, full + 1, &length), STATUS_OK);
+    CHECK_EQ(length, full);
+    CHECK_EQ(metrics_render(NULL, buffer, sizeof(buffer), &length), STATUS_ERROR_MEMORY);
+    CHECK_EQ(metrics_render(&snapshot, NULL, sizeof(buffer), &length), STATUS_ERROR_MEMORY);
+    CHECK_EQ(metrics_render(&snapshot, buffer, 0, &length), STATUS_ERROR_MEMORY);
+}
+
+int main(void) {
+    RUN_TEST(test_values);
+    RUN_TEST(test_latency_histogram);
+    RUN_TEST(test_every_sample_has_a_family);
+    RUN_TEST(test_station_count_clamped);
+    RUN_TEST(test_overflow_cuts_at_line);
+    return 0;
+}
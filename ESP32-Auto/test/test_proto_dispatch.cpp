@@ -0,0 +1,254 @@
+// Dispatch registry: decoding into the session arena, handler lookup,
+// the heartbeat fast path, the invalid-message counters and the arena's
+// entry in the memory plan
+
+#include <string.h>
+#include "host_test.h"
+#include "mem_plan.h"
+#include "proto_handler.h"
+#include "proto_stream.h"
+
+#define REPLY_MAX 64
+
+typedef struct {
+    int calls;
+    int status;
+    void *ctx;
+    size_t arena_used;              // Session arena in use during the call
+} handler_record_t;
+
+static handler_record_t g_status_record;
+static uint8_t g_reply[REPLY_MAX];
+static size_t g_reply_size;
+static int g_replies;
+
+static status_t on_status(const AndroidAutoMessage *message, void *ctx) {
+    g_status_record.calls++;
+    g_status_record.status = message->connection_status;
+    g_status_record.ctx = ctx;
+    g_status_record.arena_used = proto_get_session_arena()->used;
+    return STATUS_OK;
+}
+
+static status_t on_failing(const AndroidAutoMessage *message, void *ctx) {
+    (void)message;
+    (void)ctx;
+    return STATUS_ERROR_CONNECTION;
+}
+
+static status_t reply_sink(const uint8_t *data, size_t size, void *ctx) {
+    (void)ctx;
+    CHECK(size <= sizeof(g_reply));
+    memcpy(g_reply, data, size);
+    g_reply_size = size;
+    g_replies++;
+    return STATUS_OK;
+}
+
+static size_t encode(const AndroidAutoMessage *message, uint8_t *buffer, size_t capacity) {
+    size_t size = 0;
+    CHECK_EQ(proto_encode(message, buffer, capacity, &size), STATUS_OK);
+    return size;
+}
+
+static size_t encode_status(int status, uint8_t *buffer, size_t capacity) {
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_CONNECTION_STATUS);
+    proto_set_connection_status(&message, status);
+    return encode(&message, buffer, capacity);
+}
+
+static void test_requires_init(void) {
+    uint8_t buffer[32];
+    size_t size = encode_status(PROTO_CONNECTION_STATUS_CONNECTED, buffer, sizeof(buffer));
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_ERROR_INIT);
+    CHECK_EQ(proto_init(), STATUS_OK);
+}
+
+static void test_registered_handler_runs(void) {
+    int ctx;
+    uint8_t buffer[32];
+    memset(&g_status_record, 0, sizeof(g_status_record));
+    CHECK_EQ(proto_register_handler(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, on_status, &ctx), STATUS_OK);
+
+    size_t size = encode_status(PROTO_CONNECTION_STATUS_CONNECTING, buffer, sizeof(buffer));
+    size_t before = proto_get_session_arena()->used;
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_OK);
+
+    CHECK_EQ(g_status_record.calls, 1);
+    CHECK_EQ(g_status_record.status, PROTO_CONNECTION_STATUS_CONNECTING);
+    CHECK(g_status_record.ctx == &ctx);
+
+    // Decoded into the arena for the call, released afterwards
+    CHECK(g_status_record.arena_used > before);
+    CHECK_EQ(proto_get_session_arena()->used, before);
+
+    proto_dispatch_stats_t stats;
+    CHECK_EQ(proto_get_dispatch_stats(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, &stats), STATUS_OK);
+    CHECK_EQ(stats.received, 1);
+    CHECK_EQ(stats.handled, 1);
+}
+
+static void test_handler_error_is_returned(void) {
+    uint8_t buffer[32];
+    CHECK_EQ(proto_register_handler(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, on_failing, NULL), STATUS_OK);
+
+    size_t size = encode_status(PROTO_CONNECTION_STATUS_ERROR, buffer, sizeof(buffer));
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_ERROR_CONNECTION);
+
+    proto_dispatch_stats_t stats;
+    proto_get_dispatch_stats(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, &stats);
+    CHECK_EQ(stats.errors, 1);
+    proto_register_handler(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, on_status, NULL);
+}
+
+static void test_unhandled_type_is_counted(void) {
+    uint8_t buffer[64];
+    WifiStartRequest request;
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_UNKNOWN);
+    proto_init_wifi_start_request(&request, "192.168.4.1", 5288);
+    proto_set_wifi_start_request(&message, &request);
+
+    size_t size = encode(&message, buffer, sizeof(buffer));
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_OK);
+
+    proto_dispatch_stats_t stats;
+    proto_get_dispatch_stats(PROTO_MESSAGE_TYPE_WIFI_START_REQUEST, &stats);
+    CHECK_EQ(stats.received, 1);
+    CHECK_EQ(stats.unhandled, 1);
+}
+
+static void test_heartbeat_answered_framed(void) {
+    uint8_t buffer[32];
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_HEARTBEAT);
+    size_t size = encode(&message, buffer, sizeof(buffer));
+
+    // No sink: nothing to answer through, still not an error
+    g_replies = 0;
+    proto_set_reply_sink(NULL, NULL);
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_OK);
+    CHECK_EQ(g_replies, 0);
+
+    proto_set_reply_sink(reply_sink, NULL);
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_OK);
+    CHECK_EQ(g_replies, 1);
+
+    // One-byte length prefix, then a heartbeat
+    CHECK_EQ(g_reply[0], g_reply_size - 1);
+    AndroidAutoMessage reply;
+    CHECK_EQ(proto_decode(g_reply + 1, g_reply_size - 1, &reply), STATUS_OK);
+    CHECK_EQ(reply.type, PROTO_MESSAGE_TYPE_HEARTBEAT);
+    proto_set_reply_sink(NULL, NULL);
+}
+
+static void test_invalid_input_is_counted(void) {
+    uint32_t invalid = proto_get_invalid_count();
+    size_t used = proto_get_session_arena()->used;
+
+    // Undecodable: a length-delimited field running past the end
+    const uint8_t garbage[] = { 0x1A, 0x7F, 0x01 };
+    CHECK_EQ(proto_dispatch(garbage, sizeof(garbage)), STATUS_ERROR_PROTOCOL);
+    CHECK_EQ(proto_get_invalid_count(), invalid + 1);
+
+    // Decodable, but the type is out of range
+    uint8_t buffer[32];
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_COUNT + 3);
+    size_t size = encode(&message, buffer, sizeof(buffer));
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_ERROR_PROTOCOL);
+
+    // The type names a payload that is missing
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_DEVICE_INFO);
+    size = encode(&message, buffer, sizeof(buffer));
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_ERROR_PROTOCOL);
+
+    CHECK_EQ(proto_get_invalid_count(), invalid + 3);
+    CHECK_EQ(proto_get_session_arena()->used, used);
+}
+
+static void test_stream_callback_dispatches(void) {
+    uint8_t rx[64];
+    proto_stream_t stream;
+    CHECK_EQ(proto_stream_init(&stream, rx, sizeof(rx), proto_dispatch_stream_cb, NULL), STATUS_OK);
+
+    // Two framed status messages and a bad one between them, fed byte by byte
+    uint8_t wire[96];
+    size_t size = 0, n;
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_CONNECTION_STATUS);
+    proto_set_connection_status(&message, PROTO_CONNECTION_STATUS_CONNECTING);
+    CHECK_EQ(proto_stream_encode(&message, wire, sizeof(wire), &n), STATUS_OK);
+    size += n;
+    wire[size++] = 2;
+    wire[size++] = 0x1A;
+    wire[size++] = 0x7F;
+    proto_set_connection_status(&message, PROTO_CONNECTION_STATUS_CONNECTED);
+    CHECK_EQ(proto_stream_encode(&message, wire + size, sizeof(wire) - size, &n), STATUS_OK);
+    size += n;
+
+    memset(&g_status_record, 0, sizeof(g_status_record));
+    for (size_t i = 0; i < size; i++) {
+        CHECK_EQ(proto_stream_feed(&stream, wire + i, 1), STATUS_OK);
+    }
+    CHECK_EQ(g_status_record.calls, 2);
+    CHECK_EQ(g_status_record.status, PROTO_CONNECTION_STATUS_CONNECTED);
+}
+
+static const mem_region_t* find_region(const char *name, int *matches) {
+    const mem_region_t *found = NULL;
+    *matches = 0;
+    for (int i = 0; i < mem_plan_region_count(); i++) {
+        const mem_region_t *region = mem_plan_get_region(i);
+        if (strcmp(region->name, name) == 0) {
+            found = region;
+            (*matches)++;
+        }
+    }
+    return found;
+}
+
+static void test_arena_in_mem_plan(void) {
+    // Registered once, however often proto_init() runs
+    CHECK_EQ(proto_init(), STATUS_OK);
+    int matches;
+    const mem_region_t *region = find_region("proto_arena", &matches);
+    CHECK(region != NULL);
+    CHECK_EQ(matches, 1);
+
+    proto_arena_t *arena = proto_get_session_arena();
+    CHECK_EQ(region->kind, MEM_KIND_INTERNAL);
+    CHECK(region->base == arena->base);
+    CHECK_EQ(region->size, PROTO_ARENA_SESSION_SIZE);
+    CHECK(region->high_water != NULL);
+    CHECK_EQ(mem_plan_region_high_water(region), 0);
+
+    // The high water is the arena's peak: it follows a dispatch and
+    // survives the rewind after it and the session reset
+    uint8_t buffer[32];
+    size_t size = encode_status(PROTO_CONNECTION_STATUS_CONNECTED, buffer, sizeof(buffer));
+    proto_register_handler(PROTO_MESSAGE_TYPE_CONNECTION_STATUS, on_status, NULL);
+    CHECK_EQ(proto_dispatch(buffer, size), STATUS_OK);
+    CHECK_EQ(arena->used, 0);
+
+    size_t high = mem_plan_region_high_water(region);
+    CHECK(high > 0);
+    CHECK_EQ(high, arena->stats.peak);
+    CHECK(high <= region->size);
+
+    proto_session_reset();
+    CHECK_EQ(mem_plan_region_high_water(region), high);
+}
+
+int main(void) {
+    RUN_TEST(test_requires_init);
+    RUN_TEST(test_registered_handler_runs);
+    RUN_TEST(test_handler_error_is_returned);
+    RUN_TEST(test_unhandled_type_is_counted);
+    RUN_TEST(test_heartbeat_answered_framed);
+    RUN_TEST(test_invalid_input_is_counted);
+    RUN_TEST(test_stream_callback_dispatches);
+    RUN_TEST(test_arena_in_mem_plan);
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Proxy tuner: read size grows under backlog and shrinks over the latency
+// target only after PROXY_TUNER_STREAK agreeing windows, the poll interval
+// drops at once on backlog and relaxes one step per idle window
+
+#include <string.h>
+#include "host_test.h"
+#include "proxy_tuner.h"
+
+static const proxy_tuner_limits_t g_limits = { 512, 8192, 1, 5, 20000 };
+
+static proxy_tuner_metrics_t window(uint32_t reads, uint32_t full_reads, uint32_t p99_us) {
+    proxy_tuner_metrics_t metrics = { 5000, reads, full_reads, reads * 1024, p99_us };
+    return metrics;
+}
+
+// Half the reads full is backlog, a tenth is not
+static const proxy_tuner_metrics_t g_backlog = window(1000, 600, 8000);
+static const proxy_tuner_metrics_t g_slow = window(1000, 100, 30000);
+static const proxy_tuner_metrics_t g_steady = window(1000, 300, 8000);
+static const proxy_tuner_metrics_t g_idle = window(0, 0, 0);
+
+static proxy_tuner_action_t step(proxy_tuner_state_t *state, const proxy_tuner_metrics_t *metrics) {
+    return proxy_tuner_step(state, &g_limits, metrics);
+}
+
+static void test_init_clamps(void) {
+    proxy_tuner_state_t state;
+    proxy_tuner_init(&state, &g_limits, 100, 50);
+    CHECK_EQ(state.chunk_size, 512);
+    CHECK_EQ(state.poll_interval_ms, 5);
+    CHECK_EQ(state.streak, 0);
+
+    proxy_tuner_init(&state, &g_limits, 65536, 0);
+    CHECK_EQ(state.chunk_size, 8192);
+    CHECK_EQ(state.poll_interval_ms, 1);
+}
+
+static void test_backlog_polls_faster_then_grows(void) {
+    proxy_tuner_state_t state;
+    proxy_tuner_init(&state, &g_limits, 2048, 5);
+
+    // The poll interval halves at once; the read size waits for a streak
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_FASTER);
+    CHECK_EQ(state.poll_interval_ms, 2);
+    CHECK_EQ(state.chunk_size, 2048);
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_GROW);
+    CHECK_EQ(state.poll_interval_ms, 1);
+    CHECK_EQ(state.chunk_size, 4096);
+
+    // Streak starts over after a step
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_HOLD);
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_GROW);
+    CHECK_EQ(state.chunk_size, 8192);
+
+    // At the limit a full streak changes nothing
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_HOLD);
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.chunk_size, 8192);
+    CHECK_EQ(state.streak, 0);
+}
+
+static void test_backlog_over_target_does_not_grow(void) {
+    proxy_tuner_state_t state;
+    proxy_tuner_init(&state, &g_limits, 2048, 1);
+    proxy_tuner_metrics_t late_backlog = window(1000, 900, 25000);
+
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(step(&state, &late_backlog), PROXY_TUNER_HOLD);
+    }
+    CHECK_EQ(state.chunk_size, 2048);
+}
+
+static void test_over_target_shrinks(void) {
+    proxy_tuner_state_t state;
+    proxy_tuner_init(&state, &g_limits, 2048, 1);
+
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.streak, -1);
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_SHRINK);
+    CHECK_EQ(state.chunk_size, 1024);
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_HOLD);
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_SHRINK);
+    CHECK_EQ(state.chunk_size, 512);
+
+    // Never below the minimum
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_HOLD);
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.chunk_size, 512);
+}
+
+static void test_streak_needs_agreeing_windows(void) {
+    proxy_tuner_state_t state;
+    proxy_tuner_init(&state, &g_limits, 2048, 1);
+
+    // A window in between resets the count
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_HOLD);
+    CHECK_EQ(step(&state, &g_steady), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.streak, 0);
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.chunk_size, 2048);
+
+    // So does the opposite direction
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.streak, -1);
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.streak, 1);
+    CHECK_EQ(state.chunk_size, 2048);
+
+    // And an idle window
+    CHECK_EQ(step(&state, &g_idle), PROXY_TUNER_RELAX);
+    CHECK_EQ(state.streak, 0);
+
+    // Over target with some full reads is neither direction
+    proxy_tuner_metrics_t mixed = window(1000, 350, 30000);
+    CHECK_EQ(step(&state, &g_slow), PROXY_TUNER_HOLD);
+    CHECK_EQ(step(&state, &mixed), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.streak, 0);
+    CHECK_EQ(state.chunk_size, 2048);
+}
+
+static void test_idle_relaxes_poll(void) {
+    proxy_tuner_state_t state;
+    proxy_tuner_init(&state, &g_limits, 2048, 5);
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_FASTER);
+    CHECK_EQ(step(&state, &g_backlog), PROXY_TUNER_GROW);
+    CHECK_EQ(state.poll_interval_ms, 1);
+
+    // One millisecond per idle window, up to the configured interval
+    for (uint32_t poll = 2; poll <= 5; poll++) {
+        CHECK_EQ(step(&state, &g_idle), PROXY_TUNER_RELAX);
+        CHECK_EQ(state.poll_interval_ms, poll);
+    }
+    CHECK_EQ(step(&state, &g_idle), PROXY_TUNER_HOLD);
+    CHECK_EQ(state.poll_interval_ms, 5);
+
+    // The read size is left alone
+    CHECK_EQ(state.chunk_size, 4096);
+}
+
+static void test_full_reads_clamped(void) {
+    proxy_tuner_state_t state;
+    proxy_tuner_init(&state, &g_limits, 2048, 1);
+
+    // More full reads than reads (counters sampled apart) counts as 100%
+    proxy_tuner_metrics_t odd = window(10, 50, 1000);
+    CHECK_EQ(step(&state, &odd), PROXY_TUNER_HOLD);
+    CHECK_EQ(step(&state, &odd), PROXY_TUNER_GROW);
+
+    CHECK_EQ(proxy_tuner_step(NULL, &g_limits, &odd), PROXY_TUNER_HOLD);
+    CHECK_EQ(proxy_tuner_step(&state, &g_limits, NULL), PROXY_TUNER_HOLD);
+}
+
+static void test_action_names(void) {
+    // tools/tuner_replay.cpp matches these against the log
+    CHECK(strcmp(proxy_tuner_action_name(PROXY_TUNER_GROW), "grow") == 0);
+    CHECK(strcmp(proxy_tuner_action_name(PROXY_TUNER_RELAX), "relax") == 0);
+    CHECK(strcmp(proxy_tuner_action_name((proxy_tuner_action_t)99), "unknown") == 0);
+}
+
+int main(void) {
+    RUN_TEST(test_init_clamps);
+    RUN_TEST(test_backlog_polls_faster_then_grows);
+    RUN_TEST(test_backlog_over_target_does_not_grow);
+    RUN_TEST(test_over_target_shrinks);
+    RUN_TEST(test_streak_needs_agreeing_windows);
+    RUN_TEST(test_idle_relaxes_poll);
+    RUN_TEST(test_full_reads_clamped);
+    RUN_TEST(test_action_names);
+    return 0;
+}
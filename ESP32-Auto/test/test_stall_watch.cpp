@@ -0,0 +1,115 @@
+// Stall watch: thresholds per stage, one report per stall, back-pressure
+// from the write after a read, and the wrapping millisecond clock
+
+#include <string.h>
+#include "host_test.h"
+#include "stall_watch.h"
+
+static const uint32_t g_thresholds[STALL_STAGE_COUNT] = { 500, 1000, 500, 500 };
+
+#define BIT(stage) (1u << (stage))
+
+static void test_idle_never_stalls(void) {
+    stall_watch_t watch;
+    stall_watch_init(&watch, 0);
+
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 0), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 100000), 0);
+}
+
+static void test_threshold_per_stage(void) {
+    stall_watch_t watch;
+    stall_watch_init(&watch, 0);
+    stall_watch_pending(&watch, STALL_STAGE_USB_WRITE, 64, 1000);
+    stall_watch_pending(&watch, STALL_STAGE_TCP_SEND, 64, 1000);
+
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 1499), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 1500), BIT(STALL_STAGE_USB_WRITE));
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 1999), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 2000), BIT(STALL_STAGE_TCP_SEND));
+}
+
+static void test_reported_once_until_progress(void) {
+    stall_watch_t watch;
+    stall_watch_init(&watch, 0);
+    stall_watch_pending(&watch, STALL_STAGE_USB_WRITE, 64, 0);
+
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 600), BIT(STALL_STAGE_USB_WRITE));
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 5000), 0);
+    CHECK(watch.stages[STALL_STAGE_USB_WRITE].stalled);
+
+    // Progress clears it; the next wait is timed from its own start
+    stall_watch_progress(&watch, STALL_STAGE_USB_WRITE, 6000);
+    CHECK(!watch.stages[STALL_STAGE_USB_WRITE].stalled);
+    stall_watch_pending(&watch, STALL_STAGE_USB_WRITE, 64, 7000);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 7499), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 7500), BIT(STALL_STAGE_USB_WRITE));
+}
+
+static void test_more_bytes_keep_the_wait(void) {
+    stall_watch_t watch;
+    stall_watch_init(&watch, 0);
+
+    // Growing the backlog is not progress
+    stall_watch_pending(&watch, STALL_STAGE_TCP_RECV, 100, 0);
+    stall_watch_pending(&watch, STALL_STAGE_TCP_RECV, 300, 400);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 500), BIT(STALL_STAGE_TCP_RECV));
+    CHECK_EQ(watch.stages[STALL_STAGE_TCP_RECV].pending, 300);
+
+    // Drained to zero and waiting again starts a new wait
+    stall_watch_pending(&watch, STALL_STAGE_USB_READ, 10, 1000);
+    stall_watch_pending(&watch, STALL_STAGE_USB_READ, 0, 1200);
+    stall_watch_pending(&watch, STALL_STAGE_USB_READ, 10, 1400);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 1800), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 1900), BIT(STALL_STAGE_USB_READ));
+}
+
+static void test_back_pressure_is_not_a_stall(void) {
+    stall_watch_t watch;
+    stall_watch_init(&watch, 0);
+
+    // The TCP read waits behind a USB write: only the write stalls
+    stall_watch_pending(&watch, STALL_STAGE_TCP_RECV, 2000, 0);
+    stall_watch_pending(&watch, STALL_STAGE_USB_WRITE, 512, 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 800), BIT(STALL_STAGE_USB_WRITE));
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 3000), 0);
+
+    // Once the write moves on, the read's clock starts from the last check
+    stall_watch_progress(&watch, STALL_STAGE_USB_WRITE, 3100);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 3499), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 3500), BIT(STALL_STAGE_TCP_RECV));
+
+    // Same for the other direction
+    stall_watch_pending(&watch, STALL_STAGE_USB_READ, 64, 4000);
+    stall_watch_pending(&watch, STALL_STAGE_TCP_SEND, 64, 4000);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 4900), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, 5000), BIT(STALL_STAGE_TCP_SEND));
+}
+
+static void test_clock_wraps(void) {
+    stall_watch_t watch;
+    uint32_t start = UINT32_MAX - 100;
+    stall_watch_init(&watch, start);
+    stall_watch_pending(&watch, STALL_STAGE_USB_WRITE, 64, start);
+
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, start + 499), 0);
+    CHECK_EQ(stall_watch_check(&watch, g_thresholds, start + 500), BIT(STALL_STAGE_USB_WRITE));
+}
+
+static void test_stage_names(void) {
+    // Metric labels and log lines use these
+    CHECK(strcmp(stall_stage_name(STALL_STAGE_USB_READ), "usb_read") == 0);
+    CHECK(strcmp(stall_stage_name(STALL_STAGE_TCP_SEND), "tcp_send") == 0);
+    CHECK(strcmp(stall_stage_name(STALL_STAGE_COUNT), "unknown") == 0);
+}
+
+int main(void) {
+    RUN_TEST(test_idle_never_stalls);
+    RUN_TEST(test_threshold_per_stage);
+    RUN_TEST(test_reported_once_until_progress);
+    RUN_TEST(test_more_bytes_keep_the_wait);
+    RUN_TEST(test_back_pressure_is_not_a_stall);
+    RUN_TEST(test_clock_wraps);
+    RUN_TEST(test_stage_names);
+    return 0;
+}
@@ -0,0 +1,215 @@
+// Telemetry: latency histogram bucket edges and percentiles, and the
+// 28-byte little-endian record the phone decodes
+
+#include <string.h>
+#include "host_test.h"
+#include "telemetry.h"
+
+// Upper bound of the bucket a single sample lands in
+static uint32_t bucket_upper(uint32_t latency_us) {
+    latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    latency_histogram_record(&histogram, latency_us);
+    return latency_histogram_percentile(&histogram, 50);
+}
+
+static void test_small_values_exact(void) {
+    for (uint32_t us = 0; us < 8; us++) {
+        CHECK_EQ(bucket_upper(us), us);
+    }
+}
+
+static void test_bucket_edges(void) {
+    // 4 sub-buckets per power of two: 8-9, 10-11, 12-13, 14-15, 16-19, ...
+    CHECK_EQ(bucket_upper(8), 9);
+    CHECK_EQ(bucket_upper(9), 9);
+    CHECK_EQ(bucket_upper(10), 11);
+    CHECK_EQ(bucket_upper(15), 15);
+    CHECK_EQ(bucket_upper(16), 19);
+    CHECK_EQ(bucket_upper(1000), 1023);
+    CHECK_EQ(bucket_upper(1024), 1279);
+
+    // Every power of two starts a bucket, so the one below ends one
+    for (int bit = 3; bit < 24; bit++) {
+        uint32_t power = 1u << bit;
+        CHECK_EQ(bucket_upper(power - 1), power - 1);
+        CHECK_EQ(bucket_upper(power), power + (power >> 2) - 1);
+    }
+}
+
+static void test_bounds_within_a_quarter(void) {
+    // The bucket bound never undershoots, stays within 25% and never
+    // decreases as the latency grows
+    uint32_t previous = 0;
+    for (uint32_t us = 1; us <= (1u << 17); us++) {
+        uint32_t upper = bucket_upper(us);
+        CHECK(upper >= us);
+        CHECK((uint64_t)upper * 4 < (uint64_t)us * 5 + 4);
+        CHECK(upper >= previous);
+        previous = upper;
+    }
+}
+
+static void test_saturates_at_max(void) {
+    CHECK_EQ(bucket_upper(TELEMETRY_LATENCY_MAX_US), TELEMETRY_LATENCY_MAX_US);
+    CHECK_EQ(bucket_upper(TELEMETRY_LATENCY_MAX_US + 1), TELEMETRY_LATENCY_MAX_US);
+    CHECK_EQ(bucket_upper(UINT32_MAX), TELEMETRY_LATENCY_MAX_US);
+
+    // The largest latency lands in the last bucket
+    latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    latency_histogram_record(&histogram, UINT32_MAX);
+    CHECK_EQ(histogram.buckets[TELEMETRY_LATENCY_BUCKETS - 1], 1);
+    CHECK_EQ(histogram.count, 1);
+}
+
+static void test_percentiles(void) {
+    latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    CHECK_EQ(latency_histogram_percentile(&histogram, 50), 0);
+
+    for (int i = 0; i < 90; i++) {
+        latency_histogram_record(&histogram, 10);
+    }
+    for (int i = 0; i < 9; i++) {
+        latency_histogram_record(&histogram, 1000);
+    }
+    latency_histogram_record(&histogram, 40000);
+
+    CHECK_EQ(latency_histogram_percentile(&histogram, 0), 11);
+    CHECK_EQ(latency_histogram_percentile(&histogram, 50), 11);
+    CHECK_EQ(latency_histogram_percentile(&histogram, 90), 11);
+    CHECK_EQ(latency_histogram_percentile(&histogram, 91), 1023);
+    CHECK_EQ(latency_histogram_percentile(&histogram, 99), 1023);
+    CHECK_EQ(latency_histogram_percentile(&histogram, 100), 40959);
+    CHECK_EQ(latency_histogram_percentile(&histogram, 250), 40959);
+}
+
+static void test_count_le(void) {
+    latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+    latency_histogram_record(&histogram, 9);
+    latency_histogram_record(&histogram, 10);
+    latency_histogram_record(&histogram, 1023);
+    latency_histogram_record(&histogram, 1024);
+
+    // Exact on power-of-two bounds
+    CHECK_EQ(latency_histogram_count_le(&histogram, 15), 2);
+    CHECK_EQ(latency_histogram_count_le(&histogram, 1023), 3);
+    CHECK_EQ(latency_histogram_count_le(&histogram, TELEMETRY_LATENCY_MAX_US), 4);
+
+    // Otherwise only buckets wholly below count: 10 shares 10-11
+    CHECK_EQ(latency_histogram_count_le(&histogram, 10), 1);
+    CHECK_EQ(latency_histogram_count_le(&histogram, 8), 0);
+}
+
+static void test_delta_is_a_window(void) {
+    latency_histogram_t before, now, delta;
+    memset(&now, 0, sizeof(now));
+    latency_histogram_record(&now, 5000);
+    before = now;
+    latency_histogram_record(&now, 20);
+    latency_histogram_record(&now, 20);
+
+    latency_histogram_delta(&now, &before, &delta);
+    CHECK_EQ(delta.count, 2);
+    CHECK_EQ(delta.sum_us, 40);
+    CHECK_EQ(now.sum_us, 5040);
+    CHECK_EQ(latency_histogram_percentile(&delta, 100), 23);
+}
+
+static telemetry_record_t sample_record(void) {
+    telemetry_record_t record;
+    record.conn_state = 3;
+    record.sequence = 0x1234;
+    record.uptime_ms = 0x89ABCDEF;
+    record.to_phone_kbps = 0x0102;
+    record.to_car_kbps = 0x0304;
+    record.to_phone_us[0] = 0x1112;
+    record.to_phone_us[1] = 0x1314;
+    record.to_phone_us[2] = 0x1516;
+    record.to_car_us[0] = 0x2122;
+    record.to_car_us[1] = 0x2324;
+    record.to_car_us[2] = 0xFFFF;
+    record.rssi = -67;
+    record.adv_mode = 2;
+    record.dropped = 0x0809;
+    return record;
+}
+
+static void test_record_layout(void) {
+    telemetry_record_t record = sample_record();
+    uint8_t out[TELEMETRY_RECORD_SIZE + 1];
+    memset(out, 0xEE, sizeof(out));
+    telemetry_record_pack(&record, out);
+
+    // Byte for byte as documented in telemetry.h
+    const uint8_t expected[TELEMETRY_RECORD_SIZE] = {
+        TELEMETRY_RECORD_VERSION, 3, 0x34, 0x12, 0xEF, 0xCD, 0xAB, 0x89,
+        0x02, 0x01, 0x04, 0x03,
+        0x12, 0x11, 0x14, 0x13, 0x16, 0x15,
+        0x22, 0x21, 0x24, 0x23, 0xFF, 0xFF,
+        (uint8_t)-67, 2, 0x09, 0x08
+    };
+    CHECK_EQ(TELEMETRY_RECORD_SIZE, 28);
+    CHECK(memcmp(out, expected, TELEMETRY_RECORD_SIZE) == 0);
+    CHECK_EQ(out[TELEMETRY_RECORD_SIZE], 0xEE);
+}
+
+static void test_record_round_trip(void) {
+    telemetry_record_t record = sample_record();
+    telemetry_record_t decoded;
+    uint8_t out[TELEMETRY_RECORD_SIZE];
+    telemetry_record_pack(&record, out);
+
+    memset(&decoded, 0, sizeof(decoded));
+    CHECK_EQ(telemetry_record_unpack(out, sizeof(out), &decoded), STATUS_OK);
+    CHECK_EQ(decoded.sequence, record.sequence);
+    CHECK_EQ(decoded.uptime_ms, record.uptime_ms);
+    CHECK_EQ(decoded.to_car_us[2], 0xFFFF);
+    CHECK_EQ(decoded.rssi, -67);
+    CHECK_EQ(decoded.dropped, record.dropped);
+    CHECK(memcmp(decoded.to_phone_us, record.to_phone_us, sizeof(record.to_phone_us)) == 0);
+
+    // Short or from another version
+    CHECK_EQ(telemetry_record_unpack(out, sizeof(out) - 1, &decoded), STATUS_ERROR_PROTOCOL);
+    out[0] = TELEMETRY_RECORD_VERSION + 1;
+    CHECK_EQ(telemetry_record_unpack(out, sizeof(out), &decoded), STATUS_ERROR_PROTOCOL);
+    CHECK_EQ(telemetry_record_unpack(NULL, sizeof(out), &decoded), STATUS_ERROR_PROTOCOL);
+}
+
+static void test_queue_packs_whole_records(void) {
+    telemetry_queue_t queue;
+    telemetry_record_t record = sample_record();
+    uint8_t payload[100];
+    telemetry_queue_init(&queue);
+
+    for (uint16_t i = 0; i < 4; i++) {
+        record.sequence = i;
+        telemetry_queue_push(&queue, &record, 0);
+    }
+
+    // A 100-byte payload holds three records; the fourth waits
+    CHECK(telemetry_queue_due(&queue, sizeof(payload), 0));
+    size_t size = telemetry_queue_peek(&queue, payload, sizeof(payload));
+    CHECK_EQ(size, 3 * TELEMETRY_RECORD_SIZE);
+    CHECK_EQ(payload[2 * TELEMETRY_RECORD_SIZE + 2], 2);
+    telemetry_queue_commit(&queue, size, 1000);
+    CHECK_EQ(queue.count, 1);
+    CHECK(!telemetry_queue_due(&queue, sizeof(payload), 1000));
+    CHECK(telemetry_queue_due(&queue, sizeof(payload), 1000 + TELEMETRY_DEFAULT_FLUSH_MS * 1000));
+}
+
+int main(void) {
+    RUN_TEST(test_small_values_exact);
+    RUN_TEST(test_bucket_edges);
+    RUN_TEST(test_bounds_within_a_quarter);
+    RUN_TEST(test_saturates_at_max);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_count_le);
+    RUN_TEST(test_delta_is_a_window);
+    RUN_TEST(test_record_layout);
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_queue_packs_whole_records);
+    return 0;
+}
@@ -0,0 +1,383 @@
+// Wireless bootstrap over a socketpair: the offer, the phone's status
+// messages in GATT-sized writes, heartbeats, re-offers after errors and
+// the bootstrap timing. One end is the dongle, the other plays the phone.
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "host_test.h"
+#include "wireless_bootstrap.h"
+
+#define GATT_WRITE_SIZE     20      // Default ATT MTU - 3
+#define PHONE_MESSAGES_MAX  16
+#define MS                  1000
+
+typedef struct {
+    int type;
+    int status;
+    char text[3][32];               // IP address, or SSID, key and BSSID
+    int32_t port;
+    int security_mode;
+} phone_message_t;
+
+static wireless_bootstrap_t g_bootstrap;
+static int g_sockets[2] = { -1, -1 };   // [0] dongle, [1] phone
+
+static proto_stream_t g_phone_stream;
+static uint8_t g_phone_rx[BOOTSTRAP_OFFER_MAX_SIZE];
+static phone_message_t g_phone_messages[PHONE_MESSAGES_MAX];
+static int g_phone_count;
+
+static const wireless_bootstrap_config_t g_config = {
+    "AndroidAuto-3F2A",
+    "k3y-for-the-hotspot",
+    "24:6f:28:aa:bb:cc",
+    "192.168.4.1",
+    5288,
+    PROTO_SECURITY_MODE_WPA2_PERSONAL,
+    PROTO_ACCESS_POINT_TYPE_DYNAMIC
+};
+
+// proto_send_fn_t for the dongle end
+static status_t socket_send(const uint8_t *data, size_t size, void *ctx) {
+    int fd = *(int*)ctx;
+    ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    return (sent == (ssize_t)size) ? STATUS_OK : STATUS_ERROR_CONNECTION;
+}
+
+static void copy_string(char *out, const proto_string_t *string) {
+    CHECK(string->size < 32);
+    memcpy(out, string->data, string->size);
+    out[string->size] = '\0';
+}
+
+// proto_stream_cb_t on the phone end
+static status_t phone_on_message(const uint8_t *data, size_t size, void *ctx) {
+    (void)ctx;
+    AndroidAutoMessage message;
+    CHECK_EQ(proto_decode(data, size, &message), STATUS_OK);
+    CHECK(g_phone_count < PHONE_MESSAGES_MAX);
+
+    phone_message_t *out = &g_phone_messages[g_phone_count++];
+    memset(out, 0, sizeof(*out));
+    out->type = message.type;
+    out->status = message.connection_status;
+    if (message.has_wifi_start_request) {
+        copy_string(out->text[0], &message.wifi_start_request.ip_address);
+        out->port = message.wifi_start_request.port;
+    }
+    if (message.has_wifi_info_response) {
+        copy_string(out->text[0], &message.wifi_info_response.ssid);
+        copy_string(out->text[1], &message.wifi_info_response.key);
+        copy_string(out->text[2], &message.wifi_info_response.bssid);
+        out->security_mode = message.wifi_info_response.security_mode;
+    }
+    return STATUS_OK;
+}
+
+// Everything the dongle has written so far; returns the message count
+static int phone_read(void) {
+    uint8_t buffer[512];
+    ssize_t n;
+    g_phone_count = 0;
+    while ((n = recv(g_sockets[1], buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        CHECK_EQ(proto_stream_feed(&g_phone_stream, buffer, (size_t)n), STATUS_OK);
+    }
+    CHECK(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    return g_phone_count;
+}
+
+static void phone_write(const uint8_t *data, size_t size) {
+    CHECK_EQ(send(g_sockets[1], data, size, MSG_NOSIGNAL), (ssize_t)size);
+}
+
+static void phone_send(const AndroidAutoMessage *message) {
+    uint8_t buffer[64];
+    size_t size;
+    CHECK_EQ(proto_stream_encode(message, buffer, sizeof(buffer), &size), STATUS_OK);
+    phone_write(buffer, size);
+}
+
+static void phone_send_status(int status) {
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_CONNECTION_STATUS);
+    proto_set_connection_status(&message, status);
+    phone_send(&message);
+}
+
+// The phone's writes arrive at the dongle GATT write by GATT write
+static status_t dongle_receive(int64_t now_us) {
+    uint8_t buffer[GATT_WRITE_SIZE];
+    ssize_t n;
+    status_t ret = STATUS_OK;
+    while ((n = recv(g_sockets[0], buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        status_t fed = wireless_bootstrap_receive(&g_bootstrap, buffer, (size_t)n, now_us);
+        if (fed != STATUS_OK) {
+            ret = fed;
+        }
+    }
+    return ret;
+}
+
+static void setup(void) {
+    if (g_sockets[0] >= 0) {
+        close(g_sockets[0]);
+        close(g_sockets[1]);
+    }
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, g_sockets), 0);
+    CHECK_EQ(proto_init(), STATUS_OK);
+    CHECK_EQ(wireless_bootstrap_init(&g_bootstrap, &g_config, socket_send, &g_sockets[0]), STATUS_OK);
+    CHECK_EQ(proto_stream_init(&g_phone_stream, g_phone_rx, sizeof(g_phone_rx), phone_on_message, NULL), STATUS_OK);
+}
+
+// Connected at 0, notifications enabled at 5 ms
+static void connect_and_offer(void) {
+    wireless_bootstrap_connected(&g_bootstrap, 0);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_CONNECTED);
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 5 * MS), STATUS_OK);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_OFFERED);
+}
+
+static void check_offer(void) {
+    CHECK_EQ(phone_read(), 2);
+    CHECK_EQ(g_phone_messages[0].type, PROTO_MESSAGE_TYPE_WIFI_START_REQUEST);
+    CHECK(strcmp(g_phone_messages[0].text[0], g_config.ip_address) == 0);
+    CHECK_EQ(g_phone_messages[0].port, g_config.port);
+    CHECK_EQ(g_phone_messages[1].type, PROTO_MESSAGE_TYPE_WIFI_INFO_RESPONSE);
+    CHECK(strcmp(g_phone_messages[1].text[0], g_config.ssid) == 0);
+    CHECK(strcmp(g_phone_messages[1].text[1], g_config.key) == 0);
+    CHECK(strcmp(g_phone_messages[1].text[2], g_config.bssid) == 0);
+    CHECK_EQ(g_phone_messages[1].security_mode, g_config.security_mode);
+}
+
+static void test_rejects_bad_arguments(void) {
+    CHECK_EQ(proto_init(), STATUS_OK);
+    CHECK_EQ(wireless_bootstrap_init(NULL, &g_config, socket_send, NULL), STATUS_ERROR_INIT);
+    CHECK_EQ(wireless_bootstrap_init(&g_bootstrap, NULL, socket_send, NULL), STATUS_ERROR_INIT);
+    CHECK_EQ(wireless_bootstrap_init(&g_bootstrap, &g_config, NULL, NULL), STATUS_ERROR_INIT);
+
+    // An SSID that cannot fit the offer
+    static char long_ssid[BOOTSTRAP_OFFER_MAX_SIZE];
+    memset(long_ssid, 'a', sizeof(long_ssid) - 1);
+    wireless_bootstrap_config_t config = g_config;
+    config.ssid = long_ssid;
+    CHECK(wireless_bootstrap_init(&g_bootstrap, &config, socket_send, NULL) != STATUS_OK);
+}
+
+static void test_offer_reaches_phone(void) {
+    setup();
+
+    // Nothing goes out until the phone can receive it
+    wireless_bootstrap_connected(&g_bootstrap, 0);
+    CHECK_EQ(phone_read(), 0);
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 5 * MS), STATUS_OK);
+    check_offer();
+
+    // Only once per connection
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 6 * MS), STATUS_ERROR_CONNECTION);
+
+    bootstrap_stats_t stats;
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.connections, 1);
+    CHECK_EQ(stats.offers, 1);
+    CHECK_EQ(stats.last_offer_us, 5 * MS);
+}
+
+static void test_phone_joins(void) {
+    setup();
+    connect_and_offer();
+    phone_read();
+
+    phone_send_status(PROTO_CONNECTION_STATUS_CONNECTING);
+    CHECK_EQ(dongle_receive(400 * MS), STATUS_OK);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_JOINING);
+
+    phone_send_status(PROTO_CONNECTION_STATUS_CONNECTED);
+    CHECK_EQ(dongle_receive(1200 * MS), STATUS_OK);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_JOINED);
+
+    bootstrap_stats_t stats;
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.status_messages, 2);
+    CHECK_EQ(stats.last_join_us, 1200 * MS);
+    CHECK_EQ(stats.errors, 0);
+}
+
+static void test_status_split_across_writes(void) {
+    setup();
+    connect_and_offer();
+    phone_read();
+
+    // A message reassembled from single-byte writes
+    uint8_t buffer[32];
+    size_t size;
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_CONNECTION_STATUS);
+    proto_set_connection_status(&message, PROTO_CONNECTION_STATUS_CONNECTED);
+    proto_set_timestamp(&message, 1700000000000ull);
+    CHECK_EQ(proto_stream_encode(&message, buffer, sizeof(buffer), &size), STATUS_OK);
+    for (size_t i = 0; i < size; i++) {
+        CHECK_EQ(wireless_bootstrap_receive(&g_bootstrap, buffer + i, 1, 900 * MS), STATUS_OK);
+        CHECK_EQ(g_bootstrap.state, (i + 1 < size) ? BOOTSTRAP_STATE_OFFERED : BOOTSTRAP_STATE_JOINED);
+    }
+}
+
+static void test_heartbeat_answered(void) {
+    setup();
+    connect_and_offer();
+    phone_read();
+
+    AndroidAutoMessage message;
+    proto_init_message(&message, PROTO_MESSAGE_TYPE_HEARTBEAT);
+    phone_send(&message);
+    phone_send(&message);
+    CHECK_EQ(dongle_receive(100 * MS), STATUS_OK);
+
+    // Framed replies through the same send callback
+    CHECK_EQ(phone_read(), 2);
+    CHECK_EQ(g_phone_messages[0].type, PROTO_MESSAGE_TYPE_HEARTBEAT);
+    CHECK_EQ(g_phone_messages[1].type, PROTO_MESSAGE_TYPE_HEARTBEAT);
+
+    bootstrap_stats_t stats;
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.heartbeats, 2);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_OFFERED);
+}
+
+static void test_error_reoffers_then_fails(void) {
+    setup();
+    connect_and_offer();
+    phone_read();
+
+    for (int i = 1; i <= BOOTSTRAP_MAX_RETRIES; i++) {
+        phone_send_status(PROTO_CONNECTION_STATUS_ERROR);
+        CHECK_EQ(dongle_receive(i * 1000 * MS), STATUS_OK);
+        CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_OFFERED);
+        CHECK_EQ(g_bootstrap.retries, i);
+        check_offer();
+    }
+
+    // One error too many: no further offer
+    phone_send_status(PROTO_CONNECTION_STATUS_ERROR);
+    CHECK_EQ(dongle_receive(9000 * MS), STATUS_OK);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_FAILED);
+    CHECK_EQ(phone_read(), 0);
+
+    bootstrap_stats_t stats;
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.offers, BOOTSTRAP_MAX_RETRIES + 1);
+    CHECK_EQ(stats.last_offer_us, BOOTSTRAP_MAX_RETRIES * 1000 * MS);
+
+    // A new connection starts the retries over
+    wireless_bootstrap_connected(&g_bootstrap, 10000 * MS);
+    CHECK_EQ(g_bootstrap.retries, 0);
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 10000 * MS), STATUS_OK);
+    check_offer();
+}
+
+static void test_malformed_input_counted(void) {
+    setup();
+    connect_and_offer();
+    phone_read();
+
+    // Framed but undecodable: skipped, the stream carries on
+    const uint8_t garbage[] = { 3, 0x1A, 0x7F, 0x01 };
+    phone_write(garbage, sizeof(garbage));
+    phone_send_status(PROTO_CONNECTION_STATUS_CONNECTING);
+    CHECK_EQ(dongle_receive(100 * MS), STATUS_OK);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_JOINING);
+
+    bootstrap_stats_t stats;
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.errors, 1);
+
+    // A length over BOOTSTRAP_MAX_MESSAGE_SIZE breaks the framing; the
+    // stream starts over and the next message gets through
+    const uint8_t oversized[] = { 0xFF, 0x01 };
+    CHECK(wireless_bootstrap_receive(&g_bootstrap, oversized, sizeof(oversized), 200 * MS) != STATUS_OK);
+    phone_send_status(PROTO_CONNECTION_STATUS_CONNECTED);
+    CHECK_EQ(dongle_receive(300 * MS), STATUS_OK);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_JOINED);
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.errors, 2);
+}
+
+static void test_disconnect_stops_input(void) {
+    setup();
+    connect_and_offer();
+    phone_read();
+    wireless_bootstrap_disconnected(&g_bootstrap);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_IDLE);
+
+    phone_send_status(PROTO_CONNECTION_STATUS_CONNECTED);
+    CHECK_EQ(dongle_receive(100 * MS), STATUS_ERROR_CONNECTION);
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 100 * MS), STATUS_ERROR_CONNECTION);
+}
+
+static void test_send_failure_counted(void) {
+    setup();
+    wireless_bootstrap_connected(&g_bootstrap, 0);
+
+    // The phone end is gone
+    close(g_sockets[1]);
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 5 * MS), STATUS_ERROR_CONNECTION);
+    CHECK_EQ(g_bootstrap.state, BOOTSTRAP_STATE_CONNECTED);
+
+    bootstrap_stats_t stats;
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.errors, 1);
+    CHECK_EQ(stats.offers, 0);
+
+    g_sockets[1] = socket(AF_UNIX, SOCK_STREAM, 0);  // Closed again by setup()
+}
+
+static void test_tcp_connect_timed_once(void) {
+    setup();
+
+    // No offer yet: not a bootstrap
+    wireless_bootstrap_connected(&g_bootstrap, 1000 * MS);
+    wireless_bootstrap_tcp_connected(&g_bootstrap, 1500 * MS);
+    bootstrap_stats_t stats;
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.completed, 0);
+
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 1005 * MS), STATUS_OK);
+
+    // Earlier than the Bluetooth connect: a connection from before
+    wireless_bootstrap_tcp_connected(&g_bootstrap, 900 * MS);
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.completed, 0);
+
+    // Bluetooth often drops first; the timing still counts
+    wireless_bootstrap_disconnected(&g_bootstrap);
+    wireless_bootstrap_tcp_connected(&g_bootstrap, 3500 * MS);
+    wireless_bootstrap_tcp_connected(&g_bootstrap, 4000 * MS);
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.completed, 1);
+    CHECK_EQ(stats.last_tcp_us, 2500 * MS);
+    CHECK_EQ(stats.max_tcp_us, 2500 * MS);
+
+    // A faster second bootstrap keeps the maximum
+    wireless_bootstrap_connected(&g_bootstrap, 10000 * MS);
+    CHECK_EQ(wireless_bootstrap_ready(&g_bootstrap, 10000 * MS), STATUS_OK);
+    wireless_bootstrap_tcp_connected(&g_bootstrap, 11000 * MS);
+    wireless_bootstrap_get_stats(&g_bootstrap, &stats);
+    CHECK_EQ(stats.completed, 2);
+    CHECK_EQ(stats.last_tcp_us, 1000 * MS);
+    CHECK_EQ(stats.max_tcp_us, 2500 * MS);
+}
+
+int main(void) {
+    RUN_TEST(test_rejects_bad_arguments);
+    RUN_TEST(test_offer_reaches_phone);
+    RUN_TEST(test_phone_joins);
+    RUN_TEST(test_status_split_across_writes);
+    RUN_TEST(test_heartbeat_answered);
+    RUN_TEST(test_error_reoffers_then_fails);
+    RUN_TEST(test_malformed_input_counted);
+    RUN_TEST(test_disconnect_stops_input);
+    RUN_TEST(test_send_failure_counted);
+    RUN_TEST(test_tcp_connect_timed_once);
+    return 0;
+}
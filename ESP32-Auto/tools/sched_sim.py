@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Two-core scheduling simulation for the task placement plan.
+
+Models the ESP32-S3 data path as fixed-priority preemptive tasks on two
+cores and compares forwarding response times with every task floating
+against the pinned plan in main/task_plan.cpp. Costs and rates are rough
+figures for a 20 Mbit/s video stream; the point is the difference between
+placements, not absolute numbers.
+
+    python3 tools/sched_sim.py [--seconds 2] [--seed 1]
+"""
+
+import argparse
+import random
+
+TICK_US = 5
+MIGRATION_US = 10   # Cache refill when a task moves to the other core
+
+# name, priority, period us, period jitter us, cost us, cost jitter us,
+# core in the plan (None = floats)
+TASKS = [
+    ("wifi",         23,   600,  300, 120,  60, 0),
+    ("bt_ctrl",      22, 30000, 5000, 250, 100, 0),
+    ("lwip",         18,   580,  200,  45,  15, 0),
+    ("usb_forward",  13,  5000, 4000,  60,  20, 1),
+    ("tcp_forward",  12,  1600,  800, 280,  60, None),
+    ("conn_manager",  6, 1000000,  0, 200,  50, None),
+    ("telemetry",     1, 1000000,  0, 400, 100, None),
+]
+
+# Pinned by ESP-IDF defaults whatever the plan says
+SYSTEM_PINNED = {"wifi": 0, "bt_ctrl": 0}
+
+MEASURED = ("usb_forward", "tcp_forward")
+
+
+class Task:
+    def __init__(self, spec, pinned, rng, overrides):
+        (self.name, self.priority, self.period, self.jitter,
+         self.cost, self.cost_jitter, core) = spec
+        core = overrides.get(self.name, core)
+        if self.name in SYSTEM_PINNED:
+            self.core = SYSTEM_PINNED[self.name]
+        else:
+            self.core = core if pinned else None
+        self.rng = rng
+        self.next_release = rng.randrange(0, self.period)
+        self.queue = []         # Release times of pending jobs
+        self.remaining = 0
+        self.last_core = None
+        self.responses = []
+
+    def release(self, now):
+        while now >= self.next_release:
+            self.queue.append(self.next_release)
+            jitter = self.rng.randint(-self.jitter, self.jitter) if self.jitter else 0
+            self.next_release += max(TICK_US, self.period + jitter)
+        if self.remaining == 0 and self.queue:
+            spread = self.rng.randint(-self.cost_jitter, self.cost_jitter) if self.cost_jitter else 0
+            self.remaining = max(TICK_US, self.cost + spread)
+
+    def ready(self):
+        return self.remaining > 0
+
+
+def simulate(pinned, seconds, seed, overrides):
+    rng = random.Random(seed)
+    tasks = [Task(spec, pinned, rng, overrides) for spec in TASKS]
+    end = int(seconds * 1_000_000)
+    busy = [0, 0]
+
+    for now in range(0, end, TICK_US):
+        for task in tasks:
+            task.release(now)
+
+        # Highest priority first; the earlier release wins a tie
+        ready = sorted((t for t in tasks if t.ready()),
+                       key=lambda t: (-t.priority, t.queue[0]))
+        running = [None, None]
+        for task in ready:
+            cores = [task.core] if task.core is not None else (
+                [task.last_core, 1 - task.last_core] if task.last_core is not None else [0, 1])
+            for core in cores:
+                if running[core] is None:
+                    running[core] = task
+                    break
+
+        for core, task in enumerate(running):
+            if task is None:
+                continue
+            busy[core] += TICK_US
+            if task.core is None and task.last_core is not None and task.last_core != core:
+                task.remaining += MIGRATION_US
+            task.last_core = core
+            task.remaining -= TICK_US
+            if task.remaining <= 0:
+                task.remaining = 0
+                task.responses.append(now + TICK_US - task.queue.pop(0))
+                task.release(now)
+
+    return tasks, [b * 100 // end for b in busy]
+
+
+def percentile(values, pct):
+    if not values:
+        return 0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, (len(ordered) * pct + 99) // 100 - 1)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--seconds", type=float, default=2.0)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--place", action="append", default=[], metavar="TASK=CORE",
+                        help="override a planned core, e.g. --place tcp_forward=0")
+    args = parser.parse_args()
+
+    overrides = {}
+    for item in args.place:
+        name, core = item.split("=")
+        overrides[name] = None if core == "none" else int(core)
+
+    for pinned in (False, True):
+        tasks, load = simulate(pinned, args.seconds, args.seed, overrides)
+        print(f"{'pinned' if pinned else 'floating'}: core0 {load[0]}% core1 {load[1]}%")
+        for task in tasks:
+            if task.name in MEASURED:
+                r = task.responses
+                print(f"  {task.name:12} jobs {len(r):6}  p50 {percentile(r, 50):5} us"
+                      f"  p99 {percentile(r, 99):5} us  max {max(r, default=0):5} us")
+
+
+if __name__ == "__main__":
+    main()
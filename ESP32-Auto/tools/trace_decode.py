@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Decoder for the tokenised data-path trace (main/trace.h).
+
+Records carry only a hash of their format string. This script rebuilds
+the hash -> format table from every TRACE("...") call in the sources and
+turns the lines printed by trace_dump() in a monitor log back into text.
+Times are per core, in milliseconds before that core's newest record;
+the cycle counters of the two cores are not synchronised.
+
+    python3 tools/trace_decode.py monitor.log
+    idf.py monitor | tee monitor.log        # then trigger a dump
+    python3 tools/trace_decode.py --table   # list ids, check collisions
+"""
+
+import argparse
+import os
+import re
+import sys
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+
+TRACE_CALL = re.compile(r'\bTRACE\(\s*"((?:[^"\\]|\\.)*)"')
+BEGIN_LINE = re.compile(r'TRACE: begin core (\d+) records (\d+) mhz (\d+)')
+RECORD_LINE = re.compile(r'TRACE: r (\d+) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8}) ([0-9a-f]{8})')
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diuxXc%])')
+
+ESCAPES = {'n': '\n', 't': '\t', '"': '"', '\\': '\\'}
+
+
+def fnv1a(text):
+    value = FNV_OFFSET
+    for byte in text.encode('utf-8'):
+        value = ((value ^ byte) * FNV_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def unescape(literal):
+    return re.sub(r'\\(.)', lambda m: ESCAPES.get(m.group(1), m.group(1)), literal)
+
+
+def build_table(source_dir):
+    table = {}
+    for name in sorted(os.listdir(source_dir)):
+        if not name.endswith(('.cpp', '.h')):
+            continue
+        with open(os.path.join(source_dir, name), encoding='utf-8') as source:
+            for match in TRACE_CALL.finditer(source.read()):
+                fmt = unescape(match.group(1))
+                token = fnv1a(fmt)
+                if token in table and table[token][0] != fmt:
+                    print(f'warning: {name}: "{fmt}" collides with "{table[token][0]}"', file=sys.stderr)
+                table.setdefault(token, (fmt, name))
+    return table
+
+
+def to_python_format(fmt):
+    """C printf conversions to Python %-formatting; returns (format, signed flags)."""
+    signed = []
+
+    def convert(match):
+        flags, conv = match.groups()
+        if conv == '%':
+            return '%%'
+        signed.append(conv in 'di')
+        return '%' + flags + ('d' if conv in 'diu' else conv)
+
+    return CONVERSION.sub(convert, fmt), signed
+
+
+def render(table, token, args):
+    if token not in table:
+        return f'<unknown {token:08x}> {args[0]:#x} {args[1]:#x}'
+
+    fmt, signed = to_python_format(table[token][0])
+    values = []
+    for i, is_signed in enumerate(signed[:2]):
+        value = args[i]
+        values.append(value - (1 << 32) if is_signed and value >= (1 << 31) else value)
+    try:
+        return fmt % tuple(values)
+    except (TypeError, ValueError):
+        return f'{table[token][0]} [{args[0]:#x} {args[1]:#x}]'
+
+
+def decode(lines, table):
+    cores = {}
+    current = None
+    for line in lines:
+        begin = BEGIN_LINE.search(line)
+        if begin:
+            current = int(begin.group(1))
+            cores[current] = {'mhz': int(begin.group(3)), 'records': []}
+            continue
+        record = RECORD_LINE.search(line)
+        if record and int(record.group(1)) in cores:
+            core = cores[int(record.group(1))]
+            token, cycles, a, b = (int(group, 16) for group in record.groups()[1:])
+            core['records'].append((token, cycles, (a, b)))
+
+    for core_id in sorted(cores):
+        core = cores[core_id]
+        records = core['records']
+        if not records:
+            continue
+
+        # Unwrap the 32-bit counter; consecutive records are well under a wrap apart
+        elapsed = [0]
+        for previous, record in zip(records, records[1:]):
+            elapsed.append(elapsed[-1] + ((record[1] - previous[1]) & 0xFFFFFFFF))
+
+        cycles_per_ms = core['mhz'] * 1000
+        print(f'core {core_id}: {len(records)} records')
+        for (token, _, args), cycles in zip(records, elapsed):
+            print(f'  {(cycles - elapsed[-1]) / cycles_per_ms:10.3f} ms  {render(table, token, args)}')
+
+
+def main():
+    default_src = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'main')
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('log', nargs='?', help='monitor log with a trace_dump() (default: stdin)')
+    parser.add_argument('--src', default=default_src, help='source directory to scan for TRACE() calls')
+    parser.add_argument('--table', action='store_true', help='print the id table and exit')
+    args = parser.parse_args()
+
+    table = build_table(args.src)
+    if args.table:
+        for token, (fmt, name) in sorted(table.items(), key=lambda item: item[1]):
+            print(f'{token:08x}  {name:24s} {fmt}')
+        return
+
+    with (open(args.log, encoding='utf-8', errors='replace') if args.log else sys.stdin) as log:
+        decode(log, table)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,120 @@
+// Replays proxy tuner windows from a monitor log through main/proxy_tuner.cpp
+//
+// The proxy logs its tuner limits at the start of each connection and one
+// "Tune" line per stats window. This runs the same windows through the
+// tuner on the host and compares every decision with the recorded one, so
+// a change to the tuning logic can be checked against real sessions. With
+// an override the log becomes a what-if: decisions are printed, not checked.
+//
+//     g++ -std=c++17 -I main tools/tuner_replay.cpp main/proxy_tuner.cpp -o tuner_replay
+//     ./tuner_replay monitor.log
+//     ./tuner_replay --target 10000 --chunk-max 4096 < monitor.log
+//
+// Exits 1 when a replayed decision differs from the log. The host tests
+// replay test/traces/tuner_session.log, so a tuning change that alters a
+// decision there has to update the trace with it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "proxy_tuner.h"
+
+typedef struct {
+    long target_us;             // -1: as logged
+    long chunk_max;
+} replay_overrides_t;
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--target us] [--chunk-max bytes] [monitor.log]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    replay_overrides_t overrides = { -1, -1 };
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--target") == 0 && i + 1 < argc) {
+            overrides.target_us = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--chunk-max") == 0 && i + 1 < argc) {
+            overrides.chunk_max = strtol(argv[++i], NULL, 0);
+        } else if (argv[i][0] == '-' || path != NULL) {
+            usage(argv[0]);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE *log = (path != NULL) ? fopen(path, "r") : stdin;
+    if (log == NULL) {
+        perror(path);
+        return 2;
+    }
+
+    bool checking = overrides.target_us < 0 && overrides.chunk_max < 0;
+    proxy_tuner_limits_t limits;
+    proxy_tuner_state_t state;
+    bool started = false;
+    unsigned windows = 0, mismatches = 0, connection = 0;
+    char line[512];
+
+    while (fgets(line, sizeof(line), log) != NULL) {
+        const char *text;
+        unsigned long chunk_min, chunk_max, poll_min, poll_max, target, chunk, poll;
+
+        if ((text = strstr(line, "Tuner limits: ")) != NULL &&
+            sscanf(text, "Tuner limits: chunk %lu..%lu poll %lu..%lu ms target %lu us, start chunk %lu poll %lu",
+                   &chunk_min, &chunk_max, &poll_min, &poll_max, &target, &chunk, &poll) == 7) {
+            limits.chunk_min = chunk_min;
+            limits.chunk_max = (overrides.chunk_max >= 0) ? (uint32_t)overrides.chunk_max : chunk_max;
+            limits.poll_min_ms = poll_min;
+            limits.poll_max_ms = poll_max;
+            limits.latency_target_us = (overrides.target_us >= 0) ? (uint32_t)overrides.target_us : target;
+            proxy_tuner_init(&state, &limits, chunk, poll);
+            started = true;
+            printf("connection %u: chunk %lu..%lu poll %lu..%lu ms target %lu us\n", ++connection,
+                   (unsigned long)limits.chunk_min, (unsigned long)limits.chunk_max,
+                   poll_min, poll_max, (unsigned long)limits.latency_target_us);
+            continue;
+        }
+
+        char action[16];
+        unsigned long window, reads, full, bytes, p99;
+        if (!started || (text = strstr(line, "Tune ")) == NULL ||
+            sscanf(text, "Tune %15[a-z]: window %lu reads %lu full %lu bytes %lu p99 %lu -> chunk %lu poll %lu",
+                   action, &window, &reads, &full, &bytes, &p99, &chunk, &poll) != 8) {
+            continue;
+        }
+
+        proxy_tuner_metrics_t metrics = { (uint32_t)window, (uint32_t)reads, (uint32_t)full,
+                                          (uint32_t)bytes, (uint32_t)p99 };
+        const char *replayed = proxy_tuner_action_name(proxy_tuner_step(&state, &limits, &metrics));
+        bool differs = strcmp(replayed, action) != 0 || state.chunk_size != chunk || state.poll_interval_ms != poll;
+
+        windows++;
+        if (checking && differs) {
+            mismatches++;
+        }
+        printf("  %6lu reads %3lu%% full %8lu kbit/s p99 %6lu us  %-6s chunk %5lu poll %2lu%s\n",
+               reads, reads ? full * 100 / reads : 0, window ? bytes * 8 / window : 0, p99, replayed,
+               (unsigned long)state.chunk_size, (unsigned long)state.poll_interval_ms,
+               (checking && differs) ? "  <- logged differently" : "");
+
+        // Carry on from what the device did, so one difference does not cascade
+        if (checking) {
+            state.chunk_size = chunk;
+            state.poll_interval_ms = poll;
+        }
+    }
+
+    if (log != stdin) {
+        fclose(log);
+    }
+
+    printf("%u windows", windows);
+    if (checking) {
+        printf(", %u differ from the log", mismatches);
+    }
+    printf("\n");
+    return mismatches ? 1 : 0;
+}